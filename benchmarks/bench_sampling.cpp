@@ -0,0 +1,185 @@
+// Per-token sampling overhead with and without a grammar constraint.
+//
+//   bench_sampling <model.gguf> [tokens=2000] [valid_rate=0.9]
+//
+// Only the vocabulary is loaded. Logits are synthetic: with probability
+// valid_rate the top logit is a token the grammar accepts (a model that mostly
+// follows the format), otherwise it is random. Three modes are timed:
+//   unconstrained   greedy chain only
+//   grammar         Core::Sampler (check the greedy pick, mask vocab only on rejection)
+//   grammar-full    grammar applied to the full vocabulary on every token
+#include "llama.h"
+#include "Sampler.h"
+#include "GrammarCache.h"
+#include "JsonSchemaGrammar.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+
+static const char* TOOL_CALL_SCHEMA = R"({
+    "type": "object",
+    "properties": {
+        "name": {"enum": ["get_weather", "search", "send_email"]},
+        "arguments": {
+            "type": "object",
+            "properties": {
+                "query": {"type": "string", "maxLength": 64},
+                "limit": {"type": "integer"},
+                "urgent": {"type": "boolean"}
+            },
+            "required": ["query"]
+        }
+    },
+    "required": ["name", "arguments"]
+})";
+
+static double elapsedNs(clock_type::time_point t0) {
+    return std::chrono::duration<double, std::nano>(clock_type::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <model.gguf> [tokens=2000] [valid_rate=0.9]\n", argv[0]);
+        return 1;
+    }
+    const int n_tokens = argc > 2 ? std::atoi(argv[2]) : 2000;
+    const double valid_rate = argc > 3 ? std::atof(argv[3]) : 0.9;
+
+    llama_log_set([](enum ggml_log_level, const char*, void*) {}, nullptr);
+    llama_backend_init();
+
+    auto mparams = llama_model_default_params();
+    mparams.vocab_only = true;
+    llama_model* model = llama_model_load_from_file(argv[1], mparams);
+    if (!model) {
+        fprintf(stderr, "Failed to load %s\n", argv[1]);
+        return 1;
+    }
+    const llama_vocab* vocab = llama_model_get_vocab(model);
+    const int n_vocab = llama_vocab_n_tokens(vocab);
+
+    Core::GrammarCache cache;
+    std::string grammar = cache.grammarForSchema(nlohmann::json::parse(TOOL_CALL_SCHEMA));
+
+    // Compile (miss) vs clone from the cache (hit)
+    auto t0 = clock_type::now();
+    llama_sampler_free(cache.acquire(vocab, grammar));
+    double compile_us = elapsedNs(t0) / 1000.0;
+    t0 = clock_type::now();
+    llama_sampler_free(cache.acquire(vocab, grammar));
+    double clone_us = elapsedNs(t0) / 1000.0;
+
+    std::mt19937 rng(42);
+    std::normal_distribution<float> noise(0.0f, 2.0f);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+
+    // Shadow grammar used (untimed) to find a valid token to boost
+    std::vector<llama_token_data> scratch(n_vocab);
+    auto validToken = [&](llama_sampler* shadow) {
+        for (int i = 0; i < n_vocab; i++) scratch[i] = {i, 0.0f, 0.0f};
+        llama_token_data_array arr = {scratch.data(), scratch.size(), -1, false};
+        llama_sampler_apply(shadow, &arr);
+        std::vector<llama_token> valid;
+        for (const auto& td : scratch) {
+            if (!std::isinf(td.logit)) valid.push_back(td.id);
+        }
+        return valid.empty() ? llama_token(0) : valid[rng() % valid.size()];
+    };
+
+    // Pre-generate the logit rows so every mode sees identical inputs
+    std::vector<std::vector<float>> rows(n_tokens, std::vector<float>(n_vocab));
+    {
+        llama_sampler* shadow = cache.acquire(vocab, grammar);
+        for (int t = 0; t < n_tokens; t++) {
+            for (auto& v : rows[t]) v = noise(rng);
+            llama_token target = coin(rng) < valid_rate ? validToken(shadow) : llama_token(rng() % n_vocab);
+            rows[t][target] += 50.0f;
+
+            // Advance the shadow grammar with what a grammar-constrained sampler would pick
+            Core::Sampler pick(vocab, llama_sampler_clone(shadow));
+            llama_token chosen = pick.sample(rows[t].data());
+            if (llama_vocab_is_eog(vocab, chosen)) {
+                llama_sampler_free(shadow);
+                shadow = cache.acquire(vocab, grammar);
+            } else {
+                llama_sampler_accept(shadow, chosen);
+            }
+        }
+        llama_sampler_free(shadow);
+    }
+
+    // unconstrained
+    double base_ns = 0.0;
+    {
+        Core::Sampler sampler(vocab);
+        for (int t = 0; t < n_tokens; t++) {
+            auto start = clock_type::now();
+            llama_token tok = sampler.sample(rows[t].data());
+            sampler.accept(tok);
+            base_ns += elapsedNs(start);
+        }
+    }
+
+    // grammar (fast path)
+    double fast_ns = 0.0;
+    uint64_t resamples = 0;
+    {
+        auto sampler = std::make_unique<Core::Sampler>(vocab, cache.acquire(vocab, grammar));
+        for (int t = 0; t < n_tokens; t++) {
+            auto start = clock_type::now();
+            llama_token tok = sampler->sample(rows[t].data());
+            if (llama_vocab_is_eog(vocab, tok)) {
+                resamples += sampler->grammarResamples();
+                sampler = std::make_unique<Core::Sampler>(vocab, cache.acquire(vocab, grammar));
+            } else {
+                sampler->accept(tok);
+            }
+            fast_ns += elapsedNs(start);
+        }
+        resamples += sampler->grammarResamples();
+    }
+
+    // grammar-full (grammar in the chain, applied to every candidate)
+    double full_ns = 0.0;
+    {
+        std::vector<llama_token_data> cur(n_vocab);
+        llama_sampler* greedy = llama_sampler_init_greedy();
+        llama_sampler* gram = cache.acquire(vocab, grammar);
+        for (int t = 0; t < n_tokens; t++) {
+            auto start = clock_type::now();
+            for (int i = 0; i < n_vocab; i++) cur[i] = {i, rows[t][i], 0.0f};
+            llama_token_data_array arr = {cur.data(), cur.size(), -1, false};
+            llama_sampler_apply(gram, &arr);
+            llama_sampler_apply(greedy, &arr);
+            llama_token tok = arr.data[arr.selected].id;
+            if (llama_vocab_is_eog(vocab, tok)) {
+                llama_sampler_free(gram);
+                gram = cache.acquire(vocab, grammar);
+            } else {
+                llama_sampler_accept(gram, tok);
+            }
+            full_ns += elapsedNs(start);
+        }
+        llama_sampler_free(gram);
+        llama_sampler_free(greedy);
+    }
+
+    printf("vocab=%d tokens=%d valid_rate=%.2f\n", n_vocab, n_tokens, valid_rate);
+    printf("grammar compile: %.1f us, cached clone: %.1f us\n", compile_us, clone_us);
+    printf("%-16s %12s %12s\n", "mode", "ns/token", "overhead");
+    printf("%-16s %12.0f %12s\n", "unconstrained", base_ns / n_tokens, "-");
+    printf("%-16s %12.0f %11.2fx\n", "grammar", fast_ns / n_tokens, fast_ns / base_ns);
+    printf("%-16s %12.0f %11.2fx\n", "grammar-full", full_ns / n_tokens, full_ns / base_ns);
+    printf("grammar fast-path rejections: %llu (%.1f%%)\n",
+           (unsigned long long)resamples, 100.0 * resamples / n_tokens);
+
+    llama_model_free(model);
+    llama_backend_free();
+    return 0;
+}
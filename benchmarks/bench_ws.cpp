@@ -0,0 +1,479 @@
+// End-to-end load generator: N WebSocket connections driving infer requests.
+//
+//   bench_ws --client-id <id> --api-key <key> [--host 127.0.0.1] [--port 3000]
+//            [--connections 4] [--duration 30] [--mode closed|open] [--rate 2]
+//            [--poisson] [--think-ms 0] [--prompt "..."] [--max-tokens 64]
+//            [--same-prompt] [--out result.json]
+//
+// Each connection runs on its own thread with a blocking socket: it upgrades
+// with the x-client-id / x-api-key headers, creates one session and then sends
+// infer requests until the duration is over.
+//   closed   every connection sends its next request as soon as the previous one
+//            ends (plus --think-ms): measures capacity at a fixed concurrency
+//   open     requests are scheduled at --rate per second in total (evenly spaced,
+//            or exponential gaps with --poisson) and picked up by idle connections.
+//            Latency is measured from the scheduled time, so a saturated server
+//            shows up as growing latency instead of a silently lower send rate.
+// Prompts get a per-request suffix so the response cache is not measured
+// (--same-prompt keeps them identical). The client id must allow --connections
+// sessions.
+//
+// The report (stdout, and --out) is JSON: request/token throughput plus
+// TTFT / inter-token / total latency percentiles, for diffing against a baseline.
+#include "LatencyHistogram.h"
+#include <nlohmann/json.hpp>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+using json = nlohmann::json;
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 3000;
+    std::string clientId;
+    std::string apiKey;
+    int connections = 4;
+    double duration_s = 30.0;
+    bool open = false;
+    double rate = 2.0;  // Requests per second across all connections (open loop)
+    bool poisson = false;
+    int think_ms = 0;
+    std::string prompt = "Write a short paragraph about the history of computing.";
+    int max_tokens = 64;
+    bool samePrompt = false;
+    std::string out;
+};
+
+static std::string base64(const unsigned char* data, size_t len) {
+    static const char* table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t n = data[i] << 16;
+        if (i + 1 < len) n |= data[i + 1] << 8;
+        if (i + 2 < len) n |= data[i + 2];
+        out += table[(n >> 18) & 63];
+        out += table[(n >> 12) & 63];
+        out += i + 1 < len ? table[(n >> 6) & 63] : '=';
+        out += i + 2 < len ? table[n & 63] : '=';
+    }
+    return out;
+}
+
+/**
+ * Minimal blocking WebSocket client (RFC 6455): text frames only, no extensions.
+ * Pings are answered transparently; fragmented messages are reassembled.
+ */
+class WsClient {
+public:
+    ~WsClient() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    bool connect(const Options& opts, std::string& error) {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addrs = nullptr;
+        if (getaddrinfo(opts.host.c_str(), std::to_string(opts.port).c_str(), &hints, &addrs) != 0) {
+            error = "cannot resolve " + opts.host;
+            return false;
+        }
+        for (addrinfo* a = addrs; a && fd_ < 0; a = a->ai_next) {
+            fd_ = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd_ >= 0 && ::connect(fd_, a->ai_addr, a->ai_addrlen) != 0) {
+                ::close(fd_);
+                fd_ = -1;
+            }
+        }
+        freeaddrinfo(addrs);
+        if (fd_ < 0) {
+            error = "cannot connect to " + opts.host + ":" + std::to_string(opts.port);
+            return false;
+        }
+
+        int one = 1;
+        setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        timeval timeout{120, 0};  // A stuck server fails the connection instead of hanging the run
+        setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        unsigned char nonce[16];
+        std::random_device rd;
+        for (auto& b : nonce) b = static_cast<unsigned char>(rd());
+        std::string request =
+            "GET / HTTP/1.1\r\n"
+            "Host: " + opts.host + ":" + std::to_string(opts.port) + "\r\n"
+            "Upgrade: websocket\r\n"
+            "Connection: Upgrade\r\n"
+            "Sec-WebSocket-Key: " + base64(nonce, sizeof(nonce)) + "\r\n"
+            "Sec-WebSocket-Version: 13\r\n"
+            "x-client-id: " + opts.clientId + "\r\n"
+            "x-api-key: " + opts.apiKey + "\r\n\r\n";
+        if (!writeAll(request.data(), request.size())) {
+            error = "handshake write failed";
+            return false;
+        }
+
+        // Response headers; anything after them already belongs to the first frames
+        size_t end;
+        while ((end = buffer_.find("\r\n\r\n")) == std::string::npos) {
+            if (!fill()) {
+                error = "handshake read failed";
+                return false;
+            }
+        }
+        std::string status = buffer_.substr(0, buffer_.find("\r\n"));
+        if (status.find(" 101") == std::string::npos) {
+            error = "upgrade refused: " + status;
+            return false;
+        }
+        buffer_.erase(0, end + 4);
+        return true;
+    }
+
+    bool sendText(const std::string& payload) {
+        return sendFrame(0x1, payload);
+    }
+
+    // Next complete text message; false on close, timeout or error
+    bool recvText(std::string& message) {
+        message.clear();
+        while (true) {
+            unsigned char header[2];
+            if (!readExact(header, 2)) return false;
+            bool fin = header[0] & 0x80;
+            int opcode = header[0] & 0x0f;
+            uint64_t len = header[1] & 0x7f;
+            if (len == 126) {
+                unsigned char ext[2];
+                if (!readExact(ext, 2)) return false;
+                len = (ext[0] << 8) | ext[1];
+            } else if (len == 127) {
+                unsigned char ext[8];
+                if (!readExact(ext, 8)) return false;
+                len = 0;
+                for (int i = 0; i < 8; i++) len = (len << 8) | ext[i];
+            }
+            // Server frames are never masked
+            std::string payload(len, '\0');
+            if (len > 0 && !readExact(&payload[0], len)) return false;
+
+            if (opcode == 0x8) {
+                return false;  // Close
+            }
+            if (opcode == 0x9) {
+                sendFrame(0xA, payload);
+                continue;
+            }
+            if (opcode == 0x1 || opcode == 0x0) {
+                message += payload;
+                if (fin) return true;
+            }
+        }
+    }
+
+private:
+    int fd_ = -1;
+    std::string buffer_;  // Received but not yet consumed
+    std::mt19937 maskRng_{std::random_device{}()};
+
+    bool writeAll(const char* data, size_t len) {
+        while (len > 0) {
+            ssize_t n = ::send(fd_, data, len, MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            data += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    bool fill() {
+        char chunk[16384];
+        ssize_t n = ::recv(fd_, chunk, sizeof(chunk), 0);
+        if (n <= 0) return false;
+        buffer_.append(chunk, n);
+        return true;
+    }
+
+    bool readExact(void* out, size_t len) {
+        while (buffer_.size() < len) {
+            if (!fill()) return false;
+        }
+        memcpy(out, buffer_.data(), len);
+        buffer_.erase(0, len);
+        return true;
+    }
+
+    // Client frames must be masked
+    bool sendFrame(int opcode, const std::string& payload) {
+        std::string frame;
+        frame += static_cast<char>(0x80 | opcode);
+        size_t len = payload.size();
+        if (len < 126) {
+            frame += static_cast<char>(0x80 | len);
+        } else if (len <= 0xffff) {
+            frame += static_cast<char>(0x80 | 126);
+            frame += static_cast<char>((len >> 8) & 0xff);
+            frame += static_cast<char>(len & 0xff);
+        } else {
+            frame += static_cast<char>(0x80 | 127);
+            for (int i = 7; i >= 0; i--) frame += static_cast<char>((static_cast<uint64_t>(len) >> (8 * i)) & 0xff);
+        }
+        uint32_t key = maskRng_();
+        unsigned char mask[4] = {(unsigned char)(key >> 24), (unsigned char)(key >> 16),
+                                 (unsigned char)(key >> 8), (unsigned char)key};
+        frame.append(reinterpret_cast<char*>(mask), 4);
+        for (size_t i = 0; i < len; i++) {
+            frame += static_cast<char>(payload[i] ^ mask[i % 4]);
+        }
+        return writeAll(frame.data(), frame.size());
+    }
+};
+
+// Shared across connection threads (histograms and counters are lock-free)
+struct Results {
+    Core::LatencyHistogram ttft;
+    Core::LatencyHistogram interToken;
+    Core::LatencyHistogram total;
+    Core::LatencyHistogram sendDelay;  // Open loop: scheduled -> actually sent
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> tokens{0};
+    std::atomic<int> connected{0};
+};
+
+static uint64_t elapsedUs(clock_type::time_point from, clock_type::time_point to) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
+
+// Arrival offsets (from the start of the run) of every open-loop request
+static std::vector<clock_type::duration> arrivals(const Options& opts) {
+    std::vector<clock_type::duration> out;
+    std::mt19937_64 rng(42);
+    std::exponential_distribution<double> gap(opts.rate);
+    double t = 0.0;
+    while (true) {
+        t += opts.poisson ? gap(rng) : 1.0 / opts.rate;
+        if (t >= opts.duration_s) break;
+        out.push_back(std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(t)));
+    }
+    return out;
+}
+
+// Wait for the first frame with the given op (other ops are skipped)
+static bool waitFor(WsClient& ws, const char* op, json& frame) {
+    std::string text;
+    while (ws.recvText(text)) {
+        frame = json::parse(text, nullptr, false);
+        if (frame.is_discarded()) continue;
+        if (frame.value("op", "") == op) return true;
+        if (frame.value("op", "") == "error") return false;
+    }
+    return false;
+}
+
+static void runConnection(const Options& opts, int index, Results& results,
+                          clock_type::time_point start, const std::vector<clock_type::duration>& schedule,
+                          std::atomic<size_t>& nextArrival, std::atomic<uint64_t>& requestCounter) {
+    WsClient ws;
+    std::string error;
+    json frame;
+    if (!ws.connect(opts, error)) {
+        fprintf(stderr, "connection %d: %s\n", index, error.c_str());
+        return;
+    }
+    if (!waitFor(ws, "auth_success", frame) || !ws.sendText(json{{"op", "create_session"}}.dump()) ||
+        !waitFor(ws, "session_created", frame)) {
+        fprintf(stderr, "connection %d: could not create a session%s%s\n", index,
+                frame.contains("error") ? ": " : "", frame.value("error", "").c_str());
+        return;
+    }
+    std::string sessionId = frame["session_id"];
+    results.connected++;
+    std::this_thread::sleep_until(start);
+
+    const auto end = start + std::chrono::duration_cast<clock_type::duration>(
+                                 std::chrono::duration<double>(opts.duration_s));
+
+    while (true) {
+        // Pick the reference time latency is measured from
+        clock_type::time_point issued;
+        if (opts.open) {
+            size_t k = nextArrival.fetch_add(1);
+            if (k >= schedule.size()) break;
+            issued = start + schedule[k];
+            std::this_thread::sleep_until(issued);
+        } else {
+            issued = clock_type::now();
+            if (issued >= end) break;
+        }
+
+        std::string prompt = opts.prompt;
+        if (!opts.samePrompt) {
+            prompt += " (request " + std::to_string(requestCounter.fetch_add(1)) + ")";
+        }
+        json request = {
+            {"op", "infer"},
+            {"session_id", sessionId},
+            {"prompt", prompt},
+            {"params", {{"max_tokens", opts.max_tokens}}}
+        };
+        auto sent = clock_type::now();
+        if (opts.open) results.sendDelay.record(elapsedUs(issued, sent));
+        if (!ws.sendText(request.dump())) {
+            results.errors++;
+            break;
+        }
+
+        // Stream until END (or ERROR) for this session
+        clock_type::time_point lastToken{};
+        bool ok = false;
+        std::string text;
+        while (ws.recvText(text)) {
+            auto now = clock_type::now();
+            frame = json::parse(text, nullptr, false);
+            if (frame.is_discarded()) continue;
+            std::string op = frame.value("op", "");
+            if (op == "token") {
+                if (lastToken == clock_type::time_point{}) {
+                    results.ttft.record(elapsedUs(issued, now));
+                } else {
+                    results.interToken.record(elapsedUs(lastToken, now));
+                }
+                lastToken = now;
+                results.tokens++;
+            } else if (op == "end") {
+                results.total.record(elapsedUs(issued, now));
+                ok = true;
+                break;
+            } else if (op == "error") {
+                fprintf(stderr, "connection %d: %s\n", index, frame.value("error", "").c_str());
+                break;
+            }
+        }
+        if (ok) {
+            results.completed++;
+        } else {
+            results.errors++;
+            if (frame.is_discarded() || frame.value("op", "") != "error") break;  // Connection lost
+        }
+
+        if (!opts.open && opts.think_ms > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(opts.think_ms));
+        }
+    }
+}
+
+static json percentiles(const Core::LatencyHistogram& histogram) {
+    Core::HistogramSnapshot s = histogram.snapshot();
+    return {
+        {"count", s.total},
+        {"mean", s.mean() / 1000.0},
+        {"p50", s.percentile(0.50) / 1000.0},
+        {"p90", s.percentile(0.90) / 1000.0},
+        {"p99", s.percentile(0.99) / 1000.0},
+        {"max", s.max / 1000.0}
+    };
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s --client-id <id> --api-key <key> [--host 127.0.0.1] [--port 3000]\n"
+            "       [--connections 4] [--duration 30] [--mode closed|open] [--rate 2] [--poisson]\n"
+            "       [--think-ms 0] [--prompt \"...\"] [--max-tokens 64] [--same-prompt] [--out file.json]\n",
+            argv0);
+}
+
+int main(int argc, char** argv) {
+    Options opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--host" && hasValue) opts.host = argv[++i];
+        else if (arg == "--port" && hasValue) opts.port = std::atoi(argv[++i]);
+        else if (arg == "--client-id" && hasValue) opts.clientId = argv[++i];
+        else if (arg == "--api-key" && hasValue) opts.apiKey = argv[++i];
+        else if (arg == "--connections" && hasValue) opts.connections = std::atoi(argv[++i]);
+        else if (arg == "--duration" && hasValue) opts.duration_s = std::atof(argv[++i]);
+        else if (arg == "--mode" && hasValue) opts.open = std::string(argv[++i]) == "open";
+        else if (arg == "--rate" && hasValue) opts.rate = std::atof(argv[++i]);
+        else if (arg == "--poisson") opts.poisson = true;
+        else if (arg == "--think-ms" && hasValue) opts.think_ms = std::atoi(argv[++i]);
+        else if (arg == "--prompt" && hasValue) opts.prompt = argv[++i];
+        else if (arg == "--max-tokens" && hasValue) opts.max_tokens = std::atoi(argv[++i]);
+        else if (arg == "--same-prompt") opts.samePrompt = true;
+        else if (arg == "--out" && hasValue) opts.out = argv[++i];
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opts.clientId.empty() || opts.apiKey.empty() || opts.connections < 1 || opts.duration_s <= 0 ||
+        (opts.open && opts.rate <= 0)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Results results;
+    std::vector<clock_type::duration> schedule = opts.open ? arrivals(opts) : std::vector<clock_type::duration>();
+    std::atomic<size_t> nextArrival{0};
+    std::atomic<uint64_t> requestCounter{0};
+
+    // Connections are set up before the clock starts; the first second is not
+    // spent on handshakes
+    auto start = clock_type::now() + std::chrono::seconds(1);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < opts.connections; i++) {
+        threads.emplace_back([&, i]() {
+            runConnection(opts, i, results, start, schedule, nextArrival, requestCounter);
+        });
+    }
+    for (auto& t : threads) t.join();
+    double wall_s = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    json report = {
+        {"mode", opts.open ? "open" : "closed"},
+        {"connections", opts.connections},
+        {"connected", results.connected.load()},
+        {"duration_s", wall_s},
+        {"max_tokens", opts.max_tokens},
+        {"requests", {
+            {"completed", results.completed.load()},
+            {"errors", results.errors.load()},
+            {"per_s", results.completed.load() / wall_s}
+        }},
+        {"tokens", results.tokens.load()},
+        {"tokens_per_s", results.tokens.load() / wall_s},
+        {"ttft_ms", percentiles(results.ttft)},
+        {"inter_token_ms", percentiles(results.interToken)},
+        {"total_ms", percentiles(results.total)}
+    };
+    if (opts.open) {
+        report["target_rate"] = opts.rate;
+        report["scheduled"] = schedule.size();
+        report["send_delay_ms"] = percentiles(results.sendDelay);
+    }
+
+    std::string text = report.dump(2);
+    printf("%s\n", text.c_str());
+    if (!opts.out.empty()) {
+        std::ofstream file(opts.out);
+        file << text << "\n";
+    }
+    return results.connected.load() > 0 ? 0 : 1;
+}
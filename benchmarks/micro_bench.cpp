@@ -0,0 +1,291 @@
+// Micro-benchmarks of the protocol and per-token hot paths, with baseline diffing.
+//
+//   micro_bench [--model model.gguf] [--filter substr] [--min-time-ms 200]
+//               [--save results.json] [--baseline results.json] [--threshold 10]
+//
+// Every benchmark is calibrated to run for at least --min-time-ms, repeated
+// five times, and reported as the median ns/op.
+//   sanitize_utf8_*        Utils::sanitizeUtf8 on a token piece / a long mixed text
+//   dispatch_parse_*       the JSON parse + op extraction MessageDispatcher::dispatch
+//                          does before routing
+//   token_frame_*          InferenceHandler::buildTokenFrame, plain and with logprobs
+//   session_lookup_*       SessionManager::getSession from 1 and 4 threads (lock
+//                          contention; the ids miss, sessions need JotaDB)
+//   tokenize_*, token_to_piece
+//                          LlamaSession::tokenize / tokenToPiece (only with --model)
+//
+// --save writes the results as JSON. --baseline compares against such a file,
+// marks every benchmark slower than --threshold percent as REGRESSION and exits
+// with status 2 if there is any.
+#include "Engine.h"
+#include "LlamaSession.h"
+#include "SessionManager.h"
+#include "Utils.h"
+#include "Protocol.h"
+#include "handlers/InferenceHandler.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+using json = nlohmann::json;
+
+// Keeps the compiler from discarding a computed value
+template <typename T>
+static inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result {
+    std::string name;
+    double ns_per_op = 0.0;
+    uint64_t iterations = 0;  // Per repetition
+};
+
+class Runner {
+public:
+    Runner(std::string filter, double minTimeMs) : filter_(std::move(filter)), minTimeMs_(minTimeMs) {}
+
+    // body(n) performs n operations
+    void run(const std::string& name, const std::function<void(uint64_t)>& body) {
+        if (!filter_.empty() && name.find(filter_) == std::string::npos) {
+            return;
+        }
+
+        // Calibrate: grow n until one repetition takes at least minTimeMs_
+        uint64_t n = 1;
+        double ms = 0.0;
+        while (true) {
+            ms = timeMs(body, n);
+            if (ms >= minTimeMs_ || n >= (1ull << 40)) break;
+            double scale = ms > 0.0 ? minTimeMs_ / ms * 1.2 : 10.0;
+            n = std::max<uint64_t>(n + 1, (uint64_t)(n * std::min(scale, 10.0)));
+        }
+
+        std::vector<double> samples;
+        for (int i = 0; i < REPETITIONS; i++) {
+            samples.push_back(timeMs(body, n) * 1e6 / n);
+        }
+        std::sort(samples.begin(), samples.end());
+
+        Result result{name, samples[REPETITIONS / 2], n};
+        printf("%-28s %12.1f ns/op  (%llu ops x %d)\n", name.c_str(), result.ns_per_op,
+               (unsigned long long)n, REPETITIONS);
+        fflush(stdout);
+        results_.push_back(result);
+    }
+
+    const std::vector<Result>& results() const { return results_; }
+
+private:
+    static constexpr int REPETITIONS = 5;
+
+    std::string filter_;
+    double minTimeMs_;
+    std::vector<Result> results_;
+
+    static double timeMs(const std::function<void(uint64_t)>& body, uint64_t n) {
+        auto t0 = clock_type::now();
+        body(n);
+        return std::chrono::duration<double, std::milli>(clock_type::now() - t0).count();
+    }
+};
+
+static json toJson(const std::vector<Result>& results) {
+    json benchmarks = json::object();
+    for (const auto& r : results) {
+        benchmarks[r.name] = {{"ns_per_op", r.ns_per_op}, {"iterations", r.iterations}};
+    }
+    return {{"benchmarks", benchmarks}};
+}
+
+// Prints the diff table; returns the number of regressions
+static int compare(const std::vector<Result>& results, const json& baseline, double thresholdPct) {
+    printf("\n%-28s %12s %12s %9s\n", "benchmark", "baseline", "current", "change");
+    int regressions = 0;
+    for (const auto& r : results) {
+        if (!baseline["benchmarks"].contains(r.name)) {
+            printf("%-28s %12s %12.1f %9s\n", r.name.c_str(), "-", r.ns_per_op, "new");
+            continue;
+        }
+        double base = baseline["benchmarks"][r.name]["ns_per_op"].get<double>();
+        double change = base > 0.0 ? (r.ns_per_op - base) / base * 100.0 : 0.0;
+        const char* flag = "";
+        if (change > thresholdPct) {
+            flag = "  REGRESSION";
+            regressions++;
+        } else if (change < -thresholdPct) {
+            flag = "  improved";
+        }
+        printf("%-28s %12.1f %12.1f %+8.1f%%%s\n", r.name.c_str(), base, r.ns_per_op, change, flag);
+    }
+    return regressions;
+}
+
+static void benchProtocol(Runner& runner) {
+    const std::string piece = " the";
+    std::string text;
+    for (int i = 0; i < 64; i++) {
+        text += "Plain ASCII words, acentos en español, 漢字 and emoji 🚀 ";
+    }
+    text += "\xff\xfe truncated \xe2\x82";  // Invalid bytes take the skip path
+
+    runner.run("sanitize_utf8_piece", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) doNotOptimize(Server::Utils::sanitizeUtf8(piece));
+    });
+    runner.run("sanitize_utf8_4k", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) doNotOptimize(Server::Utils::sanitizeUtf8(text));
+    });
+
+    const std::string inferMessage = json{
+        {"op", Server::Op::INFER},
+        {"session_id", "sess_0123abcd_4567"},
+        {"prompt", "Summarize the following paragraph in one sentence: " + std::string(400, 'x')},
+        {"params", {{"temp", 0.7}, {"max_tokens", 256}}}
+    }.dump();
+    const std::string abortMessage = json{{"op", Server::Op::ABORT}, {"session_id", "sess_0123abcd_4567"}}.dump();
+
+    auto parse = [](const std::string& message) {
+        json data = json::parse(message);
+        std::string op = data["op"];
+        doNotOptimize(op);
+        return data;
+    };
+    runner.run("dispatch_parse_infer", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            json data = parse(inferMessage);
+            doNotOptimize(Server::parseInfer(data));
+        }
+    });
+    runner.run("dispatch_parse_abort", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) doNotOptimize(parse(abortMessage));
+    });
+
+    Core::TokenLogprobs logprobs;
+    logprobs.logprob = -0.25f;
+    for (int i = 0; i < 5; i++) {
+        logprobs.top.push_back(Core::LogprobEntry{" alt" + std::to_string(i), -0.25f * (i + 1)});
+    }
+    runner.run("token_frame", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            doNotOptimize(Server::InferenceHandler::buildTokenFrame("sess_0123abcd_4567", piece, nullptr));
+        }
+    });
+    runner.run("token_frame_logprobs5", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            doNotOptimize(Server::InferenceHandler::buildTokenFrame("sess_0123abcd_4567", piece, &logprobs));
+        }
+    });
+}
+
+static void benchSessionLookup(Runner& runner, Core::SessionManager& manager) {
+    const std::string id = "sess_0123abcd_4567";
+    runner.run("session_lookup_1t", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) doNotOptimize(manager.getSession(id));
+    });
+
+    // Same total work split across threads: ns/op is wall time per lookup
+    const unsigned threads = 4;
+    runner.run("session_lookup_4t", [&](uint64_t n) {
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                for (uint64_t i = t; i < n; i += threads) doNotOptimize(manager.getSession(id));
+            });
+        }
+        for (auto& w : workers) w.join();
+    });
+}
+
+static void benchTokenizer(Runner& runner, Core::Engine& engine) {
+    Core::LlamaSession session("bench", "bench", engine.getModel(), 512);
+
+    const std::string shortText = "What is the capital of France?";
+    std::string longText;
+    for (int i = 0; i < 40; i++) {
+        longText += "The quick brown fox jumps over the lazy dog while the server streams tokens. ";
+    }
+    std::vector<llama_token> tokens = session.tokenize(longText, true);
+
+    runner.run("tokenize_short", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) doNotOptimize(session.tokenize(shortText, true));
+    });
+    runner.run("tokenize_3k", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) doNotOptimize(session.tokenize(longText, true));
+    });
+    runner.run("token_to_piece", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) doNotOptimize(session.tokenToPiece(tokens[i % tokens.size()]));
+    });
+}
+
+int main(int argc, char** argv) {
+    std::string modelPath, filter, savePath, baselinePath;
+    double minTimeMs = 200.0;
+    double thresholdPct = 10.0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--model" && hasValue) modelPath = argv[++i];
+        else if (arg == "--filter" && hasValue) filter = argv[++i];
+        else if (arg == "--min-time-ms" && hasValue) minTimeMs = std::atof(argv[++i]);
+        else if (arg == "--save" && hasValue) savePath = argv[++i];
+        else if (arg == "--baseline" && hasValue) baselinePath = argv[++i];
+        else if (arg == "--threshold" && hasValue) thresholdPct = std::atof(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [--model model.gguf] [--filter substr] [--min-time-ms 200]\n"
+                            "          [--save results.json] [--baseline results.json] [--threshold 10]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    json baseline;
+    if (!baselinePath.empty()) {
+        std::ifstream file(baselinePath);
+        baseline = json::parse(file, nullptr, false);
+        if (baseline.is_discarded() || !baseline.contains("benchmarks")) {
+            fprintf(stderr, "Cannot read baseline %s\n", baselinePath.c_str());
+            return 1;
+        }
+    }
+
+    Runner runner(filter, minTimeMs);
+    benchProtocol(runner);
+
+    Core::Engine engine;
+    Core::LlamaBackend backend(engine);
+    Core::SessionManager manager(backend, 512);
+    benchSessionLookup(runner, manager);
+
+    if (!modelPath.empty()) {
+        Core::EngineConfig config;
+        config.modelPath = modelPath;
+        config.n_gpu_layers = 0;
+        if (!engine.loadModel(config)) {
+            fprintf(stderr, "Cannot load %s\n", modelPath.c_str());
+            return 1;
+        }
+        benchTokenizer(runner, engine);
+    }
+
+    if (!savePath.empty()) {
+        std::ofstream file(savePath);
+        file << toJson(runner.results()).dump(2) << "\n";
+        printf("\nSaved %zu results to %s\n", runner.results().size(), savePath.c_str());
+    }
+
+    if (!baselinePath.empty()) {
+        int regressions = compare(runner.results(), baseline, thresholdPct);
+        if (regressions > 0) {
+            printf("\n%d regression(s) above %.0f%%\n", regressions, thresholdPct);
+            return 2;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Session.h"
+#include <memory>
+#include <string>
+
+namespace Core {
+
+    class GrammarCache;
+
+    /**
+     * Backend - Creates the sessions SessionManager hands out
+     *
+     * LlamaBackend runs them on the loaded GGUF model; MockBackend emits synthetic
+     * tokens at configured rates so the server can be exercised without a model.
+     */
+    class Backend {
+    public:
+        virtual ~Backend() = default;
+
+        // "llama" or "mock" (reported by HELLO)
+        virtual const char* name() const = 0;
+
+        // True once sessions may be created
+        virtual bool isReady() const = 0;
+
+        // Identifies what produces the output (for caches keyed on model output); valid once ready
+        virtual const std::string& getFingerprint() const = 0;
+
+        // New session, or nullptr if the backend cannot create one.
+        // May throw std::runtime_error (e.g. context allocation failure)
+        virtual std::unique_ptr<Session> createSession(const std::string& session_id, const std::string& client_id,
+                                                       int ctx_size, GrammarCache* grammarCache) = 0;
+    };
+
+}
@@ -0,0 +1,293 @@
+#include "BatchGenerator.h"
+#include "Logger.h"
+#include <chrono>
+#include <map>
+#include <algorithm>
+
+namespace Core {
+
+    BatchGenerator::BatchGenerator(Engine& engine, int ctx_size, int max_seqs)
+        : engine_(engine), ctx_size_(ctx_size), max_seqs_(std::max(1, max_seqs)) {
+    }
+
+    BatchGenerator::~BatchGenerator() {
+        if (ctx_) {
+            llama_free(ctx_);
+            ctx_ = nullptr;
+        }
+    }
+
+    bool BatchGenerator::ensureContext() {
+        if (ctx_) return true;
+
+        struct llama_model* model = engine_.getModel();
+        if (!model) return false;
+
+        auto cparams = llama_context_default_params();
+        // Every sequence may grow to ctx_size; the shared prefix only occupies cells once
+        cparams.n_ctx = ctx_size_ * max_seqs_;
+        // Room for one full prompt plus one token per running sequence in a single step
+        cparams.n_batch = ctx_size_ + max_seqs_;
+        cparams.n_ubatch = 512;
+        // One extra sequence holds the shared prefix for late admissions
+        cparams.n_seq_max = max_seqs_ + 1;
+        cparams.kv_unified = true;
+
+        ctx_ = llama_init_from_model(model, cparams);
+        if (ctx_) {
+            LOG_INFO("BatchGenerator: context ready (" << max_seqs_ << " sequences x "
+                     << ctx_size_ << " tokens)");
+        }
+        return ctx_ != nullptr;
+    }
+
+    std::vector<llama_token> BatchGenerator::tokenize(const std::string& text) {
+        const llama_vocab* vocab = llama_model_get_vocab(engine_.getModel());
+
+        std::vector<llama_token> tokens(text.size() + 2);
+        int n = llama_tokenize(vocab, text.c_str(), text.size(), tokens.data(), tokens.size(), true, false);
+        if (n < 0) {
+            tokens.resize(-n);
+            n = llama_tokenize(vocab, text.c_str(), text.size(), tokens.data(), tokens.size(), true, false);
+        }
+        tokens.resize(std::max(0, n));
+        return tokens;
+    }
+
+    std::string BatchGenerator::tokenToPiece(llama_token token) {
+        char buf[256];
+        const llama_vocab* vocab = llama_model_get_vocab(engine_.getModel());
+        int n = llama_token_to_piece(vocab, token, buf, sizeof(buf), 0, true);
+        if (n < 0) {
+            return "";
+        }
+        return std::string(buf, n);
+    }
+
+    BatchStats BatchGenerator::run(const std::vector<BatchItem>& items,
+                                   BatchTokenCallback onToken,
+                                   BatchItemCallback onItemDone,
+                                   const std::atomic<bool>& abort) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        using clock = std::chrono::steady_clock;
+
+        BatchStats stats;
+        stats.prompts = items.size();
+        auto start_time = clock::now();
+
+        auto finishEmpty = [&](size_t index) {
+            if (onItemDone) onItemDone(index, Metrics());
+        };
+
+        if (!ensureContext()) {
+            stats.error = engine_.isReady() ? "Failed to create batch context" : "Model is still loading";
+            for (size_t i = 0; i < items.size(); i++) finishEmpty(i);
+            return stats;
+        }
+
+        // 1. Tokenize and collapse identical prompts (generation is deterministic)
+        struct Job {
+            std::vector<llama_token> tokens;
+            int max_tokens;
+            std::vector<size_t> indices;  // Items served by this job
+        };
+        std::vector<Job> jobs;
+        std::map<std::pair<std::vector<llama_token>, int>, size_t> seen;
+
+        for (size_t i = 0; i < items.size(); i++) {
+            auto tokens = tokenize(items[i].prompt);
+            if (tokens.empty() || (int)tokens.size() >= ctx_size_) {
+                stats.rejected++;
+                finishEmpty(i);
+                continue;
+            }
+            auto key = std::make_pair(tokens, items[i].max_tokens);
+            auto it = seen.find(key);
+            if (it != seen.end()) {
+                jobs[it->second].indices.push_back(i);
+                continue;
+            }
+            seen.emplace(std::move(key), jobs.size());
+            jobs.push_back(Job{std::move(tokens), items[i].max_tokens, {i}});
+        }
+        stats.unique_prompts = jobs.size();
+
+        // 2. Common prefix, leaving every prompt at least one token of its own
+        //    so each sequence produces its own logits
+        size_t prefix = 0;
+        if (jobs.size() > 1) {
+            prefix = jobs[0].tokens.size() - 1;
+            for (size_t j = 1; j < jobs.size() && prefix > 0; j++) {
+                const auto& t = jobs[j].tokens;
+                size_t limit = std::min(prefix, t.size() - 1);
+                size_t k = 0;
+                while (k < limit && t[k] == jobs[0].tokens[k]) k++;
+                prefix = k;
+            }
+        }
+
+        llama_memory_t mem = llama_get_memory(ctx_);
+        llama_memory_clear(mem, true);
+
+        const int n_batch = llama_n_batch(ctx_);
+        const llama_seq_id prefix_seq = max_seqs_;
+        llama_batch batch = llama_batch_init(n_batch, 0, 1);
+
+        auto add = [&batch](llama_token token, llama_pos pos, llama_seq_id seq, bool logits) {
+            int idx = batch.n_tokens++;
+            batch.token[idx] = token;
+            batch.pos[idx] = pos;
+            batch.n_seq_id[idx] = 1;
+            batch.seq_id[idx][0] = seq;
+            batch.logits[idx] = logits;
+        };
+
+        if (prefix > 0) {
+            batch.n_tokens = 0;
+            for (size_t i = 0; i < prefix; i++) {
+                add(jobs[0].tokens[i], i, prefix_seq, false);
+            }
+            if (llama_decode(ctx_, batch) != 0) {
+                LOG_ERROR("BatchGenerator: shared prefix decode failed");
+                prefix = 0;
+                llama_memory_clear(mem, true);
+            } else {
+                stats.prompt_tokens += prefix;
+            }
+        }
+        stats.shared_prefix_tokens = prefix;
+
+        // 3. Continuous batching over max_seqs slots
+        struct Slot {
+            int job = -1;
+            int n_past = 0;
+            int logits_idx = -1;
+            bool first = true;
+            clock::time_point admitted;
+            Metrics metrics;
+        };
+        std::vector<Slot> slots(max_seqs_);
+        std::vector<bool> jobDone(jobs.size(), false);
+        size_t next_job = 0;
+
+        struct llama_sampler* smpl = llama_sampler_chain_init(llama_sampler_chain_default_params());
+        llama_sampler_chain_add(smpl, llama_sampler_init_greedy());
+        const llama_vocab* vocab = llama_model_get_vocab(engine_.getModel());
+
+        auto finish = [&](llama_seq_id seq) {
+            Slot& slot = slots[seq];
+            auto now = clock::now();
+            slot.metrics.total_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time).count();
+            auto gen_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - slot.admitted).count();
+            if (gen_ms > 0) {
+                slot.metrics.tps = (double)slot.metrics.tokens_generated / (gen_ms / 1000.0);
+            }
+            stats.tokens_generated += slot.metrics.tokens_generated;
+            for (size_t index : jobs[slot.job].indices) {
+                if (onItemDone) onItemDone(index, slot.metrics);
+            }
+            jobDone[slot.job] = true;
+            llama_memory_seq_rm(mem, seq, -1, -1);
+            slot = Slot();
+        };
+
+        while (true) {
+            batch.n_tokens = 0;
+
+            // a) Sample the next token of every running sequence
+            for (llama_seq_id seq = 0; seq < max_seqs_; seq++) {
+                Slot& slot = slots[seq];
+                if (slot.job < 0) continue;
+
+                if (abort) {
+                    stats.aborted = true;
+                    finish(seq);
+                    continue;
+                }
+
+                llama_token token = llama_sampler_sample(smpl, ctx_, slot.logits_idx);
+
+                if (slot.first) {
+                    slot.metrics.ttft_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        clock::now() - start_time).count();
+                    slot.first = false;
+                }
+
+                if (llama_vocab_is_eog(vocab, token)) {
+                    finish(seq);
+                    continue;
+                }
+
+                std::string piece = tokenToPiece(token);
+                slot.metrics.tokens_generated++;
+
+                bool keep = true;
+                for (size_t index : jobs[slot.job].indices) {
+                    if (onToken && !onToken(index, piece)) keep = false;
+                }
+
+                const Job& job = jobs[slot.job];
+                if (!keep ||
+                    (job.max_tokens > 0 && slot.metrics.tokens_generated >= job.max_tokens) ||
+                    slot.n_past + 1 >= ctx_size_) {
+                    finish(seq);
+                    continue;
+                }
+
+                slot.logits_idx = batch.n_tokens;
+                add(token, slot.n_past++, seq, true);
+            }
+
+            // b) Admit pending prompts into free slots
+            for (llama_seq_id seq = 0; seq < max_seqs_ && next_job < jobs.size() && !abort; seq++) {
+                Slot& slot = slots[seq];
+                if (slot.job >= 0) continue;
+
+                const auto& tokens = jobs[next_job].tokens;
+                int suffix = tokens.size() - prefix;
+                if (batch.n_tokens + suffix > n_batch) break;
+
+                if (prefix > 0) {
+                    llama_memory_seq_cp(mem, prefix_seq, seq, 0, prefix);
+                }
+                for (size_t i = prefix; i < tokens.size(); i++) {
+                    add(tokens[i], i, seq, i + 1 == tokens.size());
+                }
+                stats.prompt_tokens += suffix;
+
+                slot.job = next_job++;
+                slot.n_past = tokens.size();
+                slot.logits_idx = batch.n_tokens - 1;
+                slot.admitted = clock::now();
+            }
+
+            if (batch.n_tokens == 0) break;
+
+            if (llama_decode(ctx_, batch) != 0) {
+                LOG_ERROR("BatchGenerator: llama_decode failed");
+                stats.error = "Decode failed";
+                for (llama_seq_id seq = 0; seq < max_seqs_; seq++) {
+                    if (slots[seq].job >= 0) finish(seq);
+                }
+                break;
+            }
+        }
+
+        // Items that never got a slot (abort or decode failure)
+        for (size_t j = 0; j < jobs.size(); j++) {
+            if (jobDone[j]) continue;
+            for (size_t index : jobs[j].indices) finishEmpty(index);
+        }
+
+        llama_batch_free(batch);
+        llama_sampler_free(smpl);
+        llama_memory_clear(mem, true);
+
+        stats.total_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start_time).count();
+        if (stats.total_time_ms > 0) {
+            stats.tps = (double)stats.tokens_generated / (stats.total_time_ms / 1000.0);
+        }
+        return stats;
+    }
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "llama.h"
+#include "Engine.h"
+#include "Metrics.h"
+#include <string>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <mutex>
+
+namespace Core {
+
+    struct BatchItem {
+        std::string prompt;
+        int max_tokens = -1;  // -1 = until EOG or the per-sequence context limit
+    };
+
+    struct BatchStats {
+        int prompts = 0;
+        int unique_prompts = 0;        // After collapsing identical prompts
+        int rejected = 0;              // Empty or longer than the per-sequence context
+        int shared_prefix_tokens = 0;  // Decoded once and shared by every sequence
+        int prompt_tokens = 0;         // Prompt tokens actually decoded
+        int tokens_generated = 0;
+        long long total_time_ms = 0;
+        double tps = 0.0;              // Aggregate generated tokens per second
+        bool aborted = false;
+        std::string error;
+    };
+
+    // Streaming callback per item index. Returns true to continue, false to stop that item.
+    using BatchTokenCallback = std::function<bool(size_t index, const std::string& token)>;
+    // Called exactly once per item index when it finishes (or is rejected/aborted)
+    using BatchItemCallback = std::function<void(size_t index, const Metrics& metrics)>;
+
+    /**
+     * BatchGenerator - Runs many independent prompts as parallel sequences of one context
+     *
+     * Up to max_seqs sequences decode together, one token each per llama_decode;
+     * finished sequences free their slot for the next pending prompt (continuous
+     * batching). The token prefix common to all prompts is decoded once and
+     * copied into each sequence, and identical prompts are generated only once.
+     * Calls are serialized (one batch at a time per generator).
+     */
+    class BatchGenerator {
+    public:
+        BatchGenerator(Engine& engine, int ctx_size, int max_seqs = 8);
+        ~BatchGenerator();
+
+        // Prevent copying
+        BatchGenerator(const BatchGenerator&) = delete;
+        BatchGenerator& operator=(const BatchGenerator&) = delete;
+
+        // Run all items to completion (blocking). Setting abort stops the batch early.
+        BatchStats run(const std::vector<BatchItem>& items,
+                       BatchTokenCallback onToken,
+                       BatchItemCallback onItemDone,
+                       const std::atomic<bool>& abort);
+
+    private:
+        Engine& engine_;
+        int ctx_size_;   // Per-sequence limit (prompt + generated)
+        int max_seqs_;
+        struct llama_context* ctx_ = nullptr;
+        std::mutex mutex_;
+
+        bool ensureContext();
+        std::vector<llama_token> tokenize(const std::string& text);
+        std::string tokenToPiece(llama_token token);
+    };
+
+}
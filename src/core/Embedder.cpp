@@ -0,0 +1,170 @@
+#include "Embedder.h"
+#include "Logger.h"
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+namespace Core {
+
+    Embedder::Embedder(Engine& engine, int ctx_size, int max_seqs)
+        : engine_(engine), ctx_size_(ctx_size), max_seqs_(std::max(1, max_seqs)) {
+    }
+
+    Embedder::~Embedder() {
+        if (ctx_) {
+            llama_free(ctx_);
+            ctx_ = nullptr;
+        }
+    }
+
+    bool Embedder::ensureContext(std::string& error) {
+        if (ctx_) return true;
+
+        struct llama_model* model = engine_.getModel();
+        if (!model) {
+            error = "Model is still loading";
+            return false;
+        }
+
+        auto cparams = llama_context_default_params();
+        cparams.embeddings = true;
+        cparams.n_ctx = ctx_size_;
+        // Non-causal models need each sequence inside a single ubatch
+        cparams.n_batch = ctx_size_;
+        cparams.n_ubatch = ctx_size_;
+        cparams.n_seq_max = max_seqs_;
+        // All packed sequences share the cells instead of n_ctx / n_seq_max each
+        cparams.kv_unified = true;
+        cparams.pooling_type = LLAMA_POOLING_TYPE_UNSPECIFIED;
+
+        ctx_ = llama_init_from_model(model, cparams);
+        if (ctx_ && llama_pooling_type(ctx_) == LLAMA_POOLING_TYPE_NONE) {
+            // Generative models have no pooling of their own: mean-pool them
+            llama_free(ctx_);
+            cparams.pooling_type = LLAMA_POOLING_TYPE_MEAN;
+            ctx_ = llama_init_from_model(model, cparams);
+        }
+
+        if (!ctx_) {
+            error = "Failed to create embeddings context";
+            return false;
+        }
+
+        LOG_INFO("Embedder: context ready (ctx " << ctx_size_ << ", up to "
+                 << max_seqs_ << " sequences per batch)");
+        return true;
+    }
+
+    std::vector<llama_token> Embedder::tokenize(const std::string& text) {
+        const llama_vocab* vocab = llama_model_get_vocab(engine_.getModel());
+
+        std::vector<llama_token> tokens(text.size() + 2);
+        int n = llama_tokenize(vocab, text.c_str(), text.size(), tokens.data(), tokens.size(), true, false);
+        if (n < 0) {
+            tokens.resize(-n);
+            n = llama_tokenize(vocab, text.c_str(), text.size(), tokens.data(), tokens.size(), true, false);
+        }
+        tokens.resize(std::max(0, n));
+        return tokens;
+    }
+
+    bool Embedder::embed(const std::vector<std::string>& inputs, bool normalize,
+                         EmbeddingResult& result, std::string& error) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (!ensureContext(error)) return false;
+
+        auto start_time = std::chrono::steady_clock::now();
+        struct llama_model* model = engine_.getModel();
+        const int n_embd = llama_model_n_embd(model);
+        const int n_batch = llama_n_batch(ctx_);
+        const bool encoder_only = llama_model_has_encoder(model) && !llama_model_has_decoder(model);
+
+        result = EmbeddingResult();
+        result.dimensions = n_embd;
+        result.vectors.resize(inputs.size());
+
+        // 1. Tokenize everything up front
+        std::vector<std::vector<llama_token>> tokenized;
+        tokenized.reserve(inputs.size());
+        for (const auto& text : inputs) {
+            auto tokens = tokenize(text);
+            if ((int)tokens.size() > n_batch) {
+                tokens.resize(n_batch);
+                result.truncated++;
+            }
+            if (tokens.empty()) {
+                error = "Input could not be tokenized";
+                return false;
+            }
+            result.prompt_tokens += tokens.size();
+            tokenized.push_back(std::move(tokens));
+        }
+
+        llama_batch batch = llama_batch_init(n_batch, 0, 1);
+        llama_memory_t mem = llama_get_memory(ctx_);
+
+        // 2. Pack consecutive inputs into multi-sequence batches
+        size_t next = 0;
+        while (next < tokenized.size()) {
+            size_t first = next;
+            batch.n_tokens = 0;
+
+            while (next < tokenized.size() &&
+                   (int)(next - first) < max_seqs_ &&
+                   batch.n_tokens + (int)tokenized[next].size() <= n_batch) {
+                const auto& tokens = tokenized[next];
+                llama_seq_id seq = next - first;
+                for (size_t i = 0; i < tokens.size(); i++) {
+                    int idx = batch.n_tokens++;
+                    batch.token[idx] = tokens[i];
+                    batch.pos[idx] = i;
+                    batch.n_seq_id[idx] = 1;
+                    batch.seq_id[idx][0] = seq;
+                    batch.logits[idx] = true;  // Pooling reads every token's output
+                }
+                next++;
+            }
+
+            if (mem) {
+                llama_memory_clear(mem, true);
+            }
+
+            int rc = encoder_only ? llama_encode(ctx_, batch) : llama_decode(ctx_, batch);
+            if (rc != 0) {
+                llama_batch_free(batch);
+                error = "Embedding decode failed";
+                return false;
+            }
+            result.batches++;
+
+            // 3. Collect pooled vectors for every sequence of the batch
+            for (size_t i = first; i < next; i++) {
+                const float* embd = llama_get_embeddings_seq(ctx_, i - first);
+                if (!embd) {
+                    llama_batch_free(batch);
+                    error = "Failed to read pooled embeddings";
+                    return false;
+                }
+
+                std::vector<float> vec(embd, embd + n_embd);
+                if (normalize) {
+                    double norm = 0.0;
+                    for (float v : vec) norm += (double)v * v;
+                    norm = std::sqrt(norm);
+                    if (norm > 0.0) {
+                        for (float& v : vec) v = (float)(v / norm);
+                    }
+                }
+                result.vectors[i] = std::move(vec);
+            }
+        }
+
+        llama_batch_free(batch);
+
+        auto end_time = std::chrono::steady_clock::now();
+        result.total_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+        return true;
+    }
+
+}
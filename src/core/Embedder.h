@@ -0,0 +1,52 @@
+#pragma once
+
+#include "llama.h"
+#include "Engine.h"
+#include <string>
+#include <vector>
+#include <mutex>
+
+namespace Core {
+
+    struct EmbeddingResult {
+        std::vector<std::vector<float>> vectors;  // One per input, in input order
+        int dimensions = 0;
+        int prompt_tokens = 0;
+        int batches = 0;      // Number of decode calls used
+        int truncated = 0;    // Inputs cut to fit the context
+        long long total_ms = 0;
+    };
+
+    /**
+     * Embedder - Batched embeddings on a dedicated embeddings-enabled context
+     *
+     * Inputs are packed as independent sequences into as few decode calls as
+     * possible (bounded by the batch size and the max sequence count) and
+     * pooled with the model's pooling type (mean pooling if the model has none).
+     * The context is created lazily on first use and shared; calls are serialized.
+     */
+    class Embedder {
+    public:
+        Embedder(Engine& engine, int ctx_size, int max_seqs = 32);
+        ~Embedder();
+
+        // Prevent copying
+        Embedder(const Embedder&) = delete;
+        Embedder& operator=(const Embedder&) = delete;
+
+        // Embed all inputs. Returns false and sets error on failure.
+        bool embed(const std::vector<std::string>& inputs, bool normalize,
+                   EmbeddingResult& result, std::string& error);
+
+    private:
+        Engine& engine_;
+        int ctx_size_;
+        int max_seqs_;
+        struct llama_context* ctx_ = nullptr;
+        std::mutex mutex_;
+
+        bool ensureContext(std::string& error);
+        std::vector<llama_token> tokenize(const std::string& text);
+    };
+
+}
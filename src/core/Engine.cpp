@@ -1,18 +1,59 @@
 #include "Engine.h"
-#include <iostream>
+#include "Logger.h"
 #include <vector>
 #include <cstring>
+#include <cerrno>
 #include <stdexcept>
 #include <mutex>
-#include <unistd.h>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 namespace Core {
 
     static std::once_flag backend_init_flag;
 
+    // Tokens generated by the warm-up decode after the prompt
+    static const int WARMUP_GEN_TOKENS = 8;
+    static const char* DEFAULT_WARMUP_PROMPT = "Hello, how are you?";
+
+    // Route llama.cpp/ggml logs through the async logger. Their INFO output
+    // (model metadata, context setup) is demoted to DEBUG to keep the default log quiet.
+    static void llamaLogCallback(enum ggml_log_level level, const char* text, void* /*user_data*/) {
+        // llama.cpp emits lines in pieces (GGML_LOG_LEVEL_CONT); assemble per thread
+        thread_local std::string pending;
+        thread_local LogLevel pendingLevel = LogLevel::DEBUG;
+
+        if (level != GGML_LOG_LEVEL_CONT) {
+            if (level == GGML_LOG_LEVEL_ERROR) pendingLevel = LogLevel::ERROR;
+            else if (level == GGML_LOG_LEVEL_WARN) pendingLevel = LogLevel::WARN;
+            else pendingLevel = LogLevel::DEBUG;
+        }
+
+        pending += text;
+        size_t newline;
+        while ((newline = pending.find('\n')) != std::string::npos) {
+            if (newline > 0) {
+                LOG_AT(pendingLevel, "[llama] " << pending.substr(0, newline));
+            }
+            pending.erase(0, newline + 1);
+        }
+    }
+
+    static long majorFaults() {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+        return usage.ru_majflt;
+    }
+
     Engine::Engine() {
         std::call_once(backend_init_flag, []() {
+            llama_log_set(llamaLogCallback, nullptr);
             llama_backend_init();
         });
     }
@@ -22,45 +63,176 @@ namespace Core {
     }
 
     bool Engine::isLoaded() const {
-        return model != nullptr;
+        EngineState state = getState();
+        return state == EngineState::WARMING || state == EngineState::READY;
     }
 
     bool Engine::loadModel(const EngineConfig& config) {
-        if (isLoaded()) return false;
+        EngineState expected = EngineState::IDLE;
+        if (!state_.compare_exchange_strong(expected, EngineState::LOADING)) return false;
 
         // Store context size for later use by SessionManager
         ctx_size_ = config.ctx_size;
+        loadProgress_ = 0.0f;
 
         // Model Parameters
         auto mparams = llama_model_default_params();
         mparams.n_gpu_layers = config.n_gpu_layers;
         mparams.use_mmap = config.use_mmap;
         mparams.use_mlock = config.use_mlock;
+        mparams.progress_callback = [](float progress, void* user_data) {
+            auto* engine = static_cast<Engine*>(user_data);
+            engine->loadProgress_.store(progress, std::memory_order_relaxed);
+            return !engine->isLoadCancelled(); // false aborts the load
+        };
+        mparams.progress_callback_user_data = this;
 
-        // Silence llama.cpp verbose output (both stdout and stderr)
-        int stdout_backup = dup(STDOUT_FILENO);
-        int stderr_backup = dup(STDERR_FILENO);
-        int devnull = open("/dev/null", O_WRONLY);
-        dup2(devnull, STDOUT_FILENO);
-        dup2(devnull, STDERR_FILENO);
-        close(devnull);
-
-        // Load Model
-        model = llama_model_load_from_file(config.modelPath.c_str(), mparams);
-        
-        // Restore stdout and stderr
-        dup2(stdout_backup, STDOUT_FILENO);
-        dup2(stderr_backup, STDERR_FILENO);
-        close(stdout_backup);
-        close(stderr_backup);
-
-        if (!model) {
+        // Load Model (llama.cpp output goes to the logger at DEBUG level)
+        struct llama_model* loaded = isLoadCancelled() ? nullptr
+                                                       : llama_model_load_from_file(config.modelPath.c_str(), mparams);
+
+        if (loaded && isLoadCancelled()) {
+            llama_model_free(loaded);  // Finished just as it was cancelled
+            loaded = nullptr;
+        }
+        if (!loaded) {
+            state_.store(EngineState::FAILED, std::memory_order_release);
             return false;
         }
 
+        model = loaded;
+        loadProgress_ = 1.0f;
+
+        char desc[256];
+        llama_model_desc(model, desc, sizeof(desc));
+        fingerprint_ = config.modelPath + "|" + desc + "|" + std::to_string(llama_model_n_params(model));
+
+        if (config.prefetch && !isLoadCancelled()) {
+            state_.store(EngineState::WARMING, std::memory_order_release);
+
+            // With mmap the weights are paged in lazily by the first requests;
+            // populate the page cache up front so they only take minor faults.
+            if (config.use_mmap) {
+                long faults_before = majorFaults();
+                auto t0 = std::chrono::steady_clock::now();
+                warmupReport_.bytes_prefetched = prefetchFile(config.modelPath, config.prefetch_threads);
+                auto t1 = std::chrono::steady_clock::now();
+                warmupReport_.prefetch_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+                warmupReport_.prefetch_major_faults = majorFaults() - faults_before;
+            }
+
+            long faults_before = majorFaults();
+            auto t0 = std::chrono::steady_clock::now();
+            warmupReport_.warmup_tokens = isLoadCancelled() ? 0 : warmupDecode(
+                config.warmup_prompt.empty() ? DEFAULT_WARMUP_PROMPT : config.warmup_prompt);
+            auto t1 = std::chrono::steady_clock::now();
+            warmupReport_.warmup_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+            warmupReport_.warmup_major_faults = majorFaults() - faults_before;
+            warmupReport_.ran = true;
+        }
+
+        if (isLoadCancelled()) {
+            state_.store(EngineState::FAILED, std::memory_order_release);
+            return false;
+        }
+        state_.store(EngineState::READY, std::memory_order_release);
         return true;
     }
 
+    unsigned long long Engine::prefetchFile(const std::string& path, int threads) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            LOG_ERROR("Prefetch: cannot open " << path << ": " << strerror(errno));
+            return 0;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            close(fd);
+            return 0;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+
+        // Same file, same page cache: pages faulted in through this mapping
+        // are shared with llama.cpp's own mapping of the model.
+        void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED) {
+            LOG_ERROR("Prefetch: mmap failed: " << strerror(errno));
+            return 0;
+        }
+
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const int n_threads = std::max(1, threads);
+        // Chunk boundaries aligned to pages (madvise requires an aligned start)
+        const size_t chunk = ((size / n_threads) / page + 1) * page;
+        const char* base = static_cast<const char*>(addr);
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < n_threads; ++t) {
+            size_t begin = t * chunk;
+            if (begin >= size) break;
+            size_t end = std::min(size, begin + chunk);
+
+            workers.emplace_back([this, base, begin, end, page]() {
+                // Kick off asynchronous readahead, then touch every page so the
+                // chunk is resident before the stage reports done.
+                madvise(const_cast<char*>(base + begin), end - begin, MADV_WILLNEED);
+                volatile char sink = 0;
+                for (size_t off = begin; off < end; off += page) {
+                    if ((off - begin) % (1024 * page) == 0 && isLoadCancelled()) break;
+                    sink = sink + base[off];
+                }
+                (void)sink;
+            });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+
+        munmap(addr, size);
+        return size;
+    }
+
+    int Engine::warmupDecode(const std::string& prompt) {
+        auto cparams = llama_context_default_params();
+        cparams.n_ctx = ctx_size_;
+        cparams.n_batch = 512;
+        cparams.n_ubatch = 512;
+
+        llama_context* ctx = llama_init_from_model(model, cparams);
+        if (!ctx) {
+            LOG_ERROR("Warm-up: failed to create context");
+            return 0;
+        }
+
+        const llama_vocab* vocab = llama_model_get_vocab(model);
+        std::vector<llama_token> tokens(prompt.size() + 2);
+        int n = llama_tokenize(vocab, prompt.c_str(), prompt.size(), tokens.data(), tokens.size(), true, false);
+        // Leave room in the context for the generated tokens
+        int max_prompt = std::max(1, std::min<int>(cparams.n_batch, ctx_size_ - WARMUP_GEN_TOKENS));
+        tokens.resize(std::max(0, std::min(n, max_prompt)));
+
+        int generated = 0;
+        if (!tokens.empty() && llama_decode(ctx, llama_batch_get_one(tokens.data(), tokens.size())) == 0) {
+            llama_sampler* smpl = llama_sampler_chain_init(llama_sampler_chain_default_params());
+            llama_sampler_chain_add(smpl, llama_sampler_init_greedy());
+
+            int n_cur = tokens.size();
+            for (; generated < WARMUP_GEN_TOKENS && n_cur < ctx_size_; ++generated, ++n_cur) {
+                llama_token token = llama_sampler_sample(smpl, ctx, -1);
+                if (llama_vocab_is_eog(vocab, token)) break;
+                if (llama_decode(ctx, llama_batch_get_one(&token, 1)) != 0) break;
+            }
+            llama_sampler_free(smpl);
+        } else {
+            LOG_ERROR("Warm-up: prompt decode failed");
+        }
+
+        llama_free(ctx);
+        return generated;
+    }
+
     
     std::string Engine::getSystemInfo() const {
         return llama_print_system_info();
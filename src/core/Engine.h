@@ -10,15 +10,37 @@
 
 namespace Core {
 
-    // Callback for streaming tokens. Returns true to continue, false to abort.
-    using TokenCallback = std::function<bool(const std::string& token)>;
-
     struct EngineConfig {
         std::string modelPath;
         int n_gpu_layers = -1; // -1 = auto-detect, 0 = CPU only, >0 = specific count
         int ctx_size = 512;    // Reduced for short conversations
         bool use_mmap = true;
         bool use_mlock = false;
+
+        // Optional cold-start stage: page the GGUF into the page cache and run
+        // a warm-up decode before the engine reports READY.
+        bool prefetch = false;
+        int prefetch_threads = 4;
+        std::string warmup_prompt;  // Empty = built-in default
+    };
+
+    enum class EngineState {
+        IDLE,
+        LOADING,
+        WARMING,
+        READY,
+        FAILED
+    };
+
+    // Cold-start I/O instrumentation from the prefetch/warm-up stage
+    struct WarmupReport {
+        bool ran = false;
+        unsigned long long bytes_prefetched = 0;
+        long long prefetch_ms = 0;
+        long prefetch_major_faults = 0;
+        long long warmup_ms = 0;
+        long warmup_major_faults = 0;  // Faults left after prefetch (should be ~0)
+        int warmup_tokens = 0;
     };
 
     class Engine {
@@ -30,24 +52,54 @@ namespace Core {
         Engine(const Engine&) = delete;
         Engine& operator=(const Engine&) = delete;
 
-        // Initialize the engine with the specific model
+        // Initialize the engine with the specific model.
+        // Safe to run on a background thread; progress is published via getLoadProgress().
         bool loadModel(const EngineConfig& config);
 
-        // Check internal status
+        // Make a running (or later) loadModel give up as soon as it can: the llama.cpp load
+        // is cancelled, prefetch/warm-up are skipped and loadModel returns false. Thread-safe.
+        void cancelLoad() { cancelled_.store(true, std::memory_order_relaxed); }
+        bool isLoadCancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+        // Check internal status (model loaded, possibly still warming up)
         bool isLoaded() const;
 
+        // True once the model is loaded and sessions may be created
+        bool isReady() const { return state_.load(std::memory_order_acquire) == EngineState::READY; }
+
+        // Loading state and progress (0.0 - 1.0), readable from any thread
+        EngineState getState() const { return state_.load(std::memory_order_acquire); }
+        float getLoadProgress() const { return loadProgress_.load(std::memory_order_relaxed); }
+
         // Get system info
         std::string getSystemInfo() const;
 
         // Get the loaded model (for SessionManager to create contexts)
-        struct llama_model* getModel() { return model; }
+        struct llama_model* getModel() { return isReady() ? model : nullptr; }
         
         // Get context size from config
         int getCtxSize() const { return ctx_size_; }
 
+        // Result of the prefetch/warm-up stage (valid once READY)
+        const WarmupReport& getWarmupReport() const { return warmupReport_; }
+
+        // Identifies the loaded weights (path, description, parameter count); valid once READY
+        const std::string& getFingerprint() const { return fingerprint_; }
+
     private:
         struct llama_model* model = nullptr;
         int ctx_size_ = 512;
+        std::atomic<EngineState> state_{EngineState::IDLE};
+        std::atomic<float> loadProgress_{0.0f};
+        std::atomic<bool> cancelled_{false};
+        WarmupReport warmupReport_;
+        std::string fingerprint_;
+
+        // Fault the model file into the page cache with parallel readers
+        unsigned long long prefetchFile(const std::string& path, int threads);
+
+        // Run one prompt decode plus a few generated tokens on a scratch context
+        int warmupDecode(const std::string& prompt);
     };
 
 }
@@ -0,0 +1,108 @@
+#include "GrammarCache.h"
+#include "JsonSchemaGrammar.h"
+#include "Logger.h"
+#include <functional>
+#include <stdexcept>
+
+namespace Core {
+
+    GrammarCache::GrammarCache(size_t capacity)
+        : capacity_(std::max<size_t>(1, capacity)) {
+    }
+
+    GrammarCache::~GrammarCache() {
+        clearPrototypes();
+    }
+
+    void GrammarCache::clearPrototypes() {
+        for (auto& entry : prototypes_) {
+            llama_sampler_free(entry.second.sampler);
+        }
+        prototypes_.clear();
+        prototypeLru_.clear();
+    }
+
+    struct llama_sampler* GrammarCache::acquire(const struct llama_vocab* vocab, const std::string& grammar) {
+        size_t key = std::hash<std::string>{}(grammar);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (vocab != vocab_) {
+                // Compiled grammars are tied to the vocabulary they were built for
+                clearPrototypes();
+                vocab_ = vocab;
+            }
+
+            auto it = prototypes_.find(key);
+            if (it != prototypes_.end() && it->second.grammar == grammar) {
+                prototypeLru_.splice(prototypeLru_.begin(), prototypeLru_, it->second.lru);
+                hits_++;
+                return llama_sampler_clone(it->second.sampler);
+            }
+        }
+
+        // Compile outside the lock; concurrent misses on the same grammar just race to insert
+        misses_++;
+        struct llama_sampler* compiled = llama_sampler_init_grammar(vocab, grammar.c_str(), "root");
+        if (!compiled) {
+            throw std::invalid_argument("Invalid grammar");
+        }
+        struct llama_sampler* copy = llama_sampler_clone(compiled);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (vocab != vocab_) {
+            // Vocabulary changed while compiling: don't cache
+            llama_sampler_free(compiled);
+            return copy;
+        }
+
+        auto it = prototypes_.find(key);
+        if (it != prototypes_.end()) {
+            // Lost the race (or a hash collision): keep the existing entry
+            llama_sampler_free(compiled);
+            return copy;
+        }
+
+        if (prototypes_.size() >= capacity_) {
+            size_t victim = prototypeLru_.back();
+            prototypeLru_.pop_back();
+            llama_sampler_free(prototypes_[victim].sampler);
+            prototypes_.erase(victim);
+        }
+
+        prototypeLru_.push_front(key);
+        prototypes_[key] = Prototype{grammar, compiled, prototypeLru_.begin()};
+        LOG_DEBUG("GrammarCache: compiled grammar " << std::hex << key << std::dec
+                  << " (" << grammar.size() << " bytes)");
+        return copy;
+    }
+
+    std::string GrammarCache::grammarForSchema(const nlohmann::json& schema) {
+        std::string serialized = schema.dump();
+        size_t key = std::hash<std::string>{}(serialized);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = schemas_.find(key);
+            if (it != schemas_.end() && it->second.key == serialized) {
+                schemaLru_.splice(schemaLru_.begin(), schemaLru_, it->second.lru);
+                return it->second.grammar;
+            }
+        }
+
+        std::string grammar = jsonSchemaToGbnf(schema);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (schemas_.count(key)) {
+            return grammar;
+        }
+        if (schemas_.size() >= capacity_) {
+            schemas_.erase(schemaLru_.back());
+            schemaLru_.pop_back();
+        }
+        schemaLru_.push_front(key);
+        schemas_[key] = Schema{serialized, grammar, schemaLru_.begin()};
+        return grammar;
+    }
+
+}
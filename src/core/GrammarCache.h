@@ -0,0 +1,69 @@
+#pragma once
+
+#include "llama.h"
+#include <nlohmann/json.hpp>
+#include <string>
+#include <unordered_map>
+#include <list>
+#include <mutex>
+#include <atomic>
+
+namespace Core {
+
+    /**
+     * GrammarCache - Compiled grammar samplers and converted JSON schemas, keyed by hash
+     *
+     * Parsing a GBNF grammar into sampler state is done once per distinct grammar;
+     * each generation gets a cheap clone of the compiled prototype (clones share
+     * nothing, so concurrent sessions can advance their own copy). Both caches are
+     * bounded and evict the least recently used entry.
+     */
+    class GrammarCache {
+    public:
+        explicit GrammarCache(size_t capacity = 64);
+        ~GrammarCache();
+
+        // Prevent copying
+        GrammarCache(const GrammarCache&) = delete;
+        GrammarCache& operator=(const GrammarCache&) = delete;
+
+        // Fresh grammar sampler for a GBNF grammar (root rule "root"). Caller owns it.
+        // Throws std::invalid_argument if the grammar does not compile.
+        struct llama_sampler* acquire(const struct llama_vocab* vocab, const std::string& grammar);
+
+        // GBNF for a JSON schema, converted once per distinct schema.
+        // Throws std::invalid_argument for unsupported schemas.
+        std::string grammarForSchema(const nlohmann::json& schema);
+
+        uint64_t hits() const { return hits_.load(); }
+        uint64_t misses() const { return misses_.load(); }
+
+    private:
+        struct Prototype {
+            std::string grammar;  // Full text, guards against hash collisions
+            struct llama_sampler* sampler = nullptr;
+            std::list<size_t>::iterator lru;
+        };
+
+        struct Schema {
+            std::string key;  // Serialized schema
+            std::string grammar;
+            std::list<size_t>::iterator lru;
+        };
+
+        size_t capacity_;
+        const struct llama_vocab* vocab_ = nullptr;
+
+        std::unordered_map<size_t, Prototype> prototypes_;
+        std::list<size_t> prototypeLru_;  // Front = most recently used
+        std::unordered_map<size_t, Schema> schemas_;
+        std::list<size_t> schemaLru_;
+        std::mutex mutex_;
+
+        std::atomic<uint64_t> hits_{0};
+        std::atomic<uint64_t> misses_{0};
+
+        void clearPrototypes();
+    };
+
+}
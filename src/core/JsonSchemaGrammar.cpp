@@ -0,0 +1,332 @@
+#include "JsonSchemaGrammar.h"
+#include <stdexcept>
+#include <vector>
+#include <map>
+#include <set>
+#include <limits>
+
+using json = nlohmann::json;
+
+namespace Core {
+
+    namespace {
+
+        // Shared building blocks, emitted only when referenced
+        const std::map<std::string, std::string> PRIMITIVES = {
+            {"space",   "| \" \" | \"\\n\" [ \\t]{0,20}"},
+            {"boolean", "(\"true\" | \"false\") space"},
+            {"null",    "\"null\" space"},
+            {"integer", "(\"-\"? ([0-9] | [1-9] [0-9]{0,15})) space"},
+            {"number",  "(\"-\"? ([0-9] | [1-9] [0-9]{0,15})) (\".\" [0-9]+)? ([eE] [-+]? [0-9]+)? space"},
+            {"char",    "[^\"\\\\\\x7F\\x00-\\x1F] | [\\\\] ([\"\\\\bfnrt/] | \"u\" [0-9a-fA-F]{4})"},
+            {"string",  "\"\\\"\" char* \"\\\"\" space"},
+            {"value",   "object | array | string | number | boolean | null"},
+            {"object",  "\"{\" space ( string \":\" space value (\",\" space string \":\" space value)* )? \"}\" space"},
+            {"array",   "\"[\" space ( value (\",\" space value)* )? \"]\" space"},
+        };
+
+        const std::map<std::string, std::vector<std::string>> PRIMITIVE_DEPS = {
+            {"boolean", {"space"}},
+            {"null",    {"space"}},
+            {"integer", {"space"}},
+            {"number",  {"space"}},
+            {"string",  {"char", "space"}},
+            {"value",   {"object", "array", "string", "number", "boolean", "null"}},
+            {"object",  {"string", "value", "space"}},
+            {"array",   {"value", "space"}},
+        };
+
+        // GBNF string literal
+        std::string literal(const std::string& text) {
+            std::string out = "\"";
+            for (char c : text) {
+                switch (c) {
+                    case '"':  out += "\\\""; break;
+                    case '\\': out += "\\\\"; break;
+                    case '\n': out += "\\n"; break;
+                    case '\r': out += "\\r"; break;
+                    case '\t': out += "\\t"; break;
+                    default:   out += c;
+                }
+            }
+            return out + "\"";
+        }
+
+        // Rule names may only contain [a-zA-Z0-9-]
+        std::string sanitize(const std::string& name) {
+            std::string out;
+            for (char c : name) {
+                bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-';
+                out += ok ? c : '-';
+            }
+            return out.empty() ? "r" : out;
+        }
+
+        std::string repeat(const std::string& item, int min, int max) {
+            // "[" item ("," item){min-1,max-1} "]", optional when min == 0
+            const std::string sep = "(\",\" space " + item + ")";
+            if (max == 0) return "";
+            std::string tail;
+            int lo = std::max(0, min - 1);
+            if (max < 0) {
+                tail = lo == 0 ? sep + "*" : sep + "{" + std::to_string(lo) + ",}";
+            } else if (max - 1 > lo) {
+                tail = sep + "{" + std::to_string(lo) + "," + std::to_string(max - 1) + "}";
+            } else if (lo > 0) {
+                tail = sep + "{" + std::to_string(lo) + "}";
+            }
+            std::string body = item + (tail.empty() ? "" : " " + tail);
+            return min == 0 ? "( " + body + " )?" : body;
+        }
+
+        class SchemaConverter {
+        public:
+            explicit SchemaConverter(const json& root) : root_(root) {}
+
+            std::string convert() {
+                std::string body = visit(root_, "root");
+                addRule("root", body);
+
+                std::string out;
+                // root first, then user rules, then primitives
+                for (const auto& name : order_) {
+                    if (name == "root") out += name + " ::= " + rules_[name] + "\n";
+                }
+                for (const auto& name : order_) {
+                    if (name != "root") out += name + " ::= " + rules_[name] + "\n";
+                }
+                for (const auto& name : primitives_) {
+                    out += name + " ::= " + PRIMITIVES.at(name) + "\n";
+                }
+                return out;
+            }
+
+        private:
+            const json& root_;
+            std::map<std::string, std::string> rules_;
+            std::vector<std::string> order_;
+            std::set<std::string> primitives_;
+            std::map<std::string, std::string> refs_;  // $ref -> rule name
+
+            std::string usePrimitive(const std::string& name) {
+                if (primitives_.insert(name).second) {
+                    auto deps = PRIMITIVE_DEPS.find(name);
+                    if (deps != PRIMITIVE_DEPS.end()) {
+                        for (const auto& dep : deps->second) usePrimitive(dep);
+                    }
+                }
+                return name;
+            }
+
+            // Register a named rule; returns the (possibly de-duplicated) name
+            std::string addRule(const std::string& wanted, const std::string& body) {
+                std::string name = sanitize(wanted);
+                std::string candidate = name;
+                for (int i = 1; rules_.count(candidate) && rules_[candidate] != body; i++) {
+                    candidate = name + std::to_string(i);
+                }
+                if (!rules_.count(candidate)) {
+                    rules_[candidate] = body;
+                    order_.push_back(candidate);
+                }
+                return candidate;
+            }
+
+            std::string resolveRef(const std::string& ref) {
+                auto known = refs_.find(ref);
+                if (known != refs_.end()) return known->second;
+
+                std::string prefix;
+                if (ref.rfind("#/$defs/", 0) == 0) prefix = "#/$defs/";
+                else if (ref.rfind("#/definitions/", 0) == 0) prefix = "#/definitions/";
+                else throw std::invalid_argument("Unsupported $ref: " + ref);
+
+                std::string key = ref.substr(prefix.size());
+                const char* section = prefix == "#/$defs/" ? "$defs" : "definitions";
+                if (!root_.contains(section) || !root_[section].contains(key)) {
+                    throw std::invalid_argument("Unresolved $ref: " + ref);
+                }
+
+                // Reserve the name first so recursive schemas terminate
+                std::string name = sanitize("ref-" + key);
+                refs_[ref] = name;
+                rules_[name] = "";
+                order_.push_back(name);
+                rules_[name] = visit(root_[section][key], name);
+                return name;
+            }
+
+            // Returns a rule body for the schema; nested schemas become named rules
+            std::string visit(const json& schema, const std::string& name) {
+                if (schema.is_boolean()) {
+                    if (!schema.get<bool>()) throw std::invalid_argument("Schema 'false' matches nothing");
+                    return usePrimitive("value");
+                }
+                if (!schema.is_object()) {
+                    throw std::invalid_argument("Schema must be an object");
+                }
+
+                for (const char* key : {"allOf", "not", "pattern", "patternProperties", "if"}) {
+                    if (schema.contains(key)) {
+                        throw std::invalid_argument(std::string("Unsupported schema keyword: ") + key);
+                    }
+                }
+
+                if (schema.contains("$ref")) {
+                    return resolveRef(schema["$ref"].get<std::string>());
+                }
+
+                if (schema.contains("const")) {
+                    return literal(schema["const"].dump()) + " " + usePrimitive("space");
+                }
+
+                if (schema.contains("enum")) {
+                    std::string body;
+                    for (const auto& value : schema["enum"]) {
+                        if (!body.empty()) body += " | ";
+                        body += literal(value.dump());
+                    }
+                    if (body.empty()) throw std::invalid_argument("Empty enum");
+                    return "(" + body + ") " + usePrimitive("space");
+                }
+
+                for (const char* key : {"anyOf", "oneOf"}) {
+                    if (schema.contains(key)) {
+                        std::string body;
+                        int i = 0;
+                        for (const auto& alt : schema[key]) {
+                            if (!body.empty()) body += " | ";
+                            body += addRule(name + "-" + std::to_string(i), visit(alt, name + "-" + std::to_string(i)));
+                            i++;
+                        }
+                        if (body.empty()) throw std::invalid_argument(std::string("Empty ") + key);
+                        return body;
+                    }
+                }
+
+                if (!schema.contains("type")) {
+                    if (schema.contains("properties")) return visitObject(schema, name);
+                    if (schema.contains("items")) return visitArray(schema, name);
+                    return usePrimitive("value");
+                }
+
+                const json& type = schema["type"];
+                if (type.is_array()) {
+                    std::string body;
+                    for (const auto& t : type) {
+                        json single = schema;
+                        single["type"] = t;
+                        std::string sub = name + "-" + t.get<std::string>();
+                        if (!body.empty()) body += " | ";
+                        body += addRule(sub, visit(single, sub));
+                    }
+                    if (body.empty()) throw std::invalid_argument("Empty type list");
+                    return body;
+                }
+
+                std::string t = type.get<std::string>();
+                if (t == "object") return visitObject(schema, name);
+                if (t == "array") return visitArray(schema, name);
+                if (t == "string") return visitString(schema);
+                if (t == "integer" || t == "number" || t == "boolean" || t == "null") return usePrimitive(t);
+                throw std::invalid_argument("Unsupported type: " + t);
+            }
+
+            std::string visitString(const json& schema) {
+                int min = schema.value("minLength", 0);
+                int max = schema.value("maxLength", -1);
+                if (min == 0 && max < 0) return usePrimitive("string");
+
+                usePrimitive("char");
+                std::string reps = max < 0 ? "{" + std::to_string(min) + ",}"
+                                           : "{" + std::to_string(min) + "," + std::to_string(max) + "}";
+                return "\"\\\"\" char" + reps + " \"\\\"\" " + usePrimitive("space");
+            }
+
+            std::string visitArray(const json& schema, const std::string& name) {
+                usePrimitive("space");
+                int min = schema.value("minItems", 0);
+                int max = schema.value("maxItems", -1);
+
+                if (schema.contains("items") && schema["items"].is_array()) {
+                    // Tuple form: fixed positions
+                    std::string body = "\"[\" space";
+                    int i = 0;
+                    for (const auto& item : schema["items"]) {
+                        std::string sub = name + "-" + std::to_string(i);
+                        if (i > 0) body += " \",\" space";
+                        body += " " + addRule(sub, visit(item, sub));
+                        i++;
+                    }
+                    return body + " \"]\" space";
+                }
+
+                std::string item = schema.contains("items")
+                    ? addRule(name + "-item", visit(schema["items"], name + "-item"))
+                    : usePrimitive("value");
+                return "\"[\" space " + repeat(item, min, max) + " \"]\" space";
+            }
+
+            std::string visitObject(const json& schema, const std::string& name) {
+                usePrimitive("space");
+                if (!schema.contains("properties")) {
+                    return usePrimitive("object");
+                }
+
+                std::set<std::string> required;
+                if (schema.contains("required")) {
+                    for (const auto& r : schema["required"]) required.insert(r.get<std::string>());
+                }
+
+                std::vector<std::string> req, opt;
+                for (auto it = schema["properties"].begin(); it != schema["properties"].end(); ++it) {
+                    std::string sub = name + "-" + it.key();
+                    std::string valueRule = addRule(sub, visit(it.value(), sub));
+                    std::string kv = addRule(sub + "-kv", literal(json(it.key()).dump()) + " space \":\" space " + valueRule);
+                    (required.count(it.key()) ? req : opt).push_back(kv);
+                }
+                for (const auto& r : required) {
+                    if (!schema["properties"].contains(r)) {
+                        throw std::invalid_argument("Required property not declared: " + r);
+                    }
+                }
+
+                std::string body = "\"{\" space";
+                for (size_t i = 0; i < req.size(); i++) {
+                    body += (i == 0 ? " " : " \",\" space ") + req[i];
+                }
+
+                if (!opt.empty()) {
+                    if (!req.empty()) {
+                        // Any subset of the optional properties, in order
+                        for (const auto& kv : opt) body += " (\",\" space " + kv + ")?";
+                    } else {
+                        // The first present optional property has no leading comma
+                        std::string alts;
+                        for (size_t i = 0; i < opt.size(); i++) {
+                            std::string rest = opt[i];
+                            for (size_t j = i + 1; j < opt.size(); j++) rest += " (\",\" space " + opt[j] + ")?";
+                            if (!alts.empty()) alts += " | ";
+                            alts += addRule(name + "-rest-" + std::to_string(i), rest);
+                        }
+                        body += " (" + alts + ")?";
+                    }
+                }
+
+                return body + " \"}\" space";
+            }
+        };
+
+    }
+
+    std::string jsonSchemaToGbnf(const nlohmann::json& schema) {
+        SchemaConverter converter(schema);
+        try {
+            return converter.convert();
+        } catch (const json::exception& e) {
+            // Wrongly typed keywords, e.g. {"type": 5} or {"minLength": "3"}
+            throw std::invalid_argument(std::string("Invalid schema: ") + e.what());
+        }
+    }
+
+}
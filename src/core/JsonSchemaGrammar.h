@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+#include <nlohmann/json.hpp>
+
+namespace Core {
+
+    /**
+     * Convert a JSON schema into a GBNF grammar whose root rule is "root".
+     *
+     * Supported: type (incl. type arrays), properties/required, items,
+     * minItems/maxItems, minLength/maxLength, enum, const, anyOf/oneOf and
+     * local $ref (#/$defs/..., #/definitions/...). Objects never accept
+     * properties beyond the declared ones; required properties come first, then
+     * the optional ones, each in key order (nlohmann::json sorts object keys, so
+     * declaration order is already lost). Throws std::invalid_argument for
+     * anything it cannot honor (e.g. pattern, allOf, remote $ref) rather than
+     * silently loosening it, and for malformed schemas (e.g. {"type": 5}).
+     */
+    std::string jsonSchemaToGbnf(const nlohmann::json& schema);
+
+}
@@ -0,0 +1,135 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Core {
+
+    namespace {
+        constexpr uint64_t SUB_BUCKETS = 1ull << LatencyHistogram::SUB_BUCKET_BITS;
+        constexpr uint64_t HALF = SUB_BUCKETS / 2;
+        constexpr uint64_t MAX_VALUE = (1ull << LatencyHistogram::MAX_VALUE_BITS) - 1;
+
+        // (client, priority) map key; client ids cannot contain control characters
+        std::string seriesKey(const std::string& client_id, const std::string& priority) {
+            return client_id + '\x1f' + priority;
+        }
+
+        void accumulate(LatencyRecorder::PhaseSnapshots& into, const LatencyRecorder::PhaseSnapshots& from) {
+            for (size_t i = 0; i < into.size(); i++) into[i].merge(from[i]);
+        }
+    }
+
+    void HistogramSnapshot::merge(const HistogramSnapshot& other) {
+        if (counts.size() < other.counts.size()) counts.resize(other.counts.size(), 0);
+        for (size_t i = 0; i < other.counts.size(); i++) counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        max = std::max(max, other.max);
+    }
+
+    uint64_t HistogramSnapshot::percentile(double q) const {
+        if (total == 0) return 0;
+        uint64_t rank = (uint64_t)std::ceil(std::clamp(q, 0.0, 1.0) * total);
+        if (rank == 0) rank = 1;
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::min(LatencyHistogram::bucketValue(i), max);
+            }
+        }
+        return max;
+    }
+
+    size_t LatencyHistogram::bucketIndex(uint64_t value) {
+        value = std::min(value, MAX_VALUE);
+        if (value < SUB_BUCKETS) {
+            return value;
+        }
+        // Values in [2^e, 2^(e+1)) keep their top SUB_BUCKET_BITS bits
+        int e = 63 - __builtin_clzll(value);
+        int shift = e - SUB_BUCKET_BITS + 1;
+        return shift * HALF + (value >> shift);
+    }
+
+    uint64_t LatencyHistogram::bucketValue(size_t index) {
+        if (index < SUB_BUCKETS) {
+            return index;
+        }
+        uint64_t shift = index / HALF - 1;
+        uint64_t sub = index - shift * HALF;
+        uint64_t lower = sub << shift;
+        return lower + ((1ull << shift) >> 1);
+    }
+
+    void LatencyHistogram::record(uint64_t value_us) {
+        counts_[bucketIndex(value_us)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value_us, std::memory_order_relaxed);
+
+        uint64_t seen = max_.load(std::memory_order_relaxed);
+        while (value_us > seen && !max_.compare_exchange_weak(seen, value_us, std::memory_order_relaxed)) {
+        }
+    }
+
+    HistogramSnapshot LatencyHistogram::snapshot() const {
+        HistogramSnapshot s;
+        s.counts.resize(BUCKETS);
+        for (size_t i = 0; i < BUCKETS; i++) {
+            s.counts[i] = counts_[i].load(std::memory_order_relaxed);
+            s.total += s.counts[i];
+        }
+        s.sum = sum_.load(std::memory_order_relaxed);
+        s.max = max_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    const char* latencyPhaseName(LatencyPhase phase) {
+        switch (phase) {
+            case LatencyPhase::QUEUE_WAIT: return "queue_wait";
+            case LatencyPhase::TTFT: return "ttft";
+            case LatencyPhase::INTER_TOKEN: return "inter_token";
+            case LatencyPhase::TOTAL: return "total";
+            default: return "unknown";
+        }
+    }
+
+    LatencyRecorder::LatencyRecorder(size_t shards) {
+        for (size_t i = 0; i < std::max<size_t>(shards, 1); i++) {
+            shards_.push_back(std::make_unique<Shard>());
+        }
+    }
+
+    LatencyRecorder::Series* LatencyRecorder::series(size_t shard, const std::string& client_id,
+                                                     const std::string& priority) {
+        Shard& s = *shards_[shard % shards_.size()];
+        std::string key = seriesKey(client_id, priority);
+
+        // Only the owning thread inserts, so its own lookups need no lock
+        auto it = s.series.find(key);
+        if (it != s.series.end()) {
+            return it->second.get();
+        }
+
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.series.emplace(std::move(key), std::make_unique<Series>()).first->second.get();
+    }
+
+    LatencyRecorder::Report LatencyRecorder::report() const {
+        Report report;
+        for (const auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            for (const auto& [key, series] : shard->series) {
+                PhaseSnapshots snaps;
+                for (size_t i = 0; i < PHASES; i++) snaps[i] = series->phases[i].snapshot();
+
+                size_t sep = key.find('\x1f');
+                accumulate(report.all, snaps);
+                accumulate(report.byClient[key.substr(0, sep)], snaps);
+                accumulate(report.byPriority[key.substr(sep + 1)], snaps);
+            }
+        }
+        return report;
+    }
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Core {
+
+    // Merged, non-atomic copy of one or more histograms
+    struct HistogramSnapshot {
+        std::vector<uint64_t> counts;
+        uint64_t total = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+
+        void merge(const HistogramSnapshot& other);
+
+        // Value at quantile q (0.0 - 1.0), within the bucket precision; 0 if empty
+        uint64_t percentile(double q) const;
+        double mean() const { return total ? (double)sum / total : 0.0; }
+    };
+
+    /**
+     * LatencyHistogram - Log-linear (HDR-style) histogram of microsecond values
+     *
+     * Each power of two is split into 16 linear sub-buckets (32 below 32 us), which
+     * keeps the relative error under ~3% from 1 us to ~19 h in 528 counters.
+     * record() is a couple of relaxed atomic adds; readers take snapshots.
+     */
+    class LatencyHistogram {
+    public:
+        static constexpr int SUB_BUCKET_BITS = 5;
+        static constexpr int MAX_VALUE_BITS = 36;  // Larger values are clamped
+        static constexpr size_t BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 2) << (SUB_BUCKET_BITS - 1);
+
+        void record(uint64_t value_us);
+        HistogramSnapshot snapshot() const;
+
+        static size_t bucketIndex(uint64_t value);
+        // Midpoint of the values that map to a bucket
+        static uint64_t bucketValue(size_t index);
+
+    private:
+        std::array<std::atomic<uint64_t>, BUCKETS> counts_{};
+        std::atomic<uint64_t> sum_{0};
+        std::atomic<uint64_t> max_{0};
+    };
+
+    enum class LatencyPhase {
+        QUEUE_WAIT,   // Enqueued -> picked up by a worker
+        TTFT,         // Enqueued -> first token (as seen by the client)
+        INTER_TOKEN,  // Between consecutive tokens
+        TOTAL,        // Enqueued -> completion
+        COUNT
+    };
+
+    const char* latencyPhaseName(LatencyPhase phase);
+
+    /**
+     * LatencyRecorder - Per-phase histograms by client and priority, sharded per worker
+     *
+     * Each worker thread owns one shard and records into it without contention; the
+     * shard map is only locked when a worker meets a new (client, priority) pair and
+     * while a reader merges. Shard i must only be written by one thread.
+     */
+    class LatencyRecorder {
+    public:
+        static constexpr size_t PHASES = static_cast<size_t>(LatencyPhase::COUNT);
+
+        // Histograms of one (client, priority) pair in one shard
+        struct Series {
+            std::array<LatencyHistogram, PHASES> phases;
+            void record(LatencyPhase phase, uint64_t value_us) {
+                phases[static_cast<size_t>(phase)].record(value_us);
+            }
+        };
+
+        using PhaseSnapshots = std::array<HistogramSnapshot, PHASES>;
+
+        struct Report {
+            PhaseSnapshots all;
+            std::map<std::string, PhaseSnapshots> byClient;
+            std::map<std::string, PhaseSnapshots> byPriority;
+        };
+
+        explicit LatencyRecorder(size_t shards);
+
+        // Series for a (client, priority) pair in a shard; the pointer stays valid for the
+        // recorder's lifetime. Must be called from the thread owning the shard.
+        Series* series(size_t shard, const std::string& client_id, const std::string& priority);
+
+        // Merge every shard (thread-safe)
+        Report report() const;
+
+    private:
+        struct Shard {
+            std::unordered_map<std::string, std::unique_ptr<Series>> series;
+            mutable std::mutex mutex;  // Inserts vs. readers; the owner reads without it
+        };
+
+        std::vector<std::unique_ptr<Shard>> shards_;
+    };
+
+}
@@ -0,0 +1,562 @@
+#include "LlamaSession.h"
+#include "Logger.h"
+#include "Logprobs.h"
+#include "Trace.h"
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+namespace Core {
+
+    LlamaSession::LlamaSession(const std::string& session_id, 
+                               const std::string& client_id,
+                               struct llama_model* model,
+                               int ctx_size,
+                               GrammarCache* grammarCache) 
+        : Session(session_id, client_id), model_(model), grammarCache_(grammarCache) {
+        
+        if (!model_) {
+            throw std::runtime_error("Cannot create session with null model");
+        }
+
+        // Create context for this session
+        auto cparams = llama_context_default_params();
+        cparams.n_ctx = ctx_size;
+        cparams.n_batch = 512;   // Logical batch size
+        cparams.n_ubatch = 512;  // Physical batch size
+        cparams.no_perf = false; // Prefill/decode timings for Metrics
+        
+        ctx_ = llama_init_from_model(model_, cparams);
+        if (!ctx_) {
+            throw std::runtime_error("Failed to create context for session " + session_id_);
+        }
+
+        LOG_DEBUG("Created session " << session_id_ 
+                  << " for client " << client_id_);
+    }
+
+    LlamaSession::~LlamaSession() {
+        if (ctx_) {
+            llama_free(ctx_);
+            ctx_ = nullptr;
+        }
+        LOG_DEBUG("Destroyed session " << session_id_);
+    }
+
+    void LlamaSession::abort() {
+        abort_flag_ = true;
+    }
+
+    std::vector<llama_token> LlamaSession::tokenize(const std::string& text, bool add_bos, bool parse_special) {
+        // Upper limit for the number of tokens
+        int n_tokens_max = text.length() + (add_bos ? 1 : 0) + 1;
+        std::vector<llama_token> tokens(n_tokens_max);
+        
+        const llama_vocab* vocab = llama_model_get_vocab(model_);
+
+        int n_tokens = llama_tokenize(vocab, text.c_str(), text.length(), 
+                                       tokens.data(), n_tokens_max, add_bos, parse_special);
+        
+        if (n_tokens < 0) {
+            tokens.resize(-n_tokens);
+            n_tokens = llama_tokenize(vocab, text.c_str(), text.length(), 
+                                      tokens.data(), tokens.size(), add_bos, parse_special);
+        }
+
+        if (n_tokens >= 0) {
+            tokens.resize(n_tokens);
+        } else {
+            tokens.clear();
+        }
+        
+        return tokens;
+    }
+
+    std::string LlamaSession::tokenToPiece(llama_token token) {
+        if (!model_) return "";
+        char buf[256];
+        const llama_vocab* vocab = llama_model_get_vocab(model_);
+        int n = llama_token_to_piece(vocab, token, buf, sizeof(buf), 0, true);
+        if (n < 0) {
+            return "";
+        }
+        return std::string(buf, n);
+    }
+
+    struct llama_sampler* LlamaSession::acquireGrammar(const std::string& grammar) {
+        if (grammar.empty()) return nullptr;
+
+        const llama_vocab* vocab = llama_model_get_vocab(model_);
+        struct llama_sampler* sampler = grammarCache_ ? grammarCache_->acquire(vocab, grammar)
+                                                      : llama_sampler_init_grammar(vocab, grammar.c_str(), "root");
+        if (!sampler) {
+            throw std::invalid_argument("Invalid grammar");
+        }
+        return sampler;
+    }
+
+    size_t LlamaSession::getMessageCount() const {
+        std::lock_guard<std::mutex> lock(messages_mutex_);
+        return messages_.size();
+    }
+
+    size_t LlamaSession::countTokens(const std::string& text) {
+        return tokenize(text, false, true).size();
+    }
+
+    std::string LlamaSession::renderChat(const std::vector<ChatMessage>& messages) const {
+        std::vector<llama_chat_message> chat;
+        chat.reserve(messages.size());
+        for (const auto& m : messages) {
+            chat.push_back(llama_chat_message{m.role.c_str(), m.content.c_str()});
+        }
+
+        // The model's own template; llama.cpp falls back to chatml when there is none
+        const char* tmpl = llama_model_chat_template(model_, nullptr);
+
+        std::vector<char> buf(1024);
+        int n = llama_chat_apply_template(tmpl, chat.data(), chat.size(), true, buf.data(), buf.size());
+        if (n > (int)buf.size()) {
+            buf.resize(n);
+            n = llama_chat_apply_template(tmpl, chat.data(), chat.size(), true, buf.data(), buf.size());
+        }
+        if (n < 0) {
+            throw std::invalid_argument("The model's chat template is not supported");
+        }
+        return std::string(buf.data(), n);
+    }
+
+    size_t LlamaSession::reuseCachedPrefix(const std::vector<llama_token>& tokens) {
+        size_t n = 0;
+        while (n < tokens.size() && n < kv_tokens_.size() && tokens[n] == kv_tokens_[n]) n++;
+        // Decode at least one token so the last position has fresh logits
+        if (n == tokens.size() && n > 0) n--;
+
+        llama_memory_t mem = llama_get_memory(ctx_);
+        if (!llama_memory_seq_rm(mem, 0, n, -1)) {
+            // Partial removal unsupported (e.g. recurrent models): start over
+            llama_memory_clear(mem, false);
+            n = 0;
+        }
+        kv_tokens_.resize(n);
+        return n;
+    }
+
+    bool LlamaSession::prefill(const std::vector<llama_token>& tokens, size_t from) {
+        const int n_batch = llama_n_batch(ctx_);
+        llama_batch batch = llama_batch_init(n_batch, 0, 1);
+
+        for (size_t i = from; i < tokens.size(); ) {
+            batch.n_tokens = 0;
+            size_t chunk_start = i;
+            for (; i < tokens.size() && batch.n_tokens < n_batch; i++) {
+                int idx = batch.n_tokens++;
+                batch.token[idx] = tokens[i];
+                batch.pos[idx] = kv_tokens_.size() + (i - chunk_start);
+                batch.n_seq_id[idx] = 1;
+                batch.seq_id[idx][0] = 0;
+                batch.logits[idx] = (i + 1 == tokens.size());  // Logits for the last token only
+            }
+
+            if (llama_decode(ctx_, batch) != 0) {
+                llama_batch_free(batch);
+                return false;
+            }
+            kv_tokens_.insert(kv_tokens_.end(), tokens.begin() + chunk_start, tokens.begin() + i);
+        }
+
+        llama_batch_free(batch);
+        return true;
+    }
+
+    Metrics LlamaSession::complete(const std::vector<llama_token>& tokens, size_t from, Sampler& sampler,
+                              const GenerationParams& params, TokenCallback callback, std::string* reply) {
+        Metrics metrics;
+        auto start_time = std::chrono::high_resolution_clock::now();
+        bool is_first_token = true;
+
+        metrics.cached_tokens = from;
+        metrics.prompt_tokens = tokens.size() - from;
+        stopped_by_callback_ = false;
+
+        // Phase timers; decodes are synchronized so GPU work is charged to its own phase
+        using Clock = std::chrono::steady_clock;
+        auto msSince = [](Clock::time_point t0) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        };
+        llama_perf_context_reset(ctx_);
+
+        // Sampled requests also get each phase as a trace span (same clock reads)
+        const uint64_t trace = Tracer::current();
+        auto traceSince = [trace](const char* name, Clock::time_point t0) {
+            if (trace) {
+                Tracer& tracer = Tracer::instance();
+                tracer.record(name, trace, tracer.toUs(t0), tracer.nowUs() - tracer.toUs(t0));
+            }
+        };
+
+        // 1. Prefill whatever is not already in the KV cache
+        auto prefill_start = Clock::now();
+        if (!prefill(tokens, from)) {
+            LOG_ERROR("llama_decode failed for session " << session_id_);
+            state_ = SessionState::ERROR;
+            return metrics;
+        }
+        llama_synchronize(ctx_);
+        metrics.prefill_ms = msSince(prefill_start);
+        traceSince("prefill", prefill_start);
+
+        // 2. Generation Loop
+        const llama_vocab* vocab = llama_model_get_vocab(model_);
+        const int n_vocab = llama_vocab_n_tokens(vocab);
+        const size_t n_ctx = llama_n_ctx(ctx_);
+        std::vector<TokenLogprob> top;
+        TokenLogprobs logprobs_out;
+        llama_batch batch = llama_batch_init(1, 0, 1);
+        int decode_steps = 0;  // Single-token decodes (the first token comes from the prefill)
+
+        while (true) {
+            // Check abort
+            if (abort_flag_) {
+                break;
+            }
+
+            // Sample (grammar-constrained when requested) and advance sampler state
+            auto sample_start = Clock::now();
+            const float* logits = llama_get_logits_ith(ctx_, -1);
+            llama_token new_token_id = sampler.sample(logits);
+            sampler.accept(new_token_id);
+            metrics.sample_ms += msSince(sample_start);
+            traceSince("sample", sample_start);
+
+            // Time to First Token
+            if (is_first_token) {
+                auto now = std::chrono::high_resolution_clock::now();
+                metrics.ttft_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time).count();
+                is_first_token = false;
+            }
+
+            if (llama_vocab_is_eog(vocab, new_token_id)) {
+                metrics.completed = true;
+                break;
+            }
+
+            std::string piece = tokenToPiece(new_token_id);
+            metrics.tokens_generated++;
+            if (reply) {
+                *reply += piece;
+            }
+
+            // Only requests that ask for logprobs pay for the extra pass over the logits
+            const TokenLogprobs* token_logprobs = nullptr;
+            if (params.logprobs > 0) {
+                auto logprobs_start = Clock::now();
+                float lse = Logprobs::logSumExp(logits, n_vocab);
+                Logprobs::topN(logits, n_vocab, params.logprobs, lse, top);
+
+                logprobs_out.logprob = logits[new_token_id] - lse;
+                logprobs_out.top.clear();
+                for (const auto& entry : top) {
+                    logprobs_out.top.push_back(LogprobEntry{tokenToPiece(entry.id), entry.logprob});
+                }
+                token_logprobs = &logprobs_out;
+                metrics.sample_ms += msSince(logprobs_start);
+                traceSince("logprobs", logprobs_start);
+            }
+
+            if (callback) {
+                auto callback_start = Clock::now();
+                bool keep_going = callback(piece, token_logprobs);
+                metrics.callback_ms += msSince(callback_start);
+                traceSince("callback", callback_start);
+                if (!keep_going) {
+                    // User aborted (or paused: see suspend())
+                    stopped_by_callback_ = true;
+                    stop_token_ = new_token_id;
+                    break;
+                }
+            }
+
+            if (params.max_tokens > 0 && metrics.tokens_generated >= params.max_tokens) {
+                metrics.completed = true;
+                break;
+            }
+            if (kv_tokens_.size() >= n_ctx) {
+                metrics.completed = true;
+                break; // Context full
+            }
+
+            // Prepare next batch for single token
+            batch.n_tokens = 1;
+            batch.token[0] = new_token_id;
+            batch.pos[0] = kv_tokens_.size();
+            batch.n_seq_id[0] = 1;
+            batch.seq_id[0][0] = 0;
+            batch.logits[0] = true;
+
+            auto decode_start = Clock::now();
+            if (llama_decode(ctx_, batch) != 0) {
+                LOG_ERROR("llama_decode failed during generation for session " 
+                          << session_id_);
+                break;
+            }
+            llama_synchronize(ctx_);
+            metrics.decode_ms += msSince(decode_start);
+            traceSince("decode", decode_start);
+            decode_steps++;
+            kv_tokens_.push_back(new_token_id);
+        }
+        
+        // Finalize Metrics
+        auto end_time = std::chrono::high_resolution_clock::now();
+        metrics.total_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+        if (metrics.total_time_ms > 0) {
+            metrics.tps = (double)metrics.tokens_generated / (metrics.total_time_ms / 1000.0);
+        }
+
+        // Prefer llama.cpp's own eval timers (graph compute only, no batch setup). It files
+        // multi-token batches under prompt eval and single tokens under eval, so they only
+        // line up with our phases when every prefill chunk had more than one token.
+        llama_perf_context_data perf = llama_perf_context(ctx_);
+        if (perf.n_p_eval == metrics.prompt_tokens && perf.n_p_eval > 0) {
+            metrics.prefill_ms = perf.t_p_eval_ms;
+            if (perf.n_eval > 0) metrics.decode_ms = perf.t_eval_ms;
+        }
+        if (metrics.prefill_ms > 0) {
+            metrics.prefill_tps = metrics.prompt_tokens / (metrics.prefill_ms / 1000.0);
+        }
+        if (metrics.decode_ms > 0) {
+            metrics.decode_tps = decode_steps / (metrics.decode_ms / 1000.0);
+        }
+
+        // Cleanup
+        llama_batch_free(batch);
+
+        if (sampler.grammarResamples() > 0) {
+            LOG_DEBUG("Session " << session_id_ << ": grammar rejected " << sampler.grammarResamples()
+                      << " of " << metrics.tokens_generated << " unconstrained picks");
+        }
+        
+        state_ = SessionState::IDLE;
+        return metrics;
+    }
+
+    Metrics LlamaSession::generate(const std::string& prompt, const GenerationParams& params, TokenCallback callback) {
+        std::unique_lock<std::mutex> busy(busy_mutex_, std::try_to_lock);
+        if (!busy.owns_lock()) {
+            throw std::invalid_argument("Session is busy");
+        }
+
+        if (!ctx_) {
+            state_ = SessionState::ERROR;
+            return Metrics();
+        }
+
+        // Compile (or clone from cache) the grammar before touching session state
+        auto sampler = std::make_unique<Sampler>(llama_model_get_vocab(model_), acquireGrammar(params.grammar));
+
+        state_ = SessionState::GENERATING;
+        abort_flag_ = false;
+        suspended_.reset();
+
+        // Raw prompts replace whatever the KV holds, keeping only the shared prefix
+        std::vector<llama_token> tokens = tokenize(prompt, true);
+        if (tokens.empty()) {
+            state_ = SessionState::IDLE;
+            return Metrics();
+        }
+        chat_in_kv_ = false;
+        size_t cached = reuseCachedPrefix(tokens);
+
+        Metrics metrics = complete(tokens, cached, *sampler, params, callback, nullptr);
+        suspend(std::move(sampler), params, metrics, false);
+        return metrics;
+    }
+
+    void LlamaSession::suspend(std::unique_ptr<Sampler> sampler, const GenerationParams& params,
+                               const Metrics& metrics, bool chat) {
+        if (!stopped_by_callback_ || state_ == SessionState::ERROR) {
+            return;
+        }
+        auto suspended = std::make_unique<Suspended>();
+        suspended->sampler = std::move(sampler);
+        suspended->params = params;
+        suspended->token = stop_token_;
+        suspended->chat = chat;
+        if (params.max_tokens > 0) {
+            suspended->params.max_tokens -= metrics.tokens_generated;
+            if (suspended->params.max_tokens <= 0) {
+                return;  // Nothing left to generate
+            }
+        }
+        suspended_ = std::move(suspended);
+    }
+
+    Metrics LlamaSession::resume(TokenCallback callback) {
+        std::unique_lock<std::mutex> busy(busy_mutex_, std::try_to_lock);
+        if (!busy.owns_lock()) {
+            throw std::invalid_argument("Session is busy");
+        }
+        if (!suspended_ || !ctx_) {
+            throw std::invalid_argument("Nothing to resume");
+        }
+        auto suspended = std::move(suspended_);
+
+        // No abort_flag_ reset: an abort sent while the generation was paused still applies
+        state_ = SessionState::GENERATING;
+
+        // The last streamed token was never decoded: it is the prompt of this part
+        size_t from = kv_tokens_.size();
+        Metrics metrics;
+        if (from >= static_cast<size_t>(llama_n_ctx(ctx_))) {
+            metrics.completed = true;  // Context full
+            state_ = SessionState::IDLE;
+            return metrics;
+        }
+        std::vector<llama_token> tokens = kv_tokens_;
+        tokens.push_back(suspended->token);
+
+        std::string reply;
+        metrics = complete(tokens, from, *suspended->sampler, suspended->params, callback, &reply);
+
+        if (suspended->chat) {
+            // The KV (and so kv_text_) now also holds the tokens decoded by this part
+            chat_in_kv_ = chat_in_kv_ && state_ != SessionState::ERROR;
+            for (size_t i = from; i < kv_tokens_.size(); i++) {
+                kv_text_ += tokenToPiece(kv_tokens_[i]);
+            }
+
+            std::lock_guard<std::mutex> lock(messages_mutex_);
+            if (!messages_.empty() && messages_.back().role == "assistant") {
+                messages_.back().content += reply;
+            }
+        }
+
+        suspend(std::move(suspended->sampler), suspended->params, metrics, suspended->chat);
+        return metrics;
+    }
+
+    Metrics LlamaSession::appendMessage(const std::string& role, const std::string& content, bool generate,
+                                   const GenerationParams& params, TokenCallback callback) {
+        std::unique_lock<std::mutex> busy(busy_mutex_, std::try_to_lock);
+        if (!busy.owns_lock()) {
+            throw std::invalid_argument("Session is busy");
+        }
+
+        if (role != "system" && role != "user" && role != "assistant") {
+            throw std::invalid_argument("Unknown role: " + role);
+        }
+
+        if (!ctx_) {
+            state_ = SessionState::ERROR;
+            return Metrics();
+        }
+        suspended_.reset();
+
+        std::vector<ChatMessage> history;
+        {
+            std::lock_guard<std::mutex> lock(messages_mutex_);
+            messages_.push_back(ChatMessage{role, content});
+            if (!generate) {
+                // Prefilled lazily, together with the next message that asks for a reply
+                return Metrics();
+            }
+            history = messages_;
+        }
+
+        // On any error below, the message is taken back out of the history
+        auto rollback = [this]() {
+            std::lock_guard<std::mutex> lock(messages_mutex_);
+            messages_.pop_back();
+        };
+
+        std::unique_ptr<Sampler> sampler;
+        std::string text;
+        std::vector<llama_token> tokens;
+        size_t cached = 0;
+
+        try {
+            sampler = std::make_unique<Sampler>(llama_model_get_vocab(model_), acquireGrammar(params.grammar));
+
+            const size_t n_ctx = llama_n_ctx(ctx_);
+            const size_t reserve = params.max_tokens > 0 ? params.max_tokens : n_ctx / 4;
+            text = renderChat(history);
+
+            // Fast path: the KV holds a prefix of this conversation; only the new text is tokenized
+            if (chat_in_kv_ && text.compare(0, kv_text_.size(), kv_text_) == 0) {
+                std::vector<llama_token> suffix = tokenize(text.substr(kv_text_.size()), false, true);
+                if (!suffix.empty() && kv_tokens_.size() + suffix.size() + reserve <= n_ctx) {
+                    tokens = kv_tokens_;
+                    cached = tokens.size();
+                    tokens.insert(tokens.end(), suffix.begin(), suffix.end());
+                }
+            }
+
+            // Slow path: re-tokenize everything, dropping the oldest turns until it fits
+            if (tokens.empty()) {
+                size_t dropped = 0;
+                while (true) {
+                    tokens = tokenize(text, true, true);
+                    if (tokens.size() + reserve <= n_ctx) break;
+
+                    auto oldest = std::find_if(history.begin(), history.end() - 1,
+                                               [](const ChatMessage& m) { return m.role != "system"; });
+                    if (oldest == history.end() - 1) {
+                        throw std::invalid_argument("Message does not fit in the context");
+                    }
+                    history.erase(oldest);
+                    dropped++;
+                    text = renderChat(history);
+                }
+
+                if (dropped > 0) {
+                    LOG_INFO("Session " << session_id_ << ": dropped " << dropped
+                             << " oldest message(s) to fit the context");
+                    std::lock_guard<std::mutex> lock(messages_mutex_);
+                    messages_ = history;
+                }
+                cached = reuseCachedPrefix(tokens);
+            }
+        } catch (...) {
+            rollback();
+            throw;
+        }
+
+        state_ = SessionState::GENERATING;
+        abort_flag_ = false;
+
+        std::string reply;
+        Metrics metrics = complete(tokens, cached, *sampler, params, callback, &reply);
+
+        if (state_ == SessionState::ERROR) {
+            // A failed turn leaves no trace: neither the message nor its partial reply. The KV
+            // may hold only part of the prompt, so the next turn re-renders from scratch.
+            chat_in_kv_ = false;
+            kv_text_.clear();
+            rollback();
+            return metrics;
+        }
+
+        // The KV now holds the rendered conversation plus the decoded part of the reply
+        // (a final token that hit max_tokens/abort is streamed but not decoded)
+        chat_in_kv_ = true;
+        kv_text_ = text;
+        size_t decoded = kv_tokens_.size() - tokens.size();
+        size_t decoded_bytes = 0;
+        for (size_t i = 0; i < decoded; i++) {
+            decoded_bytes += tokenToPiece(kv_tokens_[tokens.size() + i]).size();
+        }
+        kv_text_ += reply.substr(0, decoded_bytes);
+
+        // An aborted reply is kept as far as it was streamed: it is what the client saw
+        {
+            std::lock_guard<std::mutex> lock(messages_mutex_);
+            messages_.push_back(ChatMessage{"assistant", reply});
+        }
+
+        suspend(std::move(sampler), params, metrics, true);
+        return metrics;
+    }
+
+}
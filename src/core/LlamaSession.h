@@ -0,0 +1,95 @@
+#pragma once
+
+#include "llama.h"
+#include "Backend.h"
+#include "Engine.h"
+#include "GrammarCache.h"
+#include "Sampler.h"
+#include "Session.h"
+#include <string>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Core {
+
+    // Session on its own llama.cpp context over the shared model
+    class LlamaSession : public Session {
+    public:
+        LlamaSession(const std::string& session_id,
+                     const std::string& client_id,
+                     struct llama_model* model,
+                     int ctx_size,
+                     GrammarCache* grammarCache = nullptr);
+        ~LlamaSession() override;
+
+        Metrics generate(const std::string& prompt, const GenerationParams& params, TokenCallback callback) override;
+        Metrics appendMessage(const std::string& role, const std::string& content, bool generate,
+                              const GenerationParams& params, TokenCallback callback) override;
+        Metrics resume(TokenCallback callback) override;
+        size_t getMessageCount() const override;
+        size_t countTokens(const std::string& text) override;
+        void abort() override;
+
+        // Text <-> tokens with the model's vocabulary (stateless)
+        std::vector<llama_token> tokenize(const std::string& text, bool add_bos, bool parse_special = false);
+        std::string tokenToPiece(llama_token token);
+
+    private:
+        struct llama_context* ctx_ = nullptr;
+        struct llama_model* model_ = nullptr;  // Reference to shared model
+        GrammarCache* grammarCache_ = nullptr;  // Shared, owned by SessionManager
+        std::atomic<bool> abort_flag_{false};
+        std::mutex busy_mutex_;  // Held for the duration of a request
+
+        // Conversation state
+        std::vector<ChatMessage> messages_;
+        mutable std::mutex messages_mutex_;
+        std::vector<llama_token> kv_tokens_;  // Tokens currently in the KV cache (sequence 0)
+        std::string kv_text_;                 // Text those tokens represent, when chat_in_kv_
+        bool chat_in_kv_ = false;             // KV holds the rendered conversation (kv_text_ valid)
+
+        // Generation stopped by its callback, for resume(): the last streamed token is
+        // sampled but not decoded yet
+        struct Suspended {
+            std::unique_ptr<Sampler> sampler;
+            GenerationParams params;  // max_tokens counts what is left
+            llama_token token = 0;
+            bool chat = false;        // Growing the last assistant message
+        };
+        std::unique_ptr<Suspended> suspended_;
+        bool stopped_by_callback_ = false;  // Set by complete()
+        llama_token stop_token_ = 0;
+
+        // Helper methods (similar to Engine)
+        struct llama_sampler* acquireGrammar(const std::string& grammar);
+        std::string renderChat(const std::vector<ChatMessage>& messages) const;
+        size_t reuseCachedPrefix(const std::vector<llama_token>& tokens);
+        bool prefill(const std::vector<llama_token>& tokens, size_t from);
+        Metrics complete(const std::vector<llama_token>& tokens, size_t from, Sampler& sampler,
+                         const GenerationParams& params, TokenCallback callback, std::string* reply);
+        // After complete(): keep the sampler for resume() if the callback stopped it
+        void suspend(std::unique_ptr<Sampler> sampler, const GenerationParams& params,
+                     const Metrics& metrics, bool chat);
+    };
+
+    // Backend over the Engine's loaded model
+    class LlamaBackend : public Backend {
+    public:
+        explicit LlamaBackend(Engine& engine) : engine_(engine) {}
+
+        const char* name() const override { return "llama"; }
+        bool isReady() const override { return engine_.isReady(); }
+        const std::string& getFingerprint() const override { return engine_.getFingerprint(); }
+
+        std::unique_ptr<Session> createSession(const std::string& session_id, const std::string& client_id,
+                                               int ctx_size, GrammarCache* grammarCache) override {
+            return std::make_unique<LlamaSession>(session_id, client_id, engine_.getModel(), ctx_size, grammarCache);
+        }
+
+    private:
+        Engine& engine_;
+    };
+
+}
@@ -0,0 +1,248 @@
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <ctime>
+
+namespace Core {
+
+    // How often the writer drains the thread buffers when nobody wakes it up
+    static const auto WRITER_INTERVAL = std::chrono::milliseconds(20);
+
+    static const char* levelName(LogLevel level) {
+        switch (level) {
+            case LogLevel::DEBUG: return "debug";
+            case LogLevel::INFO:  return "info";
+            case LogLevel::WARN:  return "warn";
+            case LogLevel::ERROR: return "error";
+            default:              return "off";
+        }
+    }
+
+    static const char* levelTag(LogLevel level) {
+        switch (level) {
+            case LogLevel::DEBUG: return "DEBUG";
+            case LogLevel::INFO:  return "INFO";
+            case LogLevel::WARN:  return "WARN";
+            case LogLevel::ERROR: return "ERROR";
+            default:              return "OFF";
+        }
+    }
+
+    static void appendJsonEscaped(std::string& out, const std::string& text) {
+        for (unsigned char c : text) {
+            switch (c) {
+                case '"':  out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (c < 0x20) {
+                        char buf[8];
+                        snprintf(buf, sizeof(buf), "\\u%04x", c);
+                        out += buf;
+                    } else {
+                        out += static_cast<char>(c);
+                    }
+            }
+        }
+    }
+
+    // Marks the owning thread's buffer as dead on thread exit so the writer
+    // can release it once drained.
+    struct Logger::ThreadHandle {
+        std::shared_ptr<ThreadBuffer> buffer;
+        ~ThreadHandle() {
+            if (buffer) buffer->alive.store(false, std::memory_order_release);
+        }
+    };
+
+    Logger& Logger::instance() {
+        static Logger logger;
+        return logger;
+    }
+
+    Logger::Logger() {
+        writer_ = std::thread([this]() { writerLoop(); });
+    }
+
+    Logger::~Logger() {
+        running_ = false;
+        wakeCv_.notify_all();
+        if (writer_.joinable()) {
+            writer_.join();
+        }
+        drain();
+    }
+
+    void Logger::configure(LogLevel level, bool json) {
+        level_ = level;
+        json_ = json;
+    }
+
+    void Logger::setOutput(FILE* out, FILE* err) {
+        std::lock_guard<std::mutex> lock(drainMutex_);
+        out_ = out ? out : stdout;
+        err_ = err ? err : stderr;
+    }
+
+    LogLevel Logger::parseLevel(const std::string& name, LogLevel fallback) {
+        std::string lower = name;
+        std::transform(lower.begin(), lower.end(), lower.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+        if (lower == "debug") return LogLevel::DEBUG;
+        if (lower == "info") return LogLevel::INFO;
+        if (lower == "warn" || lower == "warning") return LogLevel::WARN;
+        if (lower == "error") return LogLevel::ERROR;
+        if (lower == "off" || lower == "none") return LogLevel::OFF;
+        return fallback;
+    }
+
+    Logger::ThreadBuffer& Logger::localBuffer() {
+        thread_local ThreadHandle handle;
+        if (!handle.buffer) {
+            handle.buffer = std::make_shared<ThreadBuffer>();
+            handle.buffer->tid = nextTid_.fetch_add(1);
+            std::lock_guard<std::mutex> lock(registryMutex_);
+            buffers_.push_back(handle.buffer);
+        }
+        return *handle.buffer;
+    }
+
+    void Logger::log(LogLevel level, std::string message) {
+        ThreadBuffer& buf = localBuffer();
+
+        size_t tail = buf.tail.load(std::memory_order_relaxed);
+        size_t used = tail - buf.head.load(std::memory_order_acquire);
+        if (used >= ThreadBuffer::CAPACITY) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        Entry& entry = buf.slots[tail % ThreadBuffer::CAPACITY];
+        entry.ts_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        entry.level = level;
+        entry.tid = buf.tid;
+        entry.message = std::move(message);
+        buf.tail.store(tail + 1, std::memory_order_release);
+
+        // Errors go out promptly; otherwise only wake the writer when filling up
+        if (level >= LogLevel::ERROR || used + 1 >= ThreadBuffer::CAPACITY * 3 / 4) {
+            wakeCv_.notify_one();
+        }
+    }
+
+    void Logger::flush() {
+        drain();
+    }
+
+    void Logger::writerLoop() {
+        while (running_) {
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex_);
+                wakeCv_.wait_for(lock, WRITER_INTERVAL);
+            }
+            drain();
+        }
+    }
+
+    void Logger::drain() {
+        std::lock_guard<std::mutex> drainLock(drainMutex_);
+
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex_);
+            buffers = buffers_;
+        }
+
+        bool releaseDead = false;
+        for (auto& buf : buffers) {
+            bool alive = buf->alive.load(std::memory_order_acquire);
+            size_t head = buf->head.load(std::memory_order_relaxed);
+            size_t tail = buf->tail.load(std::memory_order_acquire);
+            for (size_t i = head; i < tail; ++i) {
+                batch_.push_back(std::move(buf->slots[i % ThreadBuffer::CAPACITY]));
+            }
+            buf->head.store(tail, std::memory_order_release);
+            if (!alive) releaseDead = true;
+        }
+
+        if (releaseDead) {
+            // Dead threads can't enqueue anymore; drop their drained buffers
+            std::lock_guard<std::mutex> lock(registryMutex_);
+            buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(), [](const auto& b) {
+                return !b->alive.load(std::memory_order_acquire) &&
+                       b->head.load(std::memory_order_relaxed) == b->tail.load(std::memory_order_acquire);
+            }), buffers_.end());
+        }
+
+        uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+        if (batch_.empty() && dropped == reportedDropped_) return;
+
+        // Merge per-thread streams into a single timeline
+        std::stable_sort(batch_.begin(), batch_.end(), [](const Entry& a, const Entry& b) {
+            return a.ts_us < b.ts_us;
+        });
+        for (const auto& entry : batch_) {
+            write(entry);
+        }
+        batch_.clear();
+
+        if (dropped != reportedDropped_) {
+            Entry notice;
+            notice.ts_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            notice.level = LogLevel::WARN;
+            notice.message = "[Logger] Dropped " + std::to_string(dropped - reportedDropped_) +
+                             " message(s): thread buffer full";
+            write(notice);
+            reportedDropped_ = dropped;
+        }
+
+        fflush(out_);
+        fflush(err_);
+    }
+
+    void Logger::write(const Entry& entry) {
+        time_t secs = static_cast<time_t>(entry.ts_us / 1000000);
+        int micros = static_cast<int>(entry.ts_us % 1000000);
+        struct tm tm_time;
+        char stamp[32];
+
+        std::string line;
+        line.reserve(entry.message.size() + 64);
+
+        if (json_.load(std::memory_order_relaxed)) {
+            gmtime_r(&secs, &tm_time);
+            strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &tm_time);
+            char frac[16];
+            snprintf(frac, sizeof(frac), ".%06dZ", micros);
+
+            line += "{\"ts\":\"";
+            line += stamp;
+            line += frac;
+            line += "\",\"level\":\"";
+            line += levelName(entry.level);
+            line += "\",\"tid\":";
+            line += std::to_string(entry.tid);
+            line += ",\"msg\":\"";
+            appendJsonEscaped(line, entry.message);
+            line += "\"}\n";
+        } else {
+            localtime_r(&secs, &tm_time);
+            strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm_time);
+            char prefix[64];
+            snprintf(prefix, sizeof(prefix), "%s.%03d %-5s [%u] ", stamp, micros / 1000,
+                     levelTag(entry.level), entry.tid);
+            line += prefix;
+            line += entry.message;
+            line += '\n';
+        }
+
+        FILE* stream = entry.level >= LogLevel::WARN ? err_ : out_;
+        fwrite(line.data(), 1, line.size(), stream);
+    }
+
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdio>
+#include <cstdint>
+
+namespace Core {
+
+    enum class LogLevel {
+        DEBUG = 0,
+        INFO,
+        WARN,
+        ERROR,
+        OFF
+    };
+
+    /**
+     * Logger - Asynchronous logger kept off the hot paths
+     *
+     * Each thread appends to its own lock-free single-producer ring buffer;
+     * a background writer drains all rings, orders entries by timestamp and
+     * writes them in batches (one flush per batch instead of one per line).
+     * If a ring is full the entry is dropped and counted rather than blocking.
+     *
+     * Use the LOG_* macros: the message is only formatted when the level is enabled.
+     */
+    class Logger {
+    public:
+        static Logger& instance();
+
+        // Prevent copying
+        Logger(const Logger&) = delete;
+        Logger& operator=(const Logger&) = delete;
+
+        // Minimum level and output format (plain text or JSON lines)
+        void configure(LogLevel level, bool json);
+
+        // Redirect output (INFO/DEBUG to out, WARN/ERROR to err). Defaults to stdout/stderr.
+        void setOutput(FILE* out, FILE* err);
+
+        bool enabled(LogLevel level) const {
+            return level >= level_.load(std::memory_order_relaxed);
+        }
+
+        // Enqueue a message from the calling thread (never blocks on I/O)
+        void log(LogLevel level, std::string message);
+
+        // Write everything enqueued so far (blocking)
+        void flush();
+
+        // Number of entries dropped because a thread's buffer was full
+        uint64_t droppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+        // Parse "debug" / "info" / "warn" / "error" / "off" (case-insensitive)
+        static LogLevel parseLevel(const std::string& name, LogLevel fallback = LogLevel::INFO);
+
+    private:
+        Logger();
+        ~Logger();
+
+        struct Entry {
+            int64_t ts_us = 0;
+            LogLevel level = LogLevel::INFO;
+            uint32_t tid = 0;
+            std::string message;
+        };
+
+        // Single-producer (owning thread) / single-consumer (writer) ring
+        struct ThreadBuffer {
+            static constexpr size_t CAPACITY = 8192;
+            std::vector<Entry> slots{CAPACITY};
+            std::atomic<size_t> head{0};  // Next slot to read (writer)
+            std::atomic<size_t> tail{0};  // Next slot to write (owner)
+            std::atomic<bool> alive{true};
+            uint32_t tid = 0;
+        };
+
+        struct ThreadHandle;
+        friend struct ThreadHandle;
+
+        ThreadBuffer& localBuffer();
+        void writerLoop();
+        void drain();
+        void write(const Entry& entry);
+
+        std::atomic<LogLevel> level_{LogLevel::INFO};
+        std::atomic<bool> json_{false};
+        std::atomic<uint64_t> dropped_{0};
+        uint64_t reportedDropped_ = 0;
+        FILE* out_ = stdout;
+        FILE* err_ = stderr;
+
+        // Registry of per-thread buffers (only locked on thread registration and drain)
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+        std::mutex registryMutex_;
+        std::atomic<uint32_t> nextTid_{1};
+
+        // Serializes drains between the writer thread and flush()
+        std::mutex drainMutex_;
+        std::vector<Entry> batch_;
+
+        std::mutex wakeMutex_;
+        std::condition_variable wakeCv_;
+        std::atomic<bool> running_{true};
+        std::thread writer_;
+    };
+
+}
+
+#define LOG_AT(lvl, expr) \
+    do { \
+        auto& log_instance_ = ::Core::Logger::instance(); \
+        if (log_instance_.enabled(lvl)) { \
+            std::ostringstream log_stream_; \
+            log_stream_ << expr; \
+            log_instance_.log(lvl, log_stream_.str()); \
+        } \
+    } while (0)
+
+#define LOG_DEBUG(expr) LOG_AT(::Core::LogLevel::DEBUG, expr)
+#define LOG_INFO(expr)  LOG_AT(::Core::LogLevel::INFO, expr)
+#define LOG_WARN(expr)  LOG_AT(::Core::LogLevel::WARN, expr)
+#define LOG_ERROR(expr) LOG_AT(::Core::LogLevel::ERROR, expr)
@@ -0,0 +1,146 @@
+#include "Logprobs.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define LOGPROBS_AVX2 1
+#endif
+
+namespace Core {
+namespace Logprobs {
+
+    float logSumExpScalar(const float* logits, int n) {
+        if (n <= 0) return -std::numeric_limits<float>::infinity();
+        float max = *std::max_element(logits, logits + n);
+        double sum = 0.0;
+        for (int i = 0; i < n; i++) {
+            sum += std::exp((double)logits[i] - max);
+        }
+        return max + (float)std::log(sum);
+    }
+
+#ifdef LOGPROBS_AVX2
+
+    static inline float hmax(__m256 v) {
+        __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+        m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+        return _mm_cvtss_f32(m);
+    }
+
+    static inline float hsum(__m256 v) {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        return _mm_cvtss_f32(s);
+    }
+
+    // exp(x) for x <= 0: 2^k * p(r) with a degree-6 polynomial (rel. error ~1e-7)
+    static inline __m256 exp256(__m256 x) {
+        const __m256 lo = _mm256_set1_ps(-87.3f);
+        x = _mm256_max_ps(x, lo);
+
+        const __m256 log2e = _mm256_set1_ps(1.44269504088896341f);
+        const __m256 ln2_hi = _mm256_set1_ps(0.693359375f);
+        const __m256 ln2_lo = _mm256_set1_ps(-2.12194440e-4f);
+
+        __m256 k = _mm256_round_ps(_mm256_mul_ps(x, log2e), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256 r = _mm256_fnmadd_ps(k, ln2_hi, x);
+        r = _mm256_fnmadd_ps(k, ln2_lo, r);
+
+        __m256 p = _mm256_set1_ps(1.9875691500e-4f);
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.3981999507e-3f));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(8.3334519073e-3f));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(4.1665795894e-2f));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.6666665459e-1f));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(5.0000001201e-1f));
+        __m256 r2 = _mm256_mul_ps(r, r);
+        p = _mm256_fmadd_ps(p, r2, _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+
+        __m256i e = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(k), _mm256_set1_epi32(127)), 23);
+        return _mm256_mul_ps(p, _mm256_castsi256_ps(e));
+    }
+
+    float logSumExp(const float* logits, int n) {
+        if (n < 8) return logSumExpScalar(logits, n);
+
+        int i = 0;
+        __m256 vmax = _mm256_loadu_ps(logits);
+        for (i = 8; i + 8 <= n; i += 8) {
+            vmax = _mm256_max_ps(vmax, _mm256_loadu_ps(logits + i));
+        }
+        float max = hmax(vmax);
+        for (; i < n; i++) max = std::max(max, logits[i]);
+
+        const __m256 vm = _mm256_set1_ps(max);
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        for (i = 0; i + 16 <= n; i += 16) {
+            acc0 = _mm256_add_ps(acc0, exp256(_mm256_sub_ps(_mm256_loadu_ps(logits + i), vm)));
+            acc1 = _mm256_add_ps(acc1, exp256(_mm256_sub_ps(_mm256_loadu_ps(logits + i + 8), vm)));
+        }
+        for (; i + 8 <= n; i += 8) {
+            acc0 = _mm256_add_ps(acc0, exp256(_mm256_sub_ps(_mm256_loadu_ps(logits + i), vm)));
+        }
+        double sum = hsum(_mm256_add_ps(acc0, acc1));
+        for (; i < n; i++) sum += std::exp((double)logits[i] - max);
+
+        return max + (float)std::log(sum);
+    }
+
+#else
+
+    float logSumExp(const float* logits, int n) {
+        return logSumExpScalar(logits, n);
+    }
+
+#endif
+
+    // Heap ordered so the front is the weakest kept entry
+    static inline bool weaker(const TokenLogprob& a, const TokenLogprob& b) {
+        return a.logprob > b.logprob || (a.logprob == b.logprob && a.id < b.id);
+    }
+
+    void topN(const float* logits, int n_vocab, int n, float lse, std::vector<TokenLogprob>& out) {
+        out.clear();
+        n = std::min(n, n_vocab);
+        if (n <= 0) return;
+
+        // Seed with the first n logits (logprob field holds the raw logit until the end)
+        for (int i = 0; i < n; i++) out.push_back(TokenLogprob{i, logits[i]});
+        std::make_heap(out.begin(), out.end(), weaker);
+        float threshold = out.front().logprob;
+
+        auto offer = [&](int i) {
+            float v = logits[i];
+            if (v <= threshold) return;
+            std::pop_heap(out.begin(), out.end(), weaker);
+            out.back() = TokenLogprob{i, v};
+            std::push_heap(out.begin(), out.end(), weaker);
+            threshold = out.front().logprob;
+        };
+
+        int i = n;
+#ifdef LOGPROBS_AVX2
+        // Scalar up to an 8-aligned index, then skip blocks with nothing above the threshold
+        for (; i < n_vocab && (i & 7); i++) offer(i);
+        for (; i + 8 <= n_vocab; i += 8) {
+            __m256 block = _mm256_loadu_ps(logits + i);
+            int mask = _mm256_movemask_ps(_mm256_cmp_ps(block, _mm256_set1_ps(threshold), _CMP_GT_OQ));
+            while (mask) {
+                int lane = __builtin_ctz(mask);
+                mask &= mask - 1;
+                offer(i + lane);  // May raise the threshold; re-checked per element
+            }
+        }
+#endif
+        for (; i < n_vocab; i++) offer(i);
+
+        std::sort_heap(out.begin(), out.end(), weaker);
+        for (auto& entry : out) entry.logprob -= lse;
+    }
+
+}
+}
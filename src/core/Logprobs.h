@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Core {
+
+    struct TokenLogprob {
+        int32_t id;
+        float logprob;
+    };
+
+    /**
+     * Logprobs - Log-softmax and top-N selection over a vocab-sized logits row
+     *
+     * Both kernels are single passes over the row: logSumExp uses 8-wide AVX2
+     * (with a polynomial exp) when the build targets it, and topN keeps a
+     * bounded min-heap while skipping whole 8-logit blocks that cannot beat the
+     * current N-th best, so nothing is ever fully sorted.
+     */
+    namespace Logprobs {
+
+        // log(sum(exp(logits))), numerically stable (max-shifted)
+        float logSumExp(const float* logits, int n);
+
+        // Top-n entries by logit, highest first, as logprobs (logit - lse).
+        // Ties keep the lower token id first.
+        void topN(const float* logits, int n_vocab, int n, float lse, std::vector<TokenLogprob>& out);
+
+        // Scalar reference used by the tests (and on non-AVX2 builds)
+        float logSumExpScalar(const float* logits, int n);
+
+    }
+
+}
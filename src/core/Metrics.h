@@ -10,8 +10,33 @@ namespace Core {
         long long total_time_ms = 0;
         // Tokens generated
         int tokens_generated = 0;
+        // Prompt tokens decoded for this request / reused from the KV cache
+        int prompt_tokens = 0;
+        int cached_tokens = 0;
         // Tokens Per Second
         double tps = 0.0;
+
+        // Phase breakdown (ms): prompt prefill, decode steps, token selection
+        // (sampling, grammar, logprobs) and the per-token callback (framing/sending)
+        double prefill_ms = 0.0;
+        double prefill_tps = 0.0;
+        double decode_ms = 0.0;
+        double decode_tps = 0.0;
+        double sample_ms = 0.0;
+        double callback_ms = 0.0;
+        // Ran to EOG / max_tokens / context end (not aborted or failed)
+        bool completed = false;
+        // Replayed from the response cache without touching the model
+        bool cached = false;
+        // Streamed from an identical request's in-flight generation
+        bool coalesced = false;
+
+        // Client rate limit (see RateLimiter): time generation was suspended for lack
+        // of budget, and the client's bucket levels when the request ended (infinite = unlimited)
+        double throttle_ms = 0.0;
+        bool rate_limited = false;
+        double prompt_budget = 0.0;
+        double generated_budget = 0.0;
         
         // Resource Usage (Placeholder for now)
         // Memory used, etc.
@@ -0,0 +1,278 @@
+#include "MockBackend.h"
+#include "Logger.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace Core {
+
+    // Replies are drawn from this vocabulary. Every word carries its leading space so
+    // a rendered reply tokenizes back into the same pieces
+    static const char* const MOCK_WORDS[] = {
+        " the", " model", " server", " token", " stream", " latency", " request", " queue",
+        " session", " prompt", " context", " cache", " decode", " batch", " socket", " frame",
+        " and", " of", " to", " is", " with", " for", " on", " in",
+        " fast", " steady", " quiet", " warm", " so", " then", " a", " it"
+    };
+    static constexpr size_t MOCK_WORD_COUNT = sizeof(MOCK_WORDS) / sizeof(MOCK_WORDS[0]);
+
+    MockBackend::MockBackend(const Config& config) : config_(config) {
+        if (config_.prefill_tps <= 0.0 || config_.decode_tps <= 0.0) {
+            throw std::invalid_argument("Mock backend rates must be positive");
+        }
+        fingerprint_ = "mock|seed=" + std::to_string(config_.seed) +
+                       "|reply_tokens=" + std::to_string(config_.reply_tokens);
+    }
+
+    std::unique_ptr<Session> MockBackend::createSession(const std::string& session_id, const std::string& client_id,
+                                                        int ctx_size, GrammarCache* /*grammarCache*/) {
+        return std::make_unique<MockSession>(session_id, client_id, config_, ctx_size);
+    }
+
+    MockSession::MockSession(const std::string& session_id, const std::string& client_id,
+                             const MockBackend::Config& config, int ctx_size)
+        : Session(session_id, client_id), config_(config), ctx_size_(ctx_size) {
+        LOG_DEBUG("Created mock session " << session_id_ << " for client " << client_id_);
+    }
+
+    std::vector<std::string> MockSession::tokenize(const std::string& text) {
+        std::vector<std::string> tokens;
+        size_t i = 0;
+        while (i < text.size()) {
+            size_t start = i;
+            while (i < text.size() && text[i] == ' ') i++;
+            while (i < text.size() && text[i] != ' ') i++;
+            tokens.push_back(text.substr(start, i - start));
+        }
+        return tokens;
+    }
+
+    size_t MockSession::getMessageCount() const {
+        std::lock_guard<std::mutex> lock(messages_mutex_);
+        return messages_.size();
+    }
+
+    MockSession::Clock::duration MockSession::delay(std::mt19937_64& rng, double seconds) const {
+        std::uniform_real_distribution<double> jitter(-config_.jitter, config_.jitter);
+        return std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(std::max(0.0, seconds * (1.0 + jitter(rng)))));
+    }
+
+    Metrics MockSession::complete(const std::string& prompt, const GenerationParams& params,
+                                  TokenCallback callback, std::string* reply, bool chat) {
+        Metrics metrics;
+        auto start_time = Clock::now();
+        suspended_.reset();
+
+        // Everything (words and delays) follows from the prompt, so identical requests
+        // replay identically
+        std::mt19937_64 rng(config_.seed ^ std::hash<std::string>()(prompt));
+
+        // Prefill whatever does not extend the previous request
+        std::vector<std::string> tokens = tokenize(prompt);
+        if (tokens.empty()) {
+            state_ = SessionState::IDLE;
+            return metrics;
+        }
+        size_t cached = 0;
+        while (cached < tokens.size() && cached < kv_tokens_.size() && tokens[cached] == kv_tokens_[cached]) cached++;
+        if (cached == tokens.size()) cached--;
+        metrics.cached_tokens = cached;
+        metrics.prompt_tokens = tokens.size() - cached;
+
+        if (config_.fail_prefill_over > 0 && tokens.size() > static_cast<size_t>(config_.fail_prefill_over)) {
+            // Only what decoded before the failure is left in the KV
+            tokens.resize(config_.fail_prefill_over);
+            kv_tokens_ = std::move(tokens);
+            LOG_ERROR("Mock prefill failed for session " << session_id_);
+            state_ = SessionState::ERROR;
+            return metrics;
+        }
+
+        {
+            TraceSpan span("prefill");
+            auto prefill_start = Clock::now();
+            std::this_thread::sleep_until(prefill_start + delay(rng, metrics.prompt_tokens / config_.prefill_tps));
+            metrics.prefill_ms = std::chrono::duration<double, std::milli>(Clock::now() - prefill_start).count();
+        }
+        kv_tokens_ = std::move(tokens);
+
+        GenerationParams limited = params;
+        limited.max_tokens = params.max_tokens > 0 ? params.max_tokens : config_.reply_tokens;
+        decode(rng, metrics, start_time, limited, callback, reply, chat, nullptr);
+        return metrics;
+    }
+
+    void MockSession::decode(std::mt19937_64& rng, Metrics& metrics, Clock::time_point start_time,
+                             const GenerationParams& params, TokenCallback callback, std::string* reply,
+                             bool chat, const std::string* pending) {
+        auto msSince = [](Clock::time_point t0) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        };
+
+        const auto step = 1.0 / config_.decode_tps;
+        TokenLogprobs logprobs;
+        auto next = Clock::now();
+        int decode_steps = 0;
+
+        // One decode step per token but the first, which comes out of the prefill (or,
+        // when resuming, is the pending token)
+        auto decodeStep = [&](const std::string& piece) {
+            TraceSpan span("decode");
+            auto decode_start = Clock::now();
+            next = std::max(next, decode_start) + delay(rng, step);
+            std::this_thread::sleep_until(next);
+            metrics.decode_ms += msSince(decode_start);
+            kv_tokens_.push_back(piece);
+            decode_steps++;
+        };
+        if (pending) {
+            decodeStep(*pending);
+        }
+
+        while (!abort_flag_) {
+            auto sample_start = Clock::now();
+            std::string piece = MOCK_WORDS[rng() % MOCK_WORD_COUNT];
+            metrics.sample_ms += msSince(sample_start);
+
+            if (metrics.tokens_generated == 0) {
+                metrics.ttft_ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start_time).count();
+            }
+            metrics.tokens_generated++;
+            if (reply) {
+                *reply += piece;
+            }
+
+            const TokenLogprobs* token_logprobs = nullptr;
+            if (params.logprobs > 0) {
+                logprobs.logprob = 0.0f;
+                logprobs.top = {LogprobEntry{piece, 0.0f}};
+                token_logprobs = &logprobs;
+            }
+
+            if (callback) {
+                auto callback_start = Clock::now();
+                bool keep_going = callback(piece, token_logprobs);
+                metrics.callback_ms += msSince(callback_start);
+                if (!keep_going) {
+                    // Paused or aborted: resume() carries on from here
+                    if (metrics.tokens_generated < params.max_tokens) {
+                        suspended_ = std::make_unique<Suspended>();
+                        suspended_->rng = rng;
+                        suspended_->params = params;
+                        suspended_->params.max_tokens -= metrics.tokens_generated;
+                        suspended_->piece = piece;
+                        suspended_->chat = chat;
+                    }
+                    break;
+                }
+            }
+
+            if (metrics.tokens_generated >= params.max_tokens || kv_tokens_.size() >= ctx_size_) {
+                metrics.completed = true;
+                break;
+            }
+
+            decodeStep(piece);
+        }
+
+        metrics.total_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start_time).count();
+        if (metrics.total_time_ms > 0) {
+            metrics.tps = (double)metrics.tokens_generated / (metrics.total_time_ms / 1000.0);
+        }
+        if (metrics.prefill_ms > 0) {
+            metrics.prefill_tps = metrics.prompt_tokens / (metrics.prefill_ms / 1000.0);
+        }
+        if (metrics.decode_ms > 0) {
+            metrics.decode_tps = decode_steps / (metrics.decode_ms / 1000.0);
+        }
+
+        state_ = SessionState::IDLE;
+    }
+
+    Metrics MockSession::generate(const std::string& prompt, const GenerationParams& params, TokenCallback callback) {
+        std::unique_lock<std::mutex> busy(busy_mutex_, std::try_to_lock);
+        if (!busy.owns_lock()) {
+            throw std::invalid_argument("Session is busy");
+        }
+
+        state_ = SessionState::GENERATING;
+        abort_flag_ = false;
+        return complete(prompt, params, callback, nullptr, false);
+    }
+
+    Metrics MockSession::appendMessage(const std::string& role, const std::string& content, bool generate,
+                                       const GenerationParams& params, TokenCallback callback) {
+        std::unique_lock<std::mutex> busy(busy_mutex_, std::try_to_lock);
+        if (!busy.owns_lock()) {
+            throw std::invalid_argument("Session is busy");
+        }
+
+        if (role != "system" && role != "user" && role != "assistant") {
+            throw std::invalid_argument("Unknown role: " + role);
+        }
+
+        suspended_.reset();
+        std::string text;
+        {
+            std::lock_guard<std::mutex> lock(messages_mutex_);
+            messages_.push_back(ChatMessage{role, content});
+            if (!generate) {
+                return Metrics();
+            }
+            for (const auto& m : messages_) {
+                text += " <" + m.role + ">";
+                text += (m.content.empty() || m.content[0] == ' ') ? m.content : " " + m.content;
+            }
+        }
+        text += " <assistant>";
+
+        state_ = SessionState::GENERATING;
+        abort_flag_ = false;
+
+        std::string reply;
+        Metrics metrics = complete(text, params, callback, &reply, true);
+
+        std::lock_guard<std::mutex> lock(messages_mutex_);
+        if (state_ == SessionState::ERROR) {
+            messages_.pop_back();  // A failed turn leaves no trace
+            return metrics;
+        }
+        messages_.push_back(ChatMessage{"assistant", reply});
+        return metrics;
+    }
+
+    Metrics MockSession::resume(TokenCallback callback) {
+        std::unique_lock<std::mutex> busy(busy_mutex_, std::try_to_lock);
+        if (!busy.owns_lock()) {
+            throw std::invalid_argument("Session is busy");
+        }
+        if (!suspended_) {
+            throw std::invalid_argument("Nothing to resume");
+        }
+        auto suspended = std::move(suspended_);
+
+        // No abort_flag_ reset: an abort sent while the generation was paused still applies
+        state_ = SessionState::GENERATING;
+
+        Metrics metrics;
+        metrics.cached_tokens = kv_tokens_.size();
+        metrics.prompt_tokens = 1;
+        std::string reply;
+        decode(suspended->rng, metrics, Clock::now(), suspended->params, callback, &reply, suspended->chat,
+               &suspended->piece);
+
+        if (suspended->chat) {
+            std::lock_guard<std::mutex> lock(messages_mutex_);
+            if (!messages_.empty() && messages_.back().role == "assistant") {
+                messages_.back().content += reply;
+            }
+        }
+        return metrics;
+    }
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Backend.h"
+#include "Session.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * MockBackend - Model-free sessions for load tests and race reproduction
+     *
+     * Sessions split prompts on whitespace (one "token" per word), sleep as if
+     * prefilling at prefill_tps and decoding at decode_tps, and stream words picked
+     * by a hash of (seed, prompt). The same prompt always yields the same reply and
+     * the same timing, including the jitter, so response caching, coalescing and
+     * KV-prefix reuse behave as with a real model. Grammars are ignored.
+     */
+    class MockBackend : public Backend {
+    public:
+        struct Config {
+            double prefill_tps = 2000.0;  // Prompt tokens per second
+            double decode_tps = 50.0;     // Generated tokens per second
+            double jitter = 0.1;          // Each delay is scaled by 1 +/- jitter (uniform)
+            int reply_tokens = 64;        // Reply length when max_tokens is not set
+            uint64_t seed = 1;            // Changes every reply (and the fingerprint)
+            int fail_prefill_over = 0;    // Longer prompts fail to prefill like a llama_decode error (0 = never)
+        };
+
+        explicit MockBackend(const Config& config);
+
+        const char* name() const override { return "mock"; }
+        bool isReady() const override { return true; }
+        const std::string& getFingerprint() const override { return fingerprint_; }
+
+        std::unique_ptr<Session> createSession(const std::string& session_id, const std::string& client_id,
+                                               int ctx_size, GrammarCache* grammarCache) override;
+
+        const Config& getConfig() const { return config_; }
+
+    private:
+        Config config_;
+        std::string fingerprint_;
+    };
+
+    class MockSession : public Session {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        MockSession(const std::string& session_id, const std::string& client_id,
+                    const MockBackend::Config& config, int ctx_size);
+
+        Metrics generate(const std::string& prompt, const GenerationParams& params, TokenCallback callback) override;
+        Metrics appendMessage(const std::string& role, const std::string& content, bool generate,
+                              const GenerationParams& params, TokenCallback callback) override;
+        Metrics resume(TokenCallback callback) override;
+        size_t getMessageCount() const override;
+        size_t countTokens(const std::string& text) override { return tokenize(text).size(); }
+        void abort() override { abort_flag_ = true; }
+
+        // Whitespace split, each word keeping its leading space
+        static std::vector<std::string> tokenize(const std::string& text);
+
+    private:
+        const MockBackend::Config config_;
+        const size_t ctx_size_;
+        std::atomic<bool> abort_flag_{false};
+        std::mutex busy_mutex_;  // Held for the duration of a request
+
+        std::vector<ChatMessage> messages_;
+        mutable std::mutex messages_mutex_;
+        std::vector<std::string> kv_tokens_;  // What a real session would have in its KV cache
+
+        // Generation stopped by its callback, for resume()
+        struct Suspended {
+            std::mt19937_64 rng;      // Draws the next words and delays
+            GenerationParams params;  // max_tokens counts what is left
+            std::string piece;        // Streamed, not decoded yet
+            bool chat = false;
+        };
+        std::unique_ptr<Suspended> suspended_;
+
+        Metrics complete(const std::string& prompt, const GenerationParams& params, TokenCallback callback,
+                         std::string* reply, bool chat);
+        // Decode loop shared by complete() and resume(); pending is decoded first if set
+        void decode(std::mt19937_64& rng, Metrics& metrics, Clock::time_point start_time,
+                    const GenerationParams& params, TokenCallback callback, std::string* reply,
+                    bool chat, const std::string* pending);
+        Clock::duration delay(std::mt19937_64& rng, double seconds) const;
+    };
+
+}
@@ -0,0 +1,92 @@
+#include "RateLimiter.h"
+#include <algorithm>
+#include <limits>
+
+namespace Core {
+
+    void RateLimiter::Bucket::configure(double tps, double burst_s, Clock::time_point now) {
+        refill(now);
+        bool was_limited = rate > 0.0;
+        rate = tps;
+        capacity = std::max(1.0, tps * burst_s);
+        // A newly limited bucket starts full; a reconfigured one keeps its debt
+        if (!was_limited || level > capacity) {
+            level = capacity;
+        }
+        updated = now;
+    }
+
+    void RateLimiter::Bucket::refill(Clock::time_point now) {
+        if (rate <= 0.0 || now <= updated) {
+            return;
+        }
+        double elapsed = std::chrono::duration<double>(now - updated).count();
+        level = std::min(capacity, level + elapsed * rate);
+        updated = now;
+    }
+
+    RateLimiter::Clock::duration RateLimiter::Bucket::debtDuration() const {
+        if (rate <= 0.0 || level >= 0.0) {
+            return Clock::duration::zero();
+        }
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(-level / rate));
+    }
+
+    RateLimiter::RateLimiter() : RateLimiter(Limits{}) {}
+
+    RateLimiter::RateLimiter(Limits defaults, double burst_s)
+        : defaults_(defaults), burst_s_(burst_s) {}
+
+    RateLimiter::Client& RateLimiter::client(const std::string& client_id, Clock::time_point now) {
+        auto it = clients_.find(client_id);
+        if (it == clients_.end()) {
+            it = clients_.emplace(client_id, Client{}).first;
+            it->second.prompt.configure(defaults_.prompt_tps, burst_s_, now);
+            it->second.generated.configure(defaults_.generated_tps, burst_s_, now);
+        }
+        return it->second;
+    }
+
+    void RateLimiter::setLimits(const std::string& client_id, Limits limits) {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(mutex_);
+        Client& c = clients_[client_id];  // A new client starts full at these limits
+        c.prompt.configure(limits.prompt_tps > 0.0 ? limits.prompt_tps : defaults_.prompt_tps, burst_s_, now);
+        c.generated.configure(limits.generated_tps > 0.0 ? limits.generated_tps : defaults_.generated_tps, burst_s_, now);
+    }
+
+    RateLimiter::Clock::duration RateLimiter::consume(const std::string& client_id, Kind kind, double tokens,
+                                                      Clock::time_point now) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Client& c = client(client_id, now);
+        Bucket& bucket = kind == Kind::PROMPT ? c.prompt : c.generated;
+        if (bucket.rate <= 0.0) {
+            return Clock::duration::zero();
+        }
+        bucket.refill(now);
+        bucket.level = std::min(bucket.capacity, bucket.level - tokens);
+        return bucket.debtDuration();
+    }
+
+    RateLimiter::Clock::time_point RateLimiter::readyAt(const std::string& client_id, Clock::time_point now) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Client& c = client(client_id, now);
+        c.prompt.refill(now);
+        c.generated.refill(now);
+        return now + std::max(c.prompt.debtDuration(), c.generated.debtDuration());
+    }
+
+    RateLimiter::Budget RateLimiter::remaining(const std::string& client_id, Clock::time_point now) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Client& c = client(client_id, now);
+        c.prompt.refill(now);
+        c.generated.refill(now);
+
+        Budget budget;
+        budget.limited = c.prompt.rate > 0.0 || c.generated.rate > 0.0;
+        budget.prompt_tokens = c.prompt.rate > 0.0 ? c.prompt.level : std::numeric_limits<double>::infinity();
+        budget.generated_tokens = c.generated.rate > 0.0 ? c.generated.level : std::numeric_limits<double>::infinity();
+        return budget;
+    }
+
+}
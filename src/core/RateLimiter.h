@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+
+namespace Core {
+
+    /**
+     * RateLimiter - Per-client token buckets for prompt and generated tokens
+     *
+     * Each client has one bucket per kind, refilled at its tokens/s limit and holding
+     * up to burst_s seconds of it. Consuming never fails: a bucket may go into debt,
+     * and the caller is told how long until it is back to zero. The scheduler uses
+     * that to hold back a client's queued requests and suspend its running
+     * generations, so contention is resolved by delay rather than rejection. Thread-safe.
+     */
+    class RateLimiter {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        enum class Kind { PROMPT, GENERATED };
+
+        // Tokens per second; 0 = unlimited
+        struct Limits {
+            double prompt_tps = 0.0;
+            double generated_tps = 0.0;
+        };
+
+        // Bucket levels; negative while in debt, infinite when unlimited
+        struct Budget {
+            bool limited = false;  // At least one limit applies to the client
+            double prompt_tokens = 0.0;
+            double generated_tokens = 0.0;
+        };
+
+        // defaults apply to clients (or fields) without an explicit limit
+        RateLimiter();
+        explicit RateLimiter(Limits defaults, double burst_s = 10.0);
+
+        // Limits for one client; zero fields fall back to the defaults
+        void setLimits(const std::string& client_id, Limits limits);
+
+        // Take tokens from the client's bucket (negative = give back unused ones); returns
+        // how long until it is out of debt (zero if it still has tokens left or is unlimited)
+        Clock::duration consume(const std::string& client_id, Kind kind, double tokens,
+                                Clock::time_point now = Clock::now());
+
+        // When a new request of this client may start: now, or once both buckets are out of debt
+        Clock::time_point readyAt(const std::string& client_id, Clock::time_point now = Clock::now());
+
+        Budget remaining(const std::string& client_id, Clock::time_point now = Clock::now());
+
+    private:
+        struct Bucket {
+            double rate = 0.0;      // Tokens/s, 0 = unlimited
+            double capacity = 0.0;
+            double level = 0.0;
+            Clock::time_point updated{};
+
+            void configure(double tps, double burst_s, Clock::time_point now);
+            void refill(Clock::time_point now);
+            Clock::duration debtDuration() const;
+        };
+
+        struct Client {
+            Bucket prompt;
+            Bucket generated;
+        };
+
+        Limits defaults_;
+        double burst_s_;
+        std::unordered_map<std::string, Client> clients_;
+        std::mutex mutex_;
+
+        // Guarded by mutex_; creates the client with the defaults on first use
+        Client& client(const std::string& client_id, Clock::time_point now);
+    };
+
+}
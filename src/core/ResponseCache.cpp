@@ -0,0 +1,86 @@
+#include "ResponseCache.h"
+
+namespace Core {
+
+    ResponseCache::ResponseCache(const Config& config)
+        : config_(config) {
+    }
+
+    std::string ResponseCache::makeKey(const std::string& model_fingerprint,
+                                       const std::string& prompt,
+                                       const std::string& params) {
+        // Length-prefixed so no two (fingerprint, params, prompt) triples collide
+        std::string key;
+        key.reserve(model_fingerprint.size() + params.size() + prompt.size() + 32);
+        key += std::to_string(model_fingerprint.size()) + ":" + model_fingerprint;
+        key += std::to_string(params.size()) + ":" + params;
+        key += prompt;
+        return key;
+    }
+
+    void ResponseCache::erase(std::unordered_map<std::string, Entry>::iterator it) {
+        bytes_ -= it->second.bytes;
+        lru_.erase(it->second.lru);
+        entries_.erase(it);
+    }
+
+    std::shared_ptr<const CachedResponse> ResponseCache::lookup(const std::string& key) {
+        if (!enabled()) return nullptr;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it == entries_.end()) {
+            misses_++;
+            return nullptr;
+        }
+        if (std::chrono::steady_clock::now() >= it->second.expires) {
+            erase(it);
+            misses_++;
+            return nullptr;
+        }
+
+        lru_.splice(lru_.begin(), lru_, it->second.lru);
+        hits_++;
+        return it->second.response;
+    }
+
+    void ResponseCache::store(const std::string& key, CachedResponse response) {
+        if (!enabled()) return;
+
+        size_t bytes = key.size() + sizeof(Entry);
+        for (const auto& piece : response.pieces) bytes += piece.size() + sizeof(std::string);
+        if (bytes > config_.max_bytes) return;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto existing = entries_.find(key);
+        if (existing != entries_.end()) {
+            erase(existing);
+        }
+
+        while (!lru_.empty() && (entries_.size() >= config_.max_entries || bytes_ + bytes > config_.max_bytes)) {
+            erase(entries_.find(lru_.back()));
+            evictions_++;
+        }
+
+        lru_.push_front(key);
+        Entry entry;
+        entry.response = std::make_shared<const CachedResponse>(std::move(response));
+        entry.bytes = bytes;
+        entry.expires = std::chrono::steady_clock::now() + config_.ttl;
+        entry.lru = lru_.begin();
+        entries_.emplace(key, std::move(entry));
+        bytes_ += bytes;
+    }
+
+    ResponseCache::Stats ResponseCache::stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats s;
+        s.hits = hits_;
+        s.misses = misses_;
+        s.evictions = evictions_;
+        s.entries = entries_.size();
+        s.bytes = bytes_;
+        return s;
+    }
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Metrics.h"
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+namespace Core {
+
+    struct CachedResponse {
+        std::vector<std::string> pieces;  // Streamed tokens, in order
+        Metrics metrics;                  // Metrics of the original generation
+    };
+
+    /**
+     * ResponseCache - Replays outputs of deterministic (greedy) generations
+     *
+     * Entries are keyed by model fingerprint, prompt and sampling params, bounded by
+     * entry count and approximate byte size (LRU eviction), and expire after a TTL.
+     * Hit/miss counters feed the metrics stream. Thread-safe.
+     */
+    class ResponseCache {
+    public:
+        struct Config {
+            size_t max_entries = 1024;                  // 0 disables the cache
+            size_t max_bytes = 64 * 1024 * 1024;
+            std::chrono::milliseconds ttl{std::chrono::minutes(5)};
+        };
+
+        struct Stats {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t evictions = 0;  // LRU or size pressure (expirations not included)
+            size_t entries = 0;
+            size_t bytes = 0;
+            double hitRate() const { return hits + misses ? (double)hits / (hits + misses) : 0.0; }
+        };
+
+        explicit ResponseCache(const Config& config);
+
+        bool enabled() const { return config_.max_entries > 0; }
+
+        // Key material for a request; params must cover everything that affects the output
+        static std::string makeKey(const std::string& model_fingerprint,
+                                   const std::string& prompt,
+                                   const std::string& params);
+
+        // Cached response, or null on miss / expiry
+        std::shared_ptr<const CachedResponse> lookup(const std::string& key);
+
+        // Insert (or replace) a response
+        void store(const std::string& key, CachedResponse response);
+
+        Stats stats() const;
+
+    private:
+        struct Entry {
+            std::shared_ptr<const CachedResponse> response;
+            size_t bytes = 0;
+            std::chrono::steady_clock::time_point expires;
+            std::list<std::string>::iterator lru;
+        };
+
+        Config config_;
+        std::unordered_map<std::string, Entry> entries_;
+        std::list<std::string> lru_;  // Front = most recently used
+        size_t bytes_ = 0;
+        uint64_t hits_ = 0;
+        uint64_t misses_ = 0;
+        uint64_t evictions_ = 0;
+        mutable std::mutex mutex_;
+
+        void erase(std::unordered_map<std::string, Entry>::iterator it);
+    };
+
+}
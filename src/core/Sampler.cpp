@@ -0,0 +1,51 @@
+#include "Sampler.h"
+#include <cmath>
+
+namespace Core {
+
+    Sampler::Sampler(const struct llama_vocab* vocab, struct llama_sampler* grammar)
+        : grammar_(grammar), n_vocab_(llama_vocab_n_tokens(vocab)) {
+        chain_ = llama_sampler_chain_init(llama_sampler_chain_default_params());
+        llama_sampler_chain_add(chain_, llama_sampler_init_greedy());
+        candidates_.resize(n_vocab_);
+    }
+
+    Sampler::~Sampler() {
+        if (grammar_) llama_sampler_free(grammar_);
+        if (chain_) llama_sampler_free(chain_);
+    }
+
+    llama_token_data_array Sampler::fill(const float* logits) {
+        for (int i = 0; i < n_vocab_; i++) {
+            candidates_[i] = llama_token_data{i, logits[i], 0.0f};
+        }
+        return llama_token_data_array{candidates_.data(), candidates_.size(), -1, false};
+    }
+
+    llama_token Sampler::sample(const float* logits) {
+        llama_token_data_array cur = fill(logits);
+        llama_sampler_apply(chain_, &cur);
+        llama_token token = cur.data[cur.selected].id;
+
+        if (!grammar_) return token;
+
+        // Fast path: does the grammar accept the unconstrained choice?
+        llama_token_data single = {token, 1.0f, 0.0f};
+        llama_token_data_array single_arr = {&single, 1, -1, false};
+        llama_sampler_apply(grammar_, &single_arr);
+        if (!std::isinf(single.logit)) return token;
+
+        // Slow path: mask the whole vocabulary, then sample again
+        resamples_++;
+        cur = fill(logits);
+        llama_sampler_apply(grammar_, &cur);
+        llama_sampler_apply(chain_, &cur);
+        return cur.data[cur.selected].id;
+    }
+
+    void Sampler::accept(llama_token token) {
+        if (grammar_) llama_sampler_accept(grammar_, token);
+        llama_sampler_accept(chain_, token);
+    }
+
+}
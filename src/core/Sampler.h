@@ -0,0 +1,48 @@
+#pragma once
+
+#include "llama.h"
+#include <vector>
+#include <cstdint>
+
+namespace Core {
+
+    /**
+     * Sampler - Token selection for one generation, with optional grammar constraint
+     *
+     * The grammar is not part of the chain: the unconstrained chain picks a token
+     * first and the grammar only checks that single candidate. The full vocabulary
+     * goes through the grammar only when that token is rejected, which keeps the
+     * per-token cost close to unconstrained sampling.
+     */
+    class Sampler {
+    public:
+        // Takes ownership of grammar (may be null)
+        Sampler(const struct llama_vocab* vocab, struct llama_sampler* grammar = nullptr);
+        ~Sampler();
+
+        // Prevent copying
+        Sampler(const Sampler&) = delete;
+        Sampler& operator=(const Sampler&) = delete;
+
+        // Pick the next token from a row of n_vocab logits
+        llama_token sample(const float* logits);
+
+        // Advance chain and grammar state with the chosen token
+        void accept(llama_token token);
+
+        bool hasGrammar() const { return grammar_ != nullptr; }
+
+        // Tokens for which the fast path was rejected by the grammar
+        uint64_t grammarResamples() const { return resamples_; }
+
+    private:
+        struct llama_sampler* chain_ = nullptr;
+        struct llama_sampler* grammar_ = nullptr;
+        int n_vocab_;
+        std::vector<llama_token_data> candidates_;
+        uint64_t resamples_ = 0;
+
+        llama_token_data_array fill(const float* logits);
+    };
+
+}
@@ -1,16 +1,37 @@
 #pragma once
 
-#include "llama.h"
 #include "Metrics.h"
 #include <string>
 #include <functional>
-#include <atomic>
-#include <memory>
+#include <vector>
 
 namespace Core {
 
+    // Per-token log-probabilities (natural log, over the raw logits)
+    struct LogprobEntry {
+        std::string token;
+        float logprob;
+    };
+
+    struct TokenLogprobs {
+        float logprob = 0.0f;           // Chosen token
+        std::vector<LogprobEntry> top;  // Top-N alternatives, most likely first
+    };
+
     // Callback for streaming tokens. Returns true to continue, false to abort.
-    using TokenCallback = std::function<bool(const std::string& token)>;
+    // logprobs is null unless requested through GenerationParams::logprobs.
+    using TokenCallback = std::function<bool(const std::string& token, const TokenLogprobs* logprobs)>;
+
+    struct GenerationParams {
+        int max_tokens = -1;   // -1 = until EOG
+        std::string grammar;   // GBNF constraint (root rule "root"), empty = none
+        int logprobs = 0;      // Top-N alternatives per token, 0 = off
+    };
+
+    struct ChatMessage {
+        std::string role;     // "system", "user" or "assistant"
+        std::string content;
+    };
 
     enum class SessionState {
         IDLE,
@@ -18,23 +39,56 @@ namespace Core {
         ERROR
     };
 
+    /**
+     * Session - One client conversation on an inference backend
+     *
+     * Server code only sees this interface; LlamaSession runs it on a llama.cpp
+     * context and MockSession (see MockBackend.h) fakes it with timed, deterministic
+     * tokens. A session serves one request at a time.
+     */
     class Session {
     public:
-        Session(const std::string& session_id, 
-                const std::string& client_id,
-                struct llama_model* model,
-                int ctx_size);
-        ~Session();
+        Session(const std::string& session_id, const std::string& client_id)
+            : session_id_(session_id), client_id_(client_id) {}
+        virtual ~Session() = default;
 
         // Prevent copying
         Session(const Session&) = delete;
         Session& operator=(const Session&) = delete;
 
-        // Run inference on this session
-        Metrics generate(const std::string& prompt, TokenCallback callback);
+        // Run inference on a raw prompt (chat history is left untouched).
+        // Reuses the KV prefix shared with the previous request.
+        // Throws std::invalid_argument if params.grammar does not compile or the session is busy
+        virtual Metrics generate(const std::string& prompt, const GenerationParams& params,
+                                 TokenCallback callback) = 0;
+
+        // Append a message to the stored conversation and, if generate is set, reply to it
+        // as the assistant (the reply is appended to the history). Only the text added since
+        // the previous turn is tokenized and prefilled; when the history outgrows the context
+        // the oldest non-system turns are dropped and the conversation is re-prefilled.
+        // An aborted reply is stored as far as it was streamed; if generation fails
+        // (SessionState::ERROR) the message is taken back out and no reply is stored.
+        // Throws std::invalid_argument on bad input, template errors or when the session is busy
+        virtual Metrics appendMessage(const std::string& role, const std::string& content, bool generate,
+                                      const GenerationParams& params, TokenCallback callback) = 0;
+
+        // Continue the generation or chat reply that the callback last stopped (by returning
+        // false) with the token after the last one streamed, the same params and sampler/grammar
+        // state; a chat reply keeps growing the stored assistant message. Metrics cover this
+        // part only. Any other request on the session, an abort or the end of the generation
+        // discards what there was to resume.
+        // Throws std::invalid_argument if there is nothing to resume or the session is busy
+        virtual Metrics resume(TokenCallback callback) = 0;
+
+        // Number of messages in the stored conversation
+        virtual size_t getMessageCount() const = 0;
+
+        // Tokens text takes with this session's vocabulary, without touching its state
+        // (the scheduler budgets a prompt before it runs). Thread-safe.
+        virtual size_t countTokens(const std::string& text) = 0;
 
         // Abort current generation
-        void abort();
+        virtual void abort() = 0;
 
         // Getters
         std::string getSessionId() const { return session_id_; }
@@ -42,17 +96,10 @@ namespace Core {
         SessionState getState() const { return state_; }
         bool isGenerating() const { return state_ == SessionState::GENERATING; }
 
-    private:
+    protected:
         std::string session_id_;
         std::string client_id_;
-        struct llama_context* ctx_ = nullptr;
-        struct llama_model* model_ = nullptr;  // Reference to shared model
         SessionState state_ = SessionState::IDLE;
-        std::atomic<bool> abort_flag_{false};
-
-        // Helper methods (similar to Engine)
-        std::vector<llama_token> tokenize(const std::string& text, bool add_bos);
-        std::string tokenToPiece(llama_token token);
     };
 
 }
@@ -1,17 +1,15 @@
 #include "SessionManager.h"
+#include "Logger.h"
 #include <random>
 #include <sstream>
 #include <iomanip>
-#include <iostream>
 #include <algorithm>
 
 namespace Core {
 
-    SessionManager::SessionManager(struct llama_model* model, int ctx_size)
-        : model_(model), ctx_size_(ctx_size) {
-        if (!model_) {
-            throw std::runtime_error("SessionManager requires a valid model");
-        }
+    SessionManager::SessionManager(Backend& backend, int ctx_size)
+        : backend_(backend), ctx_size_(ctx_size) {
+        // The model may still be loading; sessions are refused until it is ready
     }
 
     SessionManager::~SessionManager() {
@@ -42,9 +40,14 @@ namespace Core {
     std::string SessionManager::createSession(const std::string& client_id) {
         std::lock_guard<std::mutex> lock(mutex_);
 
+        if (!backend_.isReady()) {
+            LOG_ERROR("Cannot create session: model is still loading");
+            return "";
+        }
+
         // Check if client exists and get their config
         if (!client_auth_ || !client_auth_->clientExists(client_id)) {
-            std::cerr << "Cannot create session: client " << client_id << " not found" << std::endl;
+            LOG_ERROR("Cannot create session: client " << client_id << " not found");
             return "";
         }
 
@@ -55,8 +58,8 @@ namespace Core {
         int current_count = (it != client_sessions_.end()) ? it->second.size() : 0;
         
         if (current_count >= client_config.max_sessions) {
-            std::cerr << "Client " << client_id << " has reached max sessions limit (" 
-                      << client_config.max_sessions << ")" << std::endl;
+            LOG_ERROR("Client " << client_id << " has reached max sessions limit (" 
+                      << client_config.max_sessions << ")");
             return "";
         }
 
@@ -68,20 +71,20 @@ namespace Core {
 
         try {
             // Create new session
-            auto session = std::make_unique<Session>(session_id, client_id, model_, ctx_size_);
+            auto session = backend_.createSession(session_id, client_id, ctx_size_, &grammar_cache_);
             sessions_[session_id] = std::move(session);
+            session_count_.store(sessions_.size(), std::memory_order_relaxed);
 
             // Track client -> sessions mapping
             client_sessions_[client_id].push_back(session_id);
 
-            std::cout << "Created session " << session_id << " for client " << client_id 
-                      << " (" << (current_count + 1) << "/" << client_config.max_sessions << ")" 
-                      << std::endl;
+            LOG_INFO("Created session " << session_id << " for client " << client_id 
+                      << " (" << (current_count + 1) << "/" << client_config.max_sessions << ")");
 
             return session_id;
 
         } catch (const std::exception& e) {
-            std::cerr << "Failed to create session: " << e.what() << std::endl;
+            LOG_ERROR("Failed to create session: " << e.what());
             return "";
         }
     }
@@ -108,6 +111,7 @@ namespace Core {
 
         // Remove from sessions map
         sessions_.erase(it);
+        session_count_.store(sessions_.size(), std::memory_order_relaxed);
 
         // Remove from client_sessions mapping
         auto client_it = client_sessions_.find(client_id);
@@ -124,7 +128,7 @@ namespace Core {
             }
         }
 
-        std::cout << "Closed session " << session_id << " for client " << client_id << std::endl;
+        LOG_INFO("Closed session " << session_id << " for client " << client_id);
         return true;
     }
 
@@ -153,11 +157,12 @@ namespace Core {
         for (const auto& session_id : session_ids) {
             sessions_.erase(session_id);
         }
+        session_count_.store(sessions_.size(), std::memory_order_relaxed);
 
         client_sessions_.erase(it);
 
-        std::cout << "Closed " << session_ids.size() << " session(s) for client " 
-                  << client_id << std::endl;
+        LOG_INFO("Closed " << session_ids.size() << " session(s) for client " 
+                  << client_id);
     }
 
     void SessionManager::closeAllSessions() {
@@ -166,9 +171,10 @@ namespace Core {
         int count = sessions_.size();
         sessions_.clear();
         client_sessions_.clear();
+        session_count_.store(0, std::memory_order_relaxed);
 
         if (count > 0) {
-            std::cout << "Closed all " << count << " session(s)" << std::endl;
+            LOG_INFO("Closed all " << count << " session(s)");
         }
     }
 
@@ -182,9 +188,4 @@ namespace Core {
         return 0;
     }
 
-    int SessionManager::getTotalSessionCount() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return sessions_.size();
-    }
-
 }
@@ -1,22 +1,31 @@
 #pragma once
 
+#include "Backend.h"
 #include "Session.h"
+#include "GrammarCache.h"
 #include "ClientAuth.h"
 #include <string>
 #include <unordered_map>
 #include <mutex>
+#include <atomic>
 #include <memory>
 
 namespace Core {
 
     class SessionManager {
     public:
-        SessionManager(struct llama_model* model, int ctx_size);
+        SessionManager(Backend& backend, int ctx_size);
         ~SessionManager();
 
         // Set client auth reference for validation
         void setClientAuth(Server::ClientAuth* auth) { client_auth_ = auth; }
 
+        // True once the backend can create sessions (model loaded)
+        bool isReady() const { return backend_.isReady(); }
+
+        // Identifies the loaded model (for caches keyed on model output)
+        const std::string& getModelFingerprint() const { return backend_.getFingerprint(); }
+
         // Create a new session for a client
         // Returns session_id on success, empty string on failure
         std::string createSession(const std::string& client_id);
@@ -39,18 +48,23 @@ namespace Core {
         // Get count of active sessions for a client
         int getClientSessionCount(const std::string& client_id) const;
 
-        // Get total session count
-        int getTotalSessionCount() const;
+        // Get total session count (lock-free, safe on hot paths)
+        int getTotalSessionCount() const { return session_count_.load(std::memory_order_relaxed); }
+
+        // Compiled grammars shared by all sessions
+        GrammarCache& getGrammarCache() { return grammar_cache_; }
 
     private:
-        struct llama_model* model_;
+        Backend& backend_;
         int ctx_size_;
         Server::ClientAuth* client_auth_ = nullptr;
+        GrammarCache grammar_cache_;
 
         std::unordered_map<std::string, std::unique_ptr<Session>> sessions_;
         std::unordered_map<std::string, std::vector<std::string>> client_sessions_; // client_id -> [session_ids]
         
         mutable std::mutex mutex_;
+        std::atomic<int> session_count_{0};  // sessions_.size(), published under mutex_
 
         // Generate unique session ID
         std::string generateSessionId();
@@ -0,0 +1,149 @@
+#include "Trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace Core {
+
+    thread_local uint64_t Tracer::current_ = 0;
+
+    // splitmix64 finalizer: spreads consecutive request numbers over the whole range
+    static uint64_t mix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    static void appendJsonEscaped(std::string& out, const char* text) {
+        for (const char* p = text; *p; p++) {
+            unsigned char c = static_cast<unsigned char>(*p);
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += static_cast<char>(c);
+            } else if (c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += static_cast<char>(c);
+            }
+        }
+    }
+
+    Tracer& Tracer::instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    Tracer::Tracer() : epoch_(std::chrono::steady_clock::now()) {}
+
+    void Tracer::setSampleRate(double rate) {
+        sampleRate_.store(std::min(1.0, std::max(0.0, rate)), std::memory_order_relaxed);
+    }
+
+    uint64_t Tracer::sample() {
+        double rate = sampleRate();
+        if (rate <= 0.0) {
+            return 0;
+        }
+        uint64_t n = requests_.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (rate < 1.0 && mix(n) >= (uint64_t)(rate * 18446744073709551615.0)) {
+            return 0;
+        }
+        return n;
+    }
+
+    Tracer::ThreadRing& Tracer::localRing() {
+        thread_local std::shared_ptr<ThreadRing> ring;
+        if (!ring) {
+            ring = std::make_shared<ThreadRing>();
+            ring->tid = nextTid_.fetch_add(1);
+            std::lock_guard<std::mutex> lock(registryMutex_);
+            rings_.push_back(ring);
+        }
+        return *ring;
+    }
+
+    void Tracer::record(const char* name, uint64_t trace_id, int64_t ts_us, int64_t dur_us) {
+        if (!trace_id) {
+            return;
+        }
+        ThreadRing& ring = localRing();
+        std::lock_guard<std::mutex> lock(ring.mutex);
+        Event& event = ring.events[ring.written % THREAD_CAPACITY];
+        strncpy(event.name.data(), name, NAME_SIZE - 1);
+        event.name[NAME_SIZE - 1] = '\0';
+        event.trace_id = trace_id;
+        event.ts_us = ts_us;
+        event.dur_us = dur_us;
+        ring.written++;
+    }
+
+    void Tracer::setThreadName(const std::string& name) {
+        ThreadRing& ring = localRing();
+        std::lock_guard<std::mutex> lock(ring.mutex);
+        ring.name = name;
+    }
+
+    std::string Tracer::exportChromeJson() const {
+        std::vector<std::shared_ptr<ThreadRing>> rings;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex_);
+            rings = rings_;
+        }
+
+        std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        auto separator = [&]() {
+            if (!first) out += ',';
+            first = false;
+        };
+
+        for (const auto& ring : rings) {
+            std::lock_guard<std::mutex> lock(ring->mutex);
+            std::string tid = std::to_string(ring->tid);
+
+            if (!ring->name.empty()) {
+                separator();
+                out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid + ",\"args\":{\"name\":\"";
+                appendJsonEscaped(out, ring->name.c_str());
+                out += "\"}}";
+            }
+
+            uint64_t count = std::min<uint64_t>(ring->written, THREAD_CAPACITY);
+            for (uint64_t i = ring->written - count; i < ring->written; i++) {
+                const Event& event = ring->events[i % THREAD_CAPACITY];
+                separator();
+                out += "{\"name\":\"";
+                appendJsonEscaped(out, event.name.data());
+                out += "\",\"cat\":\"request\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid;
+                out += ",\"ts\":" + std::to_string(event.ts_us);
+                out += ",\"dur\":" + std::to_string(event.dur_us);
+                out += ",\"args\":{\"trace_id\":" + std::to_string(event.trace_id) + "}}";
+            }
+        }
+
+        out += "]}";
+        return out;
+    }
+
+    bool Tracer::writeChromeJson(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        file << exportChromeJson();
+        return static_cast<bool>(file);
+    }
+
+    void Tracer::clear() {
+        std::lock_guard<std::mutex> lock(registryMutex_);
+        for (const auto& ring : rings_) {
+            std::lock_guard<std::mutex> ringLock(ring->mutex);
+            ring->written = 0;
+        }
+    }
+
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Core {
+
+    /**
+     * Tracer - Sampled per-request span recording, exported as Chrome trace JSON
+     *
+     * A request is sampled once, where it enters the server (sample()); its trace id
+     * then travels with the task and is made current on whichever thread works on it
+     * (Tracer::Scope). Spans are only recorded while a non-zero id is current, so
+     * unsampled requests cost a thread-local read per span.
+     *
+     * Each thread records into its own fixed-size ring (the oldest spans are
+     * overwritten); the per-ring mutex is only contended while exporting.
+     * The export loads in chrome://tracing and ui.perfetto.dev; filter on
+     * args.trace_id to follow one request across threads.
+     */
+    class Tracer {
+    public:
+        static constexpr size_t THREAD_CAPACITY = 8192;  // Spans kept per thread
+        static constexpr size_t NAME_SIZE = 32;          // Longer span names are truncated
+
+        struct Event {
+            std::array<char, NAME_SIZE> name{};
+            uint64_t trace_id = 0;
+            int64_t ts_us = 0;   // Since the tracer started (steady clock)
+            int64_t dur_us = 0;
+        };
+
+        static Tracer& instance();
+
+        Tracer(const Tracer&) = delete;
+        Tracer& operator=(const Tracer&) = delete;
+
+        // Fraction of requests to trace (0 = off, 1 = all)
+        void setSampleRate(double rate);
+        double sampleRate() const { return sampleRate_.load(std::memory_order_relaxed); }
+
+        // Trace id for a new request, or 0 if it is not sampled
+        uint64_t sample();
+
+        // Record a finished span on the calling thread's ring (no-op for trace_id 0)
+        void record(const char* name, uint64_t trace_id, int64_t ts_us, int64_t dur_us);
+
+        // Label the calling thread in exports ("loop", "worker-0", ...)
+        void setThreadName(const std::string& name);
+
+        // Microseconds on the tracer's clock
+        int64_t nowUs() const { return toUs(std::chrono::steady_clock::now()); }
+        int64_t toUs(std::chrono::steady_clock::time_point t) const {
+            return std::chrono::duration_cast<std::chrono::microseconds>(t - epoch_).count();
+        }
+
+        // Every retained span as {"traceEvents": [...]} (thread-safe)
+        std::string exportChromeJson() const;
+
+        // Export to a file; false if it cannot be written
+        bool writeChromeJson(const std::string& path) const;
+
+        // Drop every recorded span
+        void clear();
+
+        // Async-signal-safe: ask the server to write a dump (see takeDumpRequest)
+        void requestDump() { dumpRequested_.store(true, std::memory_order_relaxed); }
+        bool takeDumpRequest() { return dumpRequested_.exchange(false, std::memory_order_relaxed); }
+
+        // Trace id the calling thread is working for (0 = none)
+        static uint64_t current() { return current_; }
+
+        // Makes a trace id current on this thread for the scope's lifetime
+        class Scope {
+        public:
+            explicit Scope(uint64_t trace_id) : previous_(current_) { current_ = trace_id; }
+            ~Scope() { current_ = previous_; }
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+        private:
+            uint64_t previous_;
+        };
+
+    private:
+        Tracer();
+
+        struct ThreadRing {
+            std::vector<Event> events{THREAD_CAPACITY};
+            uint64_t written = 0;  // Total recorded; slot = written % THREAD_CAPACITY
+            uint32_t tid = 0;
+            std::string name;
+            std::mutex mutex;
+        };
+
+        ThreadRing& localRing();
+
+        const std::chrono::steady_clock::time_point epoch_;
+        std::atomic<double> sampleRate_{0.0};
+        std::atomic<uint64_t> requests_{0};
+        std::atomic<bool> dumpRequested_{false};
+
+        // Rings outlive their threads so late exports still see their spans
+        std::vector<std::shared_ptr<ThreadRing>> rings_;
+        mutable std::mutex registryMutex_;
+        std::atomic<uint32_t> nextTid_{1};
+
+        static thread_local uint64_t current_;
+    };
+
+    /**
+     * TraceSpan - Records [construction, destruction) under the current trace id
+     *
+     * Reads no clock when the calling thread has no sampled trace. The name must
+     * outlive the span (it is copied when the span ends).
+     */
+    class TraceSpan {
+    public:
+        explicit TraceSpan(const char* name, uint64_t trace_id = Tracer::current())
+            : name_(name), trace_id_(trace_id)
+            , start_us_(trace_id ? Tracer::instance().nowUs() : 0) {}
+
+        ~TraceSpan() {
+            if (trace_id_) {
+                Tracer& tracer = Tracer::instance();
+                tracer.record(name_, trace_id_, start_us_, tracer.nowUs() - start_us_);
+            }
+        }
+
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+    private:
+        const char* name_;
+        uint64_t trace_id_;
+        int64_t start_us_;
+    };
+
+}
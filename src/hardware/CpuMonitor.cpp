@@ -0,0 +1,192 @@
+#include "CpuMonitor.h"
+#include "../core/Logger.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <dirent.h>
+
+namespace Hardware {
+
+    namespace {
+        std::string readFile(const std::string& path) {
+            std::ifstream in(path);
+            if (!in) return "";
+            std::ostringstream ss;
+            ss << in.rdbuf();
+            return ss.str();
+        }
+
+        std::string trim(const std::string& s) {
+            size_t b = s.find_first_not_of(" \t\r\n");
+            size_t e = s.find_last_not_of(" \t\r\n");
+            return b == std::string::npos ? "" : s.substr(b, e - b + 1);
+        }
+    }
+
+    CpuMonitor::CpuMonitor(std::string procRoot, std::string sysRoot)
+        : procRoot_(std::move(procRoot)), sysRoot_(std::move(sysRoot)) {
+    }
+
+    std::vector<CpuTimes> CpuMonitor::parseProcStat(const std::string& text) {
+        std::vector<CpuTimes> out;
+        std::istringstream lines(text);
+        std::string line;
+        while (std::getline(lines, line)) {
+            if (line.compare(0, 3, "cpu") != 0) {
+                if (!out.empty()) break;  // cpu lines come first
+                continue;
+            }
+            std::istringstream fields(line);
+            std::string label;
+            CpuTimes t;
+            fields >> label >> t.user >> t.nice >> t.system >> t.idle >> t.iowait >> t.irq >> t.softirq >> t.steal;
+            out.push_back(t);
+        }
+        return out;
+    }
+
+    unsigned long long CpuMonitor::parseKbField(const std::string& text, const std::string& key) {
+        std::istringstream lines(text);
+        std::string line;
+        std::string prefix = key + ":";
+        while (std::getline(lines, line)) {
+            if (line.compare(0, prefix.size(), prefix) == 0) {
+                try {
+                    return std::stoull(line.substr(prefix.size())) * 1024;
+                } catch (const std::exception&) {
+                    return 0;
+                }
+            }
+        }
+        return 0;
+    }
+
+    PsiStats CpuMonitor::parsePsi(const std::string& text) {
+        // some avg10=1.23 avg60=0.50 avg300=0.10 total=12345
+        // full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+        PsiStats psi;
+        std::istringstream lines(text);
+        std::string line;
+        while (std::getline(lines, line)) {
+            std::istringstream fields(line);
+            std::string kind, field;
+            fields >> kind;
+            double* avg10 = kind == "some" ? &psi.some_avg10 : kind == "full" ? &psi.full_avg10 : nullptr;
+            double* avg60 = kind == "some" ? &psi.some_avg60 : kind == "full" ? &psi.full_avg60 : nullptr;
+            if (!avg10) continue;
+            while (fields >> field) {
+                try {
+                    if (field.compare(0, 6, "avg10=") == 0) *avg10 = std::stod(field.substr(6));
+                    else if (field.compare(0, 6, "avg60=") == 0) *avg60 = std::stod(field.substr(6));
+                } catch (const std::exception&) {
+                    // Leave the default on malformed values
+                }
+            }
+        }
+        return psi;
+    }
+
+    double CpuMonitor::utilization(const CpuTimes& prev, const CpuTimes& cur) {
+        if (cur.total() <= prev.total()) return 0.0;
+        double total = (double)(cur.total() - prev.total());
+        double idle = cur.idleTotal() >= prev.idleTotal() ? (double)(cur.idleTotal() - prev.idleTotal()) : 0.0;
+        double busy = total - idle;
+        return busy <= 0.0 ? 0.0 : 100.0 * busy / total;
+    }
+
+    double CpuMonitor::packageTemperature(const std::vector<std::pair<std::string, long>>& zones) {
+        // Intel exposes the package sensor directly; otherwise take the hottest CPU-ish zone
+        static const char* cpuZones[] = {"x86_pkg_temp", "cpu", "soc", "k10temp", "coretemp", "acpitz"};
+        for (const auto& [type, milli] : zones) {
+            if (type == "x86_pkg_temp") return milli / 1000.0;
+        }
+        double best = -1.0;
+        for (const auto& [type, milli] : zones) {
+            for (const char* name : cpuZones) {
+                if (type.find(name) != std::string::npos) {
+                    best = std::max(best, milli / 1000.0);
+                    break;
+                }
+            }
+        }
+        return best;
+    }
+
+    std::vector<std::pair<std::string, long>> CpuMonitor::readThermalZones() const {
+        std::vector<std::pair<std::string, long>> zones;
+        std::string base = sysRoot_ + "/class/thermal";
+        DIR* dir = opendir(base.c_str());
+        if (!dir) return zones;
+        while (struct dirent* entry = readdir(dir)) {
+            if (std::strncmp(entry->d_name, "thermal_zone", 12) != 0) continue;
+            std::string zone = base + "/" + entry->d_name;
+            std::string type = trim(readFile(zone + "/type"));
+            std::string temp = trim(readFile(zone + "/temp"));
+            if (type.empty() || temp.empty()) continue;
+            try {
+                zones.emplace_back(type, std::stol(temp));
+            } catch (const std::exception&) {
+                // Some zones report errors instead of a value when the sensor is off
+            }
+        }
+        closedir(dir);
+        return zones;
+    }
+
+    CpuStats CpuMonitor::update() {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto times = parseProcStat(readFile(procRoot_ + "/stat"));
+        if (times.empty()) {
+            current_.available = false;
+            return current_;
+        }
+        current_.available = true;
+
+        if (prevTimes_.size() == times.size()) {
+            current_.utilization = utilization(prevTimes_[0], times[0]);
+            current_.coreUtilization.resize(times.size() - 1);
+            for (size_t i = 1; i < times.size(); i++) {
+                current_.coreUtilization[i - 1] = utilization(prevTimes_[i], times[i]);
+            }
+        } else {
+            // First sample (or CPUs hot-plugged): no interval to measure yet
+            current_.utilization = 0.0;
+            current_.coreUtilization.assign(times.size() - 1, 0.0);
+        }
+        prevTimes_ = std::move(times);
+
+        current_.processRss = parseKbField(readFile(procRoot_ + "/self/status"), "VmRSS");
+        std::string meminfo = readFile(procRoot_ + "/meminfo");
+        current_.memoryTotal = parseKbField(meminfo, "MemTotal");
+        current_.memoryAvailable = parseKbField(meminfo, "MemAvailable");
+
+        current_.cpuPressure = parsePsi(readFile(procRoot_ + "/pressure/cpu"));
+        current_.memoryPressure = parsePsi(readFile(procRoot_ + "/pressure/memory"));
+        current_.ioPressure = parsePsi(readFile(procRoot_ + "/pressure/io"));
+
+        current_.packageTemp = packageTemperature(readThermalZones());
+
+        // Throttle Check
+        if (current_.packageTemp >= MAX_TEMP_SAFE) {
+            if (!current_.throttle) {
+                LOG_WARN("CPU Temperature " << current_.packageTemp << "C exceeds limit " << MAX_TEMP_SAFE << "C. Throttling...");
+            }
+            current_.throttle = true;
+        } else {
+            if (current_.throttle) {
+                LOG_INFO("CPU Temperature normalized (" << current_.packageTemp << "C).");
+            }
+            current_.throttle = false;
+        }
+
+        return current_;
+    }
+
+    bool CpuMonitor::isThrottling() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return current_.throttle;
+    }
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <mutex>
+
+namespace Hardware {
+
+    // Jiffies from one /proc/stat "cpu" line
+    struct CpuTimes {
+        unsigned long long user = 0, nice = 0, system = 0, idle = 0;
+        unsigned long long iowait = 0, irq = 0, softirq = 0, steal = 0;
+
+        unsigned long long idleTotal() const { return idle + iowait; }
+        unsigned long long total() const { return user + nice + system + idle + iowait + irq + softirq + steal; }
+    };
+
+    // One /proc/pressure/* file: share of wall time (%) stalled over 10 s / 60 s
+    struct PsiStats {
+        double some_avg10 = 0.0;
+        double some_avg60 = 0.0;
+        double full_avg10 = 0.0;
+        double full_avg60 = 0.0;
+    };
+
+    struct CpuStats {
+        bool available = false;                  // /proc could be read
+        double utilization = 0.0;                // % across all cores, since the previous update
+        std::vector<double> coreUtilization;     // % per core
+        unsigned long long processRss = 0;       // Bytes (VmRSS)
+        unsigned long long memoryTotal = 0;      // Bytes
+        unsigned long long memoryAvailable = 0;  // Bytes
+        PsiStats cpuPressure;
+        PsiStats memoryPressure;
+        PsiStats ioPressure;
+        double packageTemp = -1.0;               // C, -1 if no thermal zone
+        bool throttle = false;                   // True if packageTemp > MAX_TEMP_SAFE
+    };
+
+    /**
+     * CpuMonitor - Host telemetry from procfs/sysfs for CPU-only deployments
+     *
+     * Utilization is computed from the /proc/stat delta between two updates, so the
+     * first update reports 0%. Files that are missing (no PSI on older kernels, no
+     * thermal zones in containers) leave their fields at the defaults.
+     */
+    class CpuMonitor {
+    public:
+        explicit CpuMonitor(std::string procRoot = "/proc", std::string sysRoot = "/sys");
+
+        CpuStats update();
+        bool isThrottling() const;
+
+        // Parsers (public for tests)
+        // Aggregate "cpu" line first, then cpu0..cpuN
+        static std::vector<CpuTimes> parseProcStat(const std::string& text);
+        // "Key:   123 kB" lines (/proc/meminfo, /proc/self/status), in bytes; 0 if absent
+        static unsigned long long parseKbField(const std::string& text, const std::string& key);
+        static PsiStats parsePsi(const std::string& text);
+        // Busy share (%) between two samples
+        static double utilization(const CpuTimes& prev, const CpuTimes& cur);
+        // Package temperature (C) from (type, millidegrees) thermal zones; -1 if none fits
+        static double packageTemperature(const std::vector<std::pair<std::string, long>>& zones);
+
+        static constexpr double MAX_TEMP_SAFE = 90.0;
+
+    private:
+        std::string procRoot_;
+        std::string sysRoot_;
+        std::vector<CpuTimes> prevTimes_;
+        CpuStats current_;
+        mutable std::mutex mutex_;
+
+        std::vector<std::pair<std::string, long>> readThermalZones() const;
+    };
+
+}
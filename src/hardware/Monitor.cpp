@@ -1,5 +1,5 @@
 #include "Monitor.h"
-#include <iostream>
+#include "../core/Logger.h"
 
 namespace Hardware {
 
@@ -13,10 +13,11 @@ namespace Hardware {
     }
 
     bool Monitor::init() {
+        std::lock_guard<std::mutex> lock(mutex_);
 #ifdef USE_CUDA
         nvmlReturn_t result = nvmlInit();
         if (NVML_SUCCESS != result) {
-            std::cerr << "Failed to initialize NVML: " << nvmlErrorString(result) << std::endl;
+            LOG_ERROR("Failed to initialize NVML: " << nvmlErrorString(result));
             return false;
         }
 
@@ -24,7 +25,7 @@ namespace Hardware {
         // Assuming single GPU setup (GTX 1060)
         result = nvmlDeviceGetHandleByIndex(0, &device);
         if (NVML_SUCCESS != result) {
-            std::cerr << "Failed to get device handle: " << nvmlErrorString(result) << std::endl;
+            LOG_ERROR("Failed to get device handle: " << nvmlErrorString(result));
             nvmlShutdown();
             return false;
         }
@@ -32,18 +33,19 @@ namespace Hardware {
         // Verify device name
         char name[64];
         if (NVML_SUCCESS == nvmlDeviceGetName(device, name, sizeof(name))) {
-            std::cout << "Monitor initialized for: " << name << std::endl;
+            LOG_INFO("Monitor initialized for: " << name);
         }
 
         initialized = true;
         return true;
 #else
-        std::cout << "Monitor: CUDA support not compiled. Running in CPU-only mode." << std::endl;
+        LOG_INFO("Monitor: CUDA support not compiled. Running in CPU-only mode.");
         return false;
 #endif
     }
 
     void Monitor::shutdown() {
+        std::lock_guard<std::mutex> lock(mutex_);
 #ifdef USE_CUDA
         if (initialized) {
             nvmlShutdown();
@@ -53,6 +55,7 @@ namespace Hardware {
     }
 
     GpuStats Monitor::updateStats() {
+        std::lock_guard<std::mutex> lock(mutex_);
         if (!initialized) return currentStats;
 
 #ifdef USE_CUDA
@@ -91,12 +94,12 @@ namespace Hardware {
         // Throttle Check
         if (currentStats.temp >= MAX_TEMP_SAFE) {
             if (!currentStats.throttle) {
-                std::cerr << "WARNING: GPU Temperature " << currentStats.temp << "C exceeds limit " << MAX_TEMP_SAFE << "C. Throttling..." << std::endl;
+                LOG_WARN("GPU Temperature " << currentStats.temp << "C exceeds limit " << MAX_TEMP_SAFE << "C. Throttling...");
             }
             currentStats.throttle = true;
         } else {
             if (currentStats.throttle) {
-                std::cout << "INFO: GPU Temperature normalized (" << currentStats.temp << "C)." << std::endl;
+                LOG_INFO("GPU Temperature normalized (" << currentStats.temp << "C).");
             }
             currentStats.throttle = false;
         }
@@ -106,18 +109,22 @@ namespace Hardware {
     }
 
     bool Monitor::isThrottling() const {
-        return currentStats.throttle;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (currentStats.throttle) return true;
+        }
+        return cpu_.isThrottling();
     }
 
     int Monitor::calculateOptimalGpuLayers(unsigned long long modelSizeBytes) {
 #ifdef USE_CUDA
         if (!initialized) {
-            std::cerr << "Monitor not initialized. Cannot calculate GPU layers." << std::endl;
+            LOG_ERROR("Monitor not initialized. Cannot calculate GPU layers.");
             return -1;
         }
 
         // Update stats to get current VRAM
-        updateStats();
+        GpuStats stats = updateStats();
 
         // Safety buffer: 500MB to prevent OOM
         const unsigned long long SAFETY_BUFFER_MB = 500;
@@ -125,25 +132,25 @@ namespace Hardware {
 
         // Calculate available VRAM with buffer
         unsigned long long availableVRAM = 0;
-        if (currentStats.memoryFree > SAFETY_BUFFER_BYTES) {
-            availableVRAM = currentStats.memoryFree - SAFETY_BUFFER_BYTES;
+        if (stats.memoryFree > SAFETY_BUFFER_BYTES) {
+            availableVRAM = stats.memoryFree - SAFETY_BUFFER_BYTES;
         } else {
-            std::cerr << "WARNING: Insufficient VRAM available. Free: " 
-                      << (currentStats.memoryFree / (1024*1024)) << " MB" << std::endl;
+            LOG_WARN("Insufficient VRAM available. Free: " 
+                      << (stats.memoryFree / (1024*1024)) << " MB");
             return 0; // No GPU layers
         }
 
-        std::cout << "\n--- Smart Split Computing ---" << std::endl;
-        std::cout << "VRAM Total: " << (currentStats.memoryTotal / (1024*1024)) << " MB" << std::endl;
-        std::cout << "VRAM Free:  " << (currentStats.memoryFree / (1024*1024)) << " MB" << std::endl;
-        std::cout << "Safety Buffer: " << SAFETY_BUFFER_MB << " MB" << std::endl;
-        std::cout << "Available for Model: " << (availableVRAM / (1024*1024)) << " MB" << std::endl;
+        LOG_INFO("--- Smart Split Computing ---");
+        LOG_INFO("VRAM Total: " << (stats.memoryTotal / (1024*1024)) << " MB");
+        LOG_INFO("VRAM Free:  " << (stats.memoryFree / (1024*1024)) << " MB");
+        LOG_INFO("Safety Buffer: " << SAFETY_BUFFER_MB << " MB");
+        LOG_INFO("Available for Model: " << (availableVRAM / (1024*1024)) << " MB");
 
         // If entire model fits in VRAM, use all layers (return 99 = max)
         if (modelSizeBytes <= availableVRAM) {
-            std::cout << "Model fits entirely in GPU (" << (modelSizeBytes / (1024*1024)) 
-                      << " MB). Using all layers." << std::endl;
-            std::cout << "-----------------------------\n" << std::endl;
+            LOG_INFO("Model fits entirely in GPU (" << (modelSizeBytes / (1024*1024)) 
+                      << " MB). Using all layers.");
+            LOG_INFO("-----------------------------");
             return 99; // Max layers
         }
 
@@ -166,16 +173,16 @@ namespace Hardware {
             recommendedLayers = 1;
         }
 
-        std::cout << "Model size: " << (modelSizeBytes / (1024*1024)) << " MB" << std::endl;
-        std::cout << "Estimated total layers: " << estimatedTotalLayers << std::endl;
-        std::cout << "Recommended GPU layers: " << recommendedLayers 
-                  << " (" << (int)(proportion * 100) << "% of model)" << std::endl;
-        std::cout << "Remaining layers will use CPU" << std::endl;
-        std::cout << "-----------------------------\n" << std::endl;
+        LOG_INFO("Model size: " << (modelSizeBytes / (1024*1024)) << " MB");
+        LOG_INFO("Estimated total layers: " << estimatedTotalLayers);
+        LOG_INFO("Recommended GPU layers: " << recommendedLayers 
+                  << " (" << (int)(proportion * 100) << "% of model)");
+        LOG_INFO("Remaining layers will use CPU");
+        LOG_INFO("-----------------------------");
 
         return recommendedLayers;
 #else
-        std::cout << "CUDA not compiled. Cannot use GPU layers." << std::endl;
+        LOG_INFO("CUDA not compiled. Cannot use GPU layers.");
         return 0; // CPU-only
 #endif
     }
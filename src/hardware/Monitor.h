@@ -1,6 +1,9 @@
 #pragma once
 
 #include <string>
+#include <atomic>
+#include <mutex>
+#include "CpuMonitor.h"
 
 #ifdef USE_CUDA
 #include <nvml.h>
@@ -28,8 +31,11 @@ namespace Hardware {
         
         // Updates internal stats and returns them
         GpuStats updateStats();
+
+        // Host CPU/memory telemetry (works without CUDA and without init())
+        CpuStats updateCpuStats() { return cpu_.update(); }
         
-        // Quick check without full update
+        // Quick check without full update (GPU or CPU over its temperature limit)
         bool isThrottling() const;
         
         // Calculate optimal number of GPU layers based on available VRAM
@@ -40,8 +46,11 @@ namespace Hardware {
 #ifdef USE_CUDA
         nvmlDevice_t device;
 #endif
-        bool initialized = false;
+        std::atomic<bool> initialized{false};
         GpuStats currentStats;
+        // init() runs on the startup thread while the metrics timer polls stats
+        mutable std::mutex mutex_;
+        CpuMonitor cpu_;
         
         // Constants (GTX 1060 constraints)
         const unsigned int MAX_TEMP_SAFE = 80;
@@ -1,11 +1,18 @@
-#include <iostream>
 #include <fstream>
 #include <sys/stat.h>
+#include <thread>
+#include <atomic>
+#include <csignal>
+#include <memory>
 #include "Engine.h"
+#include "LlamaSession.h"
+#include "MockBackend.h"
 #include "WsServer.h"
 #include "Monitor.h"
 #include "EnvLoader.h"
 #include "ClientAuth.h"
+#include "Logger.h"
+#include "Trace.h"
 
 // Helper to get file size
 unsigned long long getFileSize(const std::string& filename) {
@@ -17,38 +24,27 @@ unsigned long long getFileSize(const std::string& filename) {
 int main(int argc, char** argv) {
     // 0. Load Environment Variables
     if (!Core::EnvLoader::load()) {
-        std::cerr << "WARNING: Failed to load .env file. using system environment or defaults." << std::endl;
+        LOG_WARN("Failed to load .env file. using system environment or defaults.");
     }
 
-    // 0.1 Verify JotaDB Connection (Heartbeat)
-    std::cout << "========================================" << std::endl;
-    std::cout << "  JOTADB AUTHENTICATION VERIFICATION" << std::endl;
-    std::cout << "========================================" << std::endl;
-    {
-        Server::ClientAuth auth;
-        std::cout << "Connecting to JotaDB..." << std::endl;
-        
-        if (!auth.verifyConnection()) {
-            std::cerr << std::endl;
-            std::cerr << "❌ [FATAL] AUTHENTICATION FAILED" << std::endl;
-            std::cerr << "   InferenceCenter could not authorize with JotaDB." << std::endl;
-            std::cerr << "   Please check your JOTA_DB_SK and JOTA_DB_URL configuration." << std::endl;
-            std::cerr << "========================================" << std::endl;
-            return 1;
-        }
-        
-        std::cout << std::endl;
-        std::cout << "✅ [SUCCESS] AUTHENTICATION VERIFIED" << std::endl;
-        std::cout << "   InferenceCenter is authorized with JotaDB." << std::endl;
-        std::cout << "========================================" << std::endl;
-        std::cout << std::endl;
-    }
+    // 0.1 Configure logging (LOG_LEVEL=debug|info|warn|error, LOG_FORMAT=text|json)
+    Core::Logger::instance().configure(
+        Core::Logger::parseLevel(Core::EnvLoader::get("LOG_LEVEL", "info")),
+        Core::EnvLoader::get("LOG_FORMAT", "text") == "json");
+
+    // 0.2 Request tracing (TRACE_SAMPLE_RATE=0 disables it); `kill -USR2` writes a dump
+    Core::Tracer::instance().setSampleRate(std::stod(Core::EnvLoader::get("TRACE_SAMPLE_RATE", "0.01")));
+    std::signal(SIGUSR2, [](int) { Core::Tracer::instance().requestDump(); });
 
     std::string modelPath;
     std::string initialPrompt;
     int port = 3000;
     int gpuLayers = -1;  // -1 = auto-detect
     int ctxSize = 512;
+    bool prefetch = false;
+    int prefetchThreads = 4;
+    bool mock = false;
+    Core::MockBackend::Config mockConfig;
     
     // Parse arguments
     bool hasNamedArgs = false;
@@ -69,6 +65,28 @@ int main(int argc, char** argv) {
         } else if (arg == "--ctx-size" && i + 1 < argc) {
             ctxSize = std::atoi(argv[++i]);
             hasNamedArgs = true;
+        } else if (arg == "--prefetch") {
+            prefetch = true;
+            hasNamedArgs = true;
+        } else if (arg == "--prefetch-threads" && i + 1 < argc) {
+            prefetchThreads = std::atoi(argv[++i]);
+            prefetch = true;
+            hasNamedArgs = true;
+        } else if (arg == "--mock") {
+            mock = true;
+            hasNamedArgs = true;
+        } else if (arg == "--mock-prefill-tps" && i + 1 < argc) {
+            mockConfig.prefill_tps = std::atof(argv[++i]);
+            hasNamedArgs = true;
+        } else if (arg == "--mock-decode-tps" && i + 1 < argc) {
+            mockConfig.decode_tps = std::atof(argv[++i]);
+            hasNamedArgs = true;
+        } else if (arg == "--mock-jitter" && i + 1 < argc) {
+            mockConfig.jitter = std::atof(argv[++i]);
+            hasNamedArgs = true;
+        } else if (arg == "--mock-seed" && i + 1 < argc) {
+            mockConfig.seed = std::strtoull(argv[++i], nullptr, 10);
+            hasNamedArgs = true;
         } else if (!hasNamedArgs && i == 1) {
             // Backward compatibility: first positional arg is model path
             modelPath = arg;
@@ -78,81 +96,146 @@ int main(int argc, char** argv) {
         }
     }
     
-    if (modelPath.empty()) {
-        std::cerr << "Usage: " << argv[0] << " --model <path_to_model.gguf> [--prompt \"text\"] [--port 3000] [--gpu-layers N] [--ctx-size 512]" << std::endl;
-        std::cerr << "  Or (legacy): " << argv[0] << " <path_to_model.gguf> [port]" << std::endl;
+    if (modelPath.empty() && !mock) {
+        LOG_ERROR("Usage: " << argv[0] << " --model <path_to_model.gguf> [--prompt \"text\"] [--port 3000] [--gpu-layers N] [--ctx-size 512] [--prefetch] [--prefetch-threads 4]");
+        LOG_ERROR("  Or (no model): " << argv[0] << " --mock [--mock-prefill-tps 2000] [--mock-decode-tps 50] [--mock-jitter 0.1] [--mock-seed 1] [--port 3000]");
+        LOG_ERROR("  Or (legacy): " << argv[0] << " <path_to_model.gguf> [port]");
         return 1;
     }
 
-    // 0. Initialize Hardware Monitor
     Hardware::Monitor monitor;
-    bool monitorInitialized = monitor.init();
-    
-    if (!monitorInitialized) {
-        std::cerr << "WARNING: Failed to initialize Hardware Monitor (NVML)." << std::endl;
-    } else {
-        auto stats = monitor.updateStats();
-        std::cout << "--- GPU STATUS ---" << std::endl;
-        std::cout << "VRAM Total: " << stats.memoryTotal / (1024*1024) << " MB" << std::endl;
-        std::cout << "VRAM Free:  " << stats.memoryFree / (1024*1024) << " MB" << std::endl;
-        std::cout << "Temp:       " << stats.temp << " C" << std::endl;
-        std::cout << "------------------" << std::endl;
-    }
-
-    // 1. Initialize Engine
     Core::Engine engine;
     
-    std::cout << "--- INFERENCE CORE SERVER ---" << std::endl;
-    std::cout << engine.getSystemInfo() << std::endl;
+    LOG_INFO("--- INFERENCE CORE SERVER ---");
+    LOG_INFO(engine.getSystemInfo());
 
     Core::EngineConfig config;
     config.modelPath = modelPath;
     config.ctx_size = ctxSize;
-    
-    // Smart Split Computing: Auto-detect GPU layers if user didn't specify
-    if (gpuLayers == -1) {
-        if (monitorInitialized) {
-            // Get model file size
-            unsigned long long modelSize = getFileSize(modelPath);
-            if (modelSize > 0) {
-                config.n_gpu_layers = monitor.calculateOptimalGpuLayers(modelSize);
+    config.prefetch = prefetch;
+    config.prefetch_threads = prefetchThreads;
+    config.warmup_prompt = initialPrompt;
+
+    // Sessions run on the model, or on the mock backend for load tests without one
+    std::unique_ptr<Core::Backend> backend;
+    if (mock) {
+        try {
+            backend = std::make_unique<Core::MockBackend>(mockConfig);
+        } catch (const std::exception& e) {
+            LOG_ERROR(e.what());
+            return 1;
+        }
+        LOG_INFO("Mock backend: prefill " << mockConfig.prefill_tps << " tok/s, decode "
+                  << mockConfig.decode_tps << " tok/s, jitter " << mockConfig.jitter);
+    } else {
+        backend = std::make_unique<Core::LlamaBackend>(engine);
+    }
+
+    // The listener starts immediately: HELLO answers "loading" (with progress)
+    // and sessions are refused until the model is ready.
+    Server::WsServer server(engine, *backend, monitor, port, config.ctx_size);
+    std::atomic<bool> startupFailed{false};
+
+    // Startup phase A: Verify JotaDB Connection (Heartbeat)
+    std::thread authThread([&]() {
+        Server::ClientAuth auth;
+        LOG_INFO("Connecting to JotaDB...");
+        
+        if (!auth.verifyConnection()) {
+            LOG_ERROR("========================================");
+            LOG_ERROR("❌ [FATAL] AUTHENTICATION FAILED");
+            LOG_ERROR("   InferenceCenter could not authorize with JotaDB.");
+            LOG_ERROR("   Please check your JOTA_DB_SK and JOTA_DB_URL configuration.");
+            LOG_ERROR("========================================");
+            startupFailed = true;
+            engine.cancelLoad();  // Exit now rather than after the model has loaded
+            server.stop();
+            return;
+        }
+        
+        LOG_INFO("========================================");
+        LOG_INFO("✅ [SUCCESS] AUTHENTICATION VERIFIED");
+        LOG_INFO("   InferenceCenter is authorized with JotaDB.");
+        LOG_INFO("========================================");
+    });
+
+    // Startup phase B: Hardware Monitor, GPU split and model loading
+    std::thread modelThread([&]() {
+        bool monitorInitialized = monitor.init();
+        
+        if (!monitorInitialized) {
+            LOG_WARN("Failed to initialize Hardware Monitor (NVML).");
+        } else {
+            auto stats = monitor.updateStats();
+            LOG_INFO("--- GPU STATUS ---");
+            LOG_INFO("VRAM Total: " << stats.memoryTotal / (1024*1024) << " MB");
+            LOG_INFO("VRAM Free:  " << stats.memoryFree / (1024*1024) << " MB");
+            LOG_INFO("Temp:       " << stats.temp << " C");
+            LOG_INFO("------------------");
+        }
+
+        if (mock) {
+            // No model: batch_infer and embeddings keep reporting it as loading
+            return;
+        }
+        
+        // Smart Split Computing: Auto-detect GPU layers if user didn't specify
+        if (gpuLayers == -1) {
+            if (monitorInitialized) {
+                // Get model file size
+                unsigned long long modelSize = getFileSize(modelPath);
+                if (modelSize > 0) {
+                    config.n_gpu_layers = monitor.calculateOptimalGpuLayers(modelSize);
+                } else {
+                    LOG_WARN("Could not determine model size. Using CPU-only.");
+                    config.n_gpu_layers = 0;
+                }
             } else {
-                std::cerr << "WARNING: Could not determine model size. Using CPU-only." << std::endl;
+                // No monitor, default to CPU-only
+                LOG_INFO("Monitor not available. Using CPU-only mode.");
                 config.n_gpu_layers = 0;
             }
         } else {
-            // No monitor, default to CPU-only
-            std::cout << "Monitor not available. Using CPU-only mode." << std::endl;
-            config.n_gpu_layers = 0;
+            // User specified GPU layers explicitly
+            config.n_gpu_layers = gpuLayers;
         }
-    } else {
-        // User specified GPU layers explicitly
-        config.n_gpu_layers = gpuLayers;
-    }
-    
-    
-    // Load model silently
-    if (!engine.loadModel(config)) {
-        std::cerr << std::endl;
-        std::cerr << "========================================" << std::endl;
-        std::cerr << "❌ [FATAL] MODEL LOADING FAILED" << std::endl;
-        std::cerr << "   Could not load model: " << modelPath << std::endl;
-        std::cerr << "========================================" << std::endl;
-        monitor.shutdown();
-        return 1;
-    }
-    
-    std::cout << "========================================" << std::endl;
-    std::cout << "✅ MODEL LOADED SUCCESSFULLY" << std::endl;
-    std::cout << "   GPU Layers: " << config.n_gpu_layers << std::endl;
-    std::cout << "   Context Size: " << config.ctx_size << " tokens" << std::endl;
-    std::cout << "========================================" << std::endl;
-    std::cout << std::endl;
+        
+        // Load model silently (progress is reported through HELLO).
+        // With --prefetch, the engine only reports READY once the weights are hot.
+        if (!engine.loadModel(config)) {
+            if (engine.isLoadCancelled()) {
+                LOG_INFO("Model loading cancelled");
+                return;
+            }
+            LOG_ERROR("========================================");
+            LOG_ERROR("❌ [FATAL] MODEL LOADING FAILED");
+            LOG_ERROR("   Could not load model: " << modelPath);
+            LOG_ERROR("========================================");
+            startupFailed = true;
+            server.stop();
+            return;
+        }
+        
+        LOG_INFO("========================================");
+        LOG_INFO("✅ MODEL LOADED SUCCESSFULLY");
+        LOG_INFO("   GPU Layers: " << config.n_gpu_layers);
+        LOG_INFO("   Context Size: " << config.ctx_size << " tokens");
+        const auto& warmup = engine.getWarmupReport();
+        if (warmup.ran) {
+            LOG_INFO("   Prefetch: " << warmup.bytes_prefetched / (1024*1024) << " MB in "
+                      << warmup.prefetch_ms << " ms (" << warmup.prefetch_major_faults << " major faults)");
+            LOG_INFO("   Warm-up: " << warmup.warmup_tokens << " tokens in " << warmup.warmup_ms
+                      << " ms (" << warmup.warmup_major_faults << " major faults)");
+        }
+        LOG_INFO("========================================");
+    });
 
-    // 2. Start WebSocket Server
-    Server::WsServer server(engine, monitor, port, config.ctx_size);
+    // Start WebSocket Server (blocks until stopped)
     server.run();
+
+    authThread.join();
+    modelThread.join();
     
     monitor.shutdown();
-    return 0;
-}
\ No newline at end of file
+    return startupFailed ? 1 : 0;
+}
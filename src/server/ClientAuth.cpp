@@ -1,13 +1,53 @@
 #include "ClientAuth.h"
 #include "EnvLoader.h"
-#include <iostream>
+#include "Logger.h"
 #include <cstdlib>
+#include <fstream>
+#include <iterator>
 #include <httplib.h>
 
 namespace Server {
 
-    ClientAuth::ClientAuth() {
+    const char* authOutcomeName(AuthOutcome outcome) {
+        switch (outcome) {
+            case AuthOutcome::CACHE_HIT: return "cache_hit";
+            case AuthOutcome::VALIDATED: return "validated";
+            case AuthOutcome::JOINED: return "joined";
+            case AuthOutcome::STALE: return "stale";
+            case AuthOutcome::REJECTED: return "rejected";
+            case AuthOutcome::NEGATIVE_HIT: return "negative_hit";
+            case AuthOutcome::UNAVAILABLE: return "unavailable";
+            case AuthOutcome::TOKEN: return "token";
+            default: return "unknown";
+        }
+    }
+
+    AuthCacheConfig AuthCacheConfig::fromEnv() {
+        AuthCacheConfig config;
+        config.ttl = std::chrono::seconds(std::stol(Core::EnvLoader::get("AUTH_CACHE_TTL_S", "900")));
+        config.refresh_ahead = std::chrono::seconds(std::stol(Core::EnvLoader::get("AUTH_REFRESH_AHEAD_S", "60")));
+        config.negative_ttl = std::chrono::seconds(std::stol(Core::EnvLoader::get("AUTH_NEGATIVE_TTL_S", "30")));
+        config.stale = std::chrono::seconds(std::stol(Core::EnvLoader::get("AUTH_STALE_S", "3600")));
+        return config;
+    }
+
+    ClientAuth::ClientAuth() : ClientAuth(AuthCacheConfig::fromEnv()) {}
+
+    ClientAuth::ClientAuth(const AuthCacheConfig& cache) : cache_config_(cache) {
         initJotaDB();
+        initTokens();
+        refresh_thread_ = std::thread([this]() { refreshLoop(); });
+    }
+
+    ClientAuth::~ClientAuth() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            refresh_running_ = false;
+        }
+        refresh_cv_.notify_all();
+        if (refresh_thread_.joinable()) {
+            refresh_thread_.join();
+        }
     }
 
     void ClientAuth::initJotaDB() {
@@ -15,113 +55,314 @@ namespace Server {
         jota_db_url_ = Core::EnvLoader::get("JOTA_DB_URL", "https://green-house.local/api/db");
         jota_db_usr_ = Core::EnvLoader::get("JOTA_DB_USR", "");
         jota_db_sk_ = Core::EnvLoader::get("JOTA_DB_SK", "");
-        
+        pool_size_ = std::stoul(Core::EnvLoader::get("JOTA_DB_POOL_SIZE", "4"));
 
-        std::cout << "[Auth] JotaDB URL configured: " << jota_db_url_ << std::endl;
+        LOG_INFO("[Auth] JotaDB URL configured: " << jota_db_url_);
         if (jota_db_sk_.empty() || jota_db_usr_.empty()) {
-            std::cerr << "[Auth] WARNING: JOTA_DB_SK or JOTA_DB_USR is not set! JotaDB authentication requests may fail." << std::endl;
+            LOG_WARN("[Auth] JOTA_DB_SK or JOTA_DB_USR is not set! JotaDB authentication requests may fail.");
+        }
+
+        // Parse and sanitize the URL once; every request reuses the parts
+        std::string host_port;
+        if (jota_db_url_.find("http://") == 0) {
+            scheme_ = "http";
+            host_port = jota_db_url_.substr(7);
+        } else if (jota_db_url_.find("https://") == 0) {
+            scheme_ = "https";
+            host_port = jota_db_url_.substr(8);
+        } else {
+            scheme_ = "http";
+            host_port = jota_db_url_;
+        }
+
+        size_t path_pos = host_port.find('/');
+        if (path_pos != std::string::npos) {
+            base_url_ = scheme_ + "://" + host_port.substr(0, path_pos);
+            path_prefix_ = host_port.substr(path_pos);
+        } else {
+            base_url_ = scheme_ + "://" + host_port;
+            path_prefix_ = "";
+        }
+
+        if (!path_prefix_.empty() && path_prefix_.back() == '/') {
+            path_prefix_.pop_back();
+        }
+    }
+
+    void ClientAuth::initTokens() {
+        std::string secret = Core::EnvLoader::get("AUTH_TOKEN_HS256_SECRET", "");
+        if (!secret.empty()) {
+            token_verifier_.setHmacSecret(secret);
+        }
+
+        // Either the key itself (PEM or base64 of the 32 raw bytes) or a file holding it
+        std::string public_key = Core::EnvLoader::get("AUTH_TOKEN_ED25519_PUBLIC_KEY", "");
+        if (!public_key.empty()) {
+            std::ifstream file(public_key);
+            if (file) {
+                public_key.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            }
+            if (!token_verifier_.setEd25519PublicKey(public_key)) {
+                LOG_ERROR("[Auth] AUTH_TOKEN_ED25519_PUBLIC_KEY is not a usable Ed25519 public key");
+            }
+        }
+
+        token_verifier_.setIssuer(Core::EnvLoader::get("AUTH_TOKEN_ISSUER", ""));
+        if (token_verifier_.enabled()) {
+            LOG_INFO("[Auth] Signed client tokens are verified locally");
         }
     }
 
-    bool ClientAuth::authenticate(const std::string& client_id, const std::string& api_key) {
-        // 1. Check Cache with TTL
+    std::unique_ptr<httplib::Client> ClientAuth::acquireClient(bool& reused) {
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex_);
+            if (!idle_clients_.empty()) {
+                auto client = std::move(idle_clients_.back());
+                idle_clients_.pop_back();
+                reused = true;
+                return client;
+            }
+        }
+
+        reused = false;
+        auto client = std::make_unique<httplib::Client>(base_url_.c_str());
+        client->set_keep_alive(true);
+        client->set_connection_timeout(2);
+        client->set_read_timeout(3);
+
+        #ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+        if (scheme_ == "https") {
+            client->enable_server_certificate_verification(false);
+        }
+        #endif
+
+        return client;
+    }
+
+    void ClientAuth::releaseClient(std::unique_ptr<httplib::Client> client) {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        if (idle_clients_.size() < pool_size_) {
+            idle_clients_.push_back(std::move(client));
+        }
+    }
+
+    ClientAuth::JotaResponse ClientAuth::jotaGet(const std::string& path,
+                                                 const std::vector<std::pair<std::string, std::string>>& headers) {
+        httplib::Headers request_headers(headers.begin(), headers.end());
+        std::string request_path = path_prefix_ + path;
+        JotaResponse response;
+
+        // A pooled connection may have been closed by JotaDB (or a proxy) while idle;
+        // that failure is retried once on a fresh connection instead of denying the client
+        for (int attempt = 0; attempt < 2; attempt++) {
+            bool reused = false;
+            auto client = acquireClient(reused);
+
+            auto start = std::chrono::steady_clock::now();
+            auto res = client->Get(request_path.c_str(), request_headers);
+            rtt_.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count());
+
+            if (res) {
+                response.status = res->status;
+                response.body = res->body;
+                releaseClient(std::move(client));
+                return response;
+            }
+
+            request_errors_.fetch_add(1, std::memory_order_relaxed);
+            response.error = httplib::to_string(res.error());
+
+            // The other idle connections most likely died with this one (network blip,
+            // JotaDB restart): drop them so the next requests reconnect straight away
+            {
+                std::lock_guard<std::mutex> lock(pool_mutex_);
+                idle_clients_.clear();
+            }
+
+            if (!reused) break;
+            LOG_DEBUG("[Auth] Pooled JotaDB connection failed (" << response.error << "), retrying on a new one");
+        }
+
+        return response;
+    }
+
+    AuthOutcome ClientAuth::count(AuthOutcome outcome) {
+        outcome_counts_[static_cast<size_t>(outcome)].fetch_add(1, std::memory_order_relaxed);
+        return outcome;
+    }
+
+    AuthOutcome ClientAuth::check(const std::string& client_id, const std::string& api_key) {
+        // 0. Signed token: decided here, whatever the signature says (no JotaDB fallback)
+        if (isLocalToken(api_key)) {
+            TokenClaims claims;
+            std::string error;
+            if (!token_verifier_.verify(api_key, claims, error) || claims.client_id != client_id) {
+                LOG_INFO("[Auth] Token refused for " << client_id << ": "
+                          << (error.empty() ? "issued to another client" : error));
+                return count(AuthOutcome::REJECTED);
+            }
+
+            // Kept where getClientConfig() and clientExists() look
+            ClientConfig cfg;
+            cfg.client_id = client_id;
+            cfg.api_key = api_key;
+            cfg.max_sessions = claims.max_sessions;
+            cfg.priority = claims.priority;
+            cfg.prompt_tps = claims.prompt_tps;
+            cfg.generated_tps = claims.generated_tps;
+            cfg.last_validated = std::chrono::system_clock::now();
+            std::lock_guard<std::mutex> lock(mutex_);
+            client_cache_[client_id] = cfg;
+            return count(AuthOutcome::TOKEN);
+        }
+
+        const std::string negative_key = client_id + '\n' + api_key;
+        bool stale_usable = false;
+
+        // 1. Check the caches
         {
             std::lock_guard<std::mutex> lock(mutex_);
+            auto now = std::chrono::system_clock::now();
+
             auto it = client_cache_.find(client_id);
-            if (it != client_cache_.end()) {
-                auto now = std::chrono::system_clock::now();
-                auto elapsed = std::chrono::duration_cast<std::chrono::minutes>(now - it->second.last_validated).count();
-                
-                if (elapsed < 15) {
-                    // Constant-time check for key match just to be safe (though cache should be trusted if owned)
-                    if (it->second.api_key == api_key) {
-                        std::cout << "[Auth] Cache hit for " << client_id 
-                                  << " (Validated " << elapsed << " mins ago)" << std::endl;
-                        return true;
+            if (it != client_cache_.end() && it->second.api_key == api_key) {
+                auto age = now - it->second.last_validated;
+                if (age < cache_config_.ttl) {
+                    // Close to expiry: re-validate in the background so the next connect still hits
+                    if (age >= cache_config_.ttl - cache_config_.refresh_ahead &&
+                        refresh_pending_.insert(client_id).second) {
+                        refresh_queue_.emplace_back(client_id, api_key);
+                        refresh_cv_.notify_one();
                     }
-                } else {
-                    std::cout << "[Auth] Cache expired for " << client_id 
-                              << ". Re-validating..." << std::endl;
+                    LOG_DEBUG("[Auth] Cache hit for " << client_id << " (Validated "
+                              << std::chrono::duration_cast<std::chrono::seconds>(age).count() << " s ago)");
+                    return count(AuthOutcome::CACHE_HIT);
                 }
+                stale_usable = age < cache_config_.ttl + cache_config_.stale;
+                LOG_INFO("[Auth] Cache expired for " << client_id << ". Re-validating...");
+            }
+
+            auto neg = negative_cache_.find(negative_key);
+            if (neg != negative_cache_.end()) {
+                if (now < neg->second) {
+                    return count(AuthOutcome::NEGATIVE_HIT);
+                }
+                negative_cache_.erase(neg);
             }
         }
 
-        std::cout << "[Auth] Validating " << client_id << " via JotaDB..." << std::endl;
+        // 2. Ask JotaDB (or wait for the request already asking)
+        bool joined = false;
+        switch (validate(client_id, api_key, joined)) {
+            case Verdict::AUTHORIZED:
+                return count(joined ? AuthOutcome::JOINED : AuthOutcome::VALIDATED);
+            case Verdict::REJECTED:
+                return count(AuthOutcome::REJECTED);
+            default:
+                break;
+        }
 
-        // 2. Parse and Sanitize URL
-        std::string url = jota_db_url_;
-        std::string scheme;
-        std::string host_port;
-        // Logic duplicated, could exact to helper method but for now inline is fine
-        if (url.find("http://") == 0) {
-            scheme = "http";
-            host_port = url.substr(7);
-        } else if (url.find("https://") == 0) {
-            scheme = "https";
-            host_port = url.substr(8);
-        } else {
-            scheme = "http"; 
-            host_port = url;
+        // 3. JotaDB unreachable: an expired entry is still better than locking everyone out
+        if (stale_usable) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = client_cache_.find(client_id);
+            if (it != client_cache_.end() && it->second.api_key == api_key) {
+                LOG_WARN("[Auth] JotaDB unavailable, accepting expired credentials of " << client_id);
+                return count(AuthOutcome::STALE);
+            }
         }
+        return count(AuthOutcome::UNAVAILABLE);
+    }
 
-        size_t path_pos = host_port.find('/');
-        std::string domain;
-        std::string path_prefix;
-        if (path_pos != std::string::npos) {
-            domain = host_port.substr(0, path_pos);
-            path_prefix = host_port.substr(path_pos);
-        } else {
-            domain = host_port;
-            path_prefix = "";
+    ClientAuth::Verdict ClientAuth::validate(const std::string& client_id, const std::string& api_key, bool& joined) {
+        const std::string key = client_id + '\n' + api_key;
+
+        std::shared_ptr<Flight> flight;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = flights_.find(key);
+            if (it != flights_.end()) {
+                flight = it->second;
+                joined = true;
+            } else {
+                flight = std::make_shared<Flight>();
+                flights_[key] = flight;
+            }
         }
-        
-        if (!path_prefix.empty() && path_prefix.back() == '/') {
-            path_prefix.pop_back();
+
+        if (joined) {
+            std::unique_lock<std::mutex> lock(flight->mutex);
+            flight->cv.wait(lock, [&flight] { return flight->done; });
+            return flight->verdict;
         }
-        
-        std::string base_url = scheme + "://" + domain;
 
-        // 3. Perform HTTP/HTTPS Request
-        httplib::Client cli(base_url.c_str());
-        cli.set_connection_timeout(2);
-        cli.set_read_timeout(3);
-        
-        #ifdef CPPHTTPLIB_OPENSSL_SUPPORT
-        if (scheme == "https") {
-            cli.enable_server_certificate_verification(false); 
+        ClientConfig cfg;
+        Verdict verdict = requestValidation(client_id, api_key, cfg);
+
+        // Apply before releasing the followers, so they (and later callers) see the answer
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto now = std::chrono::system_clock::now();
+            if (verdict == Verdict::AUTHORIZED) {
+                client_cache_[client_id] = cfg;
+            } else if (verdict == Verdict::REJECTED) {
+                auto it = client_cache_.find(client_id);
+                if (it != client_cache_.end() && it->second.api_key == api_key) {
+                    client_cache_.erase(it);
+                }
+                if (negative_cache_.size() >= cache_config_.max_negative) {
+                    for (auto neg = negative_cache_.begin(); neg != negative_cache_.end();) {
+                        neg = now >= neg->second ? negative_cache_.erase(neg) : std::next(neg);
+                    }
+                    if (negative_cache_.size() >= cache_config_.max_negative) {
+                        negative_cache_.clear();
+                    }
+                }
+                negative_cache_[key] = now + cache_config_.negative_ttl;
+            }
+            flights_.erase(key);
         }
-        #endif
+        {
+            std::lock_guard<std::mutex> lock(flight->mutex);
+            flight->verdict = verdict;
+            flight->done = true;
+        }
+        flight->cv.notify_all();
+
+        return verdict;
+    }
+
+    ClientAuth::Verdict ClientAuth::requestValidation(const std::string& client_id, const std::string& api_key,
+                                                      ClientConfig& cfg) {
+        LOG_INFO("[Auth] Validating " << client_id << " via JotaDB...");
 
-        std::string request_path = path_prefix + "/auth/internal";
-        
         // Headers construction
-        httplib::Headers headers;
+        std::vector<std::pair<std::string, std::string>> headers;
         
-        // 1. Client Credentials (X-Headers)
-        headers.emplace("X-Client-ID", client_id);
-        headers.emplace("X-API-Key", api_key);
+        // Client Credentials (X-Headers)
+        headers.emplace_back("X-Client-ID", client_id);
+        headers.emplace_back("X-API-Key", api_key);
         
-        // 2. Server Identity (Bearer Token)
+        // Server Identity (Bearer Token)
         if (!jota_db_sk_.empty()) {
-            headers.emplace("Authorization", "Bearer " + jota_db_sk_);
+            headers.emplace_back("Authorization", "Bearer " + jota_db_sk_);
         }
         
-        auto res = cli.Get(request_path.c_str(), headers);
+        // Perform HTTP/HTTPS Request (pooled keep-alive connection)
+        auto res = jotaGet("/auth/internal", headers);
 
-        if (res && res->status == 200) {
+        if (res.status == 200) {
             try {
-                auto json_res = json::parse(res->body);
+                auto json_res = json::parse(res.body);
                 
                 if (json_res.contains("error")) {
-                     std::cout << "[Auth] Validation failed for " << client_id << ": " 
-                               << json_res["error"] << std::endl;
-                     return false;
+                     LOG_INFO("[Auth] Validation failed for " << client_id << ": " 
+                               << json_res["error"]);
+                     return Verdict::REJECTED;
                 }
 
                 if (json_res.value("authorized", true)) {
-                    // Update cache
-                    std::lock_guard<std::mutex> lock(mutex_);
-                    ClientConfig cfg;
                     cfg.client_id = client_id;
                     cfg.api_key = api_key;
                     cfg.last_validated = std::chrono::system_clock::now();
@@ -131,99 +372,96 @@ namespace Server {
                         cfg.max_sessions = config_data.value("max_sessions", 1);
                         cfg.priority = config_data.value("priority", "normal");
                         cfg.description = config_data.value("description", "");
+                        cfg.prompt_tps = config_data.value("prompt_tps", 0.0);
+                        cfg.generated_tps = config_data.value("generated_tps", 0.0);
                     } else {
                         // Fallback
                         cfg.max_sessions = json_res.value("max_sessions", 1);
                         cfg.priority = json_res.value("priority", "normal");
                         cfg.description = json_res.value("description", "");
+                        cfg.prompt_tps = json_res.value("prompt_tps", 0.0);
+                        cfg.generated_tps = json_res.value("generated_tps", 0.0);
                     }
                     
-                    client_cache_[client_id] = cfg;
-                    
-                    std::cout << "[Auth] Validation success for " << client_id << " (max_sessions: " << cfg.max_sessions << ")" << std::endl;
-                    return true;
+                    LOG_INFO("[Auth] Validation success for " << client_id << " (max_sessions: " << cfg.max_sessions << ")");
+                    return Verdict::AUTHORIZED;
                 }
                 
-                std::cout << "[Auth] Validation failed (authorized=false) for " << client_id << std::endl;
-                return false;
+                LOG_INFO("[Auth] Validation failed (authorized=false) for " << client_id);
+                return Verdict::REJECTED;
 
             } catch (const std::exception& e) {
-                std::cerr << "[Auth] Error parsing JotaDB response: " << e.what() << std::endl;
-                return false;
+                LOG_ERROR("[Auth] Error parsing JotaDB response: " << e.what());
+                return Verdict::UNAVAILABLE;
             }
-        } else {
-            auto err = res.error();
-            std::cerr << "[Auth] JotaDB request failed. Status: " << (res ? std::to_string(res->status) : "Connection Error") 
-                      << " Error: " << err << std::endl;
-            return false;
         }
-    }
 
-    bool ClientAuth::verifyConnection() {
-        std::string url = jota_db_url_;
-        // Basic URL parsing (simplified for brevity, should ideally share logic)
-        std::string scheme;
-        std::string host_port;
-        if (url.find("http://") == 0) {
-            scheme = "http";
-            host_port = url.substr(7);
-        } else if (url.find("https://") == 0) {
-            scheme = "https";
-            host_port = url.substr(8);
-        } else {
-            scheme = "http"; 
-            host_port = url;
+        // Only an explicit "authorized": false is an answer about the credentials. Other
+        // statuses (429, 408, 401/403 for a wrong JOTA_DB_SK, 5xx) and transport errors
+        // say nothing about them, and must not evict a valid entry.
+        if (res.status != 0) {
+            auto json_res = json::parse(res.body, nullptr, false);
+            if (json_res.is_object() && json_res.contains("authorized") && json_res["authorized"] == false) {
+                LOG_INFO("[Auth] Validation failed (status " << res.status << ") for " << client_id);
+                return Verdict::REJECTED;
+            }
         }
 
-        size_t path_pos = host_port.find('/');
-        std::string domain;
-        std::string path_prefix;
-        if (path_pos != std::string::npos) {
-            domain = host_port.substr(0, path_pos);
-            path_prefix = host_port.substr(path_pos);
-        } else {
-            domain = host_port;
-            path_prefix = "";
+        LOG_ERROR("[Auth] JotaDB request failed. Status: " << (res.status ? std::to_string(res.status) : "Connection Error") 
+                  << " Error: " << res.error);
+        if (res.status == 401 || res.status == 403) {
+            LOG_ERROR("[Auth] JotaDB refused this server: check JOTA_DB_SK");
         }
-        
-        if (!path_prefix.empty() && path_prefix.back() == '/') {
-            path_prefix.pop_back();
-        }
-        
-        std::string base_url = scheme + "://" + domain;
-        httplib::Client cli(base_url.c_str());
-        cli.set_connection_timeout(3);
-        cli.set_read_timeout(3);
-        
-        #ifdef CPPHTTPLIB_OPENSSL_SUPPORT
-        if (scheme == "https") {
-            cli.enable_server_certificate_verification(false); 
+        return Verdict::UNAVAILABLE;
+    }
+
+    void ClientAuth::refreshLoop() {
+        while (true) {
+            std::pair<std::string, std::string> credentials;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                refresh_cv_.wait(lock, [this] { return !refresh_queue_.empty() || !refresh_running_; });
+                if (!refresh_running_) break;
+
+                credentials = std::move(refresh_queue_.front());
+                refresh_queue_.pop_front();
+            }
+
+            // The leader updates the cache; an unreachable JotaDB leaves the entry to
+            // expire into the stale window
+            bool joined = false;
+            Verdict verdict = validate(credentials.first, credentials.second, joined);
+            LOG_DEBUG("[Auth] Refreshed " << credentials.first << ": "
+                      << (verdict == Verdict::AUTHORIZED ? "authorized" :
+                          verdict == Verdict::REJECTED ? "rejected" : "unavailable"));
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            refresh_pending_.erase(credentials.first);
         }
-        #endif
+    }
 
-        std::string request_path = path_prefix + "/health"; 
-        
-        httplib::Headers headers;
+    bool ClientAuth::verifyConnection() {
+        std::vector<std::pair<std::string, std::string>> headers;
         if (!jota_db_sk_.empty()) {
-            headers.emplace("Authorization", "Bearer " + jota_db_sk_);
+            headers.emplace_back("Authorization", "Bearer " + jota_db_sk_);
         } else {
-            std::cerr << "[Auth] WARNING: JOTA_DB_SK is empty. Authorization will likely fail." << std::endl;
+            LOG_WARN("[Auth] JOTA_DB_SK is empty. Authorization will likely fail.");
         }
         
-        auto res = cli.Get(request_path.c_str(), headers);
+        auto res = jotaGet("/health", headers);
         
-        if (res && res->status == 200) {
-             std::cout << "[Auth] JotaDB Connection Verified (Heartbeat OK)" << std::endl;
+        if (res.status == 200) {
+             LOG_INFO("[Auth] JotaDB Connection Verified (Heartbeat OK)");
              return true;
         }
         
-        if (res) {
-             std::cerr << "[Auth] Connection Failed. Status: " << res->status << std::endl;
-             if (res->status == 401 || res->status == 403) {
-                 std::cerr << "[FATAL] Authorization Error: Check JOTA_DB_SK" << std::endl;
+        if (res.status) {
+             LOG_ERROR("[Auth] Connection Failed. Status: " << res.status);
+             if (res.status == 401 || res.status == 403) {
+                 LOG_ERROR("[FATAL] Authorization Error: Check JOTA_DB_SK");
              }
         } else {
-             std::cerr << "[Auth] Connection Failed. Network Error: " << res.error() << std::endl;
+             LOG_ERROR("[Auth] Connection Failed. Network Error: " << res.error);
         }
         
         return false;
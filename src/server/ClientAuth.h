@@ -1,11 +1,23 @@
 #pragma once
 
+#include "../core/LatencyHistogram.h"
+#include "TokenVerifier.h"
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <mutex>
 #include <chrono>
+#include <memory>
+#include <atomic>
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <vector>
 #include <nlohmann/json.hpp>
 
+namespace httplib { class Client; }
+
 using json = nlohmann::json;
 
 namespace Server {
@@ -16,17 +28,69 @@ namespace Server {
         int max_sessions = 1;
         std::string priority = "normal";
         std::string description;
+        // Token rate limits, tokens/s (0 = node default, see Core::RateLimiter)
+        double prompt_tps = 0.0;
+        double generated_tps = 0.0;
         std::chrono::system_clock::time_point last_validated;
     };
 
+    // How a credential check was answered
+    enum class AuthOutcome {
+        CACHE_HIT,     // Fresh cache entry
+        VALIDATED,     // Accepted by JotaDB
+        JOINED,        // Accepted by a JotaDB request another caller already had in flight
+        STALE,         // JotaDB unreachable; expired entry served within the stale window
+        REJECTED,      // Refused by JotaDB
+        NEGATIVE_HIT,  // Refused by JotaDB recently, not asked again
+        UNAVAILABLE,   // JotaDB unreachable and nothing usable cached
+        TOKEN,         // Signed token verified locally, JotaDB not asked
+        COUNT
+    };
+
+    const char* authOutcomeName(AuthOutcome outcome);
+    inline bool isAuthorized(AuthOutcome outcome) {
+        return outcome == AuthOutcome::CACHE_HIT || outcome == AuthOutcome::VALIDATED ||
+               outcome == AuthOutcome::JOINED || outcome == AuthOutcome::STALE ||
+               outcome == AuthOutcome::TOKEN;
+    }
+
+    // Lifetimes of cached JotaDB answers
+    struct AuthCacheConfig {
+        std::chrono::milliseconds ttl{std::chrono::minutes(15)};          // Accepted credentials
+        std::chrono::milliseconds refresh_ahead{std::chrono::minutes(1)}; // Re-validate in the background this long before expiry
+        std::chrono::milliseconds negative_ttl{std::chrono::seconds(30)}; // Refused credentials
+        std::chrono::milliseconds stale{std::chrono::hours(1)};           // Past ttl, still accepted while JotaDB is unreachable
+        size_t max_negative = 10000;                                      // Refused entries kept
+
+        // AUTH_CACHE_TTL_S, AUTH_REFRESH_AHEAD_S, AUTH_NEGATIVE_TTL_S, AUTH_STALE_S
+        static AuthCacheConfig fromEnv();
+    };
+
     class ClientAuth {
     public:
         ClientAuth();
-        ~ClientAuth() = default;
+        explicit ClientAuth(const AuthCacheConfig& cache);
+        ~ClientAuth();
 
         // Authenticate a client with client_id and api_key via JotaDB
         // Returns true if valid, false otherwise or on error
-        bool authenticate(const std::string& client_id, const std::string& api_key);
+        bool authenticate(const std::string& client_id, const std::string& api_key) {
+            return isAuthorized(check(client_id, api_key));
+        }
+
+        // Same, reporting how the answer was obtained. Signed tokens are verified
+        // in-process; legacy API keys go through the cache and JotaDB. Concurrent checks
+        // of the same key share one JotaDB request; entries close to expiry are
+        // refreshed in the background.
+        AuthOutcome check(const std::string& client_id, const std::string& api_key);
+
+        // True if check() answers this key without JotaDB (a token we can verify)
+        bool isLocalToken(const std::string& api_key) const {
+            return token_verifier_.enabled() && TokenVerifier::looksLikeToken(api_key);
+        }
+
+        // Keys for signed tokens (AUTH_TOKEN_* at construction)
+        TokenVerifier& getTokenVerifier() { return token_verifier_; }
 
         // Verify connection and authorization with JotaDB (Heartbeat)
         // Uses the configured JOTA_DB_SK to authenticate itself
@@ -39,19 +103,86 @@ namespace Server {
         // Check if a client_id exists (via JotaDB check)
         bool clientExists(const std::string& client_id) const;
 
+        // Round trips of JotaDB requests (microseconds), including failed ones
+        Core::HistogramSnapshot getRttSnapshot() const { return rtt_.snapshot(); }
+
+        // JotaDB requests that got no HTTP response (connect/read failure)
+        uint64_t getRequestErrors() const { return request_errors_.load(std::memory_order_relaxed); }
+
+        // Checks answered with an outcome so far
+        uint64_t getOutcomeCount(AuthOutcome outcome) const {
+            return outcome_counts_[static_cast<size_t>(outcome)].load(std::memory_order_relaxed);
+        }
+
     private:
         std::string jota_db_url_;
         std::string jota_db_usr_;
         std::string jota_db_sk_;
+
+        // jota_db_url_ split once: "scheme://host[:port]" and the path prefix (no trailing slash)
+        std::string scheme_;
+        std::string base_url_;
+        std::string path_prefix_;
+
+        // Idle keep-alive connections, reused so a validation skips TCP/TLS setup.
+        // At most pool_size_ are kept; extra concurrent requests open temporary ones.
+        std::vector<std::unique_ptr<httplib::Client>> idle_clients_;
+        size_t pool_size_ = 4;
+        std::mutex pool_mutex_;
+
+        Core::LatencyHistogram rtt_;
+        std::atomic<uint64_t> request_errors_{0};
+
+        struct JotaResponse {
+            int status = 0;    // 0 = no response
+            std::string body;
+            std::string error; // Transport error when status is 0
+        };
+
+        // GET path_prefix_ + path on a pooled connection
+        JotaResponse jotaGet(const std::string& path, const std::vector<std::pair<std::string, std::string>>& headers);
+        std::unique_ptr<httplib::Client> acquireClient(bool& reused);
+        void releaseClient(std::unique_ptr<httplib::Client> client);
         
-        // Simple cache to avoid hitting DB for every single token/operation if needed
-        // For now, per requirements, we will validate dynamicially but might cache config
-        // Mutable to allow modification in const methods if we implement caching
+        // Accepted credentials by client_id (last_validated = JotaDB answer time)
         mutable std::unordered_map<std::string, ClientConfig> client_cache_;
         mutable std::mutex mutex_;
 
+        TokenVerifier token_verifier_;
+
+        AuthCacheConfig cache_config_;
+        // Refused credentials (client_id + '\n' + api_key) -> expiry
+        std::unordered_map<std::string, std::chrono::system_clock::time_point> negative_cache_;
+
+        // One JotaDB request per credentials in flight; later callers wait for it
+        enum class Verdict { AUTHORIZED, REJECTED, UNAVAILABLE };
+        struct Flight {
+            std::mutex mutex;
+            std::condition_variable cv;
+            bool done = false;
+            Verdict verdict = Verdict::UNAVAILABLE;
+        };
+        std::unordered_map<std::string, std::shared_ptr<Flight>> flights_;  // Guarded by mutex_
+
+        // Refresh-ahead: credentials queued for background re-validation
+        std::deque<std::pair<std::string, std::string>> refresh_queue_;       // Guarded by mutex_
+        std::unordered_set<std::string> refresh_pending_;                    // client_ids, guarded by mutex_
+        std::condition_variable refresh_cv_;
+        bool refresh_running_ = true;
+        std::thread refresh_thread_;
+
+        std::array<std::atomic<uint64_t>, static_cast<size_t>(AuthOutcome::COUNT)> outcome_counts_{};
+
         // Helper to parse JotaDB URL from env
         void initJotaDB();
+        void initTokens();
+
+        // Validate through JotaDB, sharing the request with concurrent callers; the
+        // leader applies the answer to the caches. joined is set for followers.
+        Verdict validate(const std::string& client_id, const std::string& api_key, bool& joined);
+        Verdict requestValidation(const std::string& client_id, const std::string& api_key, ClientConfig& cfg);
+        void refreshLoop();
+        AuthOutcome count(AuthOutcome outcome);
     };
 
 }
@@ -6,9 +6,12 @@
 #include "handlers/SessionHandler.h"
 #include "handlers/InferenceHandler.h"
 #include "handlers/MetricsHandler.h"
+#include "handlers/EmbeddingHandler.h"
+#include "handlers/TraceHandler.h"
+#include "../core/Logger.h"
+#include "../core/Trace.h"
 #include <nlohmann/json.hpp>
 #include <memory>
-#include <iostream>
 
 using json = nlohmann::json;
 
@@ -19,6 +22,7 @@ namespace Server {
  * 
  * Parses operation from JSON and delegates to the correct handler.
  * Centralized error handling for malformed messages.
+ * This is where requests are sampled for tracing (see Core::Tracer).
  */
 class MessageDispatcher {
 public:
@@ -27,15 +31,20 @@ public:
         std::shared_ptr<AuthHandler> authHandler,
         std::shared_ptr<SessionHandler> sessionHandler,
         std::shared_ptr<InferenceHandler> inferenceHandler,
-        std::shared_ptr<MetricsHandler> metricsHandler
+        std::shared_ptr<MetricsHandler> metricsHandler,
+        std::shared_ptr<EmbeddingHandler> embeddingHandler,
+        std::shared_ptr<TraceHandler> traceHandler
     )
         : pingHandler_(pingHandler)
         , authHandler_(authHandler)
         , sessionHandler_(sessionHandler)
         , inferenceHandler_(inferenceHandler)
         , metricsHandler_(metricsHandler)
+        , embeddingHandler_(embeddingHandler)
+        , traceHandler_(traceHandler)
     {
-        if (!pingHandler_ || !authHandler_ || !sessionHandler_ || !inferenceHandler_ || !metricsHandler_) {
+        if (!pingHandler_ || !authHandler_ || !sessionHandler_ || !inferenceHandler_ || !metricsHandler_ ||
+            !embeddingHandler_ || !traceHandler_) {
             throw std::invalid_argument("All handlers must be provided");
         }
     }
@@ -57,6 +66,10 @@ public:
             }
             
             std::string op = data["op"];
+
+            // Sampled requests carry this trace id through every later span
+            Core::Tracer::Scope trace(Core::Tracer::instance().sample());
+            Core::TraceSpan span(op.c_str());
             
             // Route to appropriate handler
             // HELLO does not require authentication
@@ -75,15 +88,27 @@ public:
             else if (op == Op::INFER) {
                 inferenceHandler_->handleInfer(ctx, data);
             }
+            else if (op == Op::APPEND_MESSAGE) {
+                inferenceHandler_->handleAppendMessage(ctx, data);
+            }
+            else if (op == Op::BATCH_INFER) {
+                inferenceHandler_->handleBatchInfer(ctx, data);
+            }
             else if (op == Op::ABORT) {
                 inferenceHandler_->handleAbort(ctx, data);
             }
+            else if (op == Op::EMBED) {
+                embeddingHandler_->handleEmbed(ctx, data);
+            }
             else if (op == Op::SUBSCRIBE_METRICS) {
                 metricsHandler_->handleSubscribe(ctx, data);
             }
             else if (op == Op::UNSUBSCRIBE_METRICS) {
                 metricsHandler_->handleUnsubscribe(ctx, data);
             }
+            else if (op == Op::DUMP_TRACE) {
+                traceHandler_->handleDump(ctx, data);
+            }
             else {
                 handleError(ctx, "Unknown operation: " + op);
             }
@@ -101,12 +126,14 @@ private:
     std::shared_ptr<SessionHandler> sessionHandler_;
     std::shared_ptr<InferenceHandler> inferenceHandler_;
     std::shared_ptr<MetricsHandler> metricsHandler_;
+    std::shared_ptr<EmbeddingHandler> embeddingHandler_;
+    std::shared_ptr<TraceHandler> traceHandler_;
     
     /**
      * Send error response to client
      */
     void handleError(RequestContext& ctx, const std::string& error) {
-        std::cerr << "MessageDispatcher error: " << error << std::endl;
+        LOG_ERROR("MessageDispatcher error: " << error);
         
         json response = {
             {"op", Op::ERROR},
@@ -0,0 +1,102 @@
+#include "PrometheusWriter.h"
+#include <cmath>
+#include <cstdio>
+
+namespace Server {
+
+const std::vector<double>& PrometheusWriter::latencyBounds() {
+    static const std::vector<double> bounds = {
+        0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60
+    };
+    return bounds;
+}
+
+std::string PrometheusWriter::escape(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '\\': escaped += "\\\\"; break;
+            case '"': escaped += "\\\""; break;
+            case '\n': escaped += "\\n"; break;
+            default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+void PrometheusWriter::family(const std::string& name, const char* type, const std::string& help) {
+    out_ += "# HELP " + name + " " + help + "\n";
+    out_ += "# TYPE " + name + " " + type + "\n";
+}
+
+void PrometheusWriter::appendLabels(const Labels& labels, const std::string* le) {
+    if (labels.empty() && !le) return;
+    out_ += '{';
+    bool first = true;
+    for (const auto& [key, value] : labels) {
+        if (!first) out_ += ',';
+        out_ += key + "=\"" + escape(value) + "\"";
+        first = false;
+    }
+    if (le) {
+        if (!first) out_ += ',';
+        out_ += "le=\"" + *le + "\"";
+    }
+    out_ += '}';
+}
+
+void PrometheusWriter::appendValue(double value) {
+    char buf[32];
+    if (std::isinf(value)) {
+        out_ += value > 0 ? "+Inf" : "-Inf";
+    } else if (value == std::floor(value) && std::fabs(value) < 1e15) {
+        std::snprintf(buf, sizeof(buf), "%.0f", value);
+        out_ += buf;
+    } else {
+        std::snprintf(buf, sizeof(buf), "%.9g", value);
+        out_ += buf;
+    }
+}
+
+void PrometheusWriter::sample(const std::string& name, double value, const Labels& labels) {
+    out_ += name;
+    appendLabels(labels);
+    out_ += ' ';
+    appendValue(value);
+    out_ += '\n';
+}
+
+void PrometheusWriter::histogram(const std::string& name, const Core::HistogramSnapshot& snapshot,
+                                 const Labels& labels, double scale, const std::vector<double>& bounds) {
+    // Bounds ascend, so one pass over the HDR buckets yields the cumulative counts
+    size_t bucket = 0;
+    uint64_t cumulative = 0;
+    for (double bound : bounds) {
+        while (bucket < snapshot.counts.size() &&
+               Core::LatencyHistogram::bucketValue(bucket) <= bound * scale) {
+            cumulative += snapshot.counts[bucket++];
+        }
+
+        char le[32];
+        std::snprintf(le, sizeof(le), "%g", bound);
+        std::string leText = le;
+        out_ += name + "_bucket";
+        appendLabels(labels, &leText);
+        out_ += ' ';
+        appendValue((double)cumulative);
+        out_ += '\n';
+    }
+
+    std::string inf = "+Inf";
+    out_ += name + "_bucket";
+    appendLabels(labels, &inf);
+    out_ += ' ';
+    appendValue((double)snapshot.total);
+    out_ += '\n';
+
+    sample(name + "_sum", snapshot.sum / scale, labels);
+    sample(name + "_count", (double)snapshot.total, labels);
+}
+
+} // namespace Server
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../core/LatencyHistogram.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Server {
+
+/**
+ * PrometheusWriter - Builds a Prometheus text exposition (format 0.0.4)
+ *
+ * Families are declared with family() and followed by their samples. Histograms
+ * are rendered from a Core::HistogramSnapshot onto a fixed set of `le` bounds.
+ */
+class PrometheusWriter {
+public:
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    // Default `le` bounds for latency histograms, in seconds
+    static const std::vector<double>& latencyBounds();
+
+    // # HELP / # TYPE lines (type: counter, gauge or histogram)
+    void family(const std::string& name, const char* type, const std::string& help);
+
+    void sample(const std::string& name, double value, const Labels& labels = {});
+
+    // name_bucket{le=...}, name_sum and name_count; snapshot values are divided by
+    // scale (1e6 turns microseconds into seconds)
+    void histogram(const std::string& name, const Core::HistogramSnapshot& snapshot,
+                   const Labels& labels, double scale = 1e6,
+                   const std::vector<double>& bounds = latencyBounds());
+
+    const std::string& str() const { return out_; }
+    std::string take() { return std::move(out_); }
+
+    // Escape a label value (backslash, double quote, newline)
+    static std::string escape(const std::string& value);
+
+private:
+    std::string out_;
+
+    void appendLabels(const Labels& labels, const std::string* le = nullptr);
+    void appendValue(double value);
+};
+
+} // namespace Server
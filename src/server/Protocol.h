@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
@@ -17,11 +18,17 @@ namespace Server {
         
         // Inference
         constexpr const char* INFER = "infer";
+        constexpr const char* APPEND_MESSAGE = "append_message";
         constexpr const char* ABORT = "abort";
+        constexpr const char* EMBED = "embed";
+        constexpr const char* BATCH_INFER = "batch_infer";
         
         // Metrics subscription
         constexpr const char* SUBSCRIBE_METRICS = "subscribe_metrics";
         constexpr const char* UNSUBSCRIBE_METRICS = "unsubscribe_metrics";
+
+        // Diagnostics (admin clients only)
+        constexpr const char* DUMP_TRACE = "dump_trace";
         
         // Server -> Client
         constexpr const char* HELLO = "hello";
@@ -33,9 +40,12 @@ namespace Server {
         constexpr const char* TOKEN = "token";
         constexpr const char* END   = "end";
         constexpr const char* ERROR = "error";
+        constexpr const char* EMBEDDINGS = "embeddings";
+        constexpr const char* BATCH_END = "batch_end";
         constexpr const char* METRICS = "metrics";  // Real-time system metrics
         constexpr const char* METRICS_SUBSCRIBED = "metrics_subscribed";
         constexpr const char* METRICS_UNSUBSCRIBED = "metrics_unsubscribed";
+        constexpr const char* TRACE = "trace";  // Chrome trace JSON of sampled requests
     }
 
     struct InferenceParams {
@@ -43,6 +53,9 @@ namespace Server {
         std::string prompt;
         float temp = 0.7f;
         int max_tokens = -1;
+        std::string grammar;  // GBNF, root rule "root"
+        json json_schema;     // Converted to a grammar; null = none
+        int logprobs = 0;     // Top-N alternatives per token, 0 = off
     };
 
     inline InferenceParams parseInfer(const json& payload) {
@@ -53,7 +66,97 @@ namespace Server {
             auto& params = payload["params"];
             if (params.contains("temp")) p.temp = params["temp"].get<float>();
             if (params.contains("max_tokens")) p.max_tokens = params["max_tokens"].get<int>();
+            if (params.contains("grammar")) p.grammar = params["grammar"].get<std::string>();
+            if (params.contains("json_schema")) p.json_schema = params["json_schema"];
+            if (params.contains("logprobs")) p.logprobs = params["logprobs"].get<int>();
+        }
+        return p;
+    }
+
+    struct AppendMessageParams {
+        std::string role = "user";
+        bool generate = true;        // Reply as the assistant (default: only for user messages)
+        InferenceParams inference;   // session_id, content (as prompt) and generation params
+    };
+
+    inline AppendMessageParams parseAppendMessage(const json& payload) {
+        AppendMessageParams p;
+        p.inference = parseInfer(payload);
+        if (payload.contains("content")) p.inference.prompt = payload["content"].get<std::string>();
+        if (payload.contains("role")) p.role = payload["role"].get<std::string>();
+        p.generate = payload.contains("generate") ? payload["generate"].get<bool>() : p.role == "user";
+        return p;
+    }
+
+    struct BatchInferParams {
+        std::string batch_id;                // Client-chosen id (generated if empty)
+        std::vector<InferenceParams> items;  // One per prompt; index = position
+    };
+
+    // "prompts" entries are either strings or {"prompt": ..., "params": {...}};
+    // top-level "params" are the defaults for every entry.
+    inline BatchInferParams parseBatchInfer(const json& payload) {
+        BatchInferParams p;
+        if (payload.contains("batch_id")) p.batch_id = payload["batch_id"].get<std::string>();
+
+        InferenceParams defaults;
+        if (payload.contains("params")) {
+            defaults = parseInfer(json{{"params", payload["params"]}});
         }
+
+        if (payload.contains("prompts")) {
+            for (const auto& entry : payload["prompts"]) {
+                InferenceParams item = defaults;
+                if (entry.is_string()) {
+                    item.prompt = entry.get<std::string>();
+                } else {
+                    InferenceParams parsed = parseInfer(entry);
+                    item.prompt = parsed.prompt;
+                    if (entry.contains("params")) {
+                        auto& params = entry["params"];
+                        if (params.contains("temp")) item.temp = parsed.temp;
+                        if (params.contains("max_tokens")) item.max_tokens = parsed.max_tokens;
+                    }
+                }
+                p.items.push_back(std::move(item));
+            }
+        }
+        return p;
+    }
+
+    struct EmbedParams {
+        std::vector<std::string> inputs;
+        bool normalize = true;          // L2-normalize each vector
+        std::string encoding = "float"; // "float" (JSON arrays) or "base64" (little-endian float32)
+        std::string request_id;         // Echoed back to correlate responses
+    };
+
+    // "input" may be a single string or an array of strings
+    inline EmbedParams parseEmbed(const json& payload) {
+        EmbedParams p;
+        if (payload.contains("input")) {
+            auto& input = payload["input"];
+            if (input.is_array()) {
+                for (const auto& item : input) p.inputs.push_back(item.get<std::string>());
+            } else {
+                p.inputs.push_back(input.get<std::string>());
+            }
+        }
+        if (payload.contains("normalize")) p.normalize = payload["normalize"].get<bool>();
+        if (payload.contains("encoding")) p.encoding = payload["encoding"].get<std::string>();
+        if (payload.contains("request_id")) p.request_id = payload["request_id"].get<std::string>();
+        return p;
+    }
+
+    struct SubscribeMetricsParams {
+        int interval_s = 1;               // Seconds between frames
+        std::vector<std::string> fields;  // Top-level sections to include; empty = all
+    };
+
+    inline SubscribeMetricsParams parseSubscribeMetrics(const json& payload) {
+        SubscribeMetricsParams p;
+        if (payload.contains("interval_s")) p.interval_s = payload["interval_s"].get<int>();
+        if (payload.contains("fields")) p.fields = payload["fields"].get<std::vector<std::string>>();
         return p;
     }
 
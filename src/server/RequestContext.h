@@ -2,6 +2,7 @@
 
 #include <App.h> // uWebSockets
 #include "Protocol.h"
+#include "../core/Trace.h"
 #include <string>
 #include <nlohmann/json.hpp>
 
@@ -11,13 +12,16 @@ namespace Server {
 
 struct PerSocketData {
     std::string client_id;
+    std::string priority = "normal";  // From the client's JotaDB config
+    std::string metrics_topic;        // uWS topic of the metrics subscription, if any
     bool authenticated = false;
 };
 
 /**
  * RequestContext - Abstraction over WebSocket operations
  * 
- * Encapsulates uWS::Loop::defer pattern for thread-safe sends.
+ * Encapsulates uWS::Loop::defer pattern for thread-safe sends. loop is the
+ * event loop that owns ws; with WS_THREADS > 1 there is one per thread.
  * Provides clean interface for handlers without exposing uWebSockets details.
  */
 class RequestContext {
@@ -35,13 +39,7 @@ public:
      * Can be called from any thread
      */
     void send(const json& message) const {
-        std::string msg = message.dump();
-        auto* ws = ws_;
-        auto* loop = loop_;
-
-        loop->defer([ws, msg]() {
-            ws->send(msg, uWS::OpCode::TEXT);
-        });
+        sendRaw(message.dump());
     }
     
     /**
@@ -52,7 +50,16 @@ public:
         auto* ws = ws_;
         auto* loop = loop_;
 
-        loop->defer([ws, message]() {
+        // Sampled requests also trace the time spent waiting for the loop
+        uint64_t trace = Core::Tracer::current();
+        int64_t deferred_us = trace ? Core::Tracer::instance().nowUs() : 0;
+
+        loop->defer([ws, message, trace, deferred_us]() {
+            if (trace) {
+                auto& tracer = Core::Tracer::instance();
+                tracer.record("defer_wait", trace, deferred_us, tracer.nowUs() - deferred_us);
+            }
+            Core::TraceSpan span("ws_send", trace);
             ws->send(message, uWS::OpCode::TEXT);
         });
     }
@@ -0,0 +1,212 @@
+#include "TokenVerifier.h"
+#include <nlohmann/json.hpp>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/pem.h>
+#include <algorithm>
+#include <chrono>
+
+using json = nlohmann::json;
+
+namespace Server {
+
+    static const char BASE64URL[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+    TokenVerifier::TokenVerifier() = default;
+
+    TokenVerifier::~TokenVerifier() {
+        EVP_PKEY_free(ed25519_key_);
+    }
+
+    std::string TokenVerifier::base64UrlEncode(const std::string& data) {
+        std::string out;
+        out.reserve((data.size() + 2) / 3 * 4);
+        uint32_t buffer = 0;
+        int bits = 0;
+        for (unsigned char c : data) {
+            buffer = (buffer << 8) | c;
+            bits += 8;
+            while (bits >= 6) {
+                bits -= 6;
+                out += BASE64URL[(buffer >> bits) & 0x3F];
+            }
+        }
+        if (bits > 0) {
+            out += BASE64URL[(buffer << (6 - bits)) & 0x3F];
+        }
+        return out;
+    }
+
+    bool TokenVerifier::base64UrlDecode(const std::string& text, std::string& out) {
+        out.clear();
+        out.reserve(text.size() * 3 / 4);
+        uint32_t buffer = 0;
+        int bits = 0;
+        for (char c : text) {
+            int value;
+            if (c >= 'A' && c <= 'Z') value = c - 'A';
+            else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+            else if (c >= '0' && c <= '9') value = c - '0' + 52;
+            else if (c == '-') value = 62;
+            else if (c == '_') value = 63;
+            else return false;  // Including '+', '/' and padding (RFC 7515 section 2)
+
+            buffer = (buffer << 6) | value;
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                out += static_cast<char>((buffer >> bits) & 0xFF);
+            }
+        }
+        // One leftover character is not a byte, and unused bits must be zero: otherwise
+        // several strings would decode to the same bytes
+        return text.size() % 4 != 1 && (buffer & ((1u << bits) - 1)) == 0;
+    }
+
+    bool TokenVerifier::setEd25519PublicKey(const std::string& key) {
+        EVP_PKEY* pkey = nullptr;
+        if (key.find("-----BEGIN") != std::string::npos) {
+            BIO* bio = BIO_new_mem_buf(key.data(), static_cast<int>(key.size()));
+            pkey = PEM_read_bio_PUBKEY(bio, nullptr, nullptr, nullptr);
+            BIO_free(bio);
+            if (pkey && EVP_PKEY_id(pkey) != EVP_PKEY_ED25519) {
+                EVP_PKEY_free(pkey);
+                pkey = nullptr;
+            }
+        } else {
+            // Plain base64 (with padding, maybe a trailing newline) is accepted here too
+            std::string text = key;
+            text.erase(text.find_last_not_of(" \t\r\n=") + 1);
+            std::replace(text.begin(), text.end(), '+', '-');
+            std::replace(text.begin(), text.end(), '/', '_');
+            std::string raw;
+            if (base64UrlDecode(text, raw) && raw.size() == 32) {
+                pkey = EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, nullptr,
+                                                   reinterpret_cast<const unsigned char*>(raw.data()), raw.size());
+            }
+        }
+
+        if (!pkey) {
+            return false;
+        }
+        EVP_PKEY_free(ed25519_key_);
+        ed25519_key_ = pkey;
+        return true;
+    }
+
+    bool TokenVerifier::looksLikeToken(const std::string& value) {
+        size_t first = value.find('.');
+        if (first == std::string::npos || first == 0) return false;
+        size_t second = value.find('.', first + 1);
+        if (second == std::string::npos || second == first + 1 || second + 1 >= value.size()) return false;
+        return value.find('.', second + 1) == std::string::npos;
+    }
+
+    bool TokenVerifier::verifySignature(const std::string& alg, const std::string& signed_part,
+                                        const std::string& signature, std::string& error) const {
+        const auto* data = reinterpret_cast<const unsigned char*>(signed_part.data());
+        const auto* sig = reinterpret_cast<const unsigned char*>(signature.data());
+
+        if (alg == "HS256" && !hmac_secret_.empty()) {
+            unsigned char mac[EVP_MAX_MD_SIZE];
+            unsigned int mac_len = 0;
+            if (!HMAC(EVP_sha256(), hmac_secret_.data(), static_cast<int>(hmac_secret_.size()),
+                      data, signed_part.size(), mac, &mac_len)) {
+                error = "HMAC failed";
+                return false;
+            }
+            if (signature.size() != mac_len || CRYPTO_memcmp(mac, sig, mac_len) != 0) {
+                error = "Bad signature";
+                return false;
+            }
+            return true;
+        }
+
+        if (alg == "EdDSA" && ed25519_key_) {
+            EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+            bool ok = ctx && EVP_DigestVerifyInit(ctx, nullptr, nullptr, nullptr, ed25519_key_) == 1 &&
+                      EVP_DigestVerify(ctx, sig, signature.size(), data, signed_part.size()) == 1;
+            EVP_MD_CTX_free(ctx);
+            if (!ok) {
+                error = "Bad signature";
+            }
+            return ok;
+        }
+
+        error = "Algorithm not accepted: " + alg;
+        return false;
+    }
+
+    bool TokenVerifier::verify(const std::string& token, TokenClaims& claims, std::string& error, int64_t now) const {
+        if (!looksLikeToken(token)) {
+            error = "Malformed token";
+            return false;
+        }
+        size_t first = token.find('.');
+        size_t second = token.find('.', first + 1);
+
+        std::string header_text, payload_text, signature;
+        if (!base64UrlDecode(token.substr(0, first), header_text) ||
+            !base64UrlDecode(token.substr(first + 1, second - first - 1), payload_text) ||
+            !base64UrlDecode(token.substr(second + 1), signature)) {
+            error = "Malformed token";
+            return false;
+        }
+
+        json header = json::parse(header_text, nullptr, false);
+        if (!header.is_object() || !header.contains("alg") || !header["alg"].is_string()) {
+            error = "Malformed token header";
+            return false;
+        }
+
+        // Signature first: nothing in the payload is trusted before it checks out
+        if (!verifySignature(header["alg"].get<std::string>(), token.substr(0, second), signature, error)) {
+            return false;
+        }
+
+        json payload = json::parse(payload_text, nullptr, false);
+        if (!payload.is_object()) {
+            error = "Malformed token payload";
+            return false;
+        }
+
+        if (now == 0) {
+            now = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+        if (!payload.contains("exp") || !payload["exp"].is_number()) {
+            error = "Token has no expiry";
+            return false;
+        }
+        claims.expires_at = static_cast<int64_t>(payload["exp"].get<double>());
+        if (now > claims.expires_at + LEEWAY_S) {
+            error = "Token expired";
+            return false;
+        }
+        if (payload.contains("nbf") && payload["nbf"].is_number() && now + LEEWAY_S < payload["nbf"].get<double>()) {
+            error = "Token not yet valid";
+            return false;
+        }
+        try {
+            if (!issuer_.empty() && payload.value("iss", "") != issuer_) {
+                error = "Unexpected issuer";
+                return false;
+            }
+            claims.client_id = payload.value("client_id", payload.value("sub", ""));
+            claims.max_sessions = payload.value("max_sessions", 1);
+            claims.priority = payload.value("priority", "normal");
+            claims.prompt_tps = payload.value("prompt_tps", 0.0);
+            claims.generated_tps = payload.value("generated_tps", 0.0);
+        } catch (const json::exception&) {
+            error = "Malformed token claims";
+            return false;
+        }
+        if (claims.client_id.empty()) {
+            error = "Token has no client_id";
+            return false;
+        }
+        return true;
+    }
+
+}
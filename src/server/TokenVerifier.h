@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+typedef struct evp_pkey_st EVP_PKEY;
+
+namespace Server {
+
+    // Claims of a verified client token
+    struct TokenClaims {
+        std::string client_id;
+        int max_sessions = 1;
+        std::string priority = "normal";
+        double prompt_tps = 0.0;     // Token rate limits (0 = node default)
+        double generated_tps = 0.0;
+        int64_t expires_at = 0;  // Unix seconds
+    };
+
+    /**
+     * TokenVerifier - Checks JotaDB-issued signed client tokens without a network call
+     *
+     * Tokens use the JWT compact form, base64url(header).base64url(payload).base64url(sig),
+     * signed with HS256 (shared secret) or EdDSA (Ed25519, JotaDB's public key).
+     * The payload carries client_id (or sub), max_sessions, priority, optional
+     * prompt_tps / generated_tps rate limits and exp; nbf and iss are checked when
+     * present/configured. Only configured algorithms are accepted ("none" never is).
+     */
+    class TokenVerifier {
+    public:
+        static constexpr int64_t LEEWAY_S = 30;  // Clock skew tolerated on exp/nbf
+
+        TokenVerifier();
+        ~TokenVerifier();
+        TokenVerifier(const TokenVerifier&) = delete;
+        TokenVerifier& operator=(const TokenVerifier&) = delete;
+
+        void setHmacSecret(const std::string& secret) { hmac_secret_ = secret; }
+
+        // PEM (SubjectPublicKeyInfo) or base64 of the raw 32-byte key; false if unusable
+        bool setEd25519PublicKey(const std::string& key);
+
+        // Only tokens whose iss equals this are accepted (empty = iss not checked)
+        void setIssuer(const std::string& issuer) { issuer_ = issuer; }
+
+        // True once a secret or a public key is set
+        bool enabled() const { return !hmac_secret_.empty() || ed25519_key_ != nullptr; }
+
+        // Three non-empty dot-separated segments (legacy API keys have none)
+        static bool looksLikeToken(const std::string& value);
+
+        // Verify signature and claims at time now (Unix seconds; 0 = current time)
+        // Returns false with a reason in error if the token is not acceptable
+        bool verify(const std::string& token, TokenClaims& claims, std::string& error, int64_t now = 0) const;
+
+        static std::string base64UrlEncode(const std::string& data);
+        // Strict unpadded base64url, as JWS segments use; false on anything else (other
+        // characters, '=' padding, a dangling character or non-zero unused bits)
+        static bool base64UrlDecode(const std::string& text, std::string& out);
+
+    private:
+        std::string hmac_secret_;
+        EVP_PKEY* ed25519_key_ = nullptr;
+        std::string issuer_;
+
+        bool verifySignature(const std::string& alg, const std::string& signed_part,
+                             const std::string& signature, std::string& error) const;
+    };
+
+}
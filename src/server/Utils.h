@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 
 namespace Server {
 namespace Utils {
@@ -60,5 +61,36 @@ inline std::string sanitizeUtf8(const std::string& input) {
     return output;
 }
 
+// Helper: Standard base64 (RFC 4648, padded) for binary payloads in JSON
+inline std::string base64Encode(const unsigned char* data, size_t len) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string output;
+    output.reserve(((len + 2) / 3) * 4);
+
+    size_t i = 0;
+    for (; i + 2 < len; i += 3) {
+        uint32_t n = (data[i] << 16) | (data[i+1] << 8) | data[i+2];
+        output += table[(n >> 18) & 0x3F];
+        output += table[(n >> 12) & 0x3F];
+        output += table[(n >> 6) & 0x3F];
+        output += table[n & 0x3F];
+    }
+    if (i + 1 == len) {
+        uint32_t n = data[i] << 16;
+        output += table[(n >> 18) & 0x3F];
+        output += table[(n >> 12) & 0x3F];
+        output += "==";
+    } else if (i + 2 == len) {
+        uint32_t n = (data[i] << 16) | (data[i+1] << 8);
+        output += table[(n >> 18) & 0x3F];
+        output += table[(n >> 12) & 0x3F];
+        output += table[(n >> 6) & 0x3F];
+        output += '=';
+    }
+
+    return output;
+}
+
 } // namespace Utils
 } // namespace Server
@@ -1,34 +1,98 @@
 #include "WsServer.h"
+#include "../core/Logger.h"
+#include "../core/EnvLoader.h"
+#include "../core/Trace.h"
 #include <nlohmann/json.hpp>
-#include <iostream>
+#include <algorithm>
+#include <sstream>
 
 using json = nlohmann::json;
 
 namespace Server {
 
-WsServer::WsServer(Core::Engine& engine, Hardware::Monitor& monitor,
+// "a, b,c" -> {"a", "b", "c"}
+static std::set<std::string> parseIdList(const std::string& list) {
+    std::set<std::string> ids;
+    std::stringstream stream(list);
+    std::string id;
+    while (std::getline(stream, id, ',')) {
+        size_t begin = id.find_first_not_of(" \t");
+        size_t end = id.find_last_not_of(" \t");
+        if (begin != std::string::npos) ids.insert(id.substr(begin, end - begin + 1));
+    }
+    return ids;
+}
+
+WsServer::WsServer(Core::Engine& engine, Core::Backend& backend, Hardware::Monitor& monitor,
                    int port, int ctx_size)
     : engine_(engine)
+    , backend_(backend)
     , monitor_(monitor)
     , port_(port)
 {
     // Client authentication is now handled dynamically via JotaDB
     // No static config loading required
 
-    // Create session manager
-    sessionManager_ = std::make_unique<Core::SessionManager>(engine_.getModel(), ctx_size);
+    // One uWS::App per event loop thread, all listening on the port (uSockets sets
+    // SO_REUSEPORT, so the kernel spreads new connections over them)
+    int numLoops = std::max(1, std::stoi(Core::EnvLoader::get("WS_THREADS", "1")));
+    for (int i = 0; i < numLoops; i++) {
+        loops_.push_back(std::make_unique<EventLoop>());
+    }
+
+    // The first loop belongs to the thread that will call run(); grab it now so
+    // stop() can be deferred onto it even before run() starts.
+    loops_[0]->loop = uWS::Loop::get();
+
+    // Create session manager (the model may still be loading)
+    sessionManager_ = std::make_unique<Core::SessionManager>(backend_, ctx_size);
     sessionManager_->setClientAuth(&clientAuth_);
 
+    // Shared-context executor for batch_infer (8 parallel sequences)
+    batchGenerator_ = std::make_unique<Core::BatchGenerator>(engine_, ctx_size, 8);
+
+    // Replay cache for greedy requests (RESPONSE_CACHE_ENTRIES=0 disables it)
+    Core::ResponseCache::Config cacheConfig;
+    cacheConfig.max_entries = std::stoul(Core::EnvLoader::get("RESPONSE_CACHE_ENTRIES", "1024"));
+    cacheConfig.max_bytes = std::stoul(Core::EnvLoader::get("RESPONSE_CACHE_MB", "64")) * 1024 * 1024;
+    cacheConfig.ttl = std::chrono::seconds(std::stol(Core::EnvLoader::get("RESPONSE_CACHE_TTL_S", "300")));
+    responseCache_ = std::make_unique<Core::ResponseCache>(cacheConfig);
+    double replayTps = std::stod(Core::EnvLoader::get("RESPONSE_CACHE_PACE_TPS", "0"));
+
+    // Per-client token budgets; JotaDB or token limits override these defaults (0 = unlimited)
+    Core::RateLimiter::Limits defaultLimits;
+    defaultLimits.prompt_tps = std::stod(Core::EnvLoader::get("RATE_LIMIT_PROMPT_TPS", "0"));
+    defaultLimits.generated_tps = std::stod(Core::EnvLoader::get("RATE_LIMIT_GENERATED_TPS", "0"));
+    rateLimiter_ = std::make_unique<Core::RateLimiter>(
+        defaultLimits, std::stod(Core::EnvLoader::get("RATE_LIMIT_BURST_S", "10")));
+
+    // Optional bearer token for GET /metrics (empty = open to scrapers)
+    metricsToken_ = Core::EnvLoader::get("METRICS_TOKEN", "");
+
+    // Clients allowed to run diagnostic ops such as dump_trace
+    std::set<std::string> adminClientIds = parseIdList(Core::EnvLoader::get("ADMIN_CLIENT_IDS", ""));
+
     // Create services
-    inferenceService_ = std::make_unique<InferenceService>(sessionManager_.get(), 4); // 4 worker threads
+    authService_ = std::make_unique<AuthService>(clientAuth_,
+                                                 std::stoi(Core::EnvLoader::get("AUTH_WORKERS", "4")),
+                                                 std::stoul(Core::EnvLoader::get("AUTH_QUEUE_MAX", "256")));
+    inferenceService_ = std::make_unique<InferenceService>(sessionManager_.get(), 4, // 4 worker threads
+                                                           batchGenerator_.get(),
+                                                           responseCache_.get(), replayTps,
+                                                           rateLimiter_.get());
     metricsService_ = std::make_unique<MetricsService>(monitor_, sessionManager_.get(), inferenceService_.get());
+    metricsService_->setTraceDumpDir(Core::EnvLoader::get("TRACE_DUMP_DIR", "."));
+    metricsService_->setClientAuth(&clientAuth_);
+    embeddingService_ = std::make_unique<EmbeddingService>(engine_, ctx_size);
 
     // Create handlers
-    pingHandler_ = std::make_shared<PingHandler>();
+    pingHandler_ = std::make_shared<PingHandler>(engine_, backend_);
     authHandler_ = std::make_shared<AuthHandler>(clientAuth_);
     sessionHandler_ = std::make_shared<SessionHandler>(sessionManager_.get());
     inferenceHandler_ = std::make_shared<InferenceHandler>(inferenceService_.get());
     metricsHandler_ = std::make_shared<MetricsHandler>();
+    embeddingHandler_ = std::make_shared<EmbeddingHandler>(engine_, embeddingService_.get());
+    traceHandler_ = std::make_shared<TraceHandler>(metricsService_.get(), std::move(adminClientIds));
 
     // Create message dispatcher
     dispatcher_ = std::make_unique<MessageDispatcher>(
@@ -36,82 +100,206 @@ WsServer::WsServer(Core::Engine& engine, Hardware::Monitor& monitor,
         authHandler_,
         sessionHandler_,
         inferenceHandler_,
-        metricsHandler_
+        metricsHandler_,
+        embeddingHandler_,
+        traceHandler_
     );
 
-    std::cout << "WsServer initialized on port " << port_ << std::endl;
+    LOG_INFO("WsServer initialized on port " << port_);
 }
 
 WsServer::~WsServer() {
     // Shutdown services
+    if (authService_) {
+        authService_->shutdown();
+    }
     if (metricsService_) {
         metricsService_->shutdown();
     }
     if (inferenceService_) {
         inferenceService_->shutdown();
     }
+    if (embeddingService_) {
+        embeddingService_->shutdown();
+    }
+
+    // Loop threads outlive their loops so late sends from the workers find a
+    // live uWS::Loop to defer to; nothing can be sent anymore past this point
+    {
+        std::lock_guard<std::mutex> lock(loopsMutex_);
+        releaseLoops_ = true;
+    }
+    loopsCv_.notify_all();
+    for (auto& thread : loopThreads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
 
     // Cleanup
     // sessionManager_ is unique_ptr, will be deleted automatically
 
-    std::cout << "WsServer destroyed" << std::endl;
+    LOG_INFO("WsServer destroyed");
 }
 
 void WsServer::run() {
-    struct uWS::Loop* loop = uWS::Loop::get();
-    this->loop_ = loop;
+    for (size_t i = 1; i < loops_.size(); i++) {
+        loopThreads_.emplace_back([this, i]() {
+            runLoop(*loops_[i], i);
+
+            // Keep this thread's loop alive until ~WsServer (see there)
+            std::unique_lock<std::mutex> lock(loopsMutex_);
+            loopsCv_.wait(lock, [this] { return releaseLoops_; });
+        });
+    }
+
+    runLoop(*loops_[0], 0);
 
-    // Start metrics service with broadcast callback
-    metricsService_->setMetricsHandler(metricsHandler_.get());
-    metricsService_->setEventLoop(loop_);
-    metricsService_->start();
+    // Every loop has closed its clients
+    {
+        std::unique_lock<std::mutex> lock(loopsMutex_);
+        loopsCv_.wait(lock, [this] { return loopsDone_ == loops_.size(); });
+    }
+    
+    LOG_INFO("Server stopped");
+}
 
-    uWS::App()
+void WsServer::runLoop(EventLoop& el, size_t index) {
+    {
+        std::lock_guard<std::mutex> lock(loopsMutex_);
+        if (index > 0) {
+            el.loop = uWS::Loop::get();
+        }
+        // stop() came before this loop existed: don't listen, run() returns at once
+        el.stopping = stopRequested_ && index > 0;
+    }
+
+    uWS::App app;
+    Core::Tracer::instance().setThreadName(index == 0 ? "loop" : "loop-" + std::to_string(index));
+    metricsService_->addApp(el.loop, &app);
+
+    // Metrics are published to uWS topics from a timer on the first loop
+    if (index == 0) {
+        metricsService_->setMetricsHandler(metricsHandler_.get());
+        metricsService_->setEventLoop(el.loop);
+        metricsService_->start();
+    }
+
+    app.get("/metrics", [this](auto* res, auto* req) {
+            // Prometheus scrape: serves the snapshot rendered by the metrics timer
+            if (!metricsToken_.empty() && req->getHeader("authorization") != "Bearer " + metricsToken_) {
+                res->writeStatus("401 Unauthorized")->end();
+                return;
+            }
+            auto text = metricsService_->getPrometheusText();
+            res->writeHeader("Content-Type", "text/plain; version=0.0.4; charset=utf-8")->end(*text);
+        })
         .ws<PerSocketData>("/*", {
-            .upgrade = [this](auto* res, auto* req, auto* context) {
+            .upgrade = [this, &el](auto* res, auto* req, auto* context) {
                 // Extract authentication headers from HTTP request
                 auto client_id = req->getHeader("x-client-id");
                 auto api_key = req->getHeader("x-api-key");
+
+                // Signed client tokens may also come as a bearer token
+                auto authorization = req->getHeader("authorization");
+                if (api_key.empty() && authorization.substr(0, 7) == "Bearer ") {
+                    api_key = authorization.substr(7);
+                }
                 
                 // Validate presence of required headers
                 if (client_id.empty() || api_key.empty()) {
-                    std::cout << "Client connection rejected: Missing authentication headers" << std::endl;
+                    LOG_INFO("Client connection rejected: Missing authentication headers");
                     res->writeStatus("401 Unauthorized");
                     res->writeHeader("Content-Type", "application/json");
                     res->end("{\"error\":\"Missing X-Client-ID or X-API-Key headers\"}");
                     return;
                 }
                 
-                std::cout << "Client connecting with ID: " << client_id << std::endl;
-                
-                // Authenticate via JotaDB
-                if (!clientAuth_.authenticate(std::string(client_id), std::string(api_key))) {
-                    std::cout << "Client authentication failed: " << client_id << std::endl;
-                    res->writeStatus("401 Unauthorized");
-                    res->writeHeader("Content-Type", "application/json");
-                    res->end("{\"error\":\"Invalid credentials\"}");
+                LOG_DEBUG("Client connecting with ID: " << client_id);
+
+                // Headers are copied, req dies with this call
+                auto pending = std::make_shared<PendingUpgrade>();
+                pending->client_id = std::string(client_id);
+                pending->key = std::string(req->getHeader("sec-websocket-key"));
+                pending->protocol = std::string(req->getHeader("sec-websocket-protocol"));
+                pending->extensions = std::string(req->getHeader("sec-websocket-extensions"));
+
+                // Answer the handshake; runs on the loop
+                auto finish = [this, &el, res, context, pending](bool authorized, const ClientConfig& config) {
+                    res->cork([&]() {
+                        if (el.stopping) {
+                            res->writeStatus("503 Service Unavailable");
+                            res->end({}, true);
+                            return;
+                        }
+
+                        if (!authorized) {
+                            LOG_INFO("Client authentication failed: " << pending->client_id);
+                            res->writeStatus("401 Unauthorized");
+                            res->writeHeader("Content-Type", "application/json");
+                            res->end("{\"error\":\"Invalid credentials\"}");
+                            return;
+                        }
+
+                        // Authentication successful - prepare user data
+                        PerSocketData userData;
+                        userData.authenticated = true;
+                        userData.client_id = pending->client_id;
+                        userData.priority = config.priority;
+                        rateLimiter_->setLimits(pending->client_id, {config.prompt_tps, config.generated_tps});
+
+                        // Complete the WebSocket upgrade
+                        res->template upgrade<PerSocketData>(
+                            std::move(userData),
+                            pending->key,
+                            pending->protocol,
+                            pending->extensions,
+                            context
+                        );
+                    });
+                };
+
+                // A signed token is a few microseconds of crypto: verify it right here
+                std::string key(api_key);
+                if (clientAuth_.isLocalToken(key)) {
+                    bool authorized = clientAuth_.authenticate(pending->client_id, key);
+                    finish(authorized, authorized ? clientAuth_.getClientConfig(pending->client_id) : ClientConfig{});
                     return;
                 }
-                
-                // Authentication successful - prepare user data
-                PerSocketData userData;
-                userData.authenticated = true;
-                userData.client_id = std::string(client_id);
-                
-                // Complete the WebSocket upgrade
-                res->template upgrade<PerSocketData>(
-                    std::move(userData),
-                    req->getHeader("sec-websocket-key"),
-                    req->getHeader("sec-websocket-protocol"),
-                    req->getHeader("sec-websocket-extensions"),
-                    context
-                );
+
+                // JotaDB can take seconds to answer: check on the auth pool and finish the
+                // handshake back on the loop.
+                // res is freed if the client goes away before the check completes
+                res->onAborted([pending]() {
+                    pending->aborted->store(true);
+                });
+
+                bool queued = authService_->enqueueTask({pending->client_id, key,
+                    [&el, pending, finish](bool authorized, const ClientConfig& config) {
+                        el.loop->defer([pending, finish, authorized, config]() {
+                            if (pending->aborted->load()) {
+                                LOG_DEBUG("Client " << pending->client_id << " left during authentication");
+                                return;
+                            }
+                            finish(authorized, config);
+                        });
+                    }, pending->aborted});
+
+                // Too many handshakes already waiting on JotaDB: let the client retry later
+                if (!queued) {
+                    LOG_WARN("Client connection refused: authentication queue is full");
+                    res->cork([&]() {
+                        res->writeStatus("503 Service Unavailable");
+                        res->writeHeader("Retry-After", "1");
+                        res->end({}, true);
+                    });
+                }
             },
-            .open = [this](auto* ws) {
+            .open = [this, &el](auto* ws) {
                 auto* data = ws->getUserData();
                 
                 // Client is already authenticated via upgrade handler
-                std::cout << "Client authenticated: " << data->client_id << std::endl;
+                LOG_INFO("Client authenticated: " << data->client_id);
                 
                 auto config = clientAuth_.getClientConfig(data->client_id);
                 json response = {
@@ -122,49 +310,86 @@ void WsServer::run() {
                 ws->send(response.dump(), uWS::OpCode::TEXT);
                 
                 // Track connection
-                {
-                    std::lock_guard<std::mutex> lock(clientsMutex_);
-                    connectedClients_.insert(ws);
-                }
+                el.clients.insert(ws);
             },
-            .message = [this](auto* ws, std::string_view message, uWS::OpCode) {
-                // Create request context
-                RequestContext ctx(ws, loop_);
+            .message = [this, &el](auto* ws, std::string_view message, uWS::OpCode) {
+                // Create request context (sends are deferred to this socket's loop)
+                RequestContext ctx(ws, el.loop);
 
                 // Delegate to dispatcher
                 dispatcher_->dispatch(ctx, std::string(message));
             },
-            .close = [this](auto* ws, int, std::string_view) {
+            .close = [this, &el](auto* ws, int, std::string_view) {
                 auto* data = ws->getUserData();
-                std::cout << "Client disconnected";
                 if (data->authenticated) {
-                    std::cout << ": " << data->client_id;
+                    LOG_INFO("Client disconnected: " << data->client_id);
+                } else {
+                    LOG_INFO("Client disconnected");
                 }
-                std::cout << std::endl;
 
-                // Remove from metrics subscribers
-                // SAFETY: Must remove immediately to prevent use-after-free in MetricsService broadcast.
-                // MetricsService::metricsLoop uses loop->defer which runs on this same thread.
-                // By removing here, the next defer execution will not see this socket.
-                metricsHandler_->removeSubscriber(ws);
+                // uWS drops closed sockets from their metrics topic on its own;
+                // the handler only keeps the subscriber count
+                metricsHandler_->handleClose(data);
 
                 // Remove from connected clients
-                {
-                    std::lock_guard<std::mutex> lock(clientsMutex_);
-                    connectedClients_.erase(ws);
-                }
+                el.clients.erase(ws);
             }
-        })
-        .listen(port_, [this](auto* listenSocket) {
+        });
+
+    if (!el.stopping) {
+        app.listen(port_, [this, &el, index](auto* listenSocket) {
+            el.listenSocket = listenSocket;
             if (listenSocket) {
-                std::cout << "WebSocket server listening on port " << port_ << std::endl;
+                LOG_INFO("WebSocket server listening on port " << port_ << " (loop " << index << ")");
             } else {
-                std::cerr << "Failed to listen on port " << port_ << std::endl;
+                LOG_ERROR("Failed to listen on port " << port_ << " (loop " << index << ")");
             }
-        })
-        .run();
-    
-    std::cout << "Server stopped" << std::endl;
+        });
+    }
+    app.run();
+
+    // The app dies with this scope
+    if (index == 0) {
+        metricsService_->shutdown();
+    }
+    metricsService_->removeApp(&app);
+
+    {
+        std::lock_guard<std::mutex> lock(loopsMutex_);
+        loopsDone_++;
+    }
+    loopsCv_.notify_all();
+}
+
+void WsServer::stop() {
+    std::lock_guard<std::mutex> lock(loopsMutex_);
+    stopRequested_ = true;
+    for (size_t i = 0; i < loops_.size(); i++) {
+        EventLoop* el = loops_[i].get();
+        if (!el->loop) {
+            continue;  // Not started yet, sees stopRequested_
+        }
+        el->loop->defer([this, el, i]() {
+            // Handshakes still waiting on JotaDB are refused when they complete
+            el->stopping = true;
+
+            // The metrics timer lives on the first loop and would keep it running
+            if (i == 0 && metricsService_) {
+                metricsService_->shutdown();
+            }
+
+            if (el->listenSocket) {
+                us_listen_socket_close(0, el->listenSocket);
+                el->listenSocket = nullptr;
+            }
+
+            // Copy: the close handler erases from clients
+            auto clients = el->clients;
+            for (auto* ws : clients) {
+                ws->close();
+            }
+        });
+    }
 }
 
 } // namespace Server
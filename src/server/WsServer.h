@@ -1,22 +1,34 @@
 #pragma once
 
 #include <App.h> // uWebSockets
+#include <atomic>
 #include <memory>
 #include <set>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
 #include "Protocol.h"
 #include "ClientAuth.h"
 #include "RequestContext.h"
 #include "MessageDispatcher.h"
+#include "services/AuthService.h"
 #include "services/InferenceService.h"
 #include "services/MetricsService.h"
+#include "services/EmbeddingService.h"
 #include "handlers/PingHandler.h"
 #include "handlers/AuthHandler.h"
 #include "handlers/SessionHandler.h"
 #include "handlers/InferenceHandler.h"
 #include "handlers/MetricsHandler.h"
+#include "handlers/EmbeddingHandler.h"
+#include "handlers/TraceHandler.h"
+#include "../core/Backend.h"
 #include "../core/Engine.h"
 #include "../core/SessionManager.h"
+#include "../core/BatchGenerator.h"
+#include "../core/ResponseCache.h"
+#include "../core/RateLimiter.h"
 #include "../hardware/Monitor.h"
 
 namespace Server {
@@ -25,34 +37,60 @@ namespace Server {
  * WsServer - Minimal WebSocket server (network layer only)
  * 
  * Responsibilities:
- * - uWebSockets lifecycle (open, message, close)
+ * - uWebSockets lifecycle (open, message, close) on WS_THREADS event loops
+ *   sharing the port; a socket is only ever touched on its own loop
  * - Connection tracking
  * - Delegate message handling to MessageDispatcher
  * - Coordinate services (Inference, Metrics)
  */
 class WsServer {
 public:
-    WsServer(Core::Engine& engine, Hardware::Monitor& monitor, 
+    // Sessions come from backend; batch_infer and embeddings always use engine
+    WsServer(Core::Engine& engine, Core::Backend& backend, Hardware::Monitor& monitor,
              int port = 3000, int ctx_size = 512);
     ~WsServer();
 
-    // Start the server loop (blocking)
+    // Start the event loops; the calling thread runs the first one (blocking)
     void run();
 
+    // Stop listening and disconnect all clients on every loop so run() returns.
+    // Thread-safe, can be called from any thread.
+    void stop();
+
 private:
     // Core dependencies
     Core::Engine& engine_;
+    Core::Backend& backend_;
     std::unique_ptr<Core::SessionManager> sessionManager_;
+    std::unique_ptr<Core::BatchGenerator> batchGenerator_;
+    std::unique_ptr<Core::ResponseCache> responseCache_;
+    std::unique_ptr<Core::RateLimiter> rateLimiter_;
     ClientAuth clientAuth_;
     Hardware::Monitor& monitor_;
     int port_;
+    std::string metricsToken_;  // METRICS_TOKEN: bearer token required by GET /metrics
     
-    // uWebSockets loop
-    uWS::Loop* loop_ = nullptr;
+    // One uWS::App per event loop. Fields are only touched on that loop's thread,
+    // except loop, which is set under loopsMutex_.
+    struct EventLoop {
+        uWS::Loop* loop = nullptr;
+        us_listen_socket_t* listenSocket = nullptr;
+        std::set<uWS::WebSocket<false, true, PerSocketData>*> clients;
+        bool stopping = false;  // Set on the loop by stop()
+    };
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+    std::vector<std::thread> loopThreads_;  // Loops 1..N-1
+    std::mutex loopsMutex_;
+    std::condition_variable loopsCv_;
+    bool stopRequested_ = false;
+    size_t loopsDone_ = 0;
+    bool releaseLoops_ = false;
     
     // Services
+    std::unique_ptr<AuthService> authService_;
     std::unique_ptr<InferenceService> inferenceService_;
     std::unique_ptr<MetricsService> metricsService_;
+    std::unique_ptr<EmbeddingService> embeddingService_;
     
     // Handlers (shared_ptr for MessageDispatcher sharing)
     std::shared_ptr<PingHandler> pingHandler_;
@@ -60,13 +98,24 @@ private:
     std::shared_ptr<SessionHandler> sessionHandler_;
     std::shared_ptr<InferenceHandler> inferenceHandler_;
     std::shared_ptr<MetricsHandler> metricsHandler_;
+    std::shared_ptr<EmbeddingHandler> embeddingHandler_;
+    std::shared_ptr<TraceHandler> traceHandler_;
     
     // Message dispatcher
     std::unique_ptr<MessageDispatcher> dispatcher_;
     
-    // Connection tracking
-    std::set<uWS::WebSocket<false, true, PerSocketData>*> connectedClients_;
-    std::mutex clientsMutex_;
+    // Upgrade waiting on AuthService (only touched on its loop's thread)
+    struct PendingUpgrade {
+        std::string client_id;
+        std::string key;
+        std::string protocol;
+        std::string extensions;
+        // Set on the loop when the client goes away; read by the auth worker too
+        std::shared_ptr<std::atomic<bool>> aborted = std::make_shared<std::atomic<bool>>(false);
+    };
+
+    // Build the app for one loop and run it (blocking)
+    void runLoop(EventLoop& el, size_t index);
 };
 
 } // namespace Server
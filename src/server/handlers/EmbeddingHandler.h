@@ -0,0 +1,126 @@
+#pragma once
+
+#include "../RequestContext.h"
+#include "../Utils.h"
+#include "../services/EmbeddingService.h"
+#include "../../core/Engine.h"
+#include "../../core/Logger.h"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace Server {
+
+/**
+ * EmbeddingHandler - Handles embedding operations
+ *
+ * Processes Op::EMBED requests (one or many inputs, no session needed).
+ * Delegates the actual work to EmbeddingService.
+ */
+class EmbeddingHandler {
+public:
+    // Upper bound on inputs per request to keep a single request from starving others
+    static constexpr size_t MAX_INPUTS = 256;
+
+    EmbeddingHandler(const Core::Engine& engine, EmbeddingService* embeddingService)
+        : engine_(engine)
+        , embeddingService_(embeddingService)
+    {
+        if (!embeddingService_) {
+            throw std::invalid_argument("EmbeddingService cannot be null");
+        }
+    }
+
+    /**
+     * Handle embedding request
+     * @param ctx Request context
+     * @param payload JSON payload with input (string or array), normalize, encoding
+     */
+    void handleEmbed(RequestContext& ctx, const json& payload) {
+        auto* data = ctx.getData();
+
+        // Check authentication
+        if (!data->authenticated) {
+            sendError(ctx, "", "Not authenticated");
+            return;
+        }
+
+        EmbedParams params = parseEmbed(payload);
+
+        if (!engine_.isReady()) {
+            sendError(ctx, params.request_id, "Model is still loading");
+            return;
+        }
+        if (params.inputs.empty()) {
+            sendError(ctx, params.request_id, "Missing input");
+            return;
+        }
+        if (params.inputs.size() > MAX_INPUTS) {
+            sendError(ctx, params.request_id, "Too many inputs (max " + std::to_string(MAX_INPUTS) + ")");
+            return;
+        }
+        if (params.encoding != "float" && params.encoding != "base64") {
+            sendError(ctx, params.request_id, "Unknown encoding: " + params.encoding);
+            return;
+        }
+
+        std::string request_id = params.request_id;
+        bool base64 = params.encoding == "base64";
+
+        auto onComplete = [ctx, request_id, base64](const Core::EmbeddingResult& result, const std::string& error) {
+            if (!error.empty()) {
+                json msg = {
+                    {"op", Op::ERROR},
+                    {"error", error}
+                };
+                if (!request_id.empty()) msg["request_id"] = request_id;
+                ctx.send(msg);
+                return;
+            }
+
+            json vectors = json::array();
+            for (const auto& vec : result.vectors) {
+                if (base64) {
+                    vectors.push_back(Utils::base64Encode(
+                        reinterpret_cast<const unsigned char*>(vec.data()), vec.size() * sizeof(float)));
+                } else {
+                    vectors.push_back(vec);
+                }
+            }
+
+            json msg = {
+                {"op", Op::EMBEDDINGS},
+                {"encoding", base64 ? "base64" : "float"},
+                {"dimensions", result.dimensions},
+                {"data", vectors},
+                {"stats", {
+                    {"prompt_tokens", result.prompt_tokens},
+                    {"batches", result.batches},
+                    {"truncated", result.truncated},
+                    {"total_ms", result.total_ms}
+                }}
+            };
+            if (!request_id.empty()) msg["request_id"] = request_id;
+            ctx.send(msg);
+        };
+
+        embeddingService_->enqueueTask(EmbeddingService::Task{std::move(params), onComplete});
+
+        LOG_DEBUG("Embedding enqueued for client: " << data->client_id);
+    }
+
+private:
+    const Core::Engine& engine_;
+    EmbeddingService* embeddingService_;
+
+    void sendError(RequestContext& ctx, const std::string& request_id, const std::string& error) {
+        json response = {
+            {"op", Op::ERROR},
+            {"error", error}
+        };
+        if (!request_id.empty()) response["request_id"] = request_id;
+        ctx.send(response);
+    }
+};
+
+} // namespace Server
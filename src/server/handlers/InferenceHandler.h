@@ -2,8 +2,12 @@
 
 #include "../RequestContext.h"
 #include "../services/InferenceService.h"
+#include "../Utils.h"
+#include "../../core/Logger.h"
+#include "../../core/Trace.h"
 #include <nlohmann/json.hpp>
-#include <iostream>
+#include <atomic>
+#include <cmath>
 
 using json = nlohmann::json;
 
@@ -12,11 +16,17 @@ namespace Server {
 /**
  * InferenceHandler - Handles inference operations
  * 
- * Processes Op::INFER and Op::ABORT requests.
+ * Processes Op::INFER, Op::APPEND_MESSAGE, Op::BATCH_INFER and Op::ABORT requests.
  * Delegates actual inference to InferenceService.
  */
 class InferenceHandler {
 public:
+    // Upper bound on prompts per batch_infer request
+    static constexpr size_t MAX_BATCH_PROMPTS = 1024;
+
+    // Upper bound on top-N alternatives per token
+    static constexpr int MAX_LOGPROBS = 20;
+
     explicit InferenceHandler(InferenceService* inferenceService)
         : inferenceService_(inferenceService)
     {
@@ -53,37 +63,99 @@ public:
             return;
         }
         
-        std::string session_id = payload["session_id"];
-        std::string prompt = payload["prompt"];
+        // Parse inference parameters (temp, max_tokens, grammar / json_schema)
+        enqueue(ctx, parseInfer(payload), "", true);
+    }
+    
+    /**
+     * Handle append_message request
+     * Appends to the session's stored conversation; user messages (or generate: true)
+     * are answered with the same TOKEN/END stream as infer. Non-generating appends
+     * are acknowledged with an END carrying zero tokens.
+     * @param ctx Request context
+     * @param payload JSON payload with session_id, role, content, generate and params
+     */
+    void handleAppendMessage(RequestContext& ctx, const json& payload) {
+        auto* data = ctx.getData();
         
-        // Parse inference parameters
-        InferenceParams params;
-        params.prompt = prompt;
+        // Check authentication
+        if (!data->authenticated) {
+            json response = {
+                {"op", Op::ERROR},
+                {"error", "Not authenticated"}
+            };
+            ctx.send(response);
+            return;
+        }
         
-        if (payload.contains("params")) {
-            auto p = payload["params"];
-            if (p.contains("temp")) {
-                params.temp = p["temp"];
-            }
-            if (p.contains("max_tokens")) {
-                params.max_tokens = p["max_tokens"];
-            }
+        if (!payload.contains("session_id") || !payload.contains("content")) {
+            json response = {
+                {"op", Op::ERROR},
+                {"error", "Missing session_id or content"}
+            };
+            ctx.send(response);
+            return;
         }
         
-        // Create callbacks that use RequestContext
-        auto onToken = [ctx, session_id](const std::string& sid, const std::string& token) {
+        AppendMessageParams params = parseAppendMessage(payload);
+        enqueue(ctx, params.inference, params.role, params.generate);
+    }
+    
+    /**
+     * Handle batch inference request
+     * Streams Op::TOKEN / Op::END frames tagged with batch_id and index
+     * (position in "prompts"), then a final Op::BATCH_END with aggregate stats.
+     * @param ctx Request context
+     * @param payload JSON payload with prompts, params and optional batch_id
+     */
+    void handleBatchInfer(RequestContext& ctx, const json& payload) {
+        auto* data = ctx.getData();
+
+        // Check authentication
+        if (!data->authenticated) {
+            json response = {
+                {"op", Op::ERROR},
+                {"error", "Not authenticated"}
+            };
+            ctx.send(response);
+            return;
+        }
+
+        BatchInferParams params = parseBatchInfer(payload);
+        if (params.items.empty() || params.items.size() > MAX_BATCH_PROMPTS) {
+            json response = {
+                {"op", Op::ERROR},
+                {"error", "prompts must contain 1 to " + std::to_string(MAX_BATCH_PROMPTS) + " entries"}
+            };
+            ctx.send(response);
+            return;
+        }
+        if (params.batch_id.empty()) {
+            params.batch_id = "batch_" + std::to_string(++batchCounter_);
+        }
+
+        InferenceService::BatchTask task;
+        task.batch_id = params.batch_id;
+        task.client_id = data->client_id;
+        for (const auto& item : params.items) {
+            task.items.push_back(Core::BatchItem{item.prompt, item.max_tokens});
+        }
+
+        task.onToken = [ctx](const std::string& batch_id, size_t index, const std::string& token) {
             json msg = {
                 {"op", Op::TOKEN},
-                {"session_id", sid},
+                {"batch_id", batch_id},
+                {"index", index},
                 {"content", token}
             };
             ctx.send(msg);
         };
-        
-        auto onComplete = [ctx, session_id](const std::string& sid, const Core::Metrics& metrics) {
+
+        task.onItemDone = [ctx](const std::string& batch_id, size_t index, const Core::Metrics& metrics) {
             json msg = {
                 {"op", Op::END},
-                {"session_id", sid},
+                {"batch_id", batch_id},
+                {"index", index},
                 {"stats", {
                     {"ttft_ms", metrics.ttft_ms},
                     {"total_ms", metrics.total_time_ms},
@@ -93,20 +165,41 @@ public:
             };
             ctx.send(msg);
         };
-        
-        // Enqueue task to InferenceService
-        InferenceService::Task task{
-            session_id,
-            params,
-            onToken,
-            onComplete
+
+        task.onComplete = [ctx](const std::string& batch_id, const Core::BatchStats& stats) {
+            json msg = {
+                {"op", Op::BATCH_END},
+                {"batch_id", batch_id},
+                {"status", !stats.error.empty() ? "error" : stats.aborted ? "aborted" : "completed"},
+                {"stats", {
+                    {"prompts", stats.prompts},
+                    {"unique_prompts", stats.unique_prompts},
+                    {"rejected", stats.rejected},
+                    {"shared_prefix_tokens", stats.shared_prefix_tokens},
+                    {"prompt_tokens", stats.prompt_tokens},
+                    {"tokens", stats.tokens_generated},
+                    {"total_ms", stats.total_time_ms},
+                    {"tps", stats.tps}
+                }}
+            };
+            if (!stats.error.empty()) msg["error"] = stats.error;
+            ctx.send(msg);
         };
-        
-        inferenceService_->enqueueTask(std::move(task));
-        
-        std::cout << "Inference enqueued for session: " << session_id << std::endl;
+
+        std::string batch_id = task.batch_id;
+        size_t count = task.items.size();
+        if (!inferenceService_->enqueueBatch(std::move(task))) {
+            json response = {
+                {"op", Op::ERROR},
+                {"error", "Batch inference is not available"}
+            };
+            ctx.send(response);
+            return;
+        }
+
+        LOG_DEBUG("Batch " << batch_id << " enqueued with " << count << " prompts");
     }
-    
+
     /**
      * Handle abort request
      * @param ctx Request context
@@ -125,6 +218,20 @@ public:
             return;
         }
 
+        // Batches are aborted by batch_id
+        if (payload.contains("batch_id")) {
+            std::string batch_id = payload["batch_id"];
+            bool aborted = inferenceService_->abortBatch(batch_id, data->client_id);
+
+            json response = {
+                {"op", Op::ABORT},
+                {"batch_id", batch_id},
+                {"status", aborted ? "aborted" : "not_found"}
+            };
+            ctx.send(response);
+            return;
+        }
+
         std::string session_id;
         if (payload.contains("session_id")) {
             session_id = payload["session_id"];
@@ -146,11 +253,139 @@ public:
         };
         ctx.send(response);
         
-        std::cout << "Abort requested for session " << session_id << ": " << (success ? "Success" : "Failed") << std::endl;
+        LOG_DEBUG("Abort requested for session " << session_id << ": " << (success ? "Success" : "Failed"));
+    }
+
+    /**
+     * Serialized Op::TOKEN frame (the per-token hot path)
+     * @param logprobs Chosen-token logprob and top alternatives, or null
+     */
+    static std::string buildTokenFrame(const std::string& session_id, const std::string& token,
+                                       const Core::TokenLogprobs* logprobs) {
+        json msg = {
+            {"op", Op::TOKEN},
+            {"session_id", session_id},
+            {"content", token}
+        };
+        if (logprobs) {
+            json top = json::array();
+            for (const auto& entry : logprobs->top) {
+                top.push_back({{"token", Utils::sanitizeUtf8(entry.token)}, {"logprob", entry.logprob}});
+            }
+            msg["logprob"] = logprobs->logprob;
+            msg["top_logprobs"] = std::move(top);
+        }
+        return msg.dump();
+    }
+
+    /**
+     * Remaining token budget of a rate-limited client: tokens left per limited
+     * bucket (negative while in debt, i.e. the next request will wait)
+     */
+    static json buildBudget(const Core::Metrics& metrics) {
+        json budget = json::object();
+        if (std::isfinite(metrics.prompt_budget)) {
+            budget["prompt_tokens"] = static_cast<long long>(std::floor(metrics.prompt_budget));
+        }
+        if (std::isfinite(metrics.generated_budget)) {
+            budget["generated_tokens"] = static_cast<long long>(std::floor(metrics.generated_budget));
+        }
+        return budget;
     }
 
 private:
+    /**
+     * Validate generation params, wire RequestContext callbacks and enqueue the task
+     * @param chatRole Empty for infer, otherwise the role of the appended message
+     */
+    void enqueue(RequestContext& ctx, const InferenceParams& params,
+                 const std::string& chatRole, bool generate) {
+        std::string session_id = params.session_id;
+        
+        if (params.logprobs < 0 || params.logprobs > MAX_LOGPROBS) {
+            json response = {
+                {"op", Op::ERROR},
+                {"session_id", session_id},
+                {"error", "logprobs must be between 0 and " + std::to_string(MAX_LOGPROBS)}
+            };
+            ctx.send(response);
+            return;
+        }
+        
+        if (!params.grammar.empty() && !params.json_schema.is_null()) {
+            json response = {
+                {"op", Op::ERROR},
+                {"session_id", session_id},
+                {"error", "Use either grammar or json_schema, not both"}
+            };
+            ctx.send(response);
+            return;
+        }
+        
+        // Create callbacks that use RequestContext
+        auto onToken = [ctx, session_id](const std::string& sid, const std::string& token,
+                                         const Core::TokenLogprobs* logprobs) {
+            ctx.sendRaw(buildTokenFrame(sid, token, logprobs));
+        };
+        
+        auto onComplete = [ctx, session_id](const std::string& sid, const Core::Metrics& metrics) {
+            json msg = {
+                {"op", Op::END},
+                {"session_id", sid},
+                {"stats", {
+                    {"ttft_ms", metrics.ttft_ms},
+                    {"total_ms", metrics.total_time_ms},
+                    {"tokens", metrics.tokens_generated},
+                    {"tps", metrics.tps},
+                    {"prefill_ms", metrics.prefill_ms},
+                    {"prefill_tps", metrics.prefill_tps},
+                    {"decode_ms", metrics.decode_ms},
+                    {"decode_tps", metrics.decode_tps},
+                    {"sample_ms", metrics.sample_ms},
+                    {"callback_ms", metrics.callback_ms},
+                    {"prompt_tokens", metrics.prompt_tokens},
+                    {"cached_tokens", metrics.cached_tokens},
+                    {"cached", metrics.cached},
+                    {"coalesced", metrics.coalesced},
+                    {"throttle_ms", metrics.throttle_ms}
+                }}
+            };
+            if (metrics.rate_limited) {
+                msg["budget"] = buildBudget(metrics);
+            }
+            ctx.send(msg);
+        };
+        
+        auto onError = [ctx](const std::string& sid, const std::string& error) {
+            json msg = {
+                {"op", Op::ERROR},
+                {"session_id", sid},
+                {"error", error}
+            };
+            ctx.send(msg);
+        };
+        
+        // Enqueue task to InferenceService
+        InferenceService::Task task{
+            session_id,
+            params,
+            onToken,
+            onComplete,
+            onError,
+            chatRole,
+            generate,
+            ctx.getData()->client_id,
+            ctx.getData()->priority
+        };
+        task.trace_id = Core::Tracer::current();  // Sampled by MessageDispatcher
+        
+        inferenceService_->enqueueTask(std::move(task));
+        
+        LOG_DEBUG("Inference enqueued for session: " << session_id);
+    }
+
     InferenceService* inferenceService_;
+    std::atomic<uint64_t> batchCounter_{0};
 };
 
 } // namespace Server
@@ -1,10 +1,13 @@
 #pragma once
 
 #include "../RequestContext.h"
+#include "../../core/Logger.h"
 #include <nlohmann/json.hpp>
-#include <set>
+#include <algorithm>
+#include <map>
 #include <mutex>
-#include <iostream>
+#include <string>
+#include <vector>
 
 using json = nlohmann::json;
 
@@ -12,22 +15,43 @@ namespace Server {
 
 /**
  * MetricsHandler - Handles metrics subscription operations
- * 
+ *
  * Processes Op::SUBSCRIBE_METRICS and Op::UNSUBSCRIBE_METRICS requests.
- * Maintains list of subscribed clients.
+ * Subscribers join a native uWS topic per (interval, fields) combination, so
+ * MetricsService renders and publishes one shared frame per topic. uWS drops
+ * closed sockets from their topics by itself; WsServer reports closes through
+ * handleClose so the registry can count subscribers across every event loop.
+ *
+ * Called from all event loop threads; the topic registry is locked.
  */
 class MetricsHandler {
 public:
+    static constexpr int MAX_INTERVAL_S = 60;
+
+    // Top-level sections of the metrics frame a subscriber can filter on
+    static const std::vector<std::string>& sections() {
+        static const std::vector<std::string> names = {
+            "gpu", "cpu", "inference", "latency", "latency_by_client", "latency_by_priority", "response_cache"
+        };
+        return names;
+    }
+
+    struct Topic {
+        int interval_s = 1;
+        std::vector<std::string> fields;  // Sorted, empty = all sections
+        size_t subscribers = 0;           // Sockets on this topic, over all loops
+    };
+
     MetricsHandler() = default;
-    
+
     /**
      * Handle metrics subscription request
      * @param ctx Request context
-     * @param payload JSON payload (empty)
+     * @param payload JSON payload: optional "interval_s" (1-60) and "fields" (section names)
      */
-    void handleSubscribe(RequestContext& ctx, const json& /*payload*/) {
+    void handleSubscribe(RequestContext& ctx, const json& payload) {
         auto* data = ctx.getData();
-        
+
         // Check authentication
         if (!data->authenticated) {
             json response = {
@@ -37,22 +61,59 @@ public:
             ctx.send(response);
             return;
         }
-        
-        // Add to subscribers
-        {
-            std::lock_guard<std::mutex> lock(subscribersMutex_);
-            subscribers_.insert(ctx.getRawSocket());
+
+        SubscribeMetricsParams params = parseSubscribeMetrics(payload);
+        if (params.interval_s < 1 || params.interval_s > MAX_INTERVAL_S) {
+            json response = {
+                {"op", Op::ERROR},
+                {"error", "interval_s must be between 1 and " + std::to_string(MAX_INTERVAL_S)}
+            };
+            ctx.send(response);
+            return;
+        }
+        for (const auto& field : params.fields) {
+            if (std::find(sections().begin(), sections().end(), field) == sections().end()) {
+                json response = {
+                    {"op", Op::ERROR},
+                    {"error", "Unknown metrics field: " + field}
+                };
+                ctx.send(response);
+                return;
+            }
         }
-        
+
+        Topic topic;
+        topic.interval_s = params.interval_s;
+        topic.fields = params.fields;
+        std::sort(topic.fields.begin(), topic.fields.end());
+        topic.fields.erase(std::unique(topic.fields.begin(), topic.fields.end()), topic.fields.end());
+        std::string name = topicName(topic);
+
+        // One subscription per socket: re-subscribing replaces the options
+        auto* ws = ctx.getRawSocket();
+        if (data->metrics_topic != name) {
+            if (!data->metrics_topic.empty()) {
+                ws->unsubscribe(data->metrics_topic);
+                release(data->metrics_topic);
+            }
+            ws->subscribe(name);
+            data->metrics_topic = name;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            topics_.emplace(name, topic).first->second.subscribers++;
+        }
+
         json response = {
             {"op", Op::METRICS_SUBSCRIBED},
-            {"message", "Subscribed to metrics updates"}
+            {"message", "Subscribed to metrics updates"},
+            {"interval_s", topic.interval_s},
+            {"fields", topic.fields.empty() ? sections() : topic.fields}
         };
         ctx.send(response);
-        
-        std::cout << "Client subscribed to metrics: " << data->client_id << std::endl;
+
+        LOG_INFO("Client subscribed to metrics: " << data->client_id << " (" << name << ")");
     }
-    
+
     /**
      * Handle metrics unsubscription request
      * @param ctx Request context
@@ -60,7 +121,7 @@ public:
      */
     void handleUnsubscribe(RequestContext& ctx, const json& /*payload*/) {
         auto* data = ctx.getData();
-        
+
         // Check authentication
         if (!data->authenticated) {
             json response = {
@@ -70,42 +131,81 @@ public:
             ctx.send(response);
             return;
         }
-        
-        // Remove from subscribers
-        {
-            std::lock_guard<std::mutex> lock(subscribersMutex_);
-            subscribers_.erase(ctx.getRawSocket());
+
+        if (!data->metrics_topic.empty()) {
+            ctx.getRawSocket()->unsubscribe(data->metrics_topic);
+            release(data->metrics_topic);
+            data->metrics_topic.clear();
         }
-        
+
         json response = {
             {"op", Op::METRICS_UNSUBSCRIBED},
             {"message", "Unsubscribed from metrics updates"}
         };
         ctx.send(response);
-        
-        std::cout << "Client unsubscribed from metrics: " << data->client_id << std::endl;
+
+        LOG_INFO("Client unsubscribed from metrics: " << data->client_id);
     }
-    
+
     /**
-     * Get copy of subscribers set (thread-safe)
-     * Used by WsServer to broadcast metrics
+     * A socket closed (uWS already removed it from its topic)
      */
-    std::set<uWS::WebSocket<false, true, PerSocketData>*> getSubscribers() {
-        std::lock_guard<std::mutex> lock(subscribersMutex_);
-        return subscribers_;
+    void handleClose(PerSocketData* data) {
+        if (!data->metrics_topic.empty()) {
+            release(data->metrics_topic);
+            data->metrics_topic.clear();
+        }
     }
-    
+
     /**
-     * Remove subscriber (called on disconnect)
+     * Topics with at least one subscriber
      */
-    void removeSubscriber(uWS::WebSocket<false, true, PerSocketData>* ws) {
-        std::lock_guard<std::mutex> lock(subscribersMutex_);
-        subscribers_.erase(ws);
+    std::map<std::string, Topic> getTopics() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return topics_;
+    }
+
+    /**
+     * Copy of a full metrics frame with only the topic's sections
+     */
+    static json filter(const json& frame, const Topic& topic) {
+        if (topic.fields.empty()) {
+            return frame;
+        }
+        json out = {
+            {"op", frame["op"]},
+            {"timestamp", frame["timestamp"]}
+        };
+        for (const auto& field : topic.fields) {
+            if (frame.contains(field)) out[field] = frame[field];
+        }
+        return out;
     }
 
 private:
-    std::set<uWS::WebSocket<false, true, PerSocketData>*> subscribers_;
-    std::mutex subscribersMutex_;
+    std::map<std::string, Topic> topics_;  // Empty topics are erased
+    mutable std::mutex mutex_;
+
+    void release(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = topics_.find(name);
+        if (it != topics_.end() && --it->second.subscribers == 0) {
+            topics_.erase(it);
+        }
+    }
+
+    // "metrics/<interval>/<field,field|*>"
+    static std::string topicName(const Topic& topic) {
+        std::string name = "metrics/" + std::to_string(topic.interval_s) + "/";
+        if (topic.fields.empty()) {
+            return name + "*";
+        }
+        for (size_t i = 0; i < topic.fields.size(); i++) {
+            if (i > 0) name += ",";
+            name += topic.fields[i];
+        }
+        return name;
+    }
 };
 
 } // namespace Server
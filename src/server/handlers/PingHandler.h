@@ -2,6 +2,8 @@
 
 #include "../RequestContext.h"
 #include "../Protocol.h"
+#include "../../core/Backend.h"
+#include "../../core/Engine.h"
 #include <nlohmann/json.hpp>
 #include <chrono>
 
@@ -14,11 +16,15 @@ namespace Server {
  * 
  * Processes Op::HELLO requests without requiring authentication.
  * Allows clients to check server availability and status.
+ * While the model is still loading, reports "loading" with the load progress.
+ * A backend that needs no model (mock) reports "ready" straight away.
  */
 class PingHandler {
 public:
-    PingHandler()
-        : startTime_(std::chrono::steady_clock::now())
+    PingHandler(const Core::Engine& engine, const Core::Backend& backend)
+        : engine_(engine)
+        , backend_(backend)
+        , startTime_(std::chrono::steady_clock::now())
     {}
     
     /**
@@ -37,13 +43,34 @@ public:
             {"status", "ready"},
             {"message", "Server is available"},
             {"uptime_seconds", uptime},
-            {"requires_auth", true}
+            {"requires_auth", true},
+            {"backend", backend_.name()}
         };
+
+        switch (backend_.isReady() ? Core::EngineState::READY : engine_.getState()) {
+            case Core::EngineState::READY:
+                break;
+            case Core::EngineState::WARMING:
+                response["status"] = "warming";
+                response["message"] = "Model is loaded and warming up";
+                break;
+            case Core::EngineState::FAILED:
+                response["status"] = "error";
+                response["message"] = "Model failed to load";
+                break;
+            default:
+                response["status"] = "loading";
+                response["message"] = "Model is loading";
+                response["load_progress"] = engine_.getLoadProgress();
+                break;
+        }
         
         ctx.send(response);
     }
 
 private:
+    const Core::Engine& engine_;
+    const Core::Backend& backend_;
     std::chrono::steady_clock::time_point startTime_;
 };
 
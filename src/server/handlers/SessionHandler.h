@@ -2,8 +2,8 @@
 
 #include "../RequestContext.h"
 #include "../../core/SessionManager.h"
+#include "../../core/Logger.h"
 #include <nlohmann/json.hpp>
-#include <iostream>
 
 using json = nlohmann::json;
 
@@ -42,6 +42,16 @@ public:
             return;
         }
         
+        // Refuse sessions until the model has finished loading
+        if (!sessionManager_->isReady()) {
+            json response = {
+                {"op", Op::SESSION_ERROR},
+                {"error", "Model is still loading"}
+            };
+            ctx.send(response);
+            return;
+        }
+        
         // Create session
         auto session_id = sessionManager_->createSession(data->client_id);
         
@@ -52,8 +62,8 @@ public:
             };
             ctx.send(response);
             
-            std::cout << "Session created: " << session_id 
-                      << " for client: " << data->client_id << std::endl;
+            LOG_DEBUG("Session created: " << session_id 
+                      << " for client: " << data->client_id);
         } else {
             json response = {
                 {"op", Op::SESSION_ERROR},
@@ -112,7 +122,7 @@ public:
             };
             ctx.send(response);
             
-            std::cout << "Session closed: " << session_id << std::endl;
+            LOG_DEBUG("Session closed: " << session_id);
         } else {
             json response = {
                 {"op", Op::ERROR},
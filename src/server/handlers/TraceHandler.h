@@ -0,0 +1,85 @@
+#pragma once
+
+#include "../RequestContext.h"
+#include "../Protocol.h"
+#include "../services/MetricsService.h"
+#include "../../core/Logger.h"
+#include "../../core/Trace.h"
+#include <nlohmann/json.hpp>
+#include <set>
+#include <string>
+
+using json = nlohmann::json;
+
+namespace Server {
+
+/**
+ * TraceHandler - Handles trace dump requests
+ *
+ * Processes Op::DUMP_TRACE for clients listed in ADMIN_CLIENT_IDS. Replies with
+ * Op::TRACE carrying the spans of every sampled request still in the per-thread
+ * rings, as Chrome trace JSON under "trace". Formatting every ring is too slow
+ * for the event loop: the reply is rendered on the MetricsService collector.
+ */
+class TraceHandler {
+public:
+    TraceHandler(MetricsService* metricsService, std::set<std::string> adminClientIds)
+        : metricsService_(metricsService)
+        , adminClientIds_(std::move(adminClientIds))
+    {}
+
+    /**
+     * Handle dump_trace request
+     * @param ctx Request context
+     * @param payload JSON payload: optional "clear" (drop the spans after dumping)
+     */
+    void handleDump(RequestContext& ctx, const json& payload) {
+        auto* data = ctx.getData();
+
+        // Check authentication
+        if (!data->authenticated || adminClientIds_.count(data->client_id) == 0) {
+            json response = {
+                {"op", Op::ERROR},
+                {"error", "Not authorized"}
+            };
+            ctx.send(response);
+            return;
+        }
+
+        bool clear = payload.contains("clear") && payload["clear"].get<bool>();
+        std::string client_id = data->client_id;
+        bool posted = metricsService_->post([ctx, clear, client_id]() {
+            auto& tracer = Core::Tracer::instance();
+            std::string trace = tracer.exportChromeJson();
+            if (clear) {
+                tracer.clear();
+            }
+
+            // The export is already JSON: splice it in rather than re-parsing it
+            json header = {
+                {"op", Op::TRACE},
+                {"sample_rate", tracer.sampleRate()}
+            };
+            std::string message = header.dump();
+            message.pop_back();
+            message += ",\"trace\":" + trace + "}";
+            ctx.sendRaw(message);
+
+            LOG_INFO("Trace dumped for client " << client_id << " (" << trace.size() << " bytes)");
+        });
+
+        if (!posted) {
+            json response = {
+                {"op", Op::ERROR},
+                {"error", "Server is shutting down"}
+            };
+            ctx.send(response);
+        }
+    }
+
+private:
+    MetricsService* metricsService_;
+    std::set<std::string> adminClientIds_;
+};
+
+} // namespace Server
@@ -0,0 +1,88 @@
+#include "AuthService.h"
+#include "../../core/Logger.h"
+#include <chrono>
+
+namespace Server {
+
+AuthService::AuthService(ClientAuth& auth, int numWorkers, size_t maxPending)
+    : auth_(auth)
+    , maxPending_(maxPending) {
+    for (int i = 0; i < numWorkers; i++) {
+        workers_.emplace_back([this]() { workerLoop(); });
+    }
+    LOG_INFO("AuthService: " << numWorkers << " worker(s)");
+}
+
+AuthService::~AuthService() {
+    shutdown();
+}
+
+bool AuthService::enqueueTask(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        if (taskQueue_.size() >= maxPending_) {
+            return false;
+        }
+        taskQueue_.push(std::move(task));
+    }
+    queueCv_.notify_one();
+    return true;
+}
+
+void AuthService::shutdown() {
+    if (!running_.exchange(false)) {
+        return; // Already shutting down
+    }
+
+    queueCv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    LOG_INFO("AuthService: Shutdown complete");
+}
+
+size_t AuthService::getPendingCount() const {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    return taskQueue_.size();
+}
+
+void AuthService::workerLoop() {
+    while (running_) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            queueCv_.wait(lock, [this] { return !taskQueue_.empty() || !running_; });
+
+            if (!running_) break;
+
+            task = std::move(taskQueue_.front());
+            taskQueue_.pop();
+        }
+
+        // Nobody is waiting for this answer: don't spend a JotaDB round trip on it
+        if (task.aborted && task.aborted->load()) {
+            skippedChecks_++;
+            LOG_DEBUG("AuthService: " << task.client_id << " left before its check started");
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        AuthOutcome outcome = auth_.check(task.client_id, task.api_key);
+        bool authorized = isAuthorized(outcome);
+        ClientConfig config = authorized ? auth_.getClientConfig(task.client_id) : ClientConfig();
+        totalChecks_++;
+
+        LOG_DEBUG("AuthService: " << task.client_id << " " << authOutcomeName(outcome) << " in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::steady_clock::now() - start).count() << " ms");
+
+        if (task.onComplete) {
+            task.onComplete(authorized, config);
+        }
+    }
+}
+
+} // namespace Server
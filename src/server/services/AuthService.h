@@ -0,0 +1,94 @@
+#pragma once
+
+#include "../ClientAuth.h"
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace Server {
+
+/**
+ * AuthService - Runs JotaDB credential checks off the event loop
+ *
+ * ClientAuth::authenticate() blocks for a full HTTP round trip (seconds when
+ * JotaDB is slow). The upgrade handler queues each check here and finishes the
+ * handshake from the completion callback, so other sockets keep streaming.
+ */
+class AuthService {
+public:
+    // Completion callback: config is only meaningful when authorized
+    // Called from a worker thread - caller must handle thread-safety
+    using CompletionCallback = std::function<void(bool authorized, const ClientConfig& config)>;
+
+    struct Task {
+        std::string client_id;
+        std::string api_key;
+        CompletionCallback onComplete;
+        // Set once nobody waits for the answer anymore (the client left); the check is
+        // then skipped and onComplete is not called
+        std::shared_ptr<std::atomic<bool>> aborted;
+    };
+
+    /**
+     * Constructor
+     * @param auth Client authenticator (must outlive this service)
+     * @param numWorkers Concurrent checks (each holds one JotaDB request)
+     * @param maxPending Checks allowed to wait for a worker; more are refused
+     */
+    AuthService(ClientAuth& auth, int numWorkers = 4, size_t maxPending = 256);
+
+    /**
+     * Destructor - automatically shuts down the worker threads
+     */
+    ~AuthService();
+
+    /**
+     * Enqueue a check for asynchronous execution
+     * Returns false (and drops the task) if maxPending checks are already waiting
+     * Thread-safe, can be called from any thread
+     */
+    bool enqueueTask(Task task);
+
+    /**
+     * Gracefully shutdown the service (queued checks are dropped)
+     */
+    void shutdown();
+
+    /**
+     * Checks waiting for a worker
+     */
+    size_t getPendingCount() const;
+
+    /**
+     * Checks completed so far
+     */
+    long long getTotalChecks() const { return totalChecks_.load(); }
+
+    /**
+     * Checks dropped because their client had left before a worker got to them
+     */
+    long long getSkippedChecks() const { return skippedChecks_.load(); }
+
+private:
+    ClientAuth& auth_;
+
+    std::queue<Task> taskQueue_;
+    size_t maxPending_;
+    mutable std::mutex queueMutex_;
+    std::condition_variable queueCv_;
+
+    std::atomic<bool> running_{true};
+    std::vector<std::thread> workers_;
+
+    std::atomic<long long> totalChecks_{0};
+    std::atomic<long long> skippedChecks_{0};
+
+    void workerLoop();
+};
+
+} // namespace Server
@@ -0,0 +1,66 @@
+#include "EmbeddingService.h"
+#include "../../core/Logger.h"
+
+namespace Server {
+
+EmbeddingService::EmbeddingService(Core::Engine& engine, int ctx_size, int maxSequences)
+    : embedder_(engine, ctx_size, maxSequences) {
+    workerThread_ = std::thread([this]() { workerLoop(); });
+}
+
+EmbeddingService::~EmbeddingService() {
+    shutdown();
+}
+
+void EmbeddingService::enqueueTask(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        taskQueue_.push(std::move(task));
+    }
+    queueCv_.notify_one();
+}
+
+void EmbeddingService::shutdown() {
+    if (!running_.exchange(false)) {
+        return; // Already shutting down
+    }
+
+    queueCv_.notify_all();
+    if (workerThread_.joinable()) {
+        workerThread_.join();
+    }
+
+    LOG_INFO("EmbeddingService: Shutdown complete");
+}
+
+void EmbeddingService::workerLoop() {
+    while (running_) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            queueCv_.wait(lock, [this] { return !taskQueue_.empty() || !running_; });
+
+            if (!running_) break;
+
+            task = std::move(taskQueue_.front());
+            taskQueue_.pop();
+        }
+
+        Core::EmbeddingResult result;
+        std::string error;
+        if (embedder_.embed(task.params.inputs, task.params.normalize, result, error)) {
+            totalInputs_ += task.params.inputs.size();
+            LOG_DEBUG("EmbeddingService: " << task.params.inputs.size() << " input(s), "
+                      << result.prompt_tokens << " tokens in " << result.batches
+                      << " batch(es), " << result.total_ms << " ms");
+        } else {
+            LOG_ERROR("EmbeddingService: " << error);
+        }
+
+        if (task.onComplete) {
+            task.onComplete(result, error);
+        }
+    }
+}
+
+} // namespace Server
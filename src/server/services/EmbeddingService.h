@@ -0,0 +1,75 @@
+#pragma once
+
+#include "../Protocol.h"
+#include "../../core/Embedder.h"
+#include <functional>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace Server {
+
+/**
+ * EmbeddingService - Runs embedding requests off the event loop
+ *
+ * Requests are queued and executed in order on a dedicated worker thread
+ * (the Embedder owns a single context, so more workers would only contend).
+ */
+class EmbeddingService {
+public:
+    // Completion callback: error is empty on success
+    // Called from worker thread - caller must handle thread-safety
+    using CompletionCallback = std::function<void(const Core::EmbeddingResult& result, const std::string& error)>;
+
+    struct Task {
+        EmbedParams params;
+        CompletionCallback onComplete;
+    };
+
+    /**
+     * Constructor
+     * @param engine Engine holding the model (must outlive this service)
+     * @param ctx_size Context size of the embeddings context (max tokens per decode)
+     * @param maxSequences Max inputs packed into one decode
+     */
+    EmbeddingService(Core::Engine& engine, int ctx_size, int maxSequences = 32);
+
+    /**
+     * Destructor - automatically shuts down the worker thread
+     */
+    ~EmbeddingService();
+
+    /**
+     * Enqueue a task for asynchronous execution
+     * Thread-safe, can be called from any thread
+     */
+    void enqueueTask(Task task);
+
+    /**
+     * Gracefully shutdown the service
+     */
+    void shutdown();
+
+    /**
+     * Number of inputs embedded so far
+     */
+    long long getTotalInputs() const { return totalInputs_.load(); }
+
+private:
+    Core::Embedder embedder_;
+
+    std::queue<Task> taskQueue_;
+    std::mutex queueMutex_;
+    std::condition_variable queueCv_;
+
+    std::atomic<bool> running_{true};
+    std::thread workerThread_;
+
+    std::atomic<long long> totalInputs_{0};
+
+    void workerLoop();
+};
+
+} // namespace Server
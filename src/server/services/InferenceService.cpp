@@ -1,11 +1,22 @@
 #include "InferenceService.h"
 #include "Utils.h"
-#include <iostream>
+#include "../../core/Logger.h"
+#include "../../core/Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
 
 namespace Server {
 
-InferenceService::InferenceService(Core::SessionManager* sessionManager, int numWorkers)
-    : sessionManager_(sessionManager) {
+InferenceService::InferenceService(Core::SessionManager* sessionManager, int numWorkers,
+                                   Core::BatchGenerator* batchGenerator,
+                                   Core::ResponseCache* responseCache, double replayTps,
+                                   Core::RateLimiter* rateLimiter)
+    : sessionManager_(sessionManager), batchGenerator_(batchGenerator)
+    , responseCache_(responseCache), replayTps_(replayTps)
+    , rateLimiter_(rateLimiter)
+    , latency_(numWorkers + 1) {
     
     if (!sessionManager_) {
         throw std::invalid_argument("SessionManager cannot be null");
@@ -13,10 +24,16 @@ InferenceService::InferenceService(Core::SessionManager* sessionManager, int num
     
     // Start worker threads
     for (int i = 0; i < numWorkers; ++i) {
-        workerThreads_.emplace_back([this]() { workerLoop(); });
+        workerThreads_.emplace_back([this, i]() { workerLoop(i); });
+    }
+    if (batchGenerator_) {
+        batchThread_ = std::thread([this]() { batchLoop(); });
+    }
+    if (responseCache_ && replayTps_ > 0.0) {
+        replayThread_ = std::thread([this, numWorkers]() { replayLoop(numWorkers); });
     }
     
-    std::cout << "InferenceService: Started with " << numWorkers << " worker threads" << std::endl;
+    LOG_INFO("InferenceService: Started with " << numWorkers << " worker threads");
 }
 
 InferenceService::~InferenceService() {
@@ -24,13 +41,29 @@ InferenceService::~InferenceService() {
 }
 
 void InferenceService::enqueueTask(Task task) {
+    Core::TraceSpan span("enqueue", task.trace_id);
+    if (task.enqueued_at == std::chrono::steady_clock::time_point{}) {
+        task.enqueued_at = std::chrono::steady_clock::now();
+    }
     {
         std::lock_guard<std::mutex> lock(queueMutex_);
-        taskQueue_.push(std::move(task));
+        taskQueue_.push_back(std::move(task));
     }
     queueCv_.notify_one();
 }
 
+bool InferenceService::enqueueBatch(BatchTask task) {
+    if (!batchGenerator_) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(batchMutex_);
+        batchQueue_.push_back(std::move(task));
+    }
+    batchCv_.notify_one();
+    return true;
+}
+
 void InferenceService::shutdown() {
     if (!running_.exchange(false)) {
         return; // Already shutting down
@@ -38,6 +71,21 @@ void InferenceService::shutdown() {
     
     // Wake up all worker threads
     queueCv_.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(batchMutex_);
+        if (runningBatch_) runningBatch_->aborted->store(true);
+    }
+    batchCv_.notify_all();
+    if (batchThread_.joinable()) {
+        batchThread_.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(replayMutex_);
+    }
+    replayCv_.notify_all();
+    if (replayThread_.joinable()) {
+        replayThread_.join();
+    }
     
     // Wait for all workers to finish
     for (auto& thread : workerThreads_) {
@@ -46,7 +94,7 @@ void InferenceService::shutdown() {
         }
     }
     
-    std::cout << "InferenceService: Shutdown complete" << std::endl;
+    LOG_INFO("InferenceService: Shutdown complete");
 }
 
 int InferenceService::getActiveGenerations() const {
@@ -58,57 +106,422 @@ Core::Metrics InferenceService::getLastMetrics() const {
     return lastMetrics_;
 }
 
+InferenceService::Counters InferenceService::getCounters() const {
+    Counters c;
+    {
+        std::lock_guard<std::mutex> lock(metricsMutex_);
+        c = phaseTotals_;
+    }
+    c.completed = completedRequests_.load();
+    c.failed = failedRequests_.load();
+    c.tokens_generated = generatedTokens_.load();
+    return c;
+}
+
+Core::ResponseCache::Stats InferenceService::getResponseCacheStats() const {
+    return responseCache_ ? responseCache_->stats() : Core::ResponseCache::Stats();
+}
+
 bool InferenceService::abortTask(const std::string& session_id) {
+    // A coalesced request only stops following; the shared generation continues
+    if (detachSubscriber(session_id)) {
+        return true;
+    }
+    if (abortSuspended(session_id) || abortReplay(session_id)) {
+        return true;
+    }
     if (sessionManager_) {
         return sessionManager_->abortSession(session_id);
     }
     return false;
 }
 
-void InferenceService::workerLoop() {
+bool InferenceService::abortBatch(const std::string& batch_id, const std::string& client_id) {
+    BatchTask cancelled;
+    {
+        std::lock_guard<std::mutex> lock(batchMutex_);
+        if (runningBatch_ && runningBatch_->batch_id == batch_id && runningBatch_->client_id == client_id) {
+            runningBatch_->aborted->store(true);
+            return true;
+        }
+
+        auto it = std::find_if(batchQueue_.begin(), batchQueue_.end(), [&](const BatchTask& t) {
+            return t.batch_id == batch_id && t.client_id == client_id;
+        });
+        if (it == batchQueue_.end()) {
+            return false;
+        }
+        cancelled = std::move(*it);
+        batchQueue_.erase(it);
+    }
+
+    // Never started: report it as aborted without touching the generator
+    Core::BatchStats stats;
+    stats.prompts = cancelled.items.size();
+    stats.aborted = true;
+    if (cancelled.onComplete) {
+        cancelled.onComplete(cancelled.batch_id, stats);
+    }
+    return true;
+}
+
+void InferenceService::workerLoop(size_t shard) {
+    Core::Tracer::instance().setThreadName("worker-" + std::to_string(shard));
     while (running_) {
         Task task;
-        {
-            std::unique_lock<std::mutex> lock(queueMutex_);
-            queueCv_.wait(lock, [this] { return !taskQueue_.empty() || !running_; });
+        if (!nextTask(task)) break;
+        processTask(task, shard);
+    }
+}
 
-            if (!running_) break;
+bool InferenceService::nextTask(Task& task) {
+    std::unique_lock<std::mutex> lock(queueMutex_);
+    while (running_) {
+        // Oldest task whose client is not in debt; otherwise sleep until the first one is ready
+        auto now = std::chrono::steady_clock::now();
+        auto wakeAt = std::chrono::steady_clock::time_point::max();
+        std::vector<std::string> suspendedClients;
+        for (auto it = taskQueue_.begin(); it != taskQueue_.end(); ++it) {
+            if (!rateLimiter_) {
+                task = std::move(*it);
+                taskQueue_.erase(it);
+                return true;
+            }
 
-            task = std::move(taskQueue_.front());
-            taskQueue_.pop();
+            // A suspended generation (queued at the front) resumes before its client's newer requests start
+            if (std::find(suspendedClients.begin(), suspendedClients.end(), it->client_id) != suspendedClients.end()) {
+                continue;
+            }
+
+            auto readyAt = rateLimiter_->readyAt(it->client_id, now);
+            if (it->suspension) {
+                readyAt = std::max(readyAt, it->suspension->resumeAt);
+                if (readyAt > now) suspendedClients.push_back(it->client_id);
+            }
+            if (readyAt <= now) {
+                task = std::move(*it);
+                taskQueue_.erase(it);
+                // Charged before it runs, so the client's next request already waits for this
+                // prompt; processTask settles the difference once it is prefilled
+                if (task.generate && !task.suspension) {
+                    if (auto* session = sessionManager_->getSession(task.session_id)) {
+                        task.prompt_charged = static_cast<int>(session->countTokens(task.params.prompt));
+                        rateLimiter_->consume(task.client_id, Core::RateLimiter::Kind::PROMPT, task.prompt_charged);
+                    }
+                }
+                return true;
+            }
+            wakeAt = std::min(wakeAt, readyAt);
+        }
+
+        if (wakeAt == std::chrono::steady_clock::time_point::max()) {
+            queueCv_.wait(lock);
+        } else {
+            queueCv_.wait_until(lock, wakeAt);
+        }
+    }
+    return false;
+}
+
+bool InferenceService::abortSuspended(const std::string& session_id) {
+    Task aborted;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        auto it = std::find_if(taskQueue_.begin(), taskQueue_.end(), [&](const Task& t) {
+            return t.session_id == session_id && t.suspension;
+        });
+        if (it == taskQueue_.end()) {
+            return false;
         }
+        aborted = std::move(*it);
+        taskQueue_.erase(it);
+    }
+    queueCv_.notify_all();  // Its client's newer requests no longer wait for it
+
+    // Never resumed: what the earlier parts streamed is all there is
+    Core::Metrics metrics = aborted.suspension->metrics;
+    metrics.completed = false;
+    metrics.throttle_ms = std::chrono::duration<double, std::milli>(
+        aborted.suspension->throttled + (std::chrono::steady_clock::now() - aborted.suspension->since)).count();
+    fillBudget(aborted.client_id, metrics);
+    completedRequests_++;
+    generatedTokens_ += metrics.tokens_generated;
+    if (aborted.onComplete) {
+        aborted.onComplete(aborted.session_id, metrics);
+    }
+    return true;
+}
 
-        processTask(task);
+void InferenceService::fillBudget(const std::string& client_id, Core::Metrics& metrics) {
+    if (!rateLimiter_) {
+        return;
     }
+    auto budget = rateLimiter_->remaining(client_id);
+    metrics.rate_limited = budget.limited;
+    metrics.prompt_budget = budget.prompt_tokens;
+    metrics.generated_budget = budget.generated_tokens;
 }
 
-void InferenceService::processTask(Task& task) {
+// Microseconds elapsed between two points
+static uint64_t elapsedUs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
+
+// A suspended generation resumes this long after its client is out of debt, so each
+// part streams a few tokens rather than one
+static const auto RESUME_SLICE = std::chrono::milliseconds(500);
+
+// Add a resumed part to the metrics of the parts before it. The part's prompt is only
+// the token it resumed from, so its prefill counts as decoding.
+static void mergePart(Core::Metrics& total, const Core::Metrics& part) {
+    total.tokens_generated += part.tokens_generated;
+    total.total_time_ms += part.total_time_ms;
+    total.decode_ms += part.prefill_ms + part.decode_ms;
+    total.sample_ms += part.sample_ms;
+    total.callback_ms += part.callback_ms;
+    total.completed = part.completed;
+    if (total.total_time_ms > 0) {
+        total.tps = total.tokens_generated / (total.total_time_ms / 1000.0);
+    }
+    if (total.decode_ms > 0) {
+        total.decode_tps = total.tokens_generated / (total.decode_ms / 1000.0);
+    }
+}
+
+void InferenceService::processTask(Task& task, size_t shard) {
+    auto fail = [this, &task](const std::string& error) {
+        failedRequests_++;
+        LOG_ERROR("InferenceService: " << error << " (session " << task.session_id << ")");
+        if (task.onError) {
+            task.onError(task.session_id, error);
+        }
+    };
+
+    // The prompt was charged when the task was picked up; only what is prefilled is paid for
+    auto settlePrompt = [this, &task](int prefilled) {
+        if (rateLimiter_ && prefilled != task.prompt_charged) {
+            rateLimiter_->consume(task.client_id, Core::RateLimiter::Kind::PROMPT, prefilled - task.prompt_charged);
+        }
+        task.prompt_charged = 0;
+    };
+
+    // Spans recorded below (including Session's and the sends) belong to this request
+    Core::Tracer::Scope trace(task.trace_id);
+    Core::TraceSpan span("process");
+
+    auto pickedUp = std::chrono::steady_clock::now();
+    auto* latency = latency_.series(shard, task.client_id, task.priority);
+
+    // A resumed generation was suspended while its client was out of budget, not queued
+    std::shared_ptr<Suspension> suspension = std::move(task.suspension);
+    bool resumed = suspension != nullptr;
+    if (resumed) {
+        suspension->throttled += pickedUp - suspension->since;
+    } else {
+        latency->record(Core::LatencyPhase::QUEUE_WAIT, elapsedUs(task.enqueued_at, pickedUp));
+        if (task.trace_id) {
+            auto& tracer = Core::Tracer::instance();
+            tracer.record("queue_wait", task.trace_id, tracer.toUs(task.enqueued_at), elapsedUs(task.enqueued_at, pickedUp));
+        }
+    }
+
     // Get the session
     auto* session = sessionManager_->getSession(task.session_id);
     if (!session) {
-        std::cerr << "InferenceService: Session not found: " << task.session_id << std::endl;
+        settlePrompt(0);
+        fail("Session not found");
         return;
     }
 
+    // Unbounded generations of a limited client are metered token by token. Once the client
+    // is out of budget the generation is suspended and queued again, so that the worker
+    // serves others until the client has paid.
+    bool metered = rateLimiter_ && task.generate && task.params.max_tokens <= 0 &&
+                   std::isfinite(rateLimiter_->remaining(task.client_id).generated_tokens);
+
+    // Deterministic requests already answered are replayed without touching the model
+    std::string key = resumed ? "" : deterministicKey(task);
+    if (!key.empty() && responseCache_ && responseCache_->enabled()) {
+        if (auto cached = responseCache_->lookup(key)) {
+            Core::TraceSpan replaySpan("cache_replay");
+            settlePrompt(0);
+            replay(task, std::move(cached), latency);
+            return;
+        }
+    }
+
+    // Identical requests already running are joined instead of generated again
+    std::shared_ptr<Flight> flight;
+    if (!key.empty()) {
+        std::lock_guard<std::mutex> lock(flightsMutex_);
+        auto it = flights_.find(key);
+        if (it != flights_.end()) {
+            Core::TraceSpan joinSpan("join_flight");
+            std::lock_guard<std::mutex> flightLock(it->second->mutex);
+            if (!task.coalesced) {
+                task.coalesced = true;
+                coalesced_++;
+            }
+            // Catch up on what the leader already streamed, then follow along
+            if (!it->second->pieces.empty()) {
+                latency->record(Core::LatencyPhase::TTFT, elapsedUs(task.enqueued_at, std::chrono::steady_clock::now()));
+            }
+            for (const auto& piece : it->second->pieces) {
+                if (task.onToken) task.onToken(task.session_id, piece, nullptr);
+            }
+            settlePrompt(0);
+            it->second->subscribers.push_back(std::move(task));
+            LOG_DEBUG("InferenceService: session " << it->second->subscribers.back().session_id
+                      << " joined an in-flight generation (" << it->second->pieces.size() << " tokens behind)");
+            return;
+        }
+        // A metered generation would hold whoever joins it to its client's rate
+        if (!metered) {
+            flight = std::make_shared<Flight>();
+            flights_.emplace(key, flight);
+        }
+    }
+
+    Core::GenerationParams genParams;
+    genParams.max_tokens = task.params.max_tokens;
+    genParams.grammar = task.params.grammar;
+    genParams.logprobs = task.params.logprobs;
+
+    // A bounded generation pays for all its tokens up front: it runs at full speed and
+    // the client's next request waits instead. Unbounded ones are metered as they go.
+    int reserved = 0;
+    int streamed = 0;
+    std::chrono::steady_clock::duration debt{};
+    if (rateLimiter_ && task.generate && task.params.max_tokens > 0) {
+        reserved = task.params.max_tokens;
+        rateLimiter_->consume(task.client_id, Core::RateLimiter::Kind::GENERATED, reserved);
+    }
+
     activeGenerations_++;
 
     // Execute inference with token callback
-    auto metrics = session->generate(task.params.prompt, [&task](const std::string& token) {
-        // Sanitize UTF-8 to prevent JSON serialization errors
-        std::string validToken = Utils::sanitizeUtf8(token);
-        
-        // Call user callback
-        if (task.onToken) {
-            task.onToken(task.session_id, validToken);
-        }
-        
-        return true; // Continue generation
-    });
+    Core::Metrics metrics;
+    std::string error;
+    try {
+        // Schemas are converted once and cached; the compiled grammar is cached by the session manager
+        if (!task.params.json_schema.is_null()) {
+            genParams.grammar = sessionManager_->getGrammarCache().grammarForSchema(task.params.json_schema);
+        }
+
+        std::chrono::steady_clock::time_point lastToken;
+        auto onToken = [this, &task, &flight, latency, shard, &lastToken, &streamed, &debt, metered, resumed](
+                           const std::string& token, const Core::TokenLogprobs* logprobs) {
+            auto now = std::chrono::steady_clock::now();
+            if (lastToken != std::chrono::steady_clock::time_point{}) {
+                latency->record(Core::LatencyPhase::INTER_TOKEN, elapsedUs(lastToken, now));
+            } else if (!resumed) {
+                latency->record(Core::LatencyPhase::TTFT, elapsedUs(task.enqueued_at, now));
+            }
+            lastToken = now;
+
+            // Sanitize UTF-8 to prevent JSON serialization errors
+            std::string validToken = Utils::sanitizeUtf8(token);
+            
+            // Call user callback
+            if (task.onToken) {
+                task.onToken(task.session_id, validToken, logprobs);
+            }
+
+            // Fan out to coalesced requests (deterministic requests never carry logprobs)
+            if (flight) {
+                std::lock_guard<std::mutex> lock(flight->mutex);
+                for (auto& subscriber : flight->subscribers) {
+                    if (flight->pieces.empty()) {
+                        latency_.series(shard, subscriber.client_id, subscriber.priority)
+                            ->record(Core::LatencyPhase::TTFT, elapsedUs(subscriber.enqueued_at, now));
+                    }
+                    if (subscriber.onToken) subscriber.onToken(subscriber.session_id, validToken, nullptr);
+                }
+                flight->pieces.push_back(std::move(validToken));
+            }
+
+            streamed++;
+
+            // Out of budget: stop here, to be resumed once the client has paid
+            if (metered) {
+                debt = rateLimiter_->consume(task.client_id, Core::RateLimiter::Kind::GENERATED, 1);
+                if (debt > std::chrono::steady_clock::duration::zero()) {
+                    return false;
+                }
+            }
+            
+            return true; // Continue generation
+        };
+
+        if (resumed) {
+            metrics = session->resume(onToken);
+        } else if (task.chatRole.empty()) {
+            metrics = session->generate(task.params.prompt, genParams, onToken);
+        } else {
+            metrics = session->appendMessage(task.chatRole, task.params.prompt, task.generate, genParams, onToken);
+        }
+    } catch (const std::invalid_argument& e) {
+        error = e.what();
+    }
+
+    if (streamed < reserved) {
+        rateLimiter_->consume(task.client_id, Core::RateLimiter::Kind::GENERATED, streamed - reserved);
+    }
+
+    if (flight) {
+        finishFlight(key, flight, error.empty() ? &metrics : nullptr, shard);
+    }
+
+    if (!resumed) {
+        settlePrompt(metrics.prompt_tokens);
+    }
+
+    if (!error.empty()) {
+        activeGenerations_--;
+        fail(error);
+        return;
+    }
+
+    if (resumed) {
+        mergePart(suspension->metrics, metrics);
+        metrics = suspension->metrics;
+        metrics.throttle_ms = std::chrono::duration<double, std::milli>(suspension->throttled).count();
+    }
+
+    // Stopped for lack of budget (not aborted): release the worker and queue the rest
+    // ahead of newer requests, due once the debt is paid
+    if (debt > std::chrono::steady_clock::duration::zero() && !metrics.completed) {
+        if (!suspension) {
+            suspension = std::make_shared<Suspension>();
+        }
+        suspension->metrics = metrics;
+        suspension->since = std::chrono::steady_clock::now();
+        suspension->resumeAt = suspension->since + debt + RESUME_SLICE;
+        task.suspension = std::move(suspension);
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            taskQueue_.push_front(std::move(task));
+        }
+        queueCv_.notify_all();
+        activeGenerations_--;
+        return;
+    }
+
+    latency->record(Core::LatencyPhase::TOTAL, elapsedUs(task.enqueued_at, std::chrono::steady_clock::now()));
+    fillBudget(task.client_id, metrics);
+
+    completedRequests_++;
+    generatedTokens_ += metrics.tokens_generated;
 
     // Store metrics for broadcasting
     {
         std::lock_guard<std::mutex> lock(metricsMutex_);
         lastMetrics_ = metrics;
+        phaseTotals_.prompt_tokens += metrics.prompt_tokens;
+        phaseTotals_.prefill_ms += metrics.prefill_ms;
+        phaseTotals_.decode_ms += metrics.decode_ms;
+        phaseTotals_.sample_ms += metrics.sample_ms;
+        phaseTotals_.callback_ms += metrics.callback_ms;
     }
 
     // Call completion callback
@@ -119,4 +532,316 @@ void InferenceService::processTask(Task& task) {
     activeGenerations_--;
 }
 
+void InferenceService::finishFlight(const std::string& key, const std::shared_ptr<Flight>& flight,
+                                    const Core::Metrics* metrics, size_t shard) {
+    // Unpublish first: requests arriving from now on start (or replay) their own generation
+    {
+        std::lock_guard<std::mutex> lock(flightsMutex_);
+        flights_.erase(key);
+    }
+
+    std::vector<Task> subscribers;
+    {
+        std::lock_guard<std::mutex> lock(flight->mutex);
+        subscribers = std::move(flight->subscribers);
+        flight->subscribers.clear();
+    }
+
+    bool completed = metrics && metrics->completed;
+
+    // Aborted or failed generations are partial and never cached
+    if (completed && responseCache_ && responseCache_->enabled()) {
+        responseCache_->store(key, Core::CachedResponse{flight->pieces, *metrics});
+    }
+
+    for (auto& subscriber : subscribers) {
+        if (completed) {
+            Core::Metrics shared = *metrics;
+            shared.coalesced = true;
+            shared.cached_tokens = metrics->prompt_tokens + metrics->cached_tokens;
+            shared.prompt_tokens = 0;
+            shared.throttle_ms = 0.0;
+            fillBudget(subscriber.client_id, shared);
+            latency_.series(shard, subscriber.client_id, subscriber.priority)
+                ->record(Core::LatencyPhase::TOTAL, elapsedUs(subscriber.enqueued_at, std::chrono::steady_clock::now()));
+            completedRequests_++;
+            if (subscriber.onComplete) subscriber.onComplete(subscriber.session_id, shared);
+        } else {
+            // The leader failed or its own client aborted it, which must not end anyone else's
+            // request: run again on our own session. The output is deterministic, so the
+            // pieces already streamed are generated again and only the rest is sent.
+            size_t sent = flight->pieces.size();
+            if (sent > 0 && subscriber.onToken) {
+                auto skipped = std::make_shared<size_t>(0);
+                subscriber.onToken = [onToken = std::move(subscriber.onToken), skipped, sent](
+                                         const std::string& session_id, const std::string& token,
+                                         const Core::TokenLogprobs* logprobs) {
+                    if ((*skipped)++ >= sent) onToken(session_id, token, logprobs);
+                };
+            }
+            enqueueTask(std::move(subscriber));
+        }
+    }
+}
+
+bool InferenceService::detachSubscriber(const std::string& session_id) {
+    Task detached;
+    Core::Metrics metrics;
+    {
+        std::lock_guard<std::mutex> lock(flightsMutex_);
+        bool found = false;
+        for (auto& entry : flights_) {
+            auto& flight = *entry.second;
+            std::lock_guard<std::mutex> flightLock(flight.mutex);
+            auto it = std::find_if(flight.subscribers.begin(), flight.subscribers.end(),
+                                   [&](const Task& t) { return t.session_id == session_id; });
+            if (it != flight.subscribers.end()) {
+                detached = std::move(*it);
+                flight.subscribers.erase(it);
+                metrics.tokens_generated = flight.pieces.size();
+                metrics.coalesced = true;
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+
+    fillBudget(detached.client_id, metrics);
+    if (detached.onComplete) {
+        detached.onComplete(detached.session_id, metrics);
+    }
+    return true;
+}
+
+std::string InferenceService::deterministicKey(const Task& task) const {
+    // Only raw infer requests: chat turns depend on the stored history, and
+    // logprobs are neither recorded nor fanned out
+    if (!task.chatRole.empty() || task.params.logprobs > 0) {
+        return "";
+    }
+
+    // Sampling is greedy for every request, so temp does not change the output and
+    // is left out of the key. Requests that sample stochastically must return ""
+    // here once the sampler honours temp.
+    std::string params = "max_tokens=" + std::to_string(task.params.max_tokens);
+    if (!task.params.grammar.empty()) {
+        params += ";grammar=" + task.params.grammar;
+    }
+    if (!task.params.json_schema.is_null()) {
+        params += ";json_schema=" + task.params.json_schema.dump();
+    }
+
+    // Tokenization is a pure function of the model and the text, so the prompt
+    // text stands in for its tokens
+    return Core::ResponseCache::makeKey(sessionManager_->getModelFingerprint(), task.params.prompt, params);
+}
+
+void InferenceService::replay(Task& task, std::shared_ptr<const Core::CachedResponse> cached,
+                              Core::LatencyRecorder::Series* latency) {
+    activeGenerations_++;
+
+    Replay replay;
+    replay.task = std::move(task);
+    replay.cached = std::move(cached);
+    replay.start = std::chrono::steady_clock::now();
+    replay.metrics.cached = true;
+    replay.metrics.completed = true;
+    replay.metrics.cached_tokens = replay.cached->metrics.prompt_tokens + replay.cached->metrics.cached_tokens;
+
+    if (!replayThread_.joinable() || replay.cached->pieces.empty()) {
+        while (replay.sent < replay.cached->pieces.size()) {
+            sendReplayPiece(replay, latency);
+        }
+        finishReplay(replay, latency);
+        return;
+    }
+
+    // Paced: the replay thread sends the first piece right away and the rest on time
+    {
+        std::lock_guard<std::mutex> lock(replayMutex_);
+        replays_.emplace(replay.start, std::move(replay));
+    }
+    replayCv_.notify_one();
+}
+
+void InferenceService::sendReplayPiece(Replay& replay, Core::LatencyRecorder::Series* latency) {
+    if (replay.sent == 0) {
+        auto now = std::chrono::steady_clock::now();
+        replay.metrics.ttft_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - replay.start).count();
+        latency->record(Core::LatencyPhase::TTFT, elapsedUs(replay.task.enqueued_at, now));
+    }
+    if (replay.task.onToken) {
+        replay.task.onToken(replay.task.session_id, replay.cached->pieces[replay.sent], nullptr);
+    }
+    replay.sent++;
+    replay.metrics.tokens_generated++;
+}
+
+void InferenceService::finishReplay(Replay& replay, Core::LatencyRecorder::Series* latency) {
+    auto& metrics = replay.metrics;
+    auto end = std::chrono::steady_clock::now();
+    metrics.total_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - replay.start).count();
+    latency->record(Core::LatencyPhase::TOTAL, elapsedUs(replay.task.enqueued_at, end));
+    if (metrics.total_time_ms > 0) {
+        metrics.tps = (double)metrics.tokens_generated / (metrics.total_time_ms / 1000.0);
+    }
+
+    LOG_DEBUG("InferenceService: replayed " << metrics.tokens_generated << " cached tokens (session "
+              << replay.task.session_id << ")");
+
+    // Replays are not model throughput: lastMetrics_ is left untouched, no budget is used
+    fillBudget(replay.task.client_id, metrics);
+    completedRequests_++;
+    if (replay.task.onComplete) {
+        replay.task.onComplete(replay.task.session_id, metrics);
+    }
+
+    activeGenerations_--;
+}
+
+bool InferenceService::abortReplay(const std::string& session_id) {
+    Replay aborted;
+    {
+        std::lock_guard<std::mutex> lock(replayMutex_);
+        auto it = std::find_if(replays_.begin(), replays_.end(), [&](const auto& entry) {
+            return entry.second.task.session_id == session_id;
+        });
+        if (it == replays_.end()) {
+            if (!replayingSession_.empty() && replayingSession_ == session_id) {
+                replayAborted_ = true;  // replayLoop completes it after this piece
+                return true;
+            }
+            return false;
+        }
+        aborted = std::move(it->second);
+        replays_.erase(it);
+    }
+
+    // Only the pieces already sent were streamed
+    aborted.metrics.completed = false;
+    fillBudget(aborted.task.client_id, aborted.metrics);
+    completedRequests_++;
+    if (aborted.task.onComplete) {
+        aborted.task.onComplete(aborted.task.session_id, aborted.metrics);
+    }
+    activeGenerations_--;
+    return true;
+}
+
+void InferenceService::replayLoop(size_t shard) {
+    Core::Tracer::instance().setThreadName("replay");
+    const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / replayTps_));
+
+    std::unique_lock<std::mutex> lock(replayMutex_);
+    while (running_) {
+        if (replays_.empty()) {
+            replayCv_.wait(lock);
+            continue;
+        }
+        auto due = replays_.begin()->first;
+        if (due > std::chrono::steady_clock::now()) {
+            replayCv_.wait_until(lock, due);
+            continue;
+        }
+        Replay replay = std::move(replays_.begin()->second);
+        replays_.erase(replays_.begin());
+        replayingSession_ = replay.task.session_id;
+        replayAborted_ = false;
+        lock.unlock();
+
+        // Callbacks run without the lock (an abort may come from one)
+        auto* latency = latency_.series(shard, replay.task.client_id, replay.task.priority);
+        sendReplayPiece(replay, latency);
+
+        lock.lock();
+        replayingSession_.clear();
+        if (replayAborted_) {
+            replay.metrics.completed = false;
+        } else if (replay.sent < replay.cached->pieces.size()) {
+            replays_.emplace(replay.start + interval * replay.sent, std::move(replay));
+            continue;
+        }
+        lock.unlock();
+        finishReplay(replay, latency);
+        lock.lock();
+    }
+}
+
+void InferenceService::batchLoop() {
+    Core::Tracer::instance().setThreadName("batch");
+    while (running_) {
+        std::shared_ptr<BatchTask> task;
+        {
+            std::unique_lock<std::mutex> lock(batchMutex_);
+            while (running_ && !task) {
+                // Oldest batch whose client is not in debt, as nextTask() does for requests
+                auto now = std::chrono::steady_clock::now();
+                auto wakeAt = std::chrono::steady_clock::time_point::max();
+                for (auto it = batchQueue_.begin(); it != batchQueue_.end(); ++it) {
+                    auto readyAt = rateLimiter_ ? rateLimiter_->readyAt(it->client_id, now) : now;
+                    if (readyAt <= now) {
+                        task = std::make_shared<BatchTask>(std::move(*it));
+                        batchQueue_.erase(it);
+                        break;
+                    }
+                    wakeAt = std::min(wakeAt, readyAt);
+                }
+
+                if (task) {
+                    runningBatch_ = task;
+                } else if (wakeAt == std::chrono::steady_clock::time_point::max()) {
+                    batchCv_.wait(lock);
+                } else {
+                    batchCv_.wait_until(lock, wakeAt);
+                }
+            }
+
+            if (!running_) break;
+        }
+
+        activeGenerations_++;
+
+        const std::string& batch_id = task->batch_id;
+        auto stats = batchGenerator_->run(
+            task->items,
+            [&task, &batch_id](size_t index, const std::string& token) {
+                if (task->onToken) {
+                    task->onToken(batch_id, index, Utils::sanitizeUtf8(token));
+                }
+                return true;
+            },
+            [&task, &batch_id](size_t index, const Core::Metrics& metrics) {
+                if (task->onItemDone) {
+                    task->onItemDone(batch_id, index, metrics);
+                }
+            },
+            *task->aborted);
+
+        activeGenerations_--;
+
+        // Charged afterwards: the debt holds back the client's next requests and batches
+        if (rateLimiter_) {
+            rateLimiter_->consume(task->client_id, Core::RateLimiter::Kind::PROMPT, stats.prompt_tokens);
+            rateLimiter_->consume(task->client_id, Core::RateLimiter::Kind::GENERATED, stats.tokens_generated);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(batchMutex_);
+            runningBatch_.reset();
+        }
+
+        LOG_DEBUG("InferenceService: batch " << batch_id << " done: " << stats.prompts << " prompts ("
+                  << stats.unique_prompts << " unique, " << stats.shared_prefix_tokens << " shared prefix tokens), "
+                  << stats.tokens_generated << " tokens in " << stats.total_time_ms << " ms");
+
+        if (task->onComplete) {
+            task->onComplete(batch_id, stats);
+        }
+    }
+}
+
 } // namespace Server
@@ -3,13 +3,21 @@
 #include "../Protocol.h"
 #include "../../core/SessionManager.h"
 #include "../../core/Metrics.h"
+#include "../../core/BatchGenerator.h"
+#include "../../core/ResponseCache.h"
+#include "../../core/LatencyHistogram.h"
+#include "../../core/RateLimiter.h"
 #include <functional>
-#include <queue>
+#include <deque>
+#include <memory>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
 #include <vector>
+#include <map>
+#include <unordered_map>
 
 namespace Server {
 
@@ -21,14 +29,29 @@ namespace Server {
  */
 class InferenceService {
 public:
-    // Token callback: called for each generated token
+    // Token callback: called for each generated token (logprobs is null unless requested)
     // Called from worker thread - caller must handle thread-safety
-    using TokenCallback = std::function<void(const std::string& session_id, const std::string& token)>;
+    using TokenCallback = std::function<void(const std::string& session_id, const std::string& token,
+                                             const Core::TokenLogprobs* logprobs)>;
     
     // Completion callback: called when inference finishes
     // Called from worker thread - caller must handle thread-safety
     using CompletionCallback = std::function<void(const std::string& session_id, const Core::Metrics& metrics)>;
     
+    // Error callback: called instead of onComplete when the task cannot run
+    // Called from worker thread - caller must handle thread-safety
+    using ErrorCallback = std::function<void(const std::string& session_id, const std::string& error)>;
+    
+    /**
+     * What a generation suspended while its client was out of budget has done so far
+     */
+    struct Suspension {
+        Core::Metrics metrics;  // Earlier parts, merged
+        std::chrono::steady_clock::duration throttled{};  // Time spent suspended before this time
+        std::chrono::steady_clock::time_point since{};    // When it was last suspended
+        std::chrono::steady_clock::time_point resumeAt{};
+    };
+
     /**
      * Task submitted for inference execution
      */
@@ -37,14 +60,56 @@ public:
         InferenceParams params;
         TokenCallback onToken;
         CompletionCallback onComplete;
+        ErrorCallback onError;
+        // append_message: role of the message (params.prompt holds its content); empty = infer
+        std::string chatRole;
+        bool generate = true;
+        // Latency breakdown keys
+        std::string client_id;
+        std::string priority = "normal";
+        // Set by enqueueTask (kept when a task is re-queued)
+        std::chrono::steady_clock::time_point enqueued_at{};
+        // Core::Tracer id of a sampled request (0 = not traced)
+        uint64_t trace_id = 0;
+        // Set on a throttled generation waiting in the queue to be resumed (see processTask)
+        std::shared_ptr<Suspension> suspension{};
+        // Prompt tokens charged to the client's budget when the task was picked up
+        int prompt_charged = 0;
+        // Already counted in getCoalescedCount (a follower re-queued after its leader aborted)
+        bool coalesced = false;
+    };
+    
+    // Batch callbacks: called from the batch worker thread
+    using BatchTokenCallback = std::function<void(const std::string& batch_id, size_t index, const std::string& token)>;
+    using BatchItemCallback = std::function<void(const std::string& batch_id, size_t index, const Core::Metrics& metrics)>;
+    using BatchCompletionCallback = std::function<void(const std::string& batch_id, const Core::BatchStats& stats)>;
+
+    /**
+     * Batch of independent prompts executed together (see Core::BatchGenerator)
+     */
+    struct BatchTask {
+        std::string batch_id;
+        std::string client_id;
+        std::vector<Core::BatchItem> items;
+        BatchTokenCallback onToken;
+        BatchItemCallback onItemDone;
+        BatchCompletionCallback onComplete;
+        std::shared_ptr<std::atomic<bool>> aborted = std::make_shared<std::atomic<bool>>(false);
     };
     
     /**
      * Constructor
      * @param sessionManager Pointer to session manager (must outlive this service)
      * @param numWorkers Number of worker threads (default: 4)
+     * @param batchGenerator Executor for batch tasks (optional, must outlive this service)
+     * @param responseCache Replay cache for deterministic requests (optional, must outlive this service)
+     * @param replayTps Pace cache hits at this many tokens/s (0 = send immediately)
+     * @param rateLimiter Per-client token budgets (optional, must outlive this service)
      */
-    InferenceService(Core::SessionManager* sessionManager, int numWorkers = 4);
+    InferenceService(Core::SessionManager* sessionManager, int numWorkers = 4,
+                     Core::BatchGenerator* batchGenerator = nullptr,
+                     Core::ResponseCache* responseCache = nullptr, double replayTps = 0.0,
+                     Core::RateLimiter* rateLimiter = nullptr);
     
     /**
      * Destructor - automatically shuts down worker threads
@@ -53,9 +118,19 @@ public:
     
     /**
      * Enqueue a task for asynchronous execution
+     * Tasks start in order, except that a client out of token budget is passed over
+     * until its bucket refills.
      * Thread-safe, can be called from any thread
      */
     void enqueueTask(Task task);
+
+    /**
+     * Enqueue a batch for execution on the dedicated batch worker
+     * Batches run one at a time, in order, except that a batch of a client out of token
+     * budget waits until its bucket refills. Returns false if batching is unavailable.
+     * Thread-safe, can be called from any thread
+     */
+    bool enqueueBatch(BatchTask task);
     
     /**
      * Gracefully shutdown the service
@@ -75,33 +150,159 @@ public:
      */
     Core::Metrics getLastMetrics() const;
 
+    /**
+     * Response cache counters (zeroed when the cache is disabled)
+     * Thread-safe
+     */
+    Core::ResponseCache::Stats getResponseCacheStats() const;
+
+    /**
+     * Number of requests served by joining an identical in-flight generation
+     * Thread-safe
+     */
+    uint64_t getCoalescedCount() const { return coalesced_.load(); }
+
+    /**
+     * Queue wait / TTFT / inter-token / total latency histograms, merged across
+     * workers and broken down by client and priority
+     * Thread-safe
+     */
+    Core::LatencyRecorder::Report getLatencyReport() const { return latency_.report(); }
+
+    /**
+     * Cumulative request/token counters since startup
+     * Thread-safe
+     */
+    struct Counters {
+        uint64_t completed = 0;         // Including cache replays and coalesced requests
+        uint64_t failed = 0;
+        uint64_t tokens_generated = 0;  // Decoded by the model (replays excluded)
+        uint64_t prompt_tokens = 0;     // Prefilled (KV cache hits excluded)
+        double prefill_ms = 0.0;        // Phase totals, see Core::Metrics
+        double decode_ms = 0.0;
+        double sample_ms = 0.0;
+        double callback_ms = 0.0;
+    };
+    Counters getCounters() const;
+
     /**
      * Abort a running task/session
      */
     bool abortTask(const std::string& session_id);
+
+    /**
+     * Abort a queued or running batch owned by client_id
+     */
+    bool abortBatch(const std::string& batch_id, const std::string& client_id);
     
 private:
     Core::SessionManager* sessionManager_;
     
-    // Task queue
-    std::queue<Task> taskQueue_;
+    // Task queue (FIFO, skipping clients that are out of budget; suspended generations
+    // go back in at the front)
+    std::deque<Task> taskQueue_;
     std::mutex queueMutex_;
     std::condition_variable queueCv_;
     
     // Worker threads
     std::atomic<bool> running_{true};
     std::vector<std::thread> workerThreads_;
+
+    // Batch queue (single worker: the generator owns one shared context)
+    Core::BatchGenerator* batchGenerator_;
+    std::deque<BatchTask> batchQueue_;
+    std::shared_ptr<BatchTask> runningBatch_;
+    std::mutex batchMutex_;
+    std::condition_variable batchCv_;
+    std::thread batchThread_;
     
+    // Response cache
+    Core::ResponseCache* responseCache_;
+    double replayTps_;
+
+    // Cache hit being streamed back
+    struct Replay {
+        Task task;
+        std::shared_ptr<const Core::CachedResponse> cached;
+        size_t sent = 0;  // Pieces streamed so far
+        Core::Metrics metrics;
+        std::chrono::steady_clock::time_point start{};
+    };
+    // Paced replays by the time their next piece is due. A single thread streams them
+    // all, so pacing never holds an inference worker.
+    std::multimap<std::chrono::steady_clock::time_point, Replay> replays_;
+    std::string replayingSession_;  // Out of replays_ while its piece is sent
+    bool replayAborted_ = false;    // ... and aborted meanwhile
+    std::mutex replayMutex_;
+    std::condition_variable replayCv_;
+    std::thread replayThread_;
+
+    Core::RateLimiter* rateLimiter_;
+
+    // In-flight deterministic generation that identical requests subscribe to
+    struct Flight {
+        std::mutex mutex;
+        std::vector<std::string> pieces;   // Streamed so far (replayed to late subscribers)
+        std::vector<Task> subscribers;
+    };
+    std::unordered_map<std::string, std::shared_ptr<Flight>> flights_;
+    std::mutex flightsMutex_;  // Taken before any Flight::mutex
+    std::atomic<uint64_t> coalesced_{0};
+
     // Metrics state
     std::atomic<int> activeGenerations_{0};
     Core::Metrics lastMetrics_;
+    Counters phaseTotals_;  // Token/time totals (the request counters are the atomics below)
     mutable std::mutex metricsMutex_;
+    Core::LatencyRecorder latency_;  // One shard per worker thread, then the replay thread's
+    std::atomic<uint64_t> completedRequests_{0};
+    std::atomic<uint64_t> failedRequests_{0};
+    std::atomic<uint64_t> generatedTokens_{0};
     
     // Worker thread main loop
-    void workerLoop();
+    void workerLoop(size_t shard);
+
+    // Next task whose client has budget (and suspended ones once due), waiting for one
+    // if needed; false on shutdown
+    bool nextTask(Task& task);
+
+    // Take a suspended task of this session out of the queue and complete it as aborted
+    bool abortSuspended(const std::string& session_id);
+
+    // Report the client's remaining budget in metrics
+    void fillBudget(const std::string& client_id, Core::Metrics& metrics);
     
     // Process a single task
-    void processTask(Task& task);
+    void processTask(Task& task, size_t shard);
+
+    // Cache/coalescing key for a task, or empty if its output is not reproducible
+    std::string deterministicKey(const Task& task) const;
+
+    // Unpublish a flight, cache its output and complete (or re-queue) its subscribers.
+    // metrics is null if the leader failed.
+    void finishFlight(const std::string& key, const std::shared_ptr<Flight>& flight,
+                      const Core::Metrics* metrics, size_t shard);
+
+    // Stop streaming a shared generation to a subscriber; false if session_id isn't one
+    bool detachSubscriber(const std::string& session_id);
+
+    // Stream a cached response through the task callbacks: at once, or handed to the
+    // replay thread when paced
+    void replay(Task& task, std::shared_ptr<const Core::CachedResponse> cached,
+                Core::LatencyRecorder::Series* latency);
+
+    // Send a replay's next piece / complete it (activeGenerations_ counts it until then)
+    void sendReplayPiece(Replay& replay, Core::LatencyRecorder::Series* latency);
+    void finishReplay(Replay& replay, Core::LatencyRecorder::Series* latency);
+
+    // Take a paced replay of this session off the replay thread and complete it as aborted
+    bool abortReplay(const std::string& session_id);
+
+    // Replay thread main loop: streams every paced replay's pieces as they fall due
+    void replayLoop(size_t shard);
+
+    // Batch worker main loop
+    void batchLoop();
 };
 
 } // namespace Server
@@ -1,10 +1,13 @@
 #include "MetricsService.h"
 #include "../handlers/MetricsHandler.h"
 #include "../Protocol.h"
+#include "../../core/Logger.h"
+#include "../../core/Trace.h"
+#include "../PrometheusWriter.h"
 #include <nlohmann/json.hpp>
+#include <algorithm>
 #include <chrono>
-#include <thread>
-#include <iostream>
+#include <vector>
 
 using json = nlohmann::json;
 
@@ -32,10 +35,24 @@ MetricsService::~MetricsService() {
 }
 
 void MetricsService::start() {
-    // Start metrics thread
-    metricsThread_ = std::thread([this]() { metricsLoop(); });
+    if (!loop_) {
+        throw std::logic_error("MetricsService: event loop not set");
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(collectorMutex_);
+        collecting_ = true;
+    }
+    collector_ = std::thread([this]() { collectLoop(); });
+
+    // 1 s tick on the event loop; the timer's extension stores the owning service
+    timer_ = us_create_timer(reinterpret_cast<struct us_loop_t*>(loop_), 0, sizeof(MetricsService*));
+    *static_cast<MetricsService**>(us_timer_ext(timer_)) = this;
+    us_timer_set(timer_, [](struct us_timer_t* t) {
+        (*static_cast<MetricsService**>(us_timer_ext(t)))->tick();
+    }, TICK_MS, TICK_MS);
     
-    std::cout << "MetricsService: Started" << std::endl;
+    LOG_INFO("MetricsService: Started");
 }
 
 void MetricsService::setMetricsHandler(MetricsHandler* handler) {
@@ -46,47 +63,185 @@ void MetricsService::setEventLoop(uWS::Loop* loop) {
     loop_ = loop;
 }
 
+void MetricsService::addApp(uWS::Loop* loop, uWS::App* app) {
+    std::lock_guard<std::mutex> lock(appsMutex_);
+    apps_.emplace_back(loop, app);
+}
+
+void MetricsService::removeApp(uWS::App* app) {
+    std::lock_guard<std::mutex> lock(appsMutex_);
+    apps_.erase(std::remove_if(apps_.begin(), apps_.end(),
+                               [app](const auto& entry) { return entry.second == app; }),
+                apps_.end());
+}
+
+void MetricsService::setTraceDumpDir(const std::string& dir) {
+    traceDumpDir_ = dir;
+}
+
+void MetricsService::setClientAuth(const ClientAuth* auth) {
+    clientAuth_ = auth;
+}
+
 void MetricsService::shutdown() {
-    if (!running_.exchange(false)) {
-        return; // Already shutting down
+    if (!timer_) {
+        return; // Not started or already shut down
     }
-    
-    // Wait for metrics thread to finish
-    if (metricsThread_.joinable()) {
-        metricsThread_.join();
+
+    // A live timer keeps the loop running
+    us_timer_close(timer_);
+    timer_ = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(collectorMutex_);
+        collecting_ = false;
+    }
+    collectorCv_.notify_all();
+    if (collector_.joinable()) {
+        collector_.join();
     }
     
-    std::cout << "MetricsService: Shutdown complete" << std::endl;
-}
-
-void MetricsService::metricsLoop() {
-    while (running_) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        
-        if (!running_) break;
-        
-        // Build metrics JSON
-        std::string metricsJson = buildMetricsJson();
-        
-        // Broadcast via event loop
-        if (loop_ && metricsHandler_) {
-            loop_->defer([this, metricsJson]() {
-                auto subscribers = metricsHandler_->getSubscribers();
-                for (auto* ws : subscribers) {
-                    ws->send(metricsJson, uWS::OpCode::TEXT);
-                }
-            });
+    LOG_INFO("MetricsService: Shutdown complete");
+}
+
+void MetricsService::collectLoop() {
+    Core::Tracer::instance().setThreadName("metrics");
+    auto next = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(collectorMutex_);
+    while (collecting_) {
+        while (!jobs_.empty()) {
+            auto job = std::move(jobs_.front());
+            jobs_.pop_front();
+            lock.unlock();
+            job();
+            lock.lock();
+        }
+        if (std::chrono::steady_clock::now() >= next) {
+            lock.unlock();
+            collect();
+            lock.lock();
+            next += std::chrono::milliseconds(TICK_MS);
+        }
+        collectorCv_.wait_until(lock, next, [this]() { return !collecting_ || !jobs_.empty(); });
+    }
+    jobs_.clear();
+}
+
+bool MetricsService::post(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(collectorMutex_);
+        if (!collecting_) {
+            return false;
         }
+        jobs_.push_back(std::move(job));
     }
+    collectorCv_.notify_all();
+    return true;
 }
 
-std::string MetricsService::buildMetricsJson() {
-    // Get current GPU stats
+void MetricsService::collect() {
+    ticks_++;
+
+    if (Core::Tracer::instance().takeDumpRequest()) {
+        dumpTrace();
+    }
+
+    // Collect once, render both the WebSocket frames and the /metrics exposition
     auto gpuStats = monitor_.updateStats();
-    
+    auto cpuStats = monitor_.updateCpuStats();
+    auto latency = inferenceService_->getLatencyReport();
+
+    auto prometheusText = std::make_shared<const std::string>(buildPrometheusText(gpuStats, cpuStats, latency));
+    {
+        std::lock_guard<std::mutex> lock(prometheusMutex_);
+        prometheusText_ = std::move(prometheusText);
+    }
+
+    if (!metricsHandler_) {
+        return;
+    }
+
+    // One frame per topic, shared by all of its subscribers
+    json frame;
+    std::vector<std::pair<std::string, std::string>> frames;
+    for (const auto& [name, topic] : metricsHandler_->getTopics()) {
+        if (ticks_ % topic.interval_s != 0) {
+            continue;
+        }
+        if (frame.is_null()) {
+            frame = buildMetricsJson(gpuStats, cpuStats, latency);
+        }
+        frames.emplace_back(name, MetricsHandler::filter(frame, topic).dump());
+    }
+
+    std::lock_guard<std::mutex> lock(framesMutex_);
+    for (auto& [name, text] : frames) {
+        pendingFrames_[name] = std::move(text);
+    }
+}
+
+void MetricsService::tick() {
+    auto frames = std::make_shared<std::map<std::string, std::string>>();
+    {
+        std::lock_guard<std::mutex> lock(framesMutex_);
+        frames->swap(pendingFrames_);
+    }
+    if (frames->empty()) {
+        return;
+    }
+
+    // Each app publishes on its own loop (uWS topics are per app)
+    std::lock_guard<std::mutex> lock(appsMutex_);
+    for (const auto& [loop, app] : apps_) {
+        auto publish = [app = app, frames]() {
+            for (const auto& [name, text] : *frames) {
+                app->publish(name, text, uWS::OpCode::TEXT);
+            }
+        };
+        if (loop == loop_) {
+            publish();
+        } else {
+            loop->defer(publish);
+        }
+    }
+}
+
+// p50/p90/p99 (ms) and sample count per latency phase
+static json latencyJson(const Core::LatencyRecorder::PhaseSnapshots& phases) {
+    json out = json::object();
+    for (size_t i = 0; i < phases.size(); i++) {
+        const auto& h = phases[i];
+        out[Core::latencyPhaseName(static_cast<Core::LatencyPhase>(i))] = {
+            {"p50_ms", h.percentile(0.50) / 1000.0},
+            {"p90_ms", h.percentile(0.90) / 1000.0},
+            {"p99_ms", h.percentile(0.99) / 1000.0},
+            {"count", h.total}
+        };
+    }
+    return out;
+}
+
+std::shared_ptr<const std::string> MetricsService::getPrometheusText() const {
+    std::lock_guard<std::mutex> lock(prometheusMutex_);
+    return prometheusText_;
+}
+
+// Share of time stalled (%), per /proc/pressure file
+static json psiJson(const Hardware::PsiStats& psi) {
+    return {
+        {"some_avg10", psi.some_avg10},
+        {"some_avg60", psi.some_avg60},
+        {"full_avg10", psi.full_avg10},
+        {"full_avg60", psi.full_avg60}
+    };
+}
+
+json MetricsService::buildMetricsJson(const Hardware::GpuStats& gpuStats, const Hardware::CpuStats& cpuStats,
+                                      const Core::LatencyRecorder::Report& latency) {
     // Get current inference metrics
     auto currentMetrics = inferenceService_->getLastMetrics();
     int activeGens = inferenceService_->getActiveGenerations();
+    auto cacheStats = inferenceService_->getResponseCacheStats();
     
     // Build metrics JSON
     json metricsJson = {
@@ -101,16 +256,184 @@ std::string MetricsService::buildMetricsJson() {
             {"fan_percent", gpuStats.fanSpeed},
             {"throttling", gpuStats.throttle}
         }},
+        {"cpu", {
+            {"available", cpuStats.available},
+            {"utilization_percent", cpuStats.utilization},
+            {"cores_percent", cpuStats.coreUtilization},
+            {"process_rss_mb", cpuStats.processRss / (1024*1024)},
+            {"mem_total_mb", cpuStats.memoryTotal / (1024*1024)},
+            {"mem_available_mb", cpuStats.memoryAvailable / (1024*1024)},
+            {"pressure", {
+                {"cpu", psiJson(cpuStats.cpuPressure)},
+                {"memory", psiJson(cpuStats.memoryPressure)},
+                {"io", psiJson(cpuStats.ioPressure)}
+            }},
+            {"temp", cpuStats.packageTemp},
+            {"throttling", cpuStats.throttle}
+        }},
         {"inference", {
             {"active_generations", activeGens},
             {"total_sessions", sessionManager_->getTotalSessionCount()},
             {"last_tps", currentMetrics.tps},
             {"last_ttft_ms", currentMetrics.ttft_ms},
-            {"total_tokens_generated", currentMetrics.tokens_generated}
+            {"last_prompt_tokens", currentMetrics.prompt_tokens},
+            {"last_prefill_ms", currentMetrics.prefill_ms},
+            {"last_prefill_tps", currentMetrics.prefill_tps},
+            {"last_decode_tps", currentMetrics.decode_tps},
+            {"last_sample_ms", currentMetrics.sample_ms},
+            {"last_callback_ms", currentMetrics.callback_ms},
+            {"total_tokens_generated", currentMetrics.tokens_generated},
+            {"coalesced_requests", inferenceService_->getCoalescedCount()}
+        }},
+        {"latency", latencyJson(latency.all)},
+        {"response_cache", {
+            {"hits", cacheStats.hits},
+            {"misses", cacheStats.misses},
+            {"hit_rate", cacheStats.hitRate()},
+            {"evictions", cacheStats.evictions},
+            {"entries", cacheStats.entries},
+            {"bytes", cacheStats.bytes}
         }}
     };
     
-    return metricsJson.dump();
+    for (const auto& [client_id, phases] : latency.byClient) {
+        metricsJson["latency_by_client"][client_id] = latencyJson(phases);
+    }
+    for (const auto& [priority, phases] : latency.byPriority) {
+        metricsJson["latency_by_priority"][priority] = latencyJson(phases);
+    }
+
+    return metricsJson;
+}
+
+std::string MetricsService::buildPrometheusText(const Hardware::GpuStats& gpuStats, const Hardware::CpuStats& cpuStats,
+                                                const Core::LatencyRecorder::Report& latency) {
+    auto counters = inferenceService_->getCounters();
+    auto cacheStats = inferenceService_->getResponseCacheStats();
+
+    PrometheusWriter w;
+
+    w.family("inference_core_ready", "gauge", "1 once the model is loaded and sessions can be created");
+    w.sample("inference_core_ready", sessionManager_->isReady() ? 1 : 0);
+    w.family("inference_core_sessions", "gauge", "Open inference sessions");
+    w.sample("inference_core_sessions", sessionManager_->getTotalSessionCount());
+    w.family("inference_core_active_generations", "gauge", "Generations currently running");
+    w.sample("inference_core_active_generations", inferenceService_->getActiveGenerations());
+
+    w.family("inference_core_requests_total", "counter", "Inference requests by outcome");
+    w.sample("inference_core_requests_total", counters.completed, {{"status", "completed"}});
+    w.sample("inference_core_requests_total", counters.failed, {{"status", "failed"}});
+    w.family("inference_core_coalesced_requests_total", "counter",
+             "Requests served by joining an identical in-flight generation");
+    w.sample("inference_core_coalesced_requests_total", inferenceService_->getCoalescedCount());
+    w.family("inference_core_generated_tokens_total", "counter", "Tokens decoded by the model");
+    w.sample("inference_core_generated_tokens_total", counters.tokens_generated);
+    w.family("inference_core_prompt_tokens_total", "counter", "Prompt tokens prefilled (KV cache hits excluded)");
+    w.sample("inference_core_prompt_tokens_total", counters.prompt_tokens);
+    w.family("inference_core_phase_seconds_total", "counter", "Generation time by phase");
+    w.sample("inference_core_phase_seconds_total", counters.prefill_ms / 1000.0, {{"phase", "prefill"}});
+    w.sample("inference_core_phase_seconds_total", counters.decode_ms / 1000.0, {{"phase", "decode"}});
+    w.sample("inference_core_phase_seconds_total", counters.sample_ms / 1000.0, {{"phase", "sample"}});
+    w.sample("inference_core_phase_seconds_total", counters.callback_ms / 1000.0, {{"phase", "callback"}});
+
+    w.family("inference_core_response_cache_requests_total", "counter", "Response cache lookups by result");
+    w.sample("inference_core_response_cache_requests_total", cacheStats.hits, {{"result", "hit"}});
+    w.sample("inference_core_response_cache_requests_total", cacheStats.misses, {{"result", "miss"}});
+    w.family("inference_core_response_cache_evictions_total", "counter", "Response cache entries evicted");
+    w.sample("inference_core_response_cache_evictions_total", cacheStats.evictions);
+    w.family("inference_core_response_cache_entries", "gauge", "Responses held by the cache");
+    w.sample("inference_core_response_cache_entries", cacheStats.entries);
+    w.family("inference_core_response_cache_bytes", "gauge", "Approximate size of the response cache");
+    w.sample("inference_core_response_cache_bytes", cacheStats.bytes);
+
+    w.family("inference_core_gpu_temperature_celsius", "gauge", "GPU temperature");
+    w.sample("inference_core_gpu_temperature_celsius", gpuStats.temp);
+    w.family("inference_core_gpu_memory_used_bytes", "gauge", "GPU memory in use");
+    w.sample("inference_core_gpu_memory_used_bytes", gpuStats.memoryUsed);
+    w.family("inference_core_gpu_memory_total_bytes", "gauge", "GPU memory");
+    w.sample("inference_core_gpu_memory_total_bytes", gpuStats.memoryTotal);
+    w.family("inference_core_gpu_power_watts", "gauge", "GPU power draw");
+    w.sample("inference_core_gpu_power_watts", gpuStats.powerUsage / 1000.0);
+    w.family("inference_core_throttling", "gauge", "1 while a device is over its temperature limit");
+    w.sample("inference_core_throttling", gpuStats.throttle ? 1 : 0, {{"device", "gpu"}});
+    w.sample("inference_core_throttling", cpuStats.throttle ? 1 : 0, {{"device", "cpu"}});
+
+    if (cpuStats.available) {
+        w.family("inference_core_cpu_utilization_ratio", "gauge", "Host CPU busy share over the last second");
+        w.sample("inference_core_cpu_utilization_ratio", cpuStats.utilization / 100.0);
+        w.family("inference_core_cpu_core_utilization_ratio", "gauge", "Per-core busy share over the last second");
+        for (size_t i = 0; i < cpuStats.coreUtilization.size(); i++) {
+            w.sample("inference_core_cpu_core_utilization_ratio", cpuStats.coreUtilization[i] / 100.0,
+                     {{"core", std::to_string(i)}});
+        }
+        w.family("inference_core_process_resident_memory_bytes", "gauge", "Resident set size of this process");
+        w.sample("inference_core_process_resident_memory_bytes", cpuStats.processRss);
+        w.family("inference_core_memory_available_bytes", "gauge", "Host memory available (MemAvailable)");
+        w.sample("inference_core_memory_available_bytes", cpuStats.memoryAvailable);
+        w.family("inference_core_memory_total_bytes", "gauge", "Host memory (MemTotal)");
+        w.sample("inference_core_memory_total_bytes", cpuStats.memoryTotal);
+        w.family("inference_core_pressure_ratio", "gauge", "PSI share of time stalled, 10 s average");
+        const std::pair<const char*, const Hardware::PsiStats*> pressures[] = {
+            {"cpu", &cpuStats.cpuPressure}, {"memory", &cpuStats.memoryPressure}, {"io", &cpuStats.ioPressure}
+        };
+        for (const auto& [resource, psi] : pressures) {
+            w.sample("inference_core_pressure_ratio", psi->some_avg10 / 100.0, {{"resource", resource}, {"kind", "some"}});
+            w.sample("inference_core_pressure_ratio", psi->full_avg10 / 100.0, {{"resource", resource}, {"kind", "full"}});
+        }
+        if (cpuStats.packageTemp >= 0) {
+            w.family("inference_core_cpu_temperature_celsius", "gauge", "CPU package temperature");
+            w.sample("inference_core_cpu_temperature_celsius", cpuStats.packageTemp);
+        }
+    }
+
+    if (clientAuth_) {
+        w.family("inference_core_jotadb_request_seconds", "histogram",
+                 "JotaDB request round trip (credential checks and heartbeats)");
+        w.histogram("inference_core_jotadb_request_seconds", clientAuth_->getRttSnapshot(), {});
+        w.family("inference_core_jotadb_request_errors_total", "counter",
+                 "JotaDB requests that got no HTTP response");
+        w.sample("inference_core_jotadb_request_errors_total", clientAuth_->getRequestErrors());
+        w.family("inference_core_auth_checks_total", "counter",
+                 "Credential checks by outcome (cache, JotaDB, shared request, stale, refused)");
+        for (size_t i = 0; i < static_cast<size_t>(AuthOutcome::COUNT); i++) {
+            auto outcome = static_cast<AuthOutcome>(i);
+            w.sample("inference_core_auth_checks_total", clientAuth_->getOutcomeCount(outcome),
+                     {{"outcome", authOutcomeName(outcome)}});
+        }
+    }
+
+    // Per-priority and per-client breakdowns are separate families so sums don't double count
+    w.family("inference_core_latency_seconds", "histogram",
+             "Request latency by phase and client priority, measured from enqueue");
+    for (const auto& [priority, phases] : latency.byPriority) {
+        for (size_t i = 0; i < phases.size(); i++) {
+            w.histogram("inference_core_latency_seconds", phases[i],
+                        {{"phase", Core::latencyPhaseName(static_cast<Core::LatencyPhase>(i))},
+                         {"priority", priority}});
+        }
+    }
+    w.family("inference_core_client_latency_seconds", "histogram",
+             "Request latency by phase and client, measured from enqueue");
+    for (const auto& [client_id, phases] : latency.byClient) {
+        for (size_t i = 0; i < phases.size(); i++) {
+            w.histogram("inference_core_client_latency_seconds", phases[i],
+                        {{"phase", Core::latencyPhaseName(static_cast<Core::LatencyPhase>(i))},
+                         {"client", client_id}});
+        }
+    }
+
+    return w.take();
+}
+
+void MetricsService::dumpTrace() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    std::string path = traceDumpDir_ + "/trace-" +
+                       std::to_string(std::chrono::duration_cast<std::chrono::seconds>(now).count()) + ".json";
+    if (Core::Tracer::instance().writeChromeJson(path)) {
+        LOG_INFO("MetricsService: Trace written to " << path);
+    } else {
+        LOG_ERROR("MetricsService: Could not write trace to " << path);
+    }
 }
 
 } // namespace Server
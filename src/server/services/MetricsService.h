@@ -4,10 +4,19 @@
 #include "../../core/SessionManager.h"
 #include "../../core/Metrics.h"
 #include "InferenceService.h"
+#include "../ClientAuth.h"
 #include <App.h> // uWebSockets
+#include <nlohmann/json.hpp>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
-#include <atomic>
+#include <utility>
+#include <vector>
 
 namespace Server {
 
@@ -16,15 +25,18 @@ class MetricsHandler;
 /**
  * MetricsService - Periodic metrics broadcasting
  * 
- * Extracts metrics thread and broadcasting logic from WsServer.
- * Collects metrics from Monitor and InferenceService and invokes callback.
+ * A collector thread gathers metrics from Monitor and InferenceService every
+ * second, renders one frame per MetricsHandler topic and refreshes the Prometheus
+ * snapshot; it also writes the trace dumps requested with SIGUSR2 (see
+ * Core::Tracer::requestDump). A uSockets timer on the first event loop only
+ * publishes the rendered frames (uWS pub/sub) on every loop's app, so NVML and
+ * /proc reads never stall the loop. Handlers can hand other slow renders to the
+ * collector with post().
  */
 class MetricsService {
 public:
-    // Broadcast callback: sends metrics JSON to all subscribers
-    // Called from metrics thread - caller must handle thread-safety (uWS::Loop::defer)
-    using BroadcastCallback = std::function<void(const std::string& metricsJson)>;
-    
+    static constexpr int TICK_MS = 1000;
+
     /**
      * Constructor
      * @param monitor Reference to hardware monitor
@@ -38,23 +50,43 @@ public:
     );
     
     /**
-     * Destructor - automatically shuts down metrics thread
+     * Destructor - stops the timer and collector (must run on the event loop thread)
      */
     ~MetricsService();
     
     /**
-     * Start metrics broadcasting
+     * Start the collector thread and the metrics timer (call on the event loop
+     * thread, after setEventLoop)
      */
     void start();
     
     /**
-     * Gracefully shutdown the metrics service
+     * Stop the metrics timer and join the collector (call on the event loop thread;
+     * the loop only exits once the timer is closed)
      */
     void shutdown();
 
     // Setters for dependencies
     void setMetricsHandler(MetricsHandler* handler);
     void setEventLoop(uWS::Loop* loop);
+    // Apps that topic frames are published on; loop is the one running app.
+    // Thread-safe; removeApp must be called on that loop before app goes away.
+    void addApp(uWS::Loop* loop, uWS::App* app);
+    void removeApp(uWS::App* app);
+    void setTraceDumpDir(const std::string& dir);
+    void setClientAuth(const ClientAuth* auth);  // JotaDB round trips
+
+    /**
+     * Latest Prometheus text exposition, rebuilt by the collector every second
+     * (empty until the first tick). Thread-safe and cheap: returns a shared snapshot.
+     */
+    std::shared_ptr<const std::string> getPrometheusText() const;
+
+    /**
+     * Run job on the collector thread, ahead of the next collect(). Thread-safe.
+     * @return false (job dropped) if the collector is not running
+     */
+    bool post(std::function<void()> job);
     
 private:
     Hardware::Monitor& monitor_;
@@ -63,15 +95,46 @@ private:
     
     MetricsHandler* metricsHandler_ = nullptr;
     uWS::Loop* loop_ = nullptr;
+    std::vector<std::pair<uWS::Loop*, uWS::App*>> apps_;
+    std::mutex appsMutex_;
+    const ClientAuth* clientAuth_ = nullptr;
     
-    std::thread metricsThread_;
-    std::atomic<bool> running_{true};
+    struct us_timer_t* timer_ = nullptr;
+    uint64_t ticks_ = 0;  // Collector thread only
+    std::string traceDumpDir_ = ".";
+
+    std::thread collector_;
+    bool collecting_ = false;
+    std::mutex collectorMutex_;
+    std::condition_variable collectorCv_;
+    std::deque<std::function<void()>> jobs_;  // Guarded by collectorMutex_
+
+    std::shared_ptr<const std::string> prometheusText_ = std::make_shared<const std::string>();
+    mutable std::mutex prometheusMutex_;
+
+    // Rendered frames not published yet, by topic (a newer frame replaces an older one)
+    std::map<std::string, std::string> pendingFrames_;
+    std::mutex framesMutex_;
     
-    // Main metrics loop (runs in separate thread)
-    void metricsLoop();
+    // Collector thread: posted jobs as they come, collect() every TICK_MS until shutdown
+    void collectLoop();
+
+    // Collect once, render the topic frames and the Prometheus exposition (collector thread)
+    void collect();
+
+    // Timer callback (event loop thread): publish the pending frames
+    void tick();
+
+    // Write the retained trace spans to <traceDumpDir_>/trace-<unix time>.json
+    void dumpTrace();
     
-    // Build metrics JSON string
-    std::string buildMetricsJson();
+    // Build the full metrics frame
+    nlohmann::json buildMetricsJson(const Hardware::GpuStats& gpuStats, const Hardware::CpuStats& cpuStats,
+                                    const Core::LatencyRecorder::Report& latency);
+
+    // Build the Prometheus text exposition
+    std::string buildPrometheusText(const Hardware::GpuStats& gpuStats, const Hardware::CpuStats& cpuStats,
+                                    const Core::LatencyRecorder::Report& latency);
 };
 
 } // namespace Server
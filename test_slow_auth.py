@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+"""
+Checks that a slow JotaDB answer does not stall the event loop.
+
+Starts a local JotaDB stand-in whose /auth/internal takes SLOW_AUTH_S for
+"slow_client", and the server with the mock backend (no model needed). One
+client streams tokens while another connects as slow_client; the stream must
+keep flowing while that handshake waits on JotaDB.
+
+    python3 test_slow_auth.py [path/to/InferenceCore]
+"""
+import asyncio
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+import websockets
+
+SERVER_BIN = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else "./build/InferenceCore")
+PORT = 8002
+JOTA_PORT = 8092
+URI = f"ws://localhost:{PORT}"
+SLOW_AUTH_S = 3.0
+MAX_GAP_S = 0.5  # Tokens come every 20 ms; a blocked loop shows up as a multi-second gap
+
+# websockets 14 renamed extra_headers
+HEADERS_ARG = "additional_headers" if int(websockets.__version__.split(".")[0]) >= 14 else "extra_headers"
+
+
+class JotaDBStandIn(BaseHTTPRequestHandler):
+    def do_GET(self):
+        if self.path.endswith("/health"):
+            self.reply({"status": "ok"})
+            return
+        if self.headers.get("X-Client-ID") == "slow_client":
+            time.sleep(SLOW_AUTH_S)
+        self.reply({"authorized": True, "config": {"max_sessions": 2, "priority": "normal"}})
+
+    def reply(self, body):
+        data = json.dumps(body).encode()
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+    def log_message(self, *args):
+        pass
+
+
+def connect(client_id):
+    headers = {"X-Client-ID": client_id, "X-API-Key": "sk_test"}
+    return websockets.connect(URI, **{HEADERS_ARG: headers})
+
+
+async def wait_until_listening(timeout=10):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        try:
+            reader, writer = await asyncio.open_connection("localhost", PORT)
+            writer.close()
+            return True
+        except OSError:
+            await asyncio.sleep(0.2)
+    return False
+
+
+async def stream(token_times, done):
+    async with connect("fast_client") as ws:
+        assert json.loads(await ws.recv())["op"] == "auth_success"
+
+        await ws.send(json.dumps({"op": "create_session"}))
+        session = json.loads(await ws.recv())
+        assert session["op"] == "session_created", session
+
+        await ws.send(json.dumps({
+            "op": "infer",
+            "session_id": session["session_id"],
+            "prompt": "Keep talking",
+            "params": {"max_tokens": 300}
+        }))
+        while True:
+            msg = json.loads(await ws.recv())
+            if msg["op"] == "token":
+                token_times.append(time.monotonic())
+            elif msg["op"] in ("end", "error"):
+                break
+    done.set()
+
+
+async def slow_handshake():
+    start = time.monotonic()
+    async with connect("slow_client") as ws:
+        assert json.loads(await ws.recv())["op"] == "auth_success"
+        return start, time.monotonic()
+
+
+async def run():
+    token_times = []
+    done = asyncio.Event()
+    streamer = asyncio.create_task(stream(token_times, done))
+
+    # Let the stream get going, then hold a handshake on JotaDB
+    while len(token_times) < 10:
+        await asyncio.sleep(0.05)
+    auth_start, auth_end = await slow_handshake()
+    await done.wait()
+    await streamer
+
+    during = [t for t in token_times if auth_start <= t <= auth_end]
+    gaps = [b - a for a, b in zip(token_times, token_times[1:]) if auth_start <= b <= auth_end + MAX_GAP_S]
+    max_gap = max(gaps) if gaps else float("inf")
+
+    print(f"slow handshake took {auth_end - auth_start:.2f} s")
+    print(f"tokens streamed meanwhile: {len(during)}, largest gap {max_gap * 1000:.0f} ms")
+
+    assert auth_end - auth_start >= SLOW_AUTH_S * 0.9, "handshake did not wait on the stand-in"
+    assert len(during) > SLOW_AUTH_S * 50 * 0.5, "stream stalled during the handshake"
+    assert max_gap < MAX_GAP_S, f"event loop blocked for {max_gap:.2f} s"
+
+
+def main():
+    if not os.path.exists(SERVER_BIN):
+        print(f"❌ Server binary not found at {SERVER_BIN}")
+        sys.exit(1)
+
+    jota = ThreadingHTTPServer(("localhost", JOTA_PORT), JotaDBStandIn)
+    threading.Thread(target=jota.serve_forever, daemon=True).start()
+
+    env = os.environ.copy()
+    env.update({
+        "JOTA_DB_URL": f"http://localhost:{JOTA_PORT}",
+        "JOTA_DB_USR": "test",
+        "JOTA_DB_SK": "test_sk",
+        "RESPONSE_CACHE_ENTRIES": "0",
+    })
+    # Empty working directory: a developer .env must not point us at the real JotaDB
+    workdir = tempfile.mkdtemp()
+    server = subprocess.Popen(
+        [SERVER_BIN, "--mock", "--mock-decode-tps", "50", "--mock-jitter", "0", "--port", str(PORT)],
+        cwd=workdir, env=env, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+    try:
+        if not asyncio.run(wait_until_listening()):
+            print("❌ Server did not start")
+            sys.exit(1)
+        asyncio.run(run())
+        print("✅ Event loop kept streaming during a slow authentication")
+    except AssertionError as e:
+        print(f"❌ {e}")
+        sys.exit(1)
+    finally:
+        server.terminate()
+        try:
+            server.wait(timeout=5)
+        except subprocess.TimeoutExpired:
+            server.kill()
+        jota.shutdown()
+
+
+if __name__ == "__main__":
+    main()
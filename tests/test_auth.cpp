@@ -4,6 +4,9 @@
 #include <thread>
 #include <atomic>
 #include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 using namespace Server;
 
@@ -11,9 +14,22 @@ using namespace Server;
 class MockJotaDB {
 public:
     MockJotaDB(int port) : svr_(), port_(port), running_(false) {
-        svr_.Get("/auth/internal", [](const httplib::Request& req, httplib::Response& res) {
-            std::string client_id = req.get_param_value("client_id");
-            std::string api_key = req.get_param_value("api_key");
+        svr_.Get("/auth/internal", [this](const httplib::Request& req, httplib::Response& res) {
+            std::string client_id = req.get_header_value("X-Client-ID");
+            std::string api_key = req.get_header_value("X-API-Key");
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                remotePorts_.push_back(req.remote_port);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs_.load()));
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (replyStatus_ != 0) {
+                    res.status = replyStatus_;
+                    res.set_content(replyBody_, "application/json");
+                    return;
+                }
+            }
             
             // Check Authorization Header
             if (req.has_header("Authorization")) {
@@ -28,7 +44,7 @@ public:
             }
 
             json response;
-            if (client_id == "valid_user" && api_key == "secret123") {
+            if ((client_id == "valid_user" || client_id == "other_user") && api_key == "secret123") {
                 response["authorized"] = true;
                 response["config"] = {
                     {"max_sessions", 5},
@@ -66,11 +82,32 @@ public:
         stop();
     }
 
+    // Answer every request this late
+    void setDelay(int ms) { delayMs_ = ms; }
+
+    // Answer every request with this status and body (0 = answer normally)
+    void setReply(int status, const std::string& body = "") {
+        std::lock_guard<std::mutex> lock(mutex_);
+        replyStatus_ = status;
+        replyBody_ = body;
+    }
+
+    // Client port of every request (equal ports = same connection)
+    std::vector<int> remotePorts() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return remotePorts_;
+    }
+
 private:
     httplib::Server svr_;
     int port_;
     std::atomic<bool> running_;
     std::thread thread_;
+    std::mutex mutex_;
+    std::vector<int> remotePorts_;
+    std::atomic<int> delayMs_{0};
+    int replyStatus_ = 0;
+    std::string replyBody_;
 };
 
 TEST_CASE("ClientAuth: JotaDB Integration", "[auth]") {
@@ -111,3 +148,147 @@ TEST_CASE("ClientAuth: JotaDB Integration", "[auth]") {
         REQUIRE(auth.authenticate("valid_user", "secret123") == true);
     }
 }
+
+TEST_CASE("ClientAuth: JotaDB connection pool", "[auth]") {
+    int port = 8093;
+    auto mockDb = std::make_unique<MockJotaDB>(port);
+    mockDb->start();
+
+    std::string url = "http://localhost:" + std::to_string(port);
+    setenv("JOTA_DB_URL", url.c_str(), 1);
+
+    ClientAuth auth;
+
+    SECTION("Validations reuse one keep-alive connection") {
+        REQUIRE(auth.authenticate("valid_user", "secret123"));
+        REQUIRE(auth.authenticate("other_user", "secret123"));
+        REQUIRE(auth.authenticate("unknown_user", "secret123") == false);
+
+        auto ports = mockDb->remotePorts();
+        REQUIRE(ports.size() == 3);
+        REQUIRE(ports[1] == ports[0]);
+        REQUIRE(ports[2] == ports[0]);
+        REQUIRE(auth.getRttSnapshot().total == 3);
+        REQUIRE(auth.getRequestErrors() == 0);
+    }
+
+    SECTION("A dead pooled connection is replaced transparently") {
+        REQUIRE(auth.authenticate("valid_user", "secret123"));
+
+        // JotaDB restarts: the pooled connection is closed under us
+        mockDb.reset();
+        mockDb = std::make_unique<MockJotaDB>(port);
+        mockDb->start();
+
+        REQUIRE(auth.authenticate("other_user", "secret123"));
+        REQUIRE(mockDb->remotePorts().size() == 1);
+    }
+
+    SECTION("JotaDB down: denied, counted as an error") {
+        mockDb.reset();
+        REQUIRE(auth.authenticate("valid_user", "secret123") == false);
+        REQUIRE(auth.getRequestErrors() >= 1);
+    }
+}
+
+// Cache lifetimes short enough to cross in a test
+static AuthCacheConfig testCacheConfig() {
+    AuthCacheConfig config;
+    config.ttl = std::chrono::milliseconds(400);
+    config.refresh_ahead = std::chrono::milliseconds(0);
+    config.negative_ttl = std::chrono::milliseconds(200);
+    config.stale = std::chrono::milliseconds(600);
+    return config;
+}
+
+TEST_CASE("ClientAuth: Cache policies", "[auth]") {
+    int port = 8094;
+    auto mockDb = std::make_unique<MockJotaDB>(port);
+    mockDb->start();
+
+    std::string url = "http://localhost:" + std::to_string(port);
+    setenv("JOTA_DB_URL", url.c_str(), 1);
+
+    AuthCacheConfig config = testCacheConfig();
+
+    SECTION("Concurrent checks of the same credentials share one request") {
+        ClientAuth auth(config);
+        mockDb->setDelay(300);
+
+        std::vector<std::thread> threads;
+        std::atomic<int> authorized{0};
+        for (int i = 0; i < 8; i++) {
+            threads.emplace_back([&]() {
+                if (auth.authenticate("valid_user", "secret123")) authorized++;
+            });
+        }
+        for (auto& t : threads) t.join();
+
+        REQUIRE(authorized == 8);
+        REQUIRE(mockDb->remotePorts().size() == 1);
+        REQUIRE(auth.getOutcomeCount(AuthOutcome::VALIDATED) == 1);
+        REQUIRE(auth.getOutcomeCount(AuthOutcome::JOINED) == 7);
+    }
+
+    SECTION("Refused credentials are remembered for negative_ttl") {
+        ClientAuth auth(config);
+        REQUIRE(auth.check("valid_user", "wrong") == AuthOutcome::REJECTED);
+        REQUIRE(auth.check("valid_user", "wrong") == AuthOutcome::NEGATIVE_HIT);
+        REQUIRE(mockDb->remotePorts().size() == 1);
+
+        // The right key is not affected
+        REQUIRE(auth.check("valid_user", "secret123") == AuthOutcome::VALIDATED);
+
+        std::this_thread::sleep_for(config.negative_ttl + std::chrono::milliseconds(50));
+        REQUIRE(auth.check("valid_user", "wrong") == AuthOutcome::REJECTED);
+        REQUIRE(mockDb->remotePorts().size() == 3);
+    }
+
+    SECTION("Entries close to expiry are refreshed in the background") {
+        config.refresh_ahead = std::chrono::milliseconds(300);
+        ClientAuth auth(config);
+        REQUIRE(auth.check("valid_user", "secret123") == AuthOutcome::VALIDATED);
+
+        // Inside the refresh window: answered from cache, JotaDB asked behind the scenes
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        REQUIRE(auth.check("valid_user", "secret123") == AuthOutcome::CACHE_HIT);
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        REQUIRE(mockDb->remotePorts().size() == 2);
+
+        // Past the original expiry, still a hit thanks to the refresh
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        REQUIRE(auth.check("valid_user", "secret123") == AuthOutcome::CACHE_HIT);
+    }
+
+    SECTION("Expired entries are served while JotaDB is down, within the stale window") {
+        ClientAuth auth(config);
+        REQUIRE(auth.check("valid_user", "secret123") == AuthOutcome::VALIDATED);
+        mockDb.reset();
+
+        std::this_thread::sleep_for(config.ttl + std::chrono::milliseconds(50));
+        REQUIRE(auth.check("valid_user", "secret123") == AuthOutcome::STALE);
+        REQUIRE(auth.check("other_user", "secret123") == AuthOutcome::UNAVAILABLE);
+
+        std::this_thread::sleep_for(config.stale);
+        REQUIRE(auth.check("valid_user", "secret123") == AuthOutcome::UNAVAILABLE);
+    }
+
+    SECTION("Error statuses without a verdict do not evict or refuse credentials") {
+        ClientAuth auth(config);
+        REQUIRE(auth.check("valid_user", "secret123") == AuthOutcome::VALIDATED);
+        std::this_thread::sleep_for(config.ttl + std::chrono::milliseconds(50));
+
+        // Throttled, timed out, or this server's JOTA_DB_SK refused: the entry stays usable
+        for (int status : {429, 408, 401, 403}) {
+            mockDb->setReply(status, R"({"error": "nope"})");
+            REQUIRE(auth.check("valid_user", "secret123") == AuthOutcome::STALE);
+        }
+        REQUIRE(auth.check("other_user", "secret123") == AuthOutcome::UNAVAILABLE);
+        REQUIRE(auth.check("other_user", "secret123") == AuthOutcome::UNAVAILABLE);
+
+        // An explicit refusal still counts, whatever the status
+        mockDb->setReply(403, R"({"authorized": false, "error": "Invalid credentials"})");
+        REQUIRE(auth.check("valid_user", "secret123") == AuthOutcome::REJECTED);
+        REQUIRE(auth.check("valid_user", "secret123") == AuthOutcome::NEGATIVE_HIT);
+    }
+}
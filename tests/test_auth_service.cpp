@@ -0,0 +1,138 @@
+#include "catch_amalgamated.hpp"
+#include "../src/server/services/AuthService.h"
+#include <httplib.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <future>
+
+using namespace Server;
+using Clock = std::chrono::steady_clock;
+
+// JotaDB stand-in: "slow_user" takes a while to validate, everyone else is instant
+class SlowJotaDB {
+public:
+    SlowJotaDB(int port, std::chrono::milliseconds delay) : port_(port) {
+        svr_.Get("/auth/internal", [delay](const httplib::Request& req, httplib::Response& res) {
+            std::string client_id = req.get_header_value("X-Client-ID");
+            std::string api_key = req.get_header_value("X-API-Key");
+            if (client_id == "slow_user") {
+                std::this_thread::sleep_for(delay);
+            }
+
+            json response;
+            if (api_key == "secret") {
+                response["authorized"] = true;
+                response["config"] = {{"max_sessions", 2}, {"priority", "high"}};
+            } else {
+                response["authorized"] = false;
+                response["error"] = "Invalid credentials";
+            }
+            res.set_content(response.dump(), "application/json");
+        });
+        thread_ = std::thread([this]() { svr_.listen("localhost", port_); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    ~SlowJotaDB() {
+        svr_.stop();
+        if (thread_.joinable()) thread_.join();
+    }
+
+private:
+    httplib::Server svr_;
+    int port_;
+    std::thread thread_;
+};
+
+struct Outcome {
+    bool authorized = false;
+    ClientConfig config;
+    Clock::time_point at;
+};
+
+static std::future<Outcome> check(AuthService& service, const std::string& client_id, const std::string& api_key) {
+    auto promise = std::make_shared<std::promise<Outcome>>();
+    service.enqueueTask({client_id, api_key, [promise](bool authorized, const ClientConfig& config) {
+        promise->set_value(Outcome{authorized, config, Clock::now()});
+    }, nullptr});
+    return promise->get_future();
+}
+
+TEST_CASE("AuthService: Checks run off the caller's thread", "[auth]") {
+    int port = 8091;
+    SlowJotaDB jotaDb(port, std::chrono::milliseconds(800));
+    std::string url = "http://localhost:" + std::to_string(port);
+    setenv("JOTA_DB_URL", url.c_str(), 1);
+
+    ClientAuth auth;
+    AuthService service(auth, 2);
+
+    SECTION("Enqueue returns before a slow check completes") {
+        auto start = Clock::now();
+        auto slow = check(service, "slow_user", "secret");
+        REQUIRE(Clock::now() - start < std::chrono::milliseconds(100));
+
+        Outcome outcome = slow.get();
+        REQUIRE(outcome.authorized);
+        REQUIRE(outcome.config.max_sessions == 2);
+        REQUIRE(outcome.config.priority == "high");
+        REQUIRE(outcome.at - start >= std::chrono::milliseconds(800));
+    }
+
+    SECTION("A slow check does not hold up the others") {
+        auto slow = check(service, "slow_user", "secret");
+        auto fast = check(service, "fast_user", "secret");
+
+        Outcome fastOutcome = fast.get();
+        Outcome slowOutcome = slow.get();
+        REQUIRE(fastOutcome.authorized);
+        REQUIRE(fastOutcome.at < slowOutcome.at);
+    }
+
+    SECTION("Checks of clients that left are skipped") {
+        // Both workers busy, so the next checks wait in the queue
+        auto slow1 = check(service, "slow_user", "secret");
+        auto slow2 = check(service, "slow_user", "other");
+
+        auto aborted = std::make_shared<std::atomic<bool>>(false);
+        std::atomic<bool> called{false};
+        REQUIRE(service.enqueueTask({"fast_user", "secret",
+                                     [&called](bool, const ClientConfig&) { called = true; }, aborted}));
+        aborted->store(true);
+        auto after = check(service, "fast_user", "secret");
+
+        REQUIRE(after.get().authorized);
+        REQUIRE_FALSE(called);
+        REQUIRE(service.getSkippedChecks() == 1);
+        slow1.get();
+        slow2.get();
+    }
+
+    SECTION("Rejected credentials") {
+        Outcome outcome = check(service, "fast_user", "wrong").get();
+        REQUIRE_FALSE(outcome.authorized);
+        REQUIRE(service.getTotalChecks() == 1);
+    }
+}
+
+TEST_CASE("AuthService: The queue is bounded", "[auth]") {
+    int port = 8092;
+    SlowJotaDB jotaDb(port, std::chrono::milliseconds(500));
+    std::string url = "http://localhost:" + std::to_string(port);
+    setenv("JOTA_DB_URL", url.c_str(), 1);
+
+    ClientAuth auth;
+    AuthService service(auth, 1, 1);
+
+    // The worker takes the first check, the second one waits, the third is refused
+    auto first = check(service, "slow_user", "secret");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto second = check(service, "slow_user", "other");
+    REQUIRE(service.getPendingCount() == 1);
+    REQUIRE_FALSE(service.enqueueTask({"fast_user", "secret", [](bool, const ClientConfig&) {}, nullptr}));
+
+    REQUIRE(first.get().authorized);
+    REQUIRE_FALSE(second.get().authorized);
+    REQUIRE(service.enqueueTask({"fast_user", "secret", [](bool, const ClientConfig&) {}, nullptr}));
+}
@@ -0,0 +1,105 @@
+#include "catch_amalgamated.hpp"
+#include "../src/hardware/CpuMonitor.h"
+#include <unistd.h>
+#include <fstream>
+#include <filesystem>
+
+using namespace Hardware;
+namespace fs = std::filesystem;
+
+TEST_CASE("CpuMonitor: /proc/stat", "[cpu]") {
+    std::string stat =
+        "cpu  100 0 50 800 50 0 0 0 0 0\n"
+        "cpu0 60 0 20 400 20 0 0 0 0 0\n"
+        "cpu1 40 0 30 400 30 0 0 0 0 0\n"
+        "intr 12345 0 0\n"
+        "ctxt 999\n";
+
+    auto times = CpuMonitor::parseProcStat(stat);
+    REQUIRE(times.size() == 3);
+    REQUIRE(times[0].user == 100);
+    REQUIRE(times[0].idleTotal() == 850);
+    REQUIRE(times[2].total() == 500);
+
+    SECTION("Utilization from deltas") {
+        CpuTimes prev = times[1];
+        CpuTimes cur = prev;
+        cur.user += 75;
+        cur.idle += 25;
+        REQUIRE(CpuMonitor::utilization(prev, cur) == Catch::Approx(75.0));
+        REQUIRE(CpuMonitor::utilization(prev, prev) == 0.0);
+        REQUIRE(CpuMonitor::utilization(cur, prev) == 0.0);  // Counter reset
+    }
+}
+
+TEST_CASE("CpuMonitor: kB fields and PSI", "[cpu]") {
+    std::string meminfo =
+        "MemTotal:       16318504 kB\n"
+        "MemFree:         1032868 kB\n"
+        "MemAvailable:    9821964 kB\n";
+    REQUIRE(CpuMonitor::parseKbField(meminfo, "MemTotal") == 16318504ull * 1024);
+    REQUIRE(CpuMonitor::parseKbField(meminfo, "MemAvailable") == 9821964ull * 1024);
+    REQUIRE(CpuMonitor::parseKbField(meminfo, "Mem") == 0);  // Whole key only
+    REQUIRE(CpuMonitor::parseKbField(meminfo, "SwapTotal") == 0);
+
+    REQUIRE(CpuMonitor::parseKbField("Name:\tInferenceCore\nVmRSS:\t  204800 kB\n", "VmRSS") == 204800ull * 1024);
+
+    auto psi = CpuMonitor::parsePsi(
+        "some avg10=12.50 avg60=3.25 avg300=1.00 total=123456\n"
+        "full avg10=4.00 avg60=0.75 avg300=0.10 total=2345\n");
+    REQUIRE(psi.some_avg10 == Catch::Approx(12.5));
+    REQUIRE(psi.some_avg60 == Catch::Approx(3.25));
+    REQUIRE(psi.full_avg10 == Catch::Approx(4.0));
+    REQUIRE(psi.full_avg60 == Catch::Approx(0.75));
+
+    // /proc/pressure/cpu has no "full" line on older kernels
+    auto cpuOnly = CpuMonitor::parsePsi("some avg10=1.00 avg60=0.50 avg300=0.00 total=1\n");
+    REQUIRE(cpuOnly.full_avg10 == 0.0);
+}
+
+TEST_CASE("CpuMonitor: Package temperature", "[cpu]") {
+    REQUIRE(CpuMonitor::packageTemperature({}) == -1.0);
+    REQUIRE(CpuMonitor::packageTemperature({{"acpitz", 45000}, {"x86_pkg_temp", 61000}}) == Catch::Approx(61.0));
+    REQUIRE(CpuMonitor::packageTemperature({{"acpitz", 45000}, {"cpu-thermal", 52500}}) == Catch::Approx(52.5));
+    REQUIRE(CpuMonitor::packageTemperature({{"iwlwifi_1", 40000}}) == -1.0);
+}
+
+TEST_CASE("CpuMonitor: Update from a fake procfs", "[cpu]") {
+    fs::path root = fs::temp_directory_path() / ("cpu_monitor_test_" + std::to_string(::getpid()));
+    fs::create_directories(root / "proc/self");
+    fs::create_directories(root / "proc/pressure");
+    fs::create_directories(root / "sys/class/thermal/thermal_zone0");
+
+    auto write = [&](const fs::path& path, const std::string& text) { std::ofstream(root / path) << text; };
+    write("proc/stat", "cpu  100 0 0 900 0 0 0 0\ncpu0 100 0 0 900 0 0 0 0\n");
+    write("proc/self/status", "VmRSS:\t1024 kB\n");
+    write("proc/meminfo", "MemTotal: 2048 kB\nMemAvailable: 1024 kB\n");
+    write("proc/pressure/memory", "some avg10=5.00 avg60=1.00 avg300=0.00 total=1\nfull avg10=1.00 avg60=0.00 avg300=0.00 total=1\n");
+    write("sys/class/thermal/thermal_zone0/type", "x86_pkg_temp\n");
+    write("sys/class/thermal/thermal_zone0/temp", "95000\n");
+
+    CpuMonitor monitor((root / "proc").string(), (root / "sys").string());
+    auto first = monitor.update();
+    REQUIRE(first.available);
+    REQUIRE(first.utilization == 0.0);  // No interval yet
+    REQUIRE(first.coreUtilization.size() == 1);
+    REQUIRE(first.processRss == 1024 * 1024);
+    REQUIRE(first.memoryAvailable == 1024 * 1024);
+    REQUIRE(first.memoryPressure.some_avg10 == Catch::Approx(5.0));
+    REQUIRE(first.cpuPressure.some_avg10 == 0.0);  // File missing
+    REQUIRE(first.packageTemp == Catch::Approx(95.0));
+    REQUIRE(first.throttle);
+    REQUIRE(monitor.isThrottling());
+
+    write("proc/stat", "cpu  150 0 0 950 0 0 0 0\ncpu0 150 0 0 950 0 0 0 0\n");
+    write("sys/class/thermal/thermal_zone0/temp", "70000\n");
+    auto second = monitor.update();
+    REQUIRE(second.utilization == Catch::Approx(50.0));
+    REQUIRE(second.coreUtilization[0] == Catch::Approx(50.0));
+    REQUIRE_FALSE(second.throttle);
+
+    fs::remove_all(root);
+
+    CpuMonitor missing("/nonexistent/proc", "/nonexistent/sys");
+    REQUIRE_FALSE(missing.update().available);
+}
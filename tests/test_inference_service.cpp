@@ -0,0 +1,312 @@
+#include "catch_amalgamated.hpp"
+#include "../src/server/services/InferenceService.h"
+#include "../src/server/ClientAuth.h"
+#include "../src/server/TokenVerifier.h"
+#include "../src/core/MockBackend.h"
+#include "../src/core/SessionManager.h"
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+using namespace Server;
+
+static Core::MockBackend::Config slowConfig() {
+    Core::MockBackend::Config config;
+    config.prefill_tps = 1e6;
+    config.decode_tps = 100.0;
+    config.jitter = 0.0;
+    config.reply_tokens = 40;
+    return config;
+}
+
+// Signed token for client_id, so sessions can be created without JotaDB
+static std::string clientToken(const std::string& client_id, const std::string& secret) {
+    json payload = {{"client_id", client_id}, {"max_sessions", 4}, {"exp", std::time(nullptr) + 600}};
+    std::string signed_part = TokenVerifier::base64UrlEncode(json{{"alg", "HS256"}}.dump()) + "." +
+                              TokenVerifier::base64UrlEncode(payload.dump());
+    unsigned char mac[EVP_MAX_MD_SIZE];
+    unsigned int mac_len = 0;
+    HMAC(EVP_sha256(), secret.data(), static_cast<int>(secret.size()),
+         reinterpret_cast<const unsigned char*>(signed_part.data()), signed_part.size(), mac, &mac_len);
+    return signed_part + "." + TokenVerifier::base64UrlEncode(std::string(reinterpret_cast<char*>(mac), mac_len));
+}
+
+// What one request saw through its callbacks
+struct Stream {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::string text;
+    size_t tokens = 0;
+    bool done = false;
+    std::string error;
+    Core::Metrics metrics;
+
+    template <typename Pred>
+    bool waitFor(Pred pred) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, std::chrono::seconds(5), [&] { return pred(*this); });
+    }
+};
+
+static InferenceService::Task makeTask(const std::string& session_id, const std::string& client_id,
+                                       const std::string& prompt, Stream& stream) {
+    InferenceService::Task task;
+    task.session_id = session_id;
+    task.client_id = client_id;
+    task.params.prompt = prompt;
+    task.onToken = [&stream](const std::string&, const std::string& token, const Core::TokenLogprobs*) {
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        stream.text += token;
+        stream.tokens++;
+        stream.cv.notify_all();
+    };
+    task.onComplete = [&stream](const std::string&, const Core::Metrics& metrics) {
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        stream.metrics = metrics;
+        stream.done = true;
+        stream.cv.notify_all();
+    };
+    task.onError = [&stream](const std::string&, const std::string& error) {
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        stream.error = error;
+        stream.done = true;
+        stream.cv.notify_all();
+    };
+    return task;
+}
+
+TEST_CASE("InferenceService: Coalesced requests", "[inference]") {
+    Core::MockBackend backend(slowConfig());
+    ClientAuth auth;
+    auth.getTokenVerifier().setHmacSecret("test-secret");
+    REQUIRE(auth.authenticate("alice", clientToken("alice", "test-secret")));
+    REQUIRE(auth.authenticate("bob", clientToken("bob", "test-secret")));
+    REQUIRE(auth.authenticate("carol", clientToken("carol", "test-secret")));
+
+    Core::SessionManager sessions(backend, 512);
+    sessions.setClientAuth(&auth);
+    Stream leader, follower, other;  // Outlive the service's workers
+    InferenceService service(&sessions, 2);
+
+    const std::string prompt = "tell me something deterministic";
+    std::string expected;
+    {
+        auto session = backend.createSession("reference", "alice", 512, nullptr);
+        session->generate(prompt, Core::GenerationParams{}, [&](const std::string& token, const Core::TokenLogprobs*) {
+            expected += token;
+            return true;
+        });
+    }
+
+    std::string leaderSession = sessions.createSession("alice");
+    std::string followerSession = sessions.createSession("bob");
+
+    service.enqueueTask(makeTask(leaderSession, "alice", prompt, leader));
+    REQUIRE(leader.waitFor([](Stream& s) { return s.tokens >= 5; }));
+    service.enqueueTask(makeTask(followerSession, "bob", prompt, follower));
+    REQUIRE(follower.waitFor([](Stream& s) { return s.tokens >= 5; }));
+    REQUIRE(service.getCoalescedCount() == 1);
+
+    SECTION("Aborting the leader does not end the other client's request") {
+        REQUIRE(service.abortTask(leaderSession));
+        REQUIRE(leader.waitFor([](Stream& s) { return s.done; }));
+        REQUIRE_FALSE(leader.metrics.completed);
+
+        // The follower carries on by itself, without repeating what it already got
+        REQUIRE(follower.waitFor([](Stream& s) { return s.done; }));
+        REQUIRE(follower.error.empty());
+        REQUIRE(follower.metrics.completed);
+        REQUIRE(follower.text == expected);
+    }
+
+    SECTION("Followers re-queued after the leader aborts are counted once") {
+        std::string otherSession = sessions.createSession("carol");
+        service.enqueueTask(makeTask(otherSession, "carol", prompt, other));
+        REQUIRE(other.waitFor([](Stream& s) { return s.tokens >= 5; }));
+        REQUIRE(service.getCoalescedCount() == 2);
+
+        // One of them leads the new flight and the other joins it
+        REQUIRE(service.abortTask(leaderSession));
+        REQUIRE(follower.waitFor([](Stream& s) { return s.done; }));
+        REQUIRE(other.waitFor([](Stream& s) { return s.done; }));
+        REQUIRE(follower.text == expected);
+        REQUIRE(other.text == expected);
+        REQUIRE(service.getCoalescedCount() == 2);
+    }
+
+    SECTION("Aborting a follower only detaches it") {
+        REQUIRE(service.abortTask(followerSession));
+        REQUIRE(follower.waitFor([](Stream& s) { return s.done; }));
+        REQUIRE(follower.metrics.coalesced);
+        REQUIRE_FALSE(follower.metrics.completed);
+        size_t detachedAt = follower.tokens;
+
+        REQUIRE(leader.waitFor([](Stream& s) { return s.done; }));
+        REQUIRE(leader.metrics.completed);
+        REQUIRE(leader.text == expected);
+        REQUIRE(follower.tokens == detachedAt);
+    }
+
+    service.shutdown();
+}
+
+TEST_CASE("InferenceService: Throttled generations release their worker", "[inference][ratelimit]") {
+    Core::MockBackend backend(slowConfig());
+    ClientAuth auth;
+    auth.getTokenVerifier().setHmacSecret("test-secret");
+    REQUIRE(auth.authenticate("alice", clientToken("alice", "test-secret")));
+    REQUIRE(auth.authenticate("bob", clientToken("bob", "test-secret")));
+
+    Core::SessionManager sessions(backend, 512);
+    sessions.setClientAuth(&auth);
+    Stream alice, bob;  // Outlive the service's workers
+
+    // Alice may burst 10 tokens, then 20/s; the model decodes 100/s. Bob is unlimited.
+    Core::RateLimiter limiter(Core::RateLimiter::Limits{}, 0.5);
+    limiter.setLimits("alice", Core::RateLimiter::Limits{0.0, 20.0});
+    InferenceService service(&sessions, 1, nullptr, nullptr, 0.0, &limiter);
+
+    const std::string prompt = "a throttled request";
+    std::string expected;
+    {
+        auto session = backend.createSession("reference", "alice", 512, nullptr);
+        session->generate(prompt, Core::GenerationParams{}, [&](const std::string& token, const Core::TokenLogprobs*) {
+            expected += token;
+            return true;
+        });
+    }
+
+    std::string aliceSession = sessions.createSession("alice");
+    std::string bobSession = sessions.createSession("bob");
+
+    service.enqueueTask(makeTask(aliceSession, "alice", prompt, alice));
+    REQUIRE(alice.waitFor([](Stream& s) { return s.tokens >= 5; }));
+
+    SECTION("Other clients run while it waits, then it carries on where it stopped") {
+        service.enqueueTask(makeTask(bobSession, "bob", "an unlimited request", bob));
+
+        // One worker: bob only finishes first if alice's generation let go of it
+        REQUIRE(bob.waitFor([](Stream& s) { return s.done; }));
+        REQUIRE(bob.metrics.completed);
+        {
+            std::lock_guard<std::mutex> lock(alice.mutex);
+            REQUIRE_FALSE(alice.done);
+        }
+
+        REQUIRE(alice.waitFor([](Stream& s) { return s.done; }));
+        REQUIRE(alice.error.empty());
+        REQUIRE(alice.metrics.completed);
+        REQUIRE(alice.text == expected);
+        REQUIRE(alice.metrics.tokens_generated == static_cast<int>(alice.tokens));
+        REQUIRE(alice.metrics.throttle_ms > 0.0);
+        REQUIRE(alice.metrics.rate_limited);
+    }
+
+    SECTION("Aborting it while suspended ends it") {
+        REQUIRE(alice.waitFor([](Stream& s) { return s.tokens >= 11; }));
+        REQUIRE(service.abortTask(aliceSession));
+        REQUIRE(alice.waitFor([](Stream& s) { return s.done; }));
+        REQUIRE_FALSE(alice.metrics.completed);
+        REQUIRE(expected.compare(0, alice.text.size(), alice.text) == 0);
+    }
+
+    service.shutdown();
+}
+
+TEST_CASE("InferenceService: Prompts are charged before they run", "[inference][ratelimit]") {
+    Core::MockBackend backend(slowConfig());
+    ClientAuth auth;
+    auth.getTokenVerifier().setHmacSecret("test-secret");
+    REQUIRE(auth.authenticate("alice", clientToken("alice", "test-secret")));
+
+    Core::SessionManager sessions(backend, 512);
+    sessions.setClientAuth(&auth);
+    Stream first, second;  // Outlive the service's workers
+
+    // 50 prompt tokens of burst, then 100/s: a 200-word prompt costs 1.5 s of debt
+    Core::RateLimiter limiter(Core::RateLimiter::Limits{}, 0.5);
+    limiter.setLimits("alice", Core::RateLimiter::Limits{100.0, 0.0});
+    InferenceService service(&sessions, 2, nullptr, nullptr, 0.0, &limiter);
+
+    std::string prompt;
+    for (int i = 0; i < 200; i++) {
+        prompt += " word" + std::to_string(i);
+    }
+    std::string firstSession = sessions.createSession("alice");
+    std::string secondSession = sessions.createSession("alice");
+
+    // Both queued at once, with a free worker each
+    service.enqueueTask(makeTask(firstSession, "alice", prompt, first));
+    service.enqueueTask(makeTask(secondSession, "alice", prompt + " again", second));
+
+    // The first prompt's debt holds the second back for longer than the first runs
+    REQUIRE(first.waitFor([](Stream& s) { return s.done; }));
+    REQUIRE(first.metrics.completed);
+    REQUIRE(first.metrics.prompt_tokens == 200);
+    {
+        std::lock_guard<std::mutex> lock(second.mutex);
+        REQUIRE(second.tokens == 0);
+    }
+
+    REQUIRE(second.waitFor([](Stream& s) { return s.done; }));
+    REQUIRE(second.metrics.completed);
+    REQUIRE(second.metrics.prompt_budget < 0.0);  // Charged for its own prompt too
+
+    service.shutdown();
+}
+
+TEST_CASE("InferenceService: Paced replays do not hold a worker", "[inference][cache]") {
+    Core::MockBackend backend(slowConfig());
+    ClientAuth auth;
+    auth.getTokenVerifier().setHmacSecret("test-secret");
+    REQUIRE(auth.authenticate("alice", clientToken("alice", "test-secret")));
+    REQUIRE(auth.authenticate("bob", clientToken("bob", "test-secret")));
+
+    Core::SessionManager sessions(backend, 512);
+    sessions.setClientAuth(&auth);
+    Stream original, replayed, other;  // Outlive the service's workers
+
+    // One worker; a 40-token hit takes 2 s to replay at 20 tokens/s
+    Core::ResponseCache cache(Core::ResponseCache::Config{});
+    InferenceService service(&sessions, 1, nullptr, &cache, 20.0);
+
+    const std::string prompt = "cache me";
+    service.enqueueTask(makeTask(sessions.createSession("alice"), "alice", prompt, original));
+    REQUIRE(original.waitFor([](Stream& s) { return s.done; }));
+    REQUIRE(original.metrics.completed);
+
+    std::string replayedSession = sessions.createSession("alice");
+    service.enqueueTask(makeTask(replayedSession, "alice", prompt, replayed));
+    REQUIRE(replayed.waitFor([](Stream& s) { return s.tokens >= 1; }));
+
+    SECTION("Other requests run while it streams") {
+        service.enqueueTask(makeTask(sessions.createSession("bob"), "bob", "not cached", other));
+        REQUIRE(other.waitFor([](Stream& s) { return s.done; }));
+        REQUIRE(other.metrics.completed);
+        {
+            std::lock_guard<std::mutex> lock(replayed.mutex);
+            REQUIRE_FALSE(replayed.done);
+        }
+
+        REQUIRE(replayed.waitFor([](Stream& s) { return s.done; }));
+        REQUIRE(replayed.metrics.cached);
+        REQUIRE(replayed.metrics.completed);
+        REQUIRE(replayed.text == original.text);
+    }
+
+    SECTION("Aborting it stops the replay") {
+        REQUIRE(service.abortTask(replayedSession));
+        REQUIRE(replayed.waitFor([](Stream& s) { return s.done; }));
+        REQUIRE_FALSE(replayed.metrics.completed);
+        size_t stoppedAt = replayed.tokens;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        std::lock_guard<std::mutex> lock(replayed.mutex);
+        REQUIRE(replayed.tokens == stoppedAt);
+    }
+
+    service.shutdown();
+}
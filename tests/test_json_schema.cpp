@@ -0,0 +1,112 @@
+#include "catch_amalgamated.hpp"
+#include "../src/core/JsonSchemaGrammar.h"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+using namespace Core;
+
+static bool hasLine(const std::string& grammar, const std::string& line) {
+    return grammar.find(line + "\n") != std::string::npos;
+}
+
+TEST_CASE("JsonSchemaGrammar: Primitive Types", "[grammar]") {
+    SECTION("Root rule comes first") {
+        auto g = jsonSchemaToGbnf(json{{"type", "integer"}});
+        REQUIRE(g.rfind("root ::= integer\n", 0) == 0);
+        REQUIRE(hasLine(g, "space ::= | \" \" | \"\\n\" [ \\t]{0,20}"));
+    }
+
+    SECTION("Only referenced primitives are emitted") {
+        auto g = jsonSchemaToGbnf(json{{"type", "boolean"}});
+        REQUIRE(g.find("boolean ::=") != std::string::npos);
+        REQUIRE(g.find("string ::=") == std::string::npos);
+        REQUIRE(g.find("number ::=") == std::string::npos);
+    }
+
+    SECTION("String length bounds") {
+        auto g = jsonSchemaToGbnf(json{{"type", "string"}, {"minLength", 1}, {"maxLength", 8}});
+        REQUIRE(hasLine(g, "root ::= \"\\\"\" char{1,8} \"\\\"\" space"));
+    }
+
+    SECTION("Enum and const are JSON literals") {
+        auto g = jsonSchemaToGbnf(json{{"enum", {"red", 1, nullptr}}});
+        REQUIRE(hasLine(g, "root ::= (\"\\\"red\\\"\" | \"1\" | \"null\") space"));
+
+        g = jsonSchemaToGbnf(json{{"const", true}});
+        REQUIRE(hasLine(g, "root ::= \"true\" space"));
+    }
+}
+
+TEST_CASE("JsonSchemaGrammar: Objects", "[grammar]") {
+    json schema = json::parse(R"({
+        "type": "object",
+        "properties": {
+            "name": {"type": "string"},
+            "age":  {"type": "integer"}
+        },
+        "required": ["name"]
+    })");
+    auto g = jsonSchemaToGbnf(schema);
+
+    SECTION("Required properties first, optional ones may be omitted") {
+        REQUIRE(hasLine(g, "root ::= \"{\" space root-name-kv (\",\" space root-age-kv)? \"}\" space"));
+        REQUIRE(hasLine(g, "root-name-kv ::= \"\\\"name\\\"\" space \":\" space root-name"));
+        REQUIRE(hasLine(g, "root-age ::= integer"));
+    }
+
+    SECTION("All-optional objects avoid a leading comma") {
+        schema.erase("required");
+        g = jsonSchemaToGbnf(schema);
+        REQUIRE(hasLine(g, "root ::= \"{\" space (root-rest-0 | root-rest-1)? \"}\" space"));
+        REQUIRE(hasLine(g, "root-rest-0 ::= root-age-kv (\",\" space root-name-kv)?"));
+        REQUIRE(hasLine(g, "root-rest-1 ::= root-name-kv"));
+    }
+
+    SECTION("Undeclared required property is rejected") {
+        schema["required"] = {"missing"};
+        REQUIRE_THROWS_AS(jsonSchemaToGbnf(schema), std::invalid_argument);
+    }
+}
+
+TEST_CASE("JsonSchemaGrammar: Arrays, unions and refs", "[grammar]") {
+    SECTION("Bounded arrays") {
+        auto g = jsonSchemaToGbnf(json{{"type", "array"}, {"items", {{"type", "number"}}},
+                                       {"minItems", 1}, {"maxItems", 3}});
+        REQUIRE(hasLine(g, "root ::= \"[\" space root-item (\",\" space root-item){0,2} \"]\" space"));
+    }
+
+    SECTION("Nullable via type array") {
+        auto g = jsonSchemaToGbnf(json{{"type", {"string", "null"}}});
+        REQUIRE(hasLine(g, "root ::= root-string | root-null"));
+    }
+
+    SECTION("Recursive $ref terminates") {
+        json schema = json::parse(R"({
+            "$ref": "#/$defs/Node",
+            "$defs": {
+                "Node": {
+                    "type": "object",
+                    "properties": {"children": {"type": "array", "items": {"$ref": "#/$defs/Node"}}}
+                }
+            }
+        })");
+        auto g = jsonSchemaToGbnf(schema);
+        REQUIRE(hasLine(g, "root ::= ref-Node"));
+        REQUIRE(hasLine(g, "ref-Node-children-item ::= ref-Node"));
+    }
+
+    SECTION("Unsupported keywords are errors, not silently ignored") {
+        REQUIRE_THROWS_AS(jsonSchemaToGbnf(json{{"type", "string"}, {"pattern", "^a+$"}}), std::invalid_argument);
+        REQUIRE_THROWS_AS(jsonSchemaToGbnf(json{{"allOf", json::array()}}), std::invalid_argument);
+        REQUIRE_THROWS_AS(jsonSchemaToGbnf(json{{"$ref", "https://example.com/schema"}}), std::invalid_argument);
+    }
+
+    SECTION("Wrongly typed keywords are errors too") {
+        REQUIRE_THROWS_AS(jsonSchemaToGbnf(json{{"type", 5}}), std::invalid_argument);
+        REQUIRE_THROWS_AS(jsonSchemaToGbnf(json{{"type", "string"}, {"minLength", "3"}}), std::invalid_argument);
+        REQUIRE_THROWS_AS(jsonSchemaToGbnf(json{{"type", "object"}, {"properties", {{"a", {{"type", "string"}}}}},
+                                                {"required", {1}}}),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(jsonSchemaToGbnf(json{{"$ref", 7}}), std::invalid_argument);
+    }
+}
@@ -0,0 +1,82 @@
+#include "catch_amalgamated.hpp"
+#include "../src/core/LatencyHistogram.h"
+#include <thread>
+#include <vector>
+
+using namespace Core;
+
+TEST_CASE("LatencyHistogram: Buckets", "[latency]") {
+    SECTION("Small values are exact") {
+        for (uint64_t v = 0; v < 32; v++) {
+            REQUIRE(LatencyHistogram::bucketIndex(v) == v);
+            REQUIRE(LatencyHistogram::bucketValue(v) == v);
+        }
+    }
+
+    SECTION("Indices are contiguous and monotonic") {
+        size_t prev = 0;
+        bool contiguous = true;
+        for (uint64_t v = 1; v < (1u << 20); v++) {
+            size_t idx = LatencyHistogram::bucketIndex(v);
+            contiguous = contiguous && (idx == prev || idx == prev + 1);
+            prev = idx;
+        }
+        REQUIRE(contiguous);
+        REQUIRE(LatencyHistogram::bucketIndex(UINT64_MAX) == LatencyHistogram::BUCKETS - 1);
+    }
+
+    SECTION("Relative error stays within ~3%") {
+        for (uint64_t v : {33ull, 100ull, 1000ull, 12345ull, 999999ull, 60000000ull}) {
+            double approx = (double)LatencyHistogram::bucketValue(LatencyHistogram::bucketIndex(v));
+            REQUIRE(std::abs(approx - v) / v < 0.035);
+        }
+    }
+}
+
+TEST_CASE("LatencyHistogram: Percentiles", "[latency]") {
+    LatencyHistogram h;
+    REQUIRE(h.snapshot().percentile(0.5) == 0);
+
+    for (uint64_t v = 1; v <= 1000; v++) h.record(v * 100);  // 100 us .. 100 ms
+
+    auto s = h.snapshot();
+    REQUIRE(s.total == 1000);
+    REQUIRE(s.max == 100000);
+    REQUIRE(s.mean() == Catch::Approx(50050.0));
+    REQUIRE(s.percentile(0.5) == Catch::Approx(50000).epsilon(0.035));
+    REQUIRE(s.percentile(0.9) == Catch::Approx(90000).epsilon(0.035));
+    REQUIRE(s.percentile(0.99) == Catch::Approx(99000).epsilon(0.035));
+    REQUIRE(s.percentile(1.0) <= s.max);
+}
+
+TEST_CASE("LatencyRecorder: Shards merge by client and priority", "[latency]") {
+    LatencyRecorder recorder(4);
+
+    std::vector<std::thread> workers;
+    for (size_t shard = 0; shard < 4; shard++) {
+        workers.emplace_back([&recorder, shard]() {
+            auto* a = recorder.series(shard, "client_a", "high");
+            auto* b = recorder.series(shard, "client_b", "normal");
+            for (int i = 0; i < 1000; i++) {
+                a->record(LatencyPhase::TTFT, 1000);
+                b->record(LatencyPhase::TTFT, 5000);
+                b->record(LatencyPhase::TOTAL, 20000);
+            }
+        });
+    }
+    for (auto& t : workers) t.join();
+
+    auto report = recorder.report();
+    auto ttft = static_cast<size_t>(LatencyPhase::TTFT);
+    auto total = static_cast<size_t>(LatencyPhase::TOTAL);
+
+    REQUIRE(report.all[ttft].total == 8000);
+    REQUIRE(report.all[total].total == 4000);
+    REQUIRE(report.byClient.at("client_a")[ttft].total == 4000);
+    REQUIRE(report.byClient.at("client_a")[ttft].percentile(0.99) == Catch::Approx(1000).epsilon(0.035));
+    REQUIRE(report.byPriority.at("normal")[ttft].percentile(0.5) == Catch::Approx(5000).epsilon(0.035));
+    REQUIRE(report.byPriority.at("high")[total].total == 0);
+
+    // The same pair in the same shard maps to the same series
+    REQUIRE(recorder.series(0, "client_a", "high") == recorder.series(0, "client_a", "high"));
+}
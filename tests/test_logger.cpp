@@ -0,0 +1,87 @@
+#include "catch_amalgamated.hpp"
+#include "../src/core/Logger.h"
+#include <nlohmann/json.hpp>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <string>
+
+using json = nlohmann::json;
+using namespace Core;
+
+static std::vector<std::string> readLines(FILE* f) {
+    std::vector<std::string> lines;
+    fflush(f);
+    rewind(f);
+    char buf[4096];
+    while (fgets(buf, sizeof(buf), f)) {
+        std::string line(buf);
+        if (!line.empty() && line.back() == '\n') line.pop_back();
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+TEST_CASE("Logger: Level parsing", "[logger]") {
+    REQUIRE(Logger::parseLevel("debug") == LogLevel::DEBUG);
+    REQUIRE(Logger::parseLevel("INFO") == LogLevel::INFO);
+    REQUIRE(Logger::parseLevel("Warning") == LogLevel::WARN);
+    REQUIRE(Logger::parseLevel("error") == LogLevel::ERROR);
+    REQUIRE(Logger::parseLevel("off") == LogLevel::OFF);
+    REQUIRE(Logger::parseLevel("bogus", LogLevel::WARN) == LogLevel::WARN);
+}
+
+TEST_CASE("Logger: Asynchronous JSON lines", "[logger]") {
+    auto& logger = Logger::instance();
+    logger.flush();
+
+    FILE* out = tmpfile();
+    FILE* err = tmpfile();
+    REQUIRE(out != nullptr);
+    REQUIRE(err != nullptr);
+    logger.setOutput(out, err);
+    logger.configure(LogLevel::INFO, true);
+
+    SECTION("Messages from many threads are all written") {
+        const int threads = 4;
+        const int perThread = 200;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([t]() {
+                for (int i = 0; i < perThread; ++i) {
+                    LOG_INFO("worker " << t << " message " << i);
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+        logger.flush();
+
+        auto lines = readLines(out);
+        REQUIRE(lines.size() == threads * perThread);
+        for (const auto& line : lines) {
+            auto entry = json::parse(line);
+            REQUIRE(entry["level"] == "info");
+            REQUIRE(entry.contains("ts"));
+            REQUIRE(entry.contains("tid"));
+        }
+    }
+
+    SECTION("Levels are filtered and routed") {
+        LOG_DEBUG("hidden");
+        LOG_INFO("shown \"quoted\"\ttabbed");
+        LOG_ERROR("failure");
+        logger.flush();
+
+        auto outLines = readLines(out);
+        auto errLines = readLines(err);
+        REQUIRE(outLines.size() == 1);
+        REQUIRE(json::parse(outLines[0])["msg"] == "shown \"quoted\"\ttabbed");
+        REQUIRE(errLines.size() == 1);
+        REQUIRE(json::parse(errLines[0])["level"] == "error");
+    }
+
+    logger.setOutput(stdout, stderr);
+    logger.configure(LogLevel::INFO, false);
+    fclose(out);
+    fclose(err);
+}
@@ -0,0 +1,87 @@
+#include "catch_amalgamated.hpp"
+#include "../src/core/Logprobs.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace Core;
+
+static std::vector<float> randomLogits(int n, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> dist(0.0f, 4.0f);
+    std::vector<float> logits(n);
+    for (auto& v : logits) v = dist(rng);
+    return logits;
+}
+
+TEST_CASE("Logprobs: logSumExp", "[logprobs]") {
+    SECTION("Matches the scalar reference on odd-sized rows") {
+        for (int n : {1, 7, 8, 17, 32003}) {
+            auto logits = randomLogits(n, n);
+            float expected = Logprobs::logSumExpScalar(logits.data(), n);
+            REQUIRE(Logprobs::logSumExp(logits.data(), n) == Catch::Approx(expected).epsilon(1e-5));
+        }
+    }
+
+    SECTION("Stable for large logits") {
+        std::vector<float> logits(64, 1000.0f);
+        float lse = Logprobs::logSumExp(logits.data(), logits.size());
+        REQUIRE(std::isfinite(lse));
+        REQUIRE(lse == Catch::Approx(1000.0f + std::log(64.0f)));
+    }
+
+    SECTION("Probabilities sum to one") {
+        auto logits = randomLogits(5000, 7);
+        float lse = Logprobs::logSumExp(logits.data(), logits.size());
+        double total = 0.0;
+        for (float v : logits) total += std::exp((double)v - lse);
+        REQUIRE(total == Catch::Approx(1.0).epsilon(1e-4));
+    }
+}
+
+TEST_CASE("Logprobs: topN", "[logprobs]") {
+    SECTION("Matches a full sort") {
+        const int n_vocab = 32003;
+        auto logits = randomLogits(n_vocab, 42);
+        float lse = Logprobs::logSumExp(logits.data(), n_vocab);
+
+        std::vector<int> order(n_vocab);
+        for (int i = 0; i < n_vocab; i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return logits[a] > logits[b]; });
+
+        std::vector<TokenLogprob> top;
+        Logprobs::topN(logits.data(), n_vocab, 20, lse, top);
+
+        REQUIRE(top.size() == 20);
+        for (int k = 0; k < 20; k++) {
+            REQUIRE(top[k].id == order[k]);
+            REQUIRE(top[k].logprob == Catch::Approx(logits[order[k]] - lse));
+        }
+    }
+
+    SECTION("Ties keep the lower token id") {
+        std::vector<float> logits(40, 0.0f);
+        logits[3] = 5.0f;
+        logits[30] = 5.0f;
+        logits[9] = 5.0f;
+
+        std::vector<TokenLogprob> top;
+        Logprobs::topN(logits.data(), logits.size(), 2, 0.0f, top);
+        REQUIRE(top.size() == 2);
+        REQUIRE(top[0].id == 3);
+        REQUIRE(top[1].id == 9);
+    }
+
+    SECTION("N larger than the vocabulary or zero") {
+        std::vector<float> logits = {1.0f, 3.0f, 2.0f};
+        std::vector<TokenLogprob> top;
+
+        Logprobs::topN(logits.data(), 3, 10, 0.0f, top);
+        REQUIRE(top.size() == 3);
+        REQUIRE(top[0].id == 1);
+        REQUIRE(top[2].id == 0);
+
+        Logprobs::topN(logits.data(), 3, 0, 0.0f, top);
+        REQUIRE(top.empty());
+    }
+}
@@ -0,0 +1,226 @@
+#include "catch_amalgamated.hpp"
+#include "../src/core/MockBackend.h"
+#include <chrono>
+#include <thread>
+
+using namespace Core;
+
+static MockBackend::Config fastConfig() {
+    MockBackend::Config config;
+    config.prefill_tps = 1e6;
+    config.decode_tps = 5000.0;
+    config.jitter = 0.0;
+    config.reply_tokens = 16;
+    return config;
+}
+
+// Runs one request and returns the streamed text
+static std::string run(Session& session, const std::string& prompt, const GenerationParams& params,
+                       Metrics* metrics = nullptr) {
+    std::string text;
+    Metrics m = session.generate(prompt, params, [&](const std::string& piece, const TokenLogprobs*) {
+        text += piece;
+        return true;
+    });
+    if (metrics) *metrics = m;
+    return text;
+}
+
+TEST_CASE("MockBackend: Deterministic replies", "[mock]") {
+    MockBackend backend(fastConfig());
+    auto a = backend.createSession("sess_a", "client", 512, nullptr);
+    auto b = backend.createSession("sess_b", "client", 512, nullptr);
+    GenerationParams params;
+
+    REQUIRE(backend.isReady());
+    REQUIRE(std::string(backend.name()) == "mock");
+
+    SECTION("Same prompt, same reply across sessions") {
+        std::string first = run(*a, "Tell me a story", params);
+        REQUIRE(!first.empty());
+        REQUIRE(run(*b, "Tell me a story", params) == first);
+        REQUIRE(run(*a, "Tell me another story", params) != first);
+    }
+
+    SECTION("The seed changes replies and the fingerprint") {
+        MockBackend::Config config = fastConfig();
+        config.seed = 7;
+        MockBackend other(config);
+        auto c = other.createSession("sess_c", "client", 512, nullptr);
+        REQUIRE(run(*c, "Tell me a story", params) != run(*a, "Tell me a story", params));
+        REQUIRE(other.getFingerprint() != backend.getFingerprint());
+    }
+
+    SECTION("max_tokens bounds the reply, reply_tokens is the default") {
+        Metrics metrics;
+        params.max_tokens = 5;
+        run(*a, "Count", params, &metrics);
+        REQUIRE(metrics.tokens_generated == 5);
+        REQUIRE(metrics.completed);
+
+        params.max_tokens = 0;
+        run(*a, "Count", params, &metrics);
+        REQUIRE(metrics.tokens_generated == 16);
+    }
+
+    SECTION("Context size stops generation") {
+        auto small = backend.createSession("sess_small", "client", 8, nullptr);
+        Metrics metrics;
+        params.max_tokens = 100;
+        run(*small, "one two three", params, &metrics);
+        REQUIRE(metrics.tokens_generated == 6);  // 3 + 5 decoded fill the context, the 6th is sampled
+    }
+
+    SECTION("Logprobs are reported when asked for") {
+        params.max_tokens = 3;
+        params.logprobs = 1;
+        int withLogprobs = 0;
+        a->generate("Hi", params, [&](const std::string& piece, const TokenLogprobs* logprobs) {
+            if (logprobs && logprobs->top.size() == 1 && logprobs->top[0].token == piece) withLogprobs++;
+            return true;
+        });
+        REQUIRE(withLogprobs == 3);
+    }
+}
+
+TEST_CASE("MockBackend: Prefix reuse", "[mock]") {
+    MockBackend backend(fastConfig());
+    auto session = backend.createSession("sess_a", "client", 512, nullptr);
+    GenerationParams params;
+    params.max_tokens = 4;
+    Metrics metrics;
+
+    run(*session, "The quick brown fox", params, &metrics);
+    REQUIRE(metrics.prompt_tokens == 4);
+    REQUIRE(metrics.cached_tokens == 0);
+
+    run(*session, "The quick brown cat jumps", params, &metrics);
+    REQUIRE(metrics.cached_tokens == 3);
+    REQUIRE(metrics.prompt_tokens == 2);
+
+    SECTION("A conversation extends its own KV") {
+        auto chat = backend.createSession("sess_chat", "client", 512, nullptr);
+        chat->appendMessage("system", "Be brief", false, params, nullptr);
+        chat->appendMessage("user", "Hello there", true, params, nullptr);
+        metrics = chat->appendMessage("user", "And then?", true, params, nullptr);
+        REQUIRE(chat->getMessageCount() == 5);  // Replies are kept as assistant messages
+        // The last reply word (never decoded), " <user>", " And", " then?", " <assistant>"
+        REQUIRE(metrics.prompt_tokens == 5);
+        REQUIRE_THROWS_AS(chat->appendMessage("robot", "x", false, params, nullptr), std::invalid_argument);
+    }
+}
+
+TEST_CASE("MockBackend: A failed prefill leaves no trace", "[mock]") {
+    MockBackend::Config config = fastConfig();
+    config.fail_prefill_over = 12;
+    MockBackend backend(config);
+    auto chat = backend.createSession("sess_chat", "client", 512, nullptr);
+    GenerationParams params;
+    params.max_tokens = 4;
+
+    chat->appendMessage("user", "Hi", true, params, nullptr);
+    REQUIRE(chat->getMessageCount() == 2);
+
+    // The prefill fails part way: neither the message nor a reply is stored
+    Metrics metrics = chat->appendMessage("user", "one two three four five six seven eight nine ten", true,
+                                          params, nullptr);
+    REQUIRE(chat->getState() == SessionState::ERROR);
+    REQUIRE(metrics.tokens_generated == 0);
+    REQUIRE_FALSE(metrics.completed);
+    REQUIRE(chat->getMessageCount() == 2);
+
+    // The conversation carries on from where it was
+    metrics = chat->appendMessage("user", "Next", true, params, nullptr);
+    REQUIRE(chat->getState() == SessionState::IDLE);
+    REQUIRE(metrics.completed);
+    REQUIRE(chat->getMessageCount() == 4);
+}
+
+TEST_CASE("MockBackend: Timing follows the configured rates", "[mock]") {
+    MockBackend::Config config = fastConfig();
+    config.prefill_tps = 1000.0;
+    config.decode_tps = 200.0;
+    MockBackend backend(config);
+    auto session = backend.createSession("sess_a", "client", 512, nullptr);
+
+    GenerationParams params;
+    params.max_tokens = 21;
+    Metrics metrics;
+    run(*session, "a b c d e f g h i j k l m n o p q r s t", params, &metrics);
+
+    // 20 prompt tokens at 1000/s, then 20 decode steps at 200/s
+    REQUIRE(metrics.prefill_ms >= 18.0);
+    REQUIRE(metrics.ttft_ms >= 18);
+    REQUIRE(metrics.decode_ms >= 95.0);
+    REQUIRE(metrics.total_time_ms < 500);
+    REQUIRE(metrics.decode_tps > 100.0);
+    REQUIRE(metrics.decode_tps <= 210.0);
+}
+
+TEST_CASE("MockBackend: Abort and busy", "[mock]") {
+    MockBackend::Config config = fastConfig();
+    config.decode_tps = 100.0;
+    MockBackend backend(config);
+    auto session = backend.createSession("sess_a", "client", 512, nullptr);
+
+    GenerationParams params;
+    params.max_tokens = 1000;
+    Metrics metrics;
+    std::thread worker([&]() { run(*session, "Go on forever", params, &metrics); });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE(session->isGenerating());
+    REQUIRE_THROWS_AS(session->generate("Other", params, nullptr), std::invalid_argument);
+
+    session->abort();
+    worker.join();
+    REQUIRE_FALSE(metrics.completed);
+    REQUIRE(metrics.tokens_generated < 1000);
+    REQUIRE_FALSE(session->isGenerating());
+}
+
+TEST_CASE("MockBackend: Resume after the callback stops", "[mock]") {
+    MockBackend backend(fastConfig());
+    auto session = backend.createSession("sess_a", "client", 512, nullptr);
+    GenerationParams params;
+    const std::string whole = run(*session, "Tell me a story", params);
+
+    // Stop every 5 tokens and carry on: the pieces add up to the uninterrupted reply
+    std::string text;
+    int sinceStop = 0;
+    auto callback = [&](const std::string& piece, const TokenLogprobs*) {
+        text += piece;
+        return ++sinceStop % 5 != 0;
+    };
+    Metrics metrics = session->generate("Tell me a story", params, callback);
+    int parts = 1;
+    while (!metrics.completed) {
+        metrics = session->resume(callback);
+        parts++;
+    }
+    REQUIRE(text == whole);
+    REQUIRE(parts == 4);  // 16 tokens
+    REQUIRE_THROWS_AS(session->resume(callback), std::invalid_argument);
+
+    SECTION("Chat replies grow the stored message") {
+        auto chat = backend.createSession("sess_chat", "client", 512, nullptr);
+        sinceStop = 0;
+        text.clear();
+        metrics = chat->appendMessage("user", "Hello there", true, params, callback);
+        while (!metrics.completed) {
+            metrics = chat->resume(callback);
+        }
+        REQUIRE(chat->getMessageCount() == 2);
+
+        // The next turn sees the whole reply
+        metrics = chat->appendMessage("user", "And then?", true, params, nullptr);
+        REQUIRE(metrics.cached_tokens > 16);
+    }
+
+    SECTION("Other requests discard it") {
+        sinceStop = 0;
+        session->generate("Tell me a story", params, callback);
+        session->generate("Something else", params, nullptr);
+        REQUIRE_THROWS_AS(session->resume(callback), std::invalid_argument);
+    }
+}
@@ -0,0 +1,39 @@
+#include "catch_amalgamated.hpp"
+#include "../src/server/PrometheusWriter.h"
+
+using namespace Server;
+
+TEST_CASE("PrometheusWriter: Families and samples", "[prometheus]") {
+    PrometheusWriter w;
+    w.family("ic_sessions", "gauge", "Open sessions");
+    w.sample("ic_sessions", 3);
+    w.family("ic_requests_total", "counter", "Requests");
+    w.sample("ic_requests_total", 0.5, {{"client", "a\"b\\c\nd"}, {"status", "ok"}});
+
+    REQUIRE(w.str() ==
+        "# HELP ic_sessions Open sessions\n"
+        "# TYPE ic_sessions gauge\n"
+        "ic_sessions 3\n"
+        "# HELP ic_requests_total Requests\n"
+        "# TYPE ic_requests_total counter\n"
+        "ic_requests_total{client=\"a\\\"b\\\\c\\nd\",status=\"ok\"} 0.5\n");
+}
+
+TEST_CASE("PrometheusWriter: Histograms are cumulative", "[prometheus]") {
+    Core::LatencyHistogram h;
+    h.record(500);       // 0.5 ms
+    h.record(20000);     // 20 ms
+    h.record(20000);
+    h.record(3000000);   // 3 s
+
+    PrometheusWriter w;
+    w.histogram("ic_ttft_seconds", h.snapshot(), {{"phase", "ttft"}}, 1e6, {0.001, 0.025, 1});
+    const std::string& text = w.str();
+
+    REQUIRE(text.find("ic_ttft_seconds_bucket{phase=\"ttft\",le=\"0.001\"} 1\n") != std::string::npos);
+    REQUIRE(text.find("ic_ttft_seconds_bucket{phase=\"ttft\",le=\"0.025\"} 3\n") != std::string::npos);
+    REQUIRE(text.find("ic_ttft_seconds_bucket{phase=\"ttft\",le=\"1\"} 3\n") != std::string::npos);
+    REQUIRE(text.find("ic_ttft_seconds_bucket{phase=\"ttft\",le=\"+Inf\"} 4\n") != std::string::npos);
+    REQUIRE(text.find("ic_ttft_seconds_sum{phase=\"ttft\"} 3.0405\n") != std::string::npos);
+    REQUIRE(text.find("ic_ttft_seconds_count{phase=\"ttft\"} 4\n") != std::string::npos);
+}
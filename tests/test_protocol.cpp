@@ -1,6 +1,7 @@
 #define CATCH_CONFIG_MAIN
 #include "catch_amalgamated.hpp"
 #include "../src/server/Protocol.h"
+#include "../src/server/Utils.h"
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
@@ -47,3 +48,143 @@ TEST_CASE("Protocol: Message Structures", "[protocol]") {
         REQUIRE(msg["params"]["temp"] == 0.7);
     }
 }
+
+TEST_CASE("Protocol: Embed Parsing", "[protocol]") {
+    SECTION("Single string input uses defaults") {
+        json msg = {{"op", Op::EMBED}, {"input", "hello"}};
+        auto p = parseEmbed(msg);
+
+        REQUIRE(p.inputs.size() == 1);
+        REQUIRE(p.inputs[0] == "hello");
+        REQUIRE(p.normalize == true);
+        REQUIRE(p.encoding == "float");
+        REQUIRE(p.request_id.empty());
+    }
+
+    SECTION("Array input with options") {
+        json msg = {
+            {"op", Op::EMBED},
+            {"input", {"a", "b", "c"}},
+            {"normalize", false},
+            {"encoding", "base64"},
+            {"request_id", "req_1"}
+        };
+        auto p = parseEmbed(msg);
+
+        REQUIRE(p.inputs == std::vector<std::string>{"a", "b", "c"});
+        REQUIRE(p.normalize == false);
+        REQUIRE(p.encoding == "base64");
+        REQUIRE(p.request_id == "req_1");
+    }
+
+    SECTION("Missing input yields no inputs") {
+        auto p = parseEmbed(json{{"op", Op::EMBED}});
+        REQUIRE(p.inputs.empty());
+    }
+}
+
+TEST_CASE("Protocol: Base64 Encoding", "[protocol]") {
+    auto enc = [](const std::string& s) {
+        return Utils::base64Encode(reinterpret_cast<const unsigned char*>(s.data()), s.size());
+    };
+
+    REQUIRE(enc("") == "");
+    REQUIRE(enc("f") == "Zg==");
+    REQUIRE(enc("fo") == "Zm8=");
+    REQUIRE(enc("foo") == "Zm9v");
+    REQUIRE(enc("foobar") == "Zm9vYmFy");
+
+    float one = 1.0f;  // 0x3F800000, little-endian
+    REQUIRE(Utils::base64Encode(reinterpret_cast<const unsigned char*>(&one), sizeof(one)) == "AACAPw==");
+}
+
+TEST_CASE("Protocol: Batch Infer Parsing", "[protocol]") {
+    SECTION("Mixed string and object prompts inherit defaults") {
+        json msg = {
+            {"op", Op::BATCH_INFER},
+            {"batch_id", "job_7"},
+            {"params", {{"max_tokens", 32}}},
+            {"prompts", {
+                "plain prompt",
+                {{"prompt", "custom"}, {"params", {{"max_tokens", 8}}}}
+            }}
+        };
+        auto p = parseBatchInfer(msg);
+
+        REQUIRE(p.batch_id == "job_7");
+        REQUIRE(p.items.size() == 2);
+        REQUIRE(p.items[0].prompt == "plain prompt");
+        REQUIRE(p.items[0].max_tokens == 32);
+        REQUIRE(p.items[1].prompt == "custom");
+        REQUIRE(p.items[1].max_tokens == 8);
+    }
+
+    SECTION("No prompts") {
+        auto p = parseBatchInfer(json{{"op", Op::BATCH_INFER}});
+        REQUIRE(p.batch_id.empty());
+        REQUIRE(p.items.empty());
+    }
+}
+
+TEST_CASE("Protocol: Infer Parsing", "[protocol]") {
+    json msg = {
+        {"op", Op::INFER},
+        {"session_id", "sess_1"},
+        {"prompt", "Hi"},
+        {"params", {{"max_tokens", 16}, {"logprobs", 5}, {"json_schema", {{"type", "object"}}}}}
+    };
+    auto p = parseInfer(msg);
+
+    REQUIRE(p.session_id == "sess_1");
+    REQUIRE(p.max_tokens == 16);
+    REQUIRE(p.logprobs == 5);
+    REQUIRE(p.grammar.empty());
+    REQUIRE(p.json_schema["type"] == "object");
+
+    auto defaults = parseInfer(json{{"op", Op::INFER}, {"session_id", "s"}, {"prompt", "p"}});
+    REQUIRE(defaults.logprobs == 0);
+    REQUIRE(defaults.json_schema.is_null());
+}
+
+TEST_CASE("Protocol: Append Message Parsing", "[protocol]") {
+    SECTION("User messages generate by default") {
+        json msg = {
+            {"op", Op::APPEND_MESSAGE},
+            {"session_id", "sess_1"},
+            {"content", "Hello"},
+            {"params", {{"max_tokens", 64}}}
+        };
+        auto p = parseAppendMessage(msg);
+
+        REQUIRE(p.role == "user");
+        REQUIRE(p.generate == true);
+        REQUIRE(p.inference.session_id == "sess_1");
+        REQUIRE(p.inference.prompt == "Hello");
+        REQUIRE(p.inference.max_tokens == 64);
+    }
+
+    SECTION("System messages only extend the history") {
+        auto p = parseAppendMessage(json{{"session_id", "s"}, {"role", "system"}, {"content", "Be brief."}});
+        REQUIRE(p.role == "system");
+        REQUIRE(p.generate == false);
+    }
+
+    SECTION("Explicit generate flag wins") {
+        auto p = parseAppendMessage(json{{"session_id", "s"}, {"content", "x"}, {"generate", false}});
+        REQUIRE(p.generate == false);
+    }
+}
+
+TEST_CASE("Protocol: Subscribe Metrics Parsing", "[protocol]") {
+    SECTION("Defaults: every second, all sections") {
+        auto p = parseSubscribeMetrics(json{{"op", Op::SUBSCRIBE_METRICS}});
+        REQUIRE(p.interval_s == 1);
+        REQUIRE(p.fields.empty());
+    }
+
+    SECTION("Interval and field filter") {
+        auto p = parseSubscribeMetrics(json{{"interval_s", 5}, {"fields", {"gpu", "latency"}}});
+        REQUIRE(p.interval_s == 5);
+        REQUIRE(p.fields == std::vector<std::string>{"gpu", "latency"});
+    }
+}
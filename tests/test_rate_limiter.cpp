@@ -0,0 +1,80 @@
+#include "catch_amalgamated.hpp"
+#include "../src/core/RateLimiter.h"
+#include <cmath>
+
+using namespace Core;
+using Clock = RateLimiter::Clock;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+TEST_CASE("RateLimiter: Token buckets", "[rate_limit]") {
+    // 10 tokens/s, 2 s of burst
+    RateLimiter limiter(RateLimiter::Limits{0.0, 0.0}, 2.0);
+    limiter.setLimits("alice", {0.0, 10.0});
+    auto t0 = Clock::now();
+
+    SECTION("Unlimited clients never wait") {
+        REQUIRE(limiter.consume("bob", RateLimiter::Kind::GENERATED, 1e6, t0) == Clock::duration::zero());
+        REQUIRE(limiter.readyAt("bob", t0) == t0);
+        auto budget = limiter.remaining("bob", t0);
+        REQUIRE_FALSE(budget.limited);
+        REQUIRE(std::isinf(budget.generated_tokens));
+    }
+
+    SECTION("Burst is spent, then debt is paid back at the rate") {
+        REQUIRE(limiter.remaining("alice", t0).generated_tokens == Catch::Approx(20.0));
+        REQUIRE(limiter.consume("alice", RateLimiter::Kind::GENERATED, 20, t0) == Clock::duration::zero());
+
+        auto wait = limiter.consume("alice", RateLimiter::Kind::GENERATED, 5, t0);
+        REQUIRE(std::chrono::duration<double>(wait).count() == Catch::Approx(0.5));
+        REQUIRE(limiter.readyAt("alice", t0) == t0 + wait);
+
+        // Prompt tokens are unlimited for alice and do not hold her back
+        REQUIRE(limiter.consume("alice", RateLimiter::Kind::PROMPT, 1000, t0) == Clock::duration::zero());
+
+        auto later = t0 + seconds(1);
+        REQUIRE(limiter.readyAt("alice", later) == later);
+        REQUIRE(limiter.remaining("alice", later).generated_tokens == Catch::Approx(5.0));
+    }
+
+    SECTION("Refill is capped at the burst") {
+        limiter.consume("alice", RateLimiter::Kind::GENERATED, 10, t0);
+        REQUIRE(limiter.remaining("alice", t0 + seconds(60)).generated_tokens == Catch::Approx(20.0));
+    }
+
+    SECTION("Clients have separate buckets") {
+        limiter.setLimits("carol", {0.0, 10.0});
+        limiter.consume("alice", RateLimiter::Kind::GENERATED, 100, t0);
+        REQUIRE(limiter.readyAt("alice", t0) > t0);
+        REQUIRE(limiter.readyAt("carol", t0) == t0);
+    }
+
+    SECTION("Changing limits keeps the debt") {
+        limiter.consume("alice", RateLimiter::Kind::GENERATED, 40, t0);
+        limiter.setLimits("alice", {0.0, 20.0});
+        auto budget = limiter.remaining("alice", Clock::now());
+        REQUIRE(budget.generated_tokens < 0.0);
+    }
+}
+
+TEST_CASE("RateLimiter: Defaults apply to unconfigured clients", "[rate_limit]") {
+    RateLimiter limiter(RateLimiter::Limits{100.0, 5.0}, 1.0);
+    auto t0 = Clock::now();
+
+    auto budget = limiter.remaining("dave", t0);
+    REQUIRE(budget.limited);
+    REQUIRE(budget.prompt_tokens == Catch::Approx(100.0));
+    REQUIRE(budget.generated_tokens == Catch::Approx(5.0));
+
+    // A prompt three times the burst blocks the next request for two seconds
+    auto wait = limiter.consume("dave", RateLimiter::Kind::PROMPT, 300, t0);
+    REQUIRE(std::chrono::duration<double>(wait).count() == Catch::Approx(2.0));
+    REQUIRE(limiter.readyAt("dave", t0 + milliseconds(1500)) > t0 + milliseconds(1500));
+    REQUIRE(limiter.readyAt("dave", t0 + seconds(2)) <= t0 + seconds(2) + milliseconds(1));
+
+    // Per-client limits override a default field by field
+    limiter.setLimits("erin", {0.0, 50.0});
+    budget = limiter.remaining("erin", t0);
+    REQUIRE(budget.prompt_tokens == Catch::Approx(100.0));
+    REQUIRE(budget.generated_tokens == Catch::Approx(50.0));
+}
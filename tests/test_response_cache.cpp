@@ -0,0 +1,98 @@
+#include "catch_amalgamated.hpp"
+#include "../src/core/ResponseCache.h"
+#include <thread>
+
+using namespace Core;
+
+static CachedResponse makeResponse(std::vector<std::string> pieces) {
+    CachedResponse r;
+    r.pieces = std::move(pieces);
+    r.metrics.tokens_generated = r.pieces.size();
+    return r;
+}
+
+TEST_CASE("ResponseCache: Hits, misses and keys", "[cache]") {
+    ResponseCache cache(ResponseCache::Config{});
+    std::string key = ResponseCache::makeKey("model-a", "Hello", "max_tokens=16");
+
+    REQUIRE(cache.lookup(key) == nullptr);
+    cache.store(key, makeResponse({"Hi", " there"}));
+
+    auto hit = cache.lookup(key);
+    REQUIRE(hit != nullptr);
+    REQUIRE(hit->pieces == std::vector<std::string>{"Hi", " there"});
+    REQUIRE(hit->metrics.tokens_generated == 2);
+
+    SECTION("Model, params and prompt are all part of the key") {
+        REQUIRE(cache.lookup(ResponseCache::makeKey("model-b", "Hello", "max_tokens=16")) == nullptr);
+        REQUIRE(cache.lookup(ResponseCache::makeKey("model-a", "Hello", "max_tokens=17")) == nullptr);
+        REQUIRE(cache.lookup(ResponseCache::makeKey("model-a", "Hello!", "max_tokens=16")) == nullptr);
+        // Field boundaries can't be shifted to forge a match
+        REQUIRE(ResponseCache::makeKey("ab", "c", "") != ResponseCache::makeKey("a", "bc", ""));
+    }
+
+    SECTION("Hit rate") {
+        auto stats = cache.stats();
+        REQUIRE(stats.hits == 1);
+        REQUIRE(stats.misses == 1);
+        REQUIRE(stats.entries == 1);
+        REQUIRE(stats.hitRate() == Catch::Approx(0.5));
+    }
+}
+
+TEST_CASE("ResponseCache: Limits", "[cache]") {
+    SECTION("Entry limit evicts the least recently used") {
+        ResponseCache::Config config;
+        config.max_entries = 2;
+        ResponseCache cache(config);
+
+        cache.store("a", makeResponse({"1"}));
+        cache.store("b", makeResponse({"2"}));
+        REQUIRE(cache.lookup("a") != nullptr);  // "b" is now the LRU entry
+        cache.store("c", makeResponse({"3"}));
+
+        REQUIRE(cache.lookup("a") != nullptr);
+        REQUIRE(cache.lookup("b") == nullptr);
+        REQUIRE(cache.lookup("c") != nullptr);
+        REQUIRE(cache.stats().evictions == 1);
+    }
+
+    SECTION("Byte limit") {
+        ResponseCache::Config config;
+        config.max_bytes = 4096;
+        ResponseCache cache(config);
+
+        cache.store("big", makeResponse({std::string(8192, 'x')}));
+        REQUIRE(cache.lookup("big") == nullptr);  // Larger than the whole cache
+
+        for (int i = 0; i < 20; i++) {
+            cache.store("k" + std::to_string(i), makeResponse({std::string(500, 'y')}));
+        }
+        REQUIRE(cache.stats().bytes <= 4096);
+        REQUIRE(cache.lookup("k19") != nullptr);
+        REQUIRE(cache.lookup("k0") == nullptr);
+    }
+
+    SECTION("TTL") {
+        ResponseCache::Config config;
+        config.ttl = std::chrono::milliseconds(30);
+        ResponseCache cache(config);
+
+        cache.store("k", makeResponse({"x"}));
+        REQUIRE(cache.lookup("k") != nullptr);
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        REQUIRE(cache.lookup("k") == nullptr);
+        REQUIRE(cache.stats().entries == 0);
+    }
+
+    SECTION("Disabled") {
+        ResponseCache::Config config;
+        config.max_entries = 0;
+        ResponseCache cache(config);
+
+        cache.store("k", makeResponse({"x"}));
+        REQUIRE_FALSE(cache.enabled());
+        REQUIRE(cache.lookup("k") == nullptr);
+        REQUIRE(cache.stats().misses == 0);
+    }
+}
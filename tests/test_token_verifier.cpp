@@ -0,0 +1,269 @@
+#include "catch_amalgamated.hpp"
+#include "../src/server/ClientAuth.h"
+#include "../src/server/TokenVerifier.h"
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/pem.h>
+#include <algorithm>
+#include <chrono>
+
+using namespace Server;
+
+static int64_t nowSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static std::string encodeParts(const json& header, const json& payload) {
+    return TokenVerifier::base64UrlEncode(header.dump()) + "." + TokenVerifier::base64UrlEncode(payload.dump());
+}
+
+// What JotaDB would issue with the shared secret
+static std::string signHs256(const json& payload, const std::string& secret) {
+    std::string signed_part = encodeParts({{"alg", "HS256"}, {"typ", "JWT"}}, payload);
+    unsigned char mac[EVP_MAX_MD_SIZE];
+    unsigned int mac_len = 0;
+    HMAC(EVP_sha256(), secret.data(), static_cast<int>(secret.size()),
+         reinterpret_cast<const unsigned char*>(signed_part.data()), signed_part.size(), mac, &mac_len);
+    return signed_part + "." + TokenVerifier::base64UrlEncode(std::string(reinterpret_cast<char*>(mac), mac_len));
+}
+
+static std::string signEd25519(const json& payload, EVP_PKEY* key) {
+    std::string signed_part = encodeParts({{"alg", "EdDSA"}, {"typ", "JWT"}}, payload);
+    unsigned char sig[64];
+    size_t sig_len = sizeof(sig);
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    EVP_DigestSignInit(ctx, nullptr, nullptr, nullptr, key);
+    EVP_DigestSign(ctx, sig, &sig_len, reinterpret_cast<const unsigned char*>(signed_part.data()), signed_part.size());
+    EVP_MD_CTX_free(ctx);
+    return signed_part + "." + TokenVerifier::base64UrlEncode(std::string(reinterpret_cast<char*>(sig), sig_len));
+}
+
+static json claimsFor(const std::string& client_id, int64_t exp) {
+    return {{"client_id", client_id}, {"max_sessions", 3}, {"priority", "high"}, {"exp", exp}};
+}
+
+TEST_CASE("TokenVerifier: HS256 tokens", "[auth]") {
+    TokenVerifier verifier;
+    REQUIRE_FALSE(verifier.enabled());
+    verifier.setHmacSecret("shared-secret");
+    REQUIRE(verifier.enabled());
+
+    int64_t now = nowSeconds();
+    TokenClaims claims;
+    std::string error;
+
+    SECTION("Valid token yields its claims") {
+        std::string token = signHs256(claimsFor("alice", now + 600), "shared-secret");
+        REQUIRE(TokenVerifier::looksLikeToken(token));
+        REQUIRE(verifier.verify(token, claims, error));
+        REQUIRE(claims.client_id == "alice");
+        REQUIRE(claims.max_sessions == 3);
+        REQUIRE(claims.priority == "high");
+        REQUIRE(claims.expires_at == now + 600);
+    }
+
+    SECTION("sub is accepted as the client id") {
+        json payload = {{"sub", "bob"}, {"exp", now + 600}};
+        REQUIRE(verifier.verify(signHs256(payload, "shared-secret"), claims, error));
+        REQUIRE(claims.client_id == "bob");
+        REQUIRE(claims.max_sessions == 1);
+        REQUIRE(claims.priority == "normal");
+    }
+
+    SECTION("Tampered payload") {
+        std::string token = signHs256(claimsFor("alice", now + 600), "shared-secret");
+        size_t first = token.find('.');
+        size_t second = token.find('.', first + 1);
+        std::string forged = token.substr(0, first + 1) +
+                             TokenVerifier::base64UrlEncode(claimsFor("mallory", now + 600).dump()) +
+                             token.substr(second);
+        REQUIRE_FALSE(verifier.verify(forged, claims, error));
+        REQUIRE(error == "Bad signature");
+    }
+
+    SECTION("Only the canonical encoding verifies") {
+        std::string token = signHs256(claimsFor("alice", now + 600), "shared-secret");
+        REQUIRE(verifier.verify(token, claims, error));
+
+        // Padding, or anything after it
+        REQUIRE_FALSE(verifier.verify(token + "=", claims, error));
+        REQUIRE(error == "Malformed token");
+        REQUIRE_FALSE(verifier.verify(token + "=junk", claims, error));
+
+        // The last character of a 32-byte signature has two unused bits, which must be zero
+        const std::string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+        std::string forged = token;
+        forged.back() = alphabet[alphabet.find(token.back()) ^ 1];
+        REQUIRE_FALSE(verifier.verify(forged, claims, error));
+        REQUIRE(error == "Malformed token");
+
+        // A dangling character
+        REQUIRE_FALSE(verifier.verify(token + "A", claims, error));
+    }
+
+    SECTION("Wrong secret") {
+        REQUIRE_FALSE(verifier.verify(signHs256(claimsFor("alice", now + 600), "other"), claims, error));
+        REQUIRE(error == "Bad signature");
+    }
+
+    SECTION("Expiry, with clock skew tolerated") {
+        std::string token = signHs256(claimsFor("alice", now - 10), "shared-secret");
+        REQUIRE(verifier.verify(token, claims, error));
+        REQUIRE_FALSE(verifier.verify(token, claims, error, now + TokenVerifier::LEEWAY_S));
+        REQUIRE(error == "Token expired");
+    }
+
+    SECTION("Claims that must be there") {
+        REQUIRE_FALSE(verifier.verify(signHs256({{"client_id", "alice"}}, "shared-secret"), claims, error));
+        REQUIRE(error == "Token has no expiry");
+        REQUIRE_FALSE(verifier.verify(signHs256({{"exp", now + 600}}, "shared-secret"), claims, error));
+        REQUIRE(error == "Token has no client_id");
+
+        json early = claimsFor("alice", now + 600);
+        early["nbf"] = now + 300;
+        REQUIRE_FALSE(verifier.verify(signHs256(early, "shared-secret"), claims, error));
+        REQUIRE(error == "Token not yet valid");
+    }
+
+    SECTION("Issuer") {
+        verifier.setIssuer("jotadb");
+        json payload = claimsFor("alice", now + 600);
+        REQUIRE_FALSE(verifier.verify(signHs256(payload, "shared-secret"), claims, error));
+        payload["iss"] = "jotadb";
+        REQUIRE(verifier.verify(signHs256(payload, "shared-secret"), claims, error));
+    }
+
+    SECTION("Unsigned and unconfigured algorithms are refused") {
+        std::string unsigned_token = encodeParts({{"alg", "none"}}, claimsFor("alice", now + 600)) + ".c2ln";
+        REQUIRE_FALSE(verifier.verify(unsigned_token, claims, error));
+        REQUIRE(error == "Algorithm not accepted: none");
+
+        std::string eddsa = encodeParts({{"alg", "EdDSA"}}, claimsFor("alice", now + 600)) + ".c2ln";
+        REQUIRE_FALSE(verifier.verify(eddsa, claims, error));
+    }
+
+    SECTION("Legacy API keys are not tokens") {
+        REQUIRE_FALSE(TokenVerifier::looksLikeToken("sk_live_1234"));
+        REQUIRE_FALSE(TokenVerifier::looksLikeToken("a..b"));
+        REQUIRE_FALSE(TokenVerifier::looksLikeToken("a.b.c.d"));
+        REQUIRE_FALSE(verifier.verify("a.b.c", claims, error));
+    }
+}
+
+TEST_CASE("TokenVerifier: Strict base64url", "[auth]") {
+    std::string out;
+    REQUIRE(TokenVerifier::base64UrlDecode("-_8", out));
+    REQUIRE(out == "\xfb\xff");
+    REQUIRE(TokenVerifier::base64UrlDecode("QQ", out));
+    REQUIRE(out == "A");
+
+    REQUIRE_FALSE(TokenVerifier::base64UrlDecode("+/8", out));   // Standard alphabet
+    REQUIRE_FALSE(TokenVerifier::base64UrlDecode("QQ==", out));  // Padding
+    REQUIRE_FALSE(TokenVerifier::base64UrlDecode("QR", out));    // Non-zero unused bits
+    REQUIRE_FALSE(TokenVerifier::base64UrlDecode("QUJDR", out)); // One character left over
+}
+
+TEST_CASE("TokenVerifier: Ed25519 tokens", "[auth]") {
+    EVP_PKEY* key = nullptr;
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_ED25519, nullptr);
+    EVP_PKEY_keygen_init(ctx);
+    EVP_PKEY_keygen(ctx, &key);
+    EVP_PKEY_CTX_free(ctx);
+    REQUIRE(key != nullptr);
+
+    int64_t now = nowSeconds();
+    std::string token = signEd25519(claimsFor("carol", now + 600), key);
+    TokenVerifier verifier;
+    TokenClaims claims;
+    std::string error;
+
+    SECTION("Raw public key, base64") {
+        unsigned char raw[32];
+        size_t raw_len = sizeof(raw);
+        EVP_PKEY_get_raw_public_key(key, raw, &raw_len);
+        REQUIRE(verifier.setEd25519PublicKey(TokenVerifier::base64UrlEncode(std::string(reinterpret_cast<char*>(raw), raw_len))));
+
+        REQUIRE(verifier.verify(token, claims, error));
+        REQUIRE(claims.client_id == "carol");
+
+        // Flip a character in the middle of the signature: the last one carries padding bits
+        std::string forged = token;
+        char& c = forged[token.rfind('.') + 10];
+        c = c == 'A' ? 'B' : 'A';
+        REQUIRE_FALSE(verifier.verify(forged, claims, error));
+    }
+
+    SECTION("PEM public key") {
+        BIO* bio = BIO_new(BIO_s_mem());
+        PEM_write_bio_PUBKEY(bio, key);
+        char* data = nullptr;
+        long len = BIO_get_mem_data(bio, &data);
+        std::string pem(data, len);
+        BIO_free(bio);
+
+        REQUIRE(verifier.setEd25519PublicKey(pem));
+        REQUIRE(verifier.verify(token, claims, error));
+
+        // An HS256 token is not accepted with only a public key configured
+        REQUIRE_FALSE(verifier.verify(signHs256(claimsFor("carol", now + 600), "guess"), claims, error));
+    }
+
+    SECTION("Raw public key, standard base64 with padding") {
+        unsigned char raw[32];
+        size_t raw_len = sizeof(raw);
+        EVP_PKEY_get_raw_public_key(key, raw, &raw_len);
+        std::string text = TokenVerifier::base64UrlEncode(std::string(reinterpret_cast<char*>(raw), raw_len));
+        std::replace(text.begin(), text.end(), '-', '+');
+        std::replace(text.begin(), text.end(), '_', '/');
+        REQUIRE(verifier.setEd25519PublicKey(text + "=\n"));
+        REQUIRE(verifier.verify(token, claims, error));
+    }
+
+    SECTION("Unusable keys") {
+        REQUIRE_FALSE(verifier.setEd25519PublicKey("too-short"));
+        REQUIRE_FALSE(verifier.setEd25519PublicKey("-----BEGIN PUBLIC KEY-----\ngarbage\n-----END PUBLIC KEY-----\n"));
+        REQUIRE_FALSE(verifier.enabled());
+    }
+
+    EVP_PKEY_free(key);
+}
+
+TEST_CASE("ClientAuth: Signed tokens skip JotaDB", "[auth]") {
+    // Nothing listens here: any JotaDB request would fail
+    setenv("JOTA_DB_URL", "http://localhost:8095", 1);
+    setenv("AUTH_TOKEN_HS256_SECRET", "shared-secret", 1);
+    ClientAuth auth;
+    unsetenv("AUTH_TOKEN_HS256_SECRET");
+
+    int64_t now = nowSeconds();
+
+    SECTION("Valid token is authorized with its claims") {
+        std::string token = signHs256(claimsFor("dave", now + 600), "shared-secret");
+        REQUIRE(auth.isLocalToken(token));
+        REQUIRE(auth.check("dave", token) == AuthOutcome::TOKEN);
+        REQUIRE(auth.clientExists("dave"));
+        ClientConfig cfg = auth.getClientConfig("dave");
+        REQUIRE(cfg.max_sessions == 3);
+        REQUIRE(cfg.priority == "high");
+        REQUIRE(auth.getRttSnapshot().total == 0);
+    }
+
+    SECTION("Token issued to another client") {
+        std::string token = signHs256(claimsFor("dave", now + 600), "shared-secret");
+        REQUIRE(auth.check("erin", token) == AuthOutcome::REJECTED);
+        REQUIRE_FALSE(auth.clientExists("erin"));
+    }
+
+    SECTION("Bad tokens are refused without asking JotaDB") {
+        REQUIRE(auth.check("dave", signHs256(claimsFor("dave", now + 600), "other")) == AuthOutcome::REJECTED);
+        REQUIRE(auth.check("dave", signHs256(claimsFor("dave", now - 600), "shared-secret")) == AuthOutcome::REJECTED);
+        REQUIRE(auth.getRttSnapshot().total == 0);
+    }
+
+    SECTION("Legacy keys still go to JotaDB") {
+        REQUIRE_FALSE(auth.isLocalToken("secret123"));
+        REQUIRE(auth.check("dave", "secret123") == AuthOutcome::UNAVAILABLE);
+        REQUIRE(auth.getRttSnapshot().total == 1);
+    }
+}
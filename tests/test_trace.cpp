@@ -0,0 +1,109 @@
+#include "catch_amalgamated.hpp"
+#include "../src/core/Trace.h"
+#include <nlohmann/json.hpp>
+#include <thread>
+
+using namespace Core;
+using json = nlohmann::json;
+
+// Spans of one trace id in an export
+static std::vector<json> spansOf(const json& trace, uint64_t trace_id) {
+    std::vector<json> spans;
+    for (const auto& event : trace["traceEvents"]) {
+        if (event["ph"] == "X" && event["args"]["trace_id"] == trace_id) spans.push_back(event);
+    }
+    return spans;
+}
+
+TEST_CASE("Tracer: Sampling", "[trace]") {
+    Tracer& tracer = Tracer::instance();
+
+    SECTION("Rate 0 samples nothing") {
+        tracer.setSampleRate(0.0);
+        for (int i = 0; i < 100; i++) REQUIRE(tracer.sample() == 0);
+    }
+
+    SECTION("Rate 1 samples everything with distinct ids") {
+        tracer.setSampleRate(1.0);
+        uint64_t a = tracer.sample();
+        uint64_t b = tracer.sample();
+        REQUIRE(a != 0);
+        REQUIRE(b != 0);
+        REQUIRE(a != b);
+    }
+
+    SECTION("Fractional rates sample roughly that share") {
+        tracer.setSampleRate(0.25);
+        int sampled = 0;
+        for (int i = 0; i < 10000; i++) {
+            if (tracer.sample()) sampled++;
+        }
+        REQUIRE(sampled > 2000);
+        REQUIRE(sampled < 3000);
+    }
+
+    tracer.setSampleRate(0.0);
+}
+
+TEST_CASE("Tracer: Spans and Chrome export", "[trace]") {
+    Tracer& tracer = Tracer::instance();
+    tracer.clear();
+
+    SECTION("Spans follow the current trace id across threads") {
+        {
+            Tracer::Scope scope(42);
+            TraceSpan span("dispatch");
+        }
+        std::thread worker([&]() {
+            tracer.setThreadName("test-worker");
+            Tracer::Scope scope(42);
+            TraceSpan outer("process");
+            { TraceSpan inner("decode"); }
+        });
+        worker.join();
+
+        json trace = json::parse(tracer.exportChromeJson());
+        auto spans = spansOf(trace, 42);
+        REQUIRE(spans.size() == 3);
+        REQUIRE(spans[0]["name"] == "dispatch");
+        REQUIRE(spans[0]["tid"] != spans[1]["tid"]);
+
+        bool named = false;
+        for (const auto& event : trace["traceEvents"]) {
+            if (event["ph"] == "M" && event["args"]["name"] == "test-worker") named = true;
+        }
+        REQUIRE(named);
+    }
+
+    SECTION("Nothing is recorded without a sampled trace") {
+        { TraceSpan span("untraced"); }
+        tracer.record("untraced", 0, 0, 10);
+        json trace = json::parse(tracer.exportChromeJson());
+        for (const auto& event : trace["traceEvents"]) {
+            REQUIRE(event["name"] != "untraced");
+        }
+    }
+
+    SECTION("The ring keeps the most recent spans") {
+        for (uint64_t i = 0; i < Tracer::THREAD_CAPACITY + 10; i++) {
+            tracer.record("step", 7, (int64_t)i, 1);
+        }
+        json trace = json::parse(tracer.exportChromeJson());
+        auto spans = spansOf(trace, 7);
+        REQUIRE(spans.size() == Tracer::THREAD_CAPACITY);
+        REQUIRE(spans.front()["ts"] == 10);
+        REQUIRE(spans.back()["ts"] == Tracer::THREAD_CAPACITY + 9);
+    }
+
+    SECTION("Names are escaped and truncated") {
+        tracer.record("say \"hi\"", 9, 0, 1);
+        tracer.record("a_span_name_that_is_longer_than_the_slot", 9, 0, 1);
+        json trace = json::parse(tracer.exportChromeJson());
+        auto spans = spansOf(trace, 9);
+        REQUIRE(spans.size() == 2);
+        REQUIRE(spans[0]["name"] == "say \"hi\"");
+        REQUIRE(spans[1]["name"].get<std::string>().size() == Tracer::NAME_SIZE - 1);
+    }
+
+    tracer.clear();
+}